@@ -5,6 +5,7 @@
 #include "crn_comp.h"
 #include "crn_zeng.h"
 #include "crn_checksum.h"
+#include "crn_timer.h"
 
 #define CRNLIB_CREATE_DEBUG_IMAGES 0
 #define CRNLIB_ENABLE_DEBUG_MESSAGES 0
@@ -13,15 +14,54 @@ namespace crnlib
 {
    static const uint cEncodingMapNumChunksPerCode = 3;
 
+   // Incremental compression against a reference CRN file gives up if it adds more than this fraction to the texture's total error.
+   static const float cCRNReferenceMaxErrorIncrease = .1f;
+
    crn_comp::crn_comp() :
-      m_pParams(NULL)
+      m_pParams(NULL),
+      m_restart_interval(0),
+      m_cache_valid(false)
+   {
+      utils::zero_object(m_phase_times);
+   }
+
+   const char* crn_comp::get_phase_name(phase p)
    {
+      static const char* s_phase_names[cNumPhases] =
+      {
+         "create chunks",
+         "quantize chunks",
+         "color endpoints",
+         "color selectors",
+         "alpha endpoints",
+         "alpha selectors",
+         "pack chunks",
+         "create comp data"
+      };
+      return (p < cNumPhases) ? s_phase_names[p] : "?";
    }
 
    crn_comp::~crn_comp()
    {
    }
 
+   // Returns the two most distant colors a color endpoint can represent (for DXT1 these are simply the endpoints).
+   static void get_color_endpoint_extremes(color_quad_u8* pColors, uint endpoint, bool etc1)
+   {
+      if (etc1)
+      {
+         color_quad_u8 block_colors[cETC1SelectorValues];
+         unpack_etc1_endpoint(endpoint).get_block_colors(block_colors);
+         pColors[0] = block_colors[0];
+         pColors[1] = block_colors[cETC1SelectorValues - 1];
+      }
+      else
+      {
+         pColors[0] = dxt1_block::unpack_color((uint16)(endpoint & 0xFFFF), true);
+         pColors[1] = dxt1_block::unpack_color((uint16)((endpoint >> 16) & 0xFFFF), true);
+      }
+   }
+
    float crn_comp::color_endpoint_similarity_func(uint index_a, uint index_b, void* pContext)
    {
       dxt_hc& hvq = *static_cast<dxt_hc*>(pContext);
@@ -29,13 +69,13 @@ namespace crnlib
       uint endpoint_a = hvq.get_color_endpoint(index_a);
       uint endpoint_b = hvq.get_color_endpoint(index_b);
 
+      const bool etc1 = hvq.get_format() == cETC1;
+
       color_quad_u8 a[2];
-      a[0] = dxt1_block::unpack_color((uint16)(endpoint_a & 0xFFFF), true);
-      a[1] = dxt1_block::unpack_color((uint16)((endpoint_a >> 16) & 0xFFFF), true);
+      get_color_endpoint_extremes(a, endpoint_a, etc1);
 
       color_quad_u8 b[2];
-      b[0] = dxt1_block::unpack_color((uint16)(endpoint_b & 0xFFFF), true);
-      b[1] = dxt1_block::unpack_color((uint16)((endpoint_b >> 16) & 0xFFFF), true);
+      get_color_endpoint_extremes(b, endpoint_b, etc1);
 
       uint total_error = color::elucidian_distance(a[0], b[0], false) + color::elucidian_distance(a[1], b[1], false);
 
@@ -65,13 +105,18 @@ namespace crnlib
    {
       remapping.resize(endpoints.size());
 
+      const bool etc1 = m_hvq.get_format() == cETC1;
+
       uint lowest_energy = UINT_MAX;
       uint lowest_energy_index = 0;
 
       for (uint i = 0; i < endpoints.size(); i++)
       {
-         color_quad_u8 a(dxt1_block::unpack_color(static_cast<uint16>(endpoints[i] & 0xFFFF), true));
-         color_quad_u8 b(dxt1_block::unpack_color(static_cast<uint16>((endpoints[i] >> 16) & 0xFFFF), true));
+         color_quad_u8 e[2];
+         get_color_endpoint_extremes(e, endpoints[i], etc1);
+
+         const color_quad_u8& a = e[0];
+         const color_quad_u8& b = e[1];
 
          uint total = a.r + a.g + a.b + b.r + b.g + b.b;
 
@@ -99,18 +144,18 @@ namespace crnlib
          uint lowest_error = UINT_MAX;
          uint lowest_error_index = 0;
 
-         color_quad_u8 a(dxt1_block::unpack_endpoint(endpoints[cur_index], 0, true));
-         color_quad_u8 b(dxt1_block::unpack_endpoint(endpoints[cur_index], 1, true));
+         color_quad_u8 a[2];
+         get_color_endpoint_extremes(a, endpoints[cur_index], etc1);
 
          for (uint i = 0; i < endpoints.size(); i++)
          {
             if (chosen_flags[i])
                continue;
 
-            color_quad_u8 c(dxt1_block::unpack_endpoint(endpoints[i], 0, true));
-            color_quad_u8 d(dxt1_block::unpack_endpoint(endpoints[i], 1, true));
+            color_quad_u8 b[2];
+            get_color_endpoint_extremes(b, endpoints[i], etc1);
 
-            uint total = color::elucidian_distance(a, c, false) + color::elucidian_distance(b, d, false);
+            uint total = color::elucidian_distance(a[0], b[0], false) + color::elucidian_distance(a[1], b[1], false);
 
             if (total < lowest_error)
             {
@@ -206,6 +251,10 @@ namespace crnlib
 
       const uint component_limits[6] = { 31, 63, 31,  31, 63, 31 };
 
+      // ETC1 endpoints are sent as 5-bit R, G, B deltas (table 0) followed by a 3-bit intensity table delta (table 1).
+      const bool etc1 = m_hvq.get_format() == cETC1;
+      const uint syms_per_endpoint = etc1 ? 4 : 6;
+
       symbol_histogram hist[2];
       hist[0].resize(32);
       hist[1].resize(64);
@@ -216,7 +265,7 @@ namespace crnlib
 #endif
 
       crnlib::vector<uint> residual_syms;
-      residual_syms.reserve(m_hvq.get_color_endpoint_codebook_size()*2*3);
+      residual_syms.reserve(m_hvq.get_color_endpoint_codebook_size()*syms_per_endpoint);
 
       color_quad_u8 prev[2];
       prev[0].clear();
@@ -228,6 +277,27 @@ namespace crnlib
       {
          const uint endpoint = remapped_endpoints[endpoint_index];
 
+         if (etc1)
+         {
+            const etc1_solution_coordinates coords(unpack_etc1_endpoint(endpoint));
+            const etc1_solution_coordinates prev_coords(unpack_etc1_endpoint(endpoint_index ? remapped_endpoints[endpoint_index - 1] : 0));
+
+            for (uint k = 0; k < 4; k++)
+            {
+               const int delta = (k < 3) ? (coords.m_unscaled_color[k] - prev_coords.m_unscaled_color[k]) : (static_cast<int>(coords.m_inten_table) - static_cast<int>(prev_coords.m_inten_table));
+               total_residuals += delta*delta;
+
+               const int sym = delta & ((k < 3) ? 31 : 7);
+               const int table = (k == 3) ? 1 : 0;
+
+               hist[table].inc_freq(sym);
+
+               residual_syms.push_back(sym);
+            }
+
+            continue;
+         }
+
          color_quad_u8 cur[2];
          cur[0] = dxt1_block::unpack_color((uint16)(endpoint & 0xFFFF), false);
          cur[1] = dxt1_block::unpack_color((uint16)((endpoint >> 16) & 0xFFFF), false);
@@ -315,7 +385,7 @@ namespace crnlib
       for (uint i = 0; i < residual_syms.size(); i++)
       {
          const uint sym = residual_syms[i];
-         const uint table = ((i % 3) == 1) ? 1 : 0;
+         const uint table = etc1 ? (((i % syms_per_endpoint) == 3) ? 1 : 0) : (((i % 3) == 1) ? 1 : 0);
          codec.encode(sym, residual_dm[table]);
       }
 
@@ -744,8 +814,15 @@ namespace crnlib
       const crnlib::vector<uint>* pColor_endpoint_remap,
       const crnlib::vector<uint>* pColor_selector_remap,
       const crnlib::vector<uint>* pAlpha_endpoint_remap,
-      const crnlib::vector<uint>* pAlpha_selector_remap)
+      const crnlib::vector<uint>* pAlpha_selector_remap,
+      uint chunks_per_row, restart_point_vec* pRestart_points)
    {
+      if (pRestart_points)
+      {
+         CRNLIB_ASSERT(pCodec && chunks_per_row);
+         pRestart_points->resize(0);
+      }
+
       if (!pCodec)
       {
          m_chunk_encoding_hist.resize(1 << (3 * cEncodingMapNumChunksPerCode));
@@ -792,9 +869,20 @@ namespace crnlib
       utils::zero_object(prev_selector_index);
 
       uint num_encodings_left = 0;
+      uint cur_encoding_index = 0;
 
       for (uint chunk_index = first_chunk; chunk_index < (first_chunk + num_chunks); chunk_index++)
       {
+         if ((pRestart_points) && (((chunk_index - first_chunk) % chunks_per_row) == 0))
+         {
+            // Record the decoder's state at the start of this chunk row: the not yet consumed chunk encodings (with a stop bit above them), and the previous indices.
+            restart_point& r = *pRestart_points->enlarge(1);
+            r.m_bit_ofs = pCodec->encode_get_total_bits_written();
+            r.m_chunk_encoding_bits = num_encodings_left ? ((cur_encoding_index >> (3 * (cEncodingMapNumChunksPerCode - num_encodings_left))) | (1 << (3 * num_encodings_left))) : 1;
+            memcpy(r.m_prev_endpoint_index, prev_endpoint_index, sizeof(prev_endpoint_index));
+            memcpy(r.m_prev_selector_index, prev_selector_index, sizeof(prev_selector_index));
+         }
+
          if (!num_encodings_left)
          {
             uint index = 0;
@@ -802,6 +890,8 @@ namespace crnlib
                if ((chunk_index + i) < (first_chunk + num_chunks))
                   index |= (m_hvq.get_chunk_encoding(chunk_index + i).m_encoding_index << (i * 3));
 
+            cur_encoding_index = index;
+
             if (pCodec)
                pCodec->encode(index, m_chunk_encoding_dm);
             else
@@ -1162,7 +1252,8 @@ namespace crnlib
 
    void crn_comp::clear()
    {
-      m_pParams = NULL;
+      m_cache_valid = false;
+      m_chunk_analysis.clear();
 
       for (uint f = 0; f < cCRNMaxFaces; f++)
          for (uint l = 0; l < cCRNMaxLevels; l++)
@@ -1172,6 +1263,18 @@ namespace crnlib
 
       m_mip_groups.clear();
 
+      m_total_chunks = 0;
+
+      m_chunks.clear();
+
+      clear_pass();
+   }
+
+   // Clears everything that depends on the quality level.
+   void crn_comp::clear_pass()
+   {
+      m_pParams = NULL;
+
       utils::zero_object(m_has_comp);
 
       m_chunk_details.clear();
@@ -1182,10 +1285,6 @@ namespace crnlib
          m_selector_indices[i].clear();
       }
 
-      m_total_chunks = 0;
-
-      m_chunks.clear();
-
       utils::zero_object(m_crn_header);
 
       m_comp_data.clear();
@@ -1203,7 +1302,11 @@ namespace crnlib
       }
 
       for (uint i = 0; i < cCRNMaxLevels; i++)
+      {
          m_packed_chunks[i].clear();
+         m_restart_points[i].clear();
+      }
+      m_restart_interval = 0;
 
       m_packed_data_models.clear();
 
@@ -1211,6 +1314,8 @@ namespace crnlib
       m_packed_color_selectors.clear();
       m_packed_alpha_endpoints.clear();
       m_packed_alpha_selectors.clear();
+
+      utils::zero_object(m_phase_times);
    }
 
    bool crn_comp::quantize_chunks()
@@ -1344,8 +1449,9 @@ namespace crnlib
          }
          case cCRNFmtETC1:
          {
-            console::warning("crn_comp::quantize_chunks: This class does not support ETC1");
-            return false;
+            params.m_format = cETC1;
+            m_has_comp[cColor] = true;
+            break;
          }
          default:
          {
@@ -1361,7 +1467,10 @@ namespace crnlib
          params.m_levels[i].m_num_chunks = m_levels[i].m_num_chunks;
       }
 
-      if (!m_hvq.compress(params, m_total_chunks, &m_chunks[0], m_task_pool))
+      if ((m_pParams->m_pCRN_reference) && (quantize_chunks_incremental(params)))
+         return true;
+
+      if (!m_hvq.compress(params, m_total_chunks, &m_chunks[0], m_task_pool, &m_chunk_analysis))
          return false;
 
 #if CRNLIB_CREATE_DEBUG_IMAGES
@@ -1913,32 +2022,93 @@ namespace crnlib
       return true;
    }
 
-   bool crn_comp::pack_data_models()
+   bool crn_comp::pack_restart_points(symbol_codec& codec, uint interval)
    {
-      symbol_codec codec;
-      codec.start_encoding(1024*1024);
+      codec.encode_bits(interval, crnd::cCRNRestartIntervalBits);
 
-      if (!codec.encode_transmit_static_huffman_data_model(m_chunk_encoding_dm, false))
-         return false;
+      const uint comp_order[3] = { cAlpha0, cAlpha1, cColor };
 
-      for (uint i = 0; i < 2; i++)
+      for (uint level = 0; level < m_mip_groups.size(); level++)
       {
-         if (m_endpoint_index_dm[i].get_total_syms())
+         const restart_point_vec& points = m_restart_points[level];
+         const uint chunk_height = m_levels[level].m_chunk_height;
+         if (points.size() != chunk_height * m_pParams->m_faces)
+            return false;
+
+         for (uint face = 0; face < m_pParams->m_faces; face++)
          {
-            if (!codec.encode_transmit_static_huffman_data_model(m_endpoint_index_dm[i], false))
-               return false;
+            for (uint y = 0; y < chunk_height; y += interval)
+            {
+               const restart_point& r = points[face * chunk_height + y];
+
+               codec.encode_bits(r.m_bit_ofs, crnd::cCRNRestartBitOfsBits);
+               codec.encode_bits(r.m_chunk_encoding_bits, crnd::cCRNRestartChunkEncodingBits);
+
+               for (uint c = 0; c < 3; c++)
+               {
+                  const uint comp_index = comp_order[c];
+                  if (!m_has_comp[comp_index])
+                     continue;
+
+                  codec.encode_bits(r.m_prev_endpoint_index[comp_index], crnd::cCRNRestartIndexBits);
+                  codec.encode_bits(r.m_prev_selector_index[comp_index], crnd::cCRNRestartIndexBits);
+               }
+            }
          }
+      }
 
-         if (m_selector_index_dm[i].get_total_syms())
+      return true;
+   }
+
+   bool crn_comp::pack_data_models()
+   {
+      uint restart_interval = m_pParams->m_crn_restart_interval;
+
+      for ( ; ; )
+      {
+         symbol_codec codec;
+         codec.start_encoding(1024*1024);
+
+         if (!codec.encode_transmit_static_huffman_data_model(m_chunk_encoding_dm, false))
+            return false;
+
+         for (uint i = 0; i < 2; i++)
+         {
+            if (m_endpoint_index_dm[i].get_total_syms())
+            {
+               if (!codec.encode_transmit_static_huffman_data_model(m_endpoint_index_dm[i], false))
+                  return false;
+            }
+
+            if (m_selector_index_dm[i].get_total_syms())
+            {
+               if (!codec.encode_transmit_static_huffman_data_model(m_selector_index_dm[i], false))
+                  return false;
+            }
+         }
+
+         if (restart_interval)
          {
-            if (!codec.encode_transmit_static_huffman_data_model(m_selector_index_dm[i], false))
+            if (!pack_restart_points(codec, restart_interval))
                return false;
          }
-      }
 
-      codec.stop_encoding(false);
+         codec.stop_encoding(false);
 
-      m_packed_data_models.swap(codec.get_encoding_buf());
+         // The tables section's size is limited to 16 bits, so space the restart points out further until they fit.
+         if ((restart_interval) && (codec.get_encoding_buf().size() > cUINT16_MAX))
+         {
+            restart_interval *= 2;
+            if (restart_interval > cCRNMaxRestartInterval)
+               restart_interval = 0;
+            continue;
+         }
+
+         m_packed_data_models.swap(codec.get_encoding_buf());
+         break;
+      }
+
+      m_restart_interval = restart_interval;
 
       return true;
    }
@@ -1954,6 +2124,8 @@ namespace crnlib
       m_crn_header.m_format = static_cast<uint8>(m_pParams->m_format);
       m_crn_header.m_userdata0 = m_pParams->m_userdata0;
       m_crn_header.m_userdata1 = m_pParams->m_userdata1;
+      if (m_restart_interval)
+         m_crn_header.m_flags = crnd::cCRNHeaderFlagRestartPoints;
 
       m_comp_data.clear();
       m_comp_data.reserve(2*1024*1024);
@@ -2025,6 +2197,163 @@ namespace crnlib
       return true;
    }
 
+   // Quantizes the chunks against the palettes of m_pParams->m_pCRN_reference, starting from the way that file encoded them.
+   // Returns false if the reference can't be used, in which case the chunks must be quantized from scratch.
+   bool crn_comp::quantize_chunks_incremental(const dxt_hc::params& params)
+   {
+      const void* pRef = m_pParams->m_pCRN_reference;
+      const uint ref_size = m_pParams->m_crn_reference_size;
+
+      crnd::crn_texture_info tex_info;
+      if (!crnd::crnd_get_texture_info(pRef, ref_size, &tex_info))
+      {
+         console::warning("Reference CRN file is invalid, compressing from scratch");
+         return false;
+      }
+
+      if ((tex_info.m_width != m_pParams->m_width) || (tex_info.m_height != m_pParams->m_height) || (tex_info.m_levels != m_pParams->m_levels) ||
+          (tex_info.m_faces != m_pParams->m_faces) || (tex_info.m_format != m_pParams->m_format))
+      {
+         console::info("Reference CRN file's dimensions or format differ, compressing from scratch");
+         return false;
+      }
+
+      if (params.m_format == cETC1)
+      {
+         console::info("Incremental compression doesn't support ETC1, compressing from scratch");
+         return false;
+      }
+
+      crnd::crnd_unpack_context pContext = crnd::crnd_unpack_begin(pRef, ref_size);
+      if (!pContext)
+      {
+         console::warning("Reference CRN file is invalid, compressing from scratch");
+         return false;
+      }
+
+      dxt_hc::codebooks cb;
+
+      crnd::crn_unpacked_palettes palettes;
+      if (!crnd::crnd_get_palettes(pContext, &palettes))
+      {
+         crnd::crnd_unpack_end(pContext);
+         return false;
+      }
+
+      cb.m_color_endpoints.resize(palettes.m_num_color_endpoints);
+      for (uint i = 0; i < palettes.m_num_color_endpoints; i++)
+         cb.m_color_endpoints[i] = palettes.m_pColor_endpoints[i];
+
+      cb.m_color_selectors.resize(palettes.m_num_color_selectors);
+      for (uint i = 0; i < palettes.m_num_color_selectors; i++)
+         for (uint p = 0; p < cDXTBlockSize * cDXTBlockSize; p++)
+            cb.m_color_selectors[i].set_by_index(p, (palettes.m_pColor_selectors[i] >> (p * cDXT1SelectorBits)) & cDXT1SelectorMask);
+
+      cb.m_alpha_endpoints.resize(palettes.m_num_alpha_endpoints);
+      for (uint i = 0; i < palettes.m_num_alpha_endpoints; i++)
+         cb.m_alpha_endpoints[i] = palettes.m_pAlpha_endpoints[i];
+
+      cb.m_alpha_selectors.resize(palettes.m_num_alpha_selectors);
+      for (uint i = 0; i < palettes.m_num_alpha_selectors; i++)
+      {
+         const uint16* pSrc = &palettes.m_pAlpha_selectors[i * 3];
+         const uint64 bits = pSrc[0] | (static_cast<uint64>(pSrc[1]) << 16U) | (static_cast<uint64>(pSrc[2]) << 32U);
+         for (uint p = 0; p < cDXTBlockSize * cDXTBlockSize; p++)
+            cb.m_alpha_selectors[i].set_by_index(p, static_cast<uint>(bits >> (p * cDXT5SelectorBits)) & cDXT5SelectorMask);
+      }
+
+      // The index of each block's endpoints and selectors in the reference, recast as chunk encodings.
+      dxt_hc::chunk_encoding_vec prev_encodings(m_total_chunks);
+
+      const uint bytes_per_block = crnd::crnd_get_bytes_per_dxt_block(m_pParams->m_format);
+      const bool has_color = params.m_format != cDXT5A && params.m_format != cDXN_XY && params.m_format != cDXN_YX;
+      const uint num_alpha_blocks = (params.m_format == cDXT1) ? 0 : ((params.m_format == cDXN_XY) || (params.m_format == cDXN_YX)) ? 2 : 1;
+
+      crnlib::vector<uint8> face_indices[cCRNMaxFaces];
+      bool status = true;
+
+      for (uint level = 0; (level < m_pParams->m_levels) && (status); level++)
+      {
+         const uint width = math::maximum(1U, m_pParams->m_width >> level);
+         const uint height = math::maximum(1U, m_pParams->m_height >> level);
+         const uint blocks_x = (width + 3) >> 2, blocks_y = (height + 3) >> 2;
+         const uint row_pitch = blocks_x * bytes_per_block;
+
+         void* pFaces[cCRNMaxFaces];
+         for (uint face = 0; face < m_pParams->m_faces; face++)
+         {
+            face_indices[face].resize(row_pitch * blocks_y);
+            pFaces[face] = face_indices[face].get_ptr();
+         }
+
+         if (!crnd::crnd_unpack_level_indices(pContext, pFaces, row_pitch * blocks_y, row_pitch, level))
+         {
+            status = false;
+            break;
+         }
+
+         const level_tag& lev = m_levels[level];
+
+         for (uint face = 0; face < m_pParams->m_faces; face++)
+         {
+            for (uint cy = 0; cy < lev.m_chunk_height; cy++)
+            {
+               for (uint cx = 0; cx < lev.m_chunk_width; cx++)
+               {
+                  const uint serpentine_x = (cy & 1) ? (lev.m_chunk_width - 1 - cx) : cx;
+                  dxt_hc::chunk_encoding& encoding = prev_encodings[lev.m_first_chunk + face * lev.m_chunk_width * lev.m_chunk_height + cy * lev.m_chunk_width + serpentine_x];
+
+                  uint16 block_endpoint_indices[3][cChunkBlockHeight][cChunkBlockWidth];
+                  utils::zero_object(block_endpoint_indices);
+
+                  for (uint by = 0; by < cChunkBlockHeight; by++)
+                  {
+                     for (uint bx = 0; bx < cChunkBlockWidth; bx++)
+                     {
+                        // Blocks past the edge of the level get the edge's indices, as create_chunks() gives them the edge's pixels.
+                        const uint block_x = math::minimum(cx * cChunkBlockWidth + bx, blocks_x - 1);
+                        const uint block_y = math::minimum(cy * cChunkBlockHeight + by, blocks_y - 1);
+                        const uint8* pBlock = &face_indices[face][block_y * row_pitch + block_x * bytes_per_block];
+
+                        for (uint a = 0; a < num_alpha_blocks; a++)
+                        {
+                           const uint16* pAlpha = reinterpret_cast<const uint16*>(pBlock + a * 8);
+                           block_endpoint_indices[cAlpha0 + a][by][bx] = pAlpha[0];
+                           encoding.m_selector_indices[cAlpha0 + a][by][bx] = pAlpha[1];
+                        }
+
+                        if (has_color)
+                        {
+                           const uint32* pColor = reinterpret_cast<const uint32*>(pBlock + num_alpha_blocks * 8);
+                           block_endpoint_indices[cColor][by][bx] = static_cast<uint16>(pColor[0]);
+                           encoding.m_selector_indices[cColor][by][bx] = static_cast<uint16>(pColor[1]);
+                        }
+                     }
+                  }
+
+                  dxt_hc::set_chunk_encoding_tiles(encoding, block_endpoint_indices, true);
+               }
+            }
+         }
+      }
+
+      crnd::crnd_unpack_end(pContext);
+
+      if (!status)
+      {
+         console::warning("Unable to unpack reference CRN file, compressing from scratch");
+         return false;
+      }
+
+      if (!m_hvq.compress_incremental(params, m_total_chunks, &m_chunks[0], cb, prev_encodings, cCRNReferenceMaxErrorIncrease, m_task_pool))
+      {
+         console::info("Reference CRN file's palettes don't fit the texture anymore, compressing from scratch");
+         return false;
+      }
+
+      return true;
+   }
+
    bool crn_comp::update_progress(uint phase_index, uint subphase_index, uint subphase_total)
    {
       if (!m_pParams->m_pProgress_func)
@@ -2040,35 +2369,58 @@ namespace crnlib
 
    bool crn_comp::compress_internal()
    {
-      if (!alias_images())
-         return false;
+      timer tm;
+      tm.start();
 
-      create_chunks();
+      if (!m_cache_valid)
+      {
+         if (!alias_images())
+            return false;
+
+         create_chunks();
+      }
+
+      m_phase_times[cPhaseCreateChunks] = tm.get_elapsed_secs();
+      tm.start();
 
       if (!quantize_chunks())
          return false;
 
       create_chunk_indices();
 
+      m_phase_times[cPhaseQuantizeChunks] = tm.get_elapsed_secs();
+
       crnlib::vector<uint> endpoint_remap[2];
       crnlib::vector<uint> selector_remap[2];
 
       if (m_has_comp[cColor])
       {
+         tm.start();
          if (!optimize_color_endpoint_codebook(endpoint_remap[0]))
             return false;
+         m_phase_times[cPhaseColorEndpoints] = tm.get_elapsed_secs();
+
+         tm.start();
          if (!optimize_color_selector_codebook(selector_remap[0]))
             return false;
+         m_phase_times[cPhaseColorSelectors] = tm.get_elapsed_secs();
       }
 
       if (m_has_comp[cAlpha0])
       {
+         tm.start();
          if (!optimize_alpha_endpoint_codebook(endpoint_remap[1]))
             return false;
+         m_phase_times[cPhaseAlphaEndpoints] = tm.get_elapsed_secs();
+
+         tm.start();
          if (!optimize_alpha_selector_codebook(selector_remap[1]))
             return false;
+         m_phase_times[cPhaseAlphaSelectors] = tm.get_elapsed_secs();
       }
 
+      tm.start();
+
       m_chunk_encoding_hist.clear();
       for (uint i = 0; i < 2; i++)
       {
@@ -2089,7 +2441,8 @@ namespace crnlib
                m_mip_groups[mip_group].m_first_chunk, m_mip_groups[mip_group].m_num_chunks,
                !pass && !mip_group, pass ? &codec : NULL,
                m_has_comp[cColor] ? &endpoint_remap[0] : NULL, m_has_comp[cColor] ? &selector_remap[0] : NULL,
-               m_has_comp[cAlpha0] ? &endpoint_remap[1] : NULL, m_has_comp[cAlpha0] ? &selector_remap[1] : NULL))
+               m_has_comp[cAlpha0] ? &endpoint_remap[1] : NULL, m_has_comp[cAlpha0] ? &selector_remap[1] : NULL,
+               m_levels[mip_group].m_chunk_width, (pass && m_pParams->m_crn_restart_interval) ? &m_restart_points[mip_group] : NULL))
             {
                return false;
             }
@@ -2115,12 +2468,17 @@ namespace crnlib
          }
       }
 
+      m_phase_times[cPhasePackChunks] = tm.get_elapsed_secs();
+      tm.start();
+
       if (!pack_data_models())
          return false;
 
       if (!create_comp_data())
          return false;
 
+      m_phase_times[cPhaseCreateCompData] = tm.get_elapsed_secs();
+
       if (!update_progress(24, 1, 1))
          return false;
 
@@ -2132,15 +2490,44 @@ namespace crnlib
       return true;
    }
 
+   // Returns true if the cached images, chunks and chunk analysis created with cache_params may be used to compress with params.
+   bool crn_comp::can_reuse_cache(const crn_comp_params& cache_params, const crn_comp_params& params)
+   {
+      const uint32 cPassOnlyFlags = cCRNCompFlagManualPaletteSizes | cCRNCompFlagParallelBitrateSearch;
+
+      crn_comp_params p(params);
+      p.m_flags = (params.m_flags & ~cPassOnlyFlags) | (cache_params.m_flags & cPassOnlyFlags);
+      p.m_target_bitrate = cache_params.m_target_bitrate;
+      p.m_quality_level = cache_params.m_quality_level;
+      p.m_crn_color_endpoint_palette_size = cache_params.m_crn_color_endpoint_palette_size;
+      p.m_crn_color_selector_palette_size = cache_params.m_crn_color_selector_palette_size;
+      p.m_crn_alpha_endpoint_palette_size = cache_params.m_crn_alpha_endpoint_palette_size;
+      p.m_crn_alpha_selector_palette_size = cache_params.m_crn_alpha_selector_palette_size;
+      p.m_crn_restart_interval = cache_params.m_crn_restart_interval;
+      p.m_lzma_level = cache_params.m_lzma_level;
+      p.m_lzma_dict_size = cache_params.m_lzma_dict_size;
+      p.m_num_helper_threads = cache_params.m_num_helper_threads;
+      p.m_userdata0 = cache_params.m_userdata0;
+      p.m_userdata1 = cache_params.m_userdata1;
+      p.m_pProgress_func = cache_params.m_pProgress_func;
+      p.m_pProgress_func_data = cache_params.m_pProgress_func_data;
+
+      return p == cache_params;
+   }
+
    bool crn_comp::compress_init(const crn_comp_params& params)
    {
       params;
+      clear();
       return true;
    }
 
    bool crn_comp::compress_pass(const crn_comp_params& params, float *pEffective_bitrate)
    {
-      clear();
+      if ((m_cache_valid) && (can_reuse_cache(m_cache_params, params)))
+         clear_pass();
+      else
+         clear();
 
       if (pEffective_bitrate) *pEffective_bitrate = 0.0f;
 
@@ -2149,13 +2536,21 @@ namespace crnlib
       if ((math::minimum(m_pParams->m_width, m_pParams->m_height) < 1) || (math::maximum(m_pParams->m_width, m_pParams->m_height) > cCRNMaxLevelResolution))
          return false;
 
-      if (!m_task_pool.init(params.m_num_helper_threads))
+      if (!m_task_pool.init(get_num_helper_threads(params)))
          return false;
 
       bool status = compress_internal();
 
       m_task_pool.deinit();
 
+      if (status)
+      {
+         m_cache_valid = true;
+         m_cache_params = params;
+      }
+      else
+         clear();
+
       if ((status) && (pEffective_bitrate))
       {
          uint total_pixels = 0;
@@ -2172,6 +2567,7 @@ namespace crnlib
 
    void crn_comp::compress_deinit()
    {
+      clear();
    }
 
 } // namespace crnlib
@@ -25,6 +25,8 @@ namespace crnlib
 
       virtual const char *get_ext() const { return "CRN"; }
 
+      // The images, chunks and first stage of chunk quantization are kept between compress_pass() calls, and reused if the params only differ
+      // in the quality level, palette sizes, or other settings that don't affect them. The source images must not change until compress_deinit().
       virtual bool compress_init(const crn_comp_params& params);
       virtual bool compress_pass(const crn_comp_params& params, float *pEffective_bitrate);
       virtual void compress_deinit();
@@ -35,6 +37,29 @@ namespace crnlib
       uint get_comp_data_size() const { return m_comp_data.size(); }
       const uint8* get_comp_data_ptr() const { return m_comp_data.size() ? &m_comp_data[0] : NULL; }
 
+      // The phases of compress_pass(), in the order they run.
+      enum phase
+      {
+         cPhaseCreateChunks,
+         cPhaseQuantizeChunks,
+         cPhaseColorEndpoints,
+         cPhaseColorSelectors,
+         cPhaseAlphaEndpoints,
+         cPhaseAlphaSelectors,
+         cPhasePackChunks,
+         cPhaseCreateCompData,
+
+         cNumPhases
+      };
+
+      static const char* get_phase_name(phase p);
+
+      // Wall clock time spent in each phase by the last compress_pass(), in seconds.
+      double get_phase_time(phase p) const { return m_phase_times[p]; }
+
+      // Breakdown of the last compress_pass()'s cPhaseQuantizeChunks phase.
+      const dxt_hc::phase_stats_vec& get_quantize_phase_stats() const { return m_hvq.get_phase_stats(); }
+
    private:
       task_pool                  m_task_pool;
       const crn_comp_params* m_pParams;
@@ -101,13 +126,35 @@ namespace crnlib
       static_huffman_data_model     m_selector_index_dm[2]; // color, alpha
 
       crnlib::vector<uint8>         m_packed_chunks[cCRNMaxLevels];
+
+      // Decoder state at the start of each chunk row of a level's stream, indexed by face * chunk_height + chunk_y.
+      struct restart_point
+      {
+         uint m_bit_ofs;
+         uint m_chunk_encoding_bits;
+         uint m_prev_endpoint_index[cNumComps];
+         uint m_prev_selector_index[cNumComps];
+      };
+      typedef crnlib::vector<restart_point> restart_point_vec;
+      restart_point_vec             m_restart_points[cCRNMaxLevels];
+      uint                          m_restart_interval;
+
       crnlib::vector<uint8>         m_packed_data_models;
       crnlib::vector<uint8>         m_packed_color_endpoints;
       crnlib::vector<uint8>         m_packed_color_selectors;
       crnlib::vector<uint8>         m_packed_alpha_endpoints;
       crnlib::vector<uint8>         m_packed_alpha_selectors;
 
+      double                        m_phase_times[cNumPhases];
+
+      // True if m_images, m_levels, m_mip_groups, m_chunks and m_chunk_analysis were created by a previous pass with m_cache_params.
+      bool                          m_cache_valid;
+      crn_comp_params               m_cache_params;
+      dxt_hc::chunk_analysis        m_chunk_analysis;
+
       void clear();
+      void clear_pass();
+      static bool can_reuse_cache(const crn_comp_params& cache_params, const crn_comp_params& params);
 
       void append_chunks(const image_u8& img, uint num_chunks_x, uint num_chunks_y, dxt_hc::pixel_chunk_vec& chunks, float weight);
 
@@ -135,6 +182,7 @@ namespace crnlib
       bool alias_images();
       void create_chunks();
       bool quantize_chunks();
+      bool quantize_chunks_incremental(const dxt_hc::params& params);
       void create_chunk_indices();
 
       bool pack_chunks(
@@ -144,7 +192,10 @@ namespace crnlib
          const crnlib::vector<uint>* pColor_endpoint_remap,
          const crnlib::vector<uint>* pColor_selector_remap,
          const crnlib::vector<uint>* pAlpha_endpoint_remap,
-         const crnlib::vector<uint>* pAlpha_selector_remap);
+         const crnlib::vector<uint>* pAlpha_selector_remap,
+         uint chunks_per_row = 0, restart_point_vec* pRestart_points = NULL);
+
+      bool pack_restart_points(symbol_codec& codec, uint interval);
 
       bool pack_chunks_simulation(
          uint first_chunk, uint num_chunks,
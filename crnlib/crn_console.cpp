@@ -16,6 +16,7 @@ namespace crnlib
    mutex*                                    console::m_pMutex;
    uint                                      console::m_num_messages[cCMTTotal];
    bool                                      console::m_at_beginning_of_line = true;
+   crnlib::vector<console::thread_capture>   console::m_captures;
 
    const uint cConsoleBufSize = 4096;
 
@@ -40,14 +41,92 @@ namespace crnlib
    {
       init();
 
-      m_crlf = false;
+      scoped_mutex lock(*m_pMutex);
+
+      console_capture* pCapture = find_capture();
+      if (pCapture)
+         pCapture->m_crlf = false;
+      else
+         m_crlf = false;
    }
 
    void console::enable_crlf()
    {
       init();
 
-      m_crlf = true;
+      scoped_mutex lock(*m_pMutex);
+
+      console_capture* pCapture = find_capture();
+      if (pCapture)
+         pCapture->m_crlf = true;
+      else
+         m_crlf = true;
+   }
+
+   void console::begin_capture(console_capture& capture)
+   {
+      init();
+
+      scoped_mutex lock(*m_pMutex);
+
+      CRNLIB_ASSERT(!find_capture());
+
+      capture.m_crlf = true;
+
+      thread_capture* p = m_captures.enlarge(1);
+      p->m_thread_id = crn_get_current_thread_id();
+      p->m_pCapture = &capture;
+   }
+
+   void console::end_capture()
+   {
+      init();
+
+      scoped_mutex lock(*m_pMutex);
+
+      const uint64 thread_id = crn_get_current_thread_id();
+      for (uint i = 0; i < m_captures.size(); i++)
+      {
+         if (m_captures[i].m_thread_id == thread_id)
+         {
+            m_captures.erase_unordered(i);
+            break;
+         }
+      }
+   }
+
+   // m_pMutex must be locked.
+   console_capture* console::find_capture()
+   {
+      if (m_captures.empty())
+         return NULL;
+
+      const uint64 thread_id = crn_get_current_thread_id();
+      for (uint i = 0; i < m_captures.size(); i++)
+         if (m_captures[i].m_thread_id == thread_id)
+            return m_captures[i].m_pCapture;
+
+      return NULL;
+   }
+
+   void console_capture::replay()
+   {
+      console::init();
+
+      scoped_mutex lock(*console::m_pMutex);
+
+      // The output funcs look at get_crlf(), so the setting each message was printed with is swapped in while it's output.
+      const bool crlf = console::m_crlf;
+
+      for (uint i = 0; i < m_messages.size(); i++)
+      {
+         console::m_crlf = m_messages[i].m_crlf;
+         console::output(m_messages[i].m_type, m_messages[i].m_text.get_ptr());
+      }
+
+      console::m_crlf = crlf;
+
+      m_messages.clear();
    }
 
    void console::vprintf(eConsoleMessageType type, const char* p, va_list args)
@@ -61,6 +140,25 @@ namespace crnlib
       char buf[cConsoleBufSize];
       vsprintf_s(buf, cConsoleBufSize, p, args);
 
+      console_capture* pCapture = find_capture();
+      if (pCapture)
+      {
+         if (type != cProgressConsoleMessage)
+         {
+            console_capture::message* pMsg = pCapture->m_messages.enlarge(1);
+            pMsg->m_type = type;
+            pMsg->m_crlf = pCapture->m_crlf;
+            pMsg->m_text = buf;
+         }
+         return;
+      }
+
+      output(type, buf);
+   }
+
+   // m_pMutex must be locked.
+   void console::output(eConsoleMessageType type, const char* buf)
+   {
       bool handled = false;
 
       if (m_output_funcs.size())
@@ -28,6 +28,32 @@ namespace crnlib
 
    typedef bool (*console_output_func)(eConsoleMessageType type, const char* pMsg, void* pData);
 
+   // Holds the output of a thread that called console::begin_capture().
+   class console_capture
+   {
+   public:
+      console_capture() : m_crlf(true) { }
+
+      bool is_empty() const { return m_messages.empty(); }
+      void clear() { m_messages.clear(); }
+
+      // Prints (and logs) the captured messages as if they had been printed just now, then clears them.
+      void replay();
+
+   private:
+      friend class console;
+
+      struct message
+      {
+         eConsoleMessageType m_type;
+         bool m_crlf;
+         dynamic_string m_text;
+      };
+
+      crnlib::vector<message> m_messages;
+      bool m_crlf;
+   };
+
    class console
    {
    public:
@@ -55,6 +81,12 @@ namespace crnlib
       static void warning(const char* p, ...);
       static void error(const char* p, ...);
 
+      // Stores everything the calling thread prints in capture, rather than printing it, until end_capture() is called.
+      // This lets several threads each produce a block of output that's printed as a whole later on. While capturing,
+      // disable_crlf()/enable_crlf() only affect the calling thread, and progress messages are dropped.
+      static void begin_capture(console_capture& capture);
+      static void end_capture();
+
       // FIXME: All console state is currently global!
       static void disable_prefixes();
       static void enable_prefixes();
@@ -95,6 +127,18 @@ namespace crnlib
       static uint m_num_messages[cCMTTotal];
 
       static bool m_at_beginning_of_line;
+
+      struct thread_capture
+      {
+         uint64 m_thread_id;
+         console_capture* m_pCapture;
+      };
+      static crnlib::vector<thread_capture> m_captures;
+
+      friend class console_capture;
+
+      static console_capture* find_capture();
+      static void output(eConsoleMessageType type, const char* pMsg);
    };
 
 #if defined(WIN32)
@@ -0,0 +1,115 @@
+// File: crn_cpu_features.cpp
+// This software is in the public domain. Please see license.txt.
+#include "crn_core.h"
+#include "crn_cpu_features.h"
+#include "crn_strutils.h"
+#include <stdlib.h>
+
+#if CRNLIB_X86_SIMD && defined(_MSC_VER)
+   #include <intrin.h>
+   #if CRNLIB_X86_AVX2
+      #include <immintrin.h>
+   #endif
+#endif
+
+namespace crnlib
+{
+   namespace cpu_features
+   {
+      static cpu_level g_supported_level = cCPULevelScalar;
+      static cpu_level g_level = cCPULevelScalar;
+
+      static const char* g_level_names[cCPUTotalLevels] = { "scalar", "sse2", "sse4.1", "avx2" };
+
+      static cpu_level probe()
+      {
+#if !CRNLIB_X86_SIMD
+         return cCPULevelScalar;
+#elif defined(_MSC_VER)
+         int regs[4];
+         __cpuid(regs, 0);
+         const int max_leaf = regs[0];
+
+         __cpuid(regs, 1);
+         if ((regs[2] & (1 << 19)) == 0)
+            return cCPULevelSSE2;
+
+   #if CRNLIB_X86_AVX2
+         // AVX2 also needs the OS to save the YMM registers (OSXSAVE set, and XCR0 enabling SSE and AVX state).
+         const bool os_avx = ((regs[2] & (1 << 27)) != 0) && ((regs[2] & (1 << 28)) != 0) && ((_xgetbv(0) & 6) == 6);
+         if ((os_avx) && (max_leaf >= 7))
+         {
+            __cpuidex(regs, 7, 0);
+            if (regs[1] & (1 << 5))
+               return cCPULevelAVX2;
+         }
+   #else
+         max_leaf;
+   #endif
+         return cCPULevelSSE41;
+#elif defined(__GNUC__)
+         // __builtin_cpu_supports() includes the OS support check for AVX2.
+         __builtin_cpu_init();
+         if (__builtin_cpu_supports("avx2"))
+            return cCPULevelAVX2;
+         if (__builtin_cpu_supports("sse4.1"))
+            return cCPULevelSSE41;
+         return cCPULevelSSE2;
+#else
+         return cCPULevelSSE2;
+#endif
+      }
+
+      void init()
+      {
+         g_supported_level = probe();
+         g_level = g_supported_level;
+
+         const char* pForced = getenv("CRN_CPU_LEVEL");
+         if ((pForced) && (*pForced))
+         {
+            cpu_level level;
+            if (find_level(pForced, level))
+               set_level(level);
+         }
+      }
+
+      cpu_level get_supported_level()
+      {
+         return g_supported_level;
+      }
+
+      cpu_level get_level()
+      {
+         return g_level;
+      }
+
+      cpu_level set_level(cpu_level level)
+      {
+         g_level = math::minimum(level, g_supported_level);
+         return g_level;
+      }
+
+      const char* get_level_name(cpu_level level)
+      {
+         if (static_cast<uint>(level) >= cCPUTotalLevels)
+            return "?";
+         return g_level_names[level];
+      }
+
+      bool find_level(const char* pName, cpu_level& level)
+      {
+         for (uint i = 0; i < cCPUTotalLevels; i++)
+         {
+            if (crn_stricmp(pName, g_level_names[i]) == 0)
+            {
+               level = static_cast<cpu_level>(i);
+               return true;
+            }
+         }
+         return false;
+      }
+
+   } // namespace cpu_features
+
+} // namespace crnlib
@@ -0,0 +1,62 @@
+// File: crn_cpu_features.h
+// This software is in the public domain. Please see license.txt.
+#pragma once
+
+// CRNLIB_X86_SIMD is 1 when the SSE2 intrinsics are available at compile time. Higher instruction sets are compiled per function
+// (see CRNLIB_TARGET_SSE41/CRNLIB_TARGET_AVX2) and only called after the CPU has been probed.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+   #define CRNLIB_X86_SIMD 1
+#else
+   #define CRNLIB_X86_SIMD 0
+#endif
+
+// CRNLIB_X86_AVX2 is 1 when the compiler also provides the AVX2 intrinsics (immintrin.h, _xgetbv, __cpuidex). MSVC only has them from
+// VS2012 on, older versions build the SSE2/SSE4.1 kernels only and the probed level is capped at cCPULevelSSE41.
+#if CRNLIB_X86_SIMD && (!defined(_MSC_VER) || (_MSC_VER >= 1700))
+   #define CRNLIB_X86_AVX2 1
+#else
+   #define CRNLIB_X86_AVX2 0
+#endif
+
+#if CRNLIB_X86_SIMD && defined(__GNUC__)
+   #define CRNLIB_TARGET_SSE41 __attribute__((target("sse4.1")))
+   #define CRNLIB_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+   #define CRNLIB_TARGET_SSE41
+   #define CRNLIB_TARGET_AVX2
+#endif
+
+namespace crnlib
+{
+   enum cpu_level
+   {
+      cCPULevelScalar,
+      cCPULevelSSE2,
+      cCPULevelSSE41,
+      cCPULevelAVX2,
+
+      cCPUTotalLevels
+   };
+
+   // Selects which variant of the SIMD kernels (crn_dxt1_kernels, crn_resampler, crn_rg_etc1) crnlib runs.
+   // init() probes the CPU at startup and uses the best supported level, unless the CRN_CPU_LEVEL environment variable
+   // (scalar, sse2, sse4.1 or avx2) asks for a lower one. All levels produce bit identical output.
+   namespace cpu_features
+   {
+      void init();
+
+      cpu_level get_supported_level();
+      cpu_level get_level();
+
+      // Forces a lower level, for benchmarking and reproducibility testing. Levels above get_supported_level() are clamped. Returns the level actually set.
+      // Not thread safe: call it while no compression is in progress.
+      cpu_level set_level(cpu_level level);
+
+      const char* get_level_name(cpu_level level);
+
+      // Case insensitive, accepts the names returned by get_level_name().
+      bool find_level(const char* pName, cpu_level& level);
+
+   } // namespace cpu_features
+
+} // namespace crnlib
@@ -202,7 +202,7 @@ namespace crnlib
       if ((m_pixel_fmt == PIXEL_FMT_DXT1) && (m_src_tex.has_alpha()) && (m_pack_params.m_use_both_block_types) && (m_pParams->m_flags & cCRNCompFlagDXT1AForTransparency))
          m_pixel_fmt = PIXEL_FMT_DXT1A;
       
-      if (!m_task_pool.init(m_pParams->m_num_helper_threads))
+      if (!m_task_pool.init(get_num_helper_threads(*m_pParams)))
          return false;
       m_pack_params.m_pTask_pool = &m_task_pool;
 
@@ -235,7 +235,12 @@ namespace crnlib
 
       if (pEffective_bitrate)
       {
-         lzma_codec lossless_codec;
+         // The whole file is packed as one stream, like it would be for distribution. (Packing the mip levels in parallel as separate
+         // streams makes the output several percent larger, which would skew the bitrate.)
+         lzma_codec lossless_codec(m_pParams->m_lzma_level, m_pParams->m_lzma_dict_size);
+
+         // The match finder thread stands in for the helper threads, which are idle by now.
+         lossless_codec.set_multithreaded(m_task_pool.get_num_threads() > 0);
 
          crnlib::vector<uint8> cmp_tex_bytes;
          if (lossless_codec.pack(m_comp_data.get_ptr(), m_comp_data.size(), cmp_tex_bytes))
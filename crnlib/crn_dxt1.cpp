@@ -39,7 +39,9 @@ namespace crnlib
       m_pSolutions(NULL),
       m_perceptual(false),
       m_has_color_weighting(false),
-      m_all_pixels_grayscale(false)
+      m_all_pixels_grayscale(false),
+      m_use_kernels(false),
+      m_num_prev_results(0)
    {
       m_low_coords.reserve(512);
       m_high_coords.reserve(512);
@@ -1564,7 +1566,11 @@ namespace crnlib
             colors[2].set_noclamp_rgba( (colors[0].r * 2 + colors[1].r + alternate_rounding) / 3, (colors[0].g * 2 + colors[1].g + alternate_rounding) / 3, (colors[0].b * 2 + colors[1].b + alternate_rounding) / 3, 0);
             colors[3].set_noclamp_rgba( (colors[1].r * 2 + colors[0].r + alternate_rounding) / 3, (colors[1].g * 2 + colors[0].g + alternate_rounding) / 3, (colors[1].b * 2 + colors[0].b + alternate_rounding) / 3, 0);
 
-            if (m_perceptual)
+            if (m_use_kernels)
+            {
+               trial_error = dxt1_kernels::find_best_selectors(m_kernel_colors, colors, 4, m_kernel_comp_weights, solution.m_error, m_trial_selectors.get_ptr());
+            }
+            else if (m_perceptual)
             {
                for (int unique_color_index = (int)m_unique_colors.size() - 1; unique_color_index >= 0; unique_color_index--)
                {
@@ -1619,7 +1625,11 @@ namespace crnlib
          {
             colors[2].set_noclamp_rgba( (colors[0].r + colors[1].r + alternate_rounding) >> 1, (colors[0].g + colors[1].g + alternate_rounding) >> 1, (colors[0].b + colors[1].b + alternate_rounding) >> 1, 255U);
 
-            if (m_perceptual)
+            if (m_use_kernels)
+            {
+               trial_error = dxt1_kernels::find_best_selectors(m_kernel_colors, colors, 3, m_kernel_comp_weights, solution.m_error, m_trial_selectors.get_ptr());
+            }
+            else if (m_perceptual)
             {
                for (int unique_color_index = (int)m_unique_colors.size() - 1; unique_color_index >= 0; unique_color_index--)
                {
@@ -1767,25 +1777,34 @@ namespace crnlib
             int halfPoint = stops[3] + stops[2];
             int c3Point = stops[2] + stops[0];
 
-            for (int unique_color_index = (int)m_unique_colors.size() - 1; unique_color_index >= 0; unique_color_index--)
+            if (m_use_kernels)
+            {
+               const int dir[3] = { dirr, dirg, dirb };
+               const int points[3] = { halfPoint, c3Point, c0Point };
+               trial_error = dxt1_kernels::find_projected_selectors(m_kernel_colors, colors, 4, dir, points, m_kernel_comp_weights, solution.m_error, m_trial_selectors.get_ptr());
+            }
+            else
             {
-               const color_quad_u8& c = m_unique_colors[unique_color_index].m_color;
+               for (int unique_color_index = (int)m_unique_colors.size() - 1; unique_color_index >= 0; unique_color_index--)
+               {
+                  const color_quad_u8& c = m_unique_colors[unique_color_index].m_color;
 
-               int dot = c.r*dirr + c.g*dirg + c.b*dirb;
+                  int dot = c.r*dirr + c.g*dirg + c.b*dirb;
 
-               uint8 best_color_index;
-               if (dot < halfPoint)
-                  best_color_index = (dot < c3Point) ? 0 : 2;
-               else
-                  best_color_index = (dot < c0Point) ? 3 : 1;
+                  uint8 best_color_index;
+                  if (dot < halfPoint)
+                     best_color_index = (dot < c3Point) ? 0 : 2;
+                  else
+                     best_color_index = (dot < c0Point) ? 3 : 1;
 
-               uint best_error = color_distance(m_perceptual, c, colors[best_color_index], false);
+                  uint best_error = color_distance(m_perceptual, c, colors[best_color_index], false);
 
-               trial_error += best_error * static_cast<uint64>(m_unique_colors[unique_color_index].m_weight);
-               if (trial_error >= solution.m_error)
-                  break;
+                  trial_error += best_error * static_cast<uint64>(m_unique_colors[unique_color_index].m_weight);
+                  if (trial_error >= solution.m_error)
+                     break;
 
-               m_trial_selectors[unique_color_index] = static_cast<uint8>(best_color_index);
+                  m_trial_selectors[unique_color_index] = static_cast<uint8>(best_color_index);
+               }
             }
          }
          else
@@ -1798,27 +1817,36 @@ namespace crnlib
             int c02Point = stops[0] + stops[2];
             int c21Point = stops[2] + stops[1];
 
-            for (int unique_color_index = (int)m_unique_colors.size() - 1; unique_color_index >= 0; unique_color_index--)
+            if (m_use_kernels)
+            {
+               const int dir[3] = { dirr, dirg, dirb };
+               const int points[2] = { c02Point, c21Point };
+               trial_error = dxt1_kernels::find_projected_selectors(m_kernel_colors, colors, 3, dir, points, m_kernel_comp_weights, solution.m_error, m_trial_selectors.get_ptr());
+            }
+            else
             {
-               const color_quad_u8& c = m_unique_colors[unique_color_index].m_color;
+               for (int unique_color_index = (int)m_unique_colors.size() - 1; unique_color_index >= 0; unique_color_index--)
+               {
+                  const color_quad_u8& c = m_unique_colors[unique_color_index].m_color;
 
-               int dot = c.r*dirr + c.g*dirg + c.b*dirb;
+                  int dot = c.r*dirr + c.g*dirg + c.b*dirb;
 
-               uint8 best_color_index;
-               if (dot < c02Point)
-                  best_color_index = 0;
-               else if (dot < c21Point)
-                  best_color_index = 2;
-               else
-                  best_color_index = 1;
+                  uint8 best_color_index;
+                  if (dot < c02Point)
+                     best_color_index = 0;
+                  else if (dot < c21Point)
+                     best_color_index = 2;
+                  else
+                     best_color_index = 1;
 
-               uint best_error = color_distance(m_perceptual, c, colors[best_color_index], false);
+                  uint best_error = color_distance(m_perceptual, c, colors[best_color_index], false);
 
-               trial_error += best_error * static_cast<uint64>(m_unique_colors[unique_color_index].m_weight);
-               if (trial_error >= solution.m_error)
-                  break;
+                  trial_error += best_error * static_cast<uint64>(m_unique_colors[unique_color_index].m_weight);
+                  if (trial_error >= solution.m_error)
+                     break;
 
-               m_trial_selectors[unique_color_index] = static_cast<uint8>(best_color_index);
+                  m_trial_selectors[unique_color_index] = static_cast<uint8>(best_color_index);
+               }
             }
          }
 
@@ -2068,6 +2096,21 @@ namespace crnlib
       m_has_color_weighting = (m_pParams->m_color_weights[0] != 1) || (m_pParams->m_color_weights[1] != 1) || (m_pParams->m_color_weights[2] != 1);
       m_perceptual = m_pParams->m_perceptual && !m_has_color_weighting && !m_pParams->m_grayscale_sampling;
 
+      // Mirror color_distance() for the selector kernels. They don't handle grayscale sampling, or user weights too large for their 16-bit math.
+      m_use_kernels = !m_pParams->m_grayscale_sampling;
+      for (uint i = 0; i < 3; i++)
+      {
+         if (m_perceptual)
+            m_kernel_comp_weights[i] = (i == 0) ? color::cRWeight : ((i == 1) ? color::cGWeight : color::cBWeight);
+         else if (m_has_color_weighting)
+            m_kernel_comp_weights[i] = m_pParams->m_color_weights[i];
+         else
+            m_kernel_comp_weights[i] = 1;
+
+         if ((m_kernel_comp_weights[i] < 0) || (m_kernel_comp_weights[i] > dxt1_kernels::cMaxComponentWeight))
+            m_use_kernels = false;
+      }
+
       find_unique_colors();
 
       m_best_solution.clear();
@@ -2166,6 +2209,13 @@ namespace crnlib
       m_unique_colors.resize(num_unique_colors);
 
       m_total_unique_color_weight = num_opaque_pixels;
+
+      if (m_use_kernels)
+      {
+         m_kernel_colors.resize(num_unique_colors);
+         for (uint i = 0; i < num_unique_colors; i++)
+            m_kernel_colors.set(i, m_unique_colors[i].m_color, m_unique_colors[i].m_weight);
+      }
    }
 
 } // namespace crnlib
@@ -2,6 +2,7 @@
 // This software is in the public domain. Please see license.txt.
 #pragma once
 #include "crn_dxt.h"
+#include "crn_dxt1_kernels.h"
 
 namespace crnlib
 {
@@ -244,6 +245,10 @@ namespace crnlib
       crnlib::vector<uint16> m_unique_packed_colors;
       crnlib::vector<uint8> m_trial_selectors;
 
+      dxt1_kernels::color_set m_kernel_colors;
+      int               m_kernel_comp_weights[3];
+      bool              m_use_kernels;
+
       crnlib::vector<vec3F> m_low_coords;
       crnlib::vector<vec3F> m_high_coords;
 
@@ -0,0 +1,346 @@
+// File: crn_dxt1_kernels.cpp
+// This software is in the public domain. Please see license.txt.
+#include "crn_core.h"
+#include "crn_dxt1_kernels.h"
+#include "crn_cpu_features.h"
+
+#if CRNLIB_X86_SIMD
+   #include <emmintrin.h>
+   #include <smmintrin.h>
+   #if CRNLIB_X86_AVX2
+      #include <immintrin.h>
+   #endif
+#endif
+
+namespace crnlib
+{
+   namespace dxt1_kernels
+   {
+      void color_set::resize(uint num_colors)
+      {
+         m_num_colors = num_colors;
+
+         // Padding colors have zero weight, so they never contribute to the error.
+         const uint padded_size = math::align_up_value(num_colors, cBatchSize);
+         m_r.resize(padded_size);
+         m_g.resize(padded_size);
+         m_b.resize(padded_size);
+         m_weights.resize(padded_size);
+         for (uint i = num_colors; i < padded_size; i++)
+         {
+            m_r[i] = 0;
+            m_g[i] = 0;
+            m_b[i] = 0;
+            m_weights[i] = 0;
+         }
+      }
+
+      namespace scalar
+      {
+         struct soa_source
+         {
+            const int16* m_pR;
+            const int16* m_pG;
+            const int16* m_pB;
+            const uint32* m_pWeights;
+            uint m_num_colors;
+
+            inline void get(uint i, int& r, int& g, int& b, uint& weight) const
+            {
+               r = m_pR[i];
+               g = m_pG[i];
+               b = m_pB[i];
+               weight = m_pWeights[i];
+            }
+         };
+
+         struct aos_source
+         {
+            const color_quad_u8* m_pPixels;
+            uint m_num_colors;
+
+            inline void get(uint i, int& r, int& g, int& b, uint& weight) const
+            {
+               r = m_pPixels[i].r;
+               g = m_pPixels[i].g;
+               b = m_pPixels[i].b;
+               weight = 1;
+            }
+         };
+
+         static inline uint color_distance(int r, int g, int b, const color_quad_u8& p, const int* pComp_weights)
+         {
+            int dr = r - p.r;
+            int dg = g - p.g;
+            int db = b - p.b;
+            return static_cast<uint>(dr * dr * pComp_weights[0] + dg * dg * pComp_weights[1] + db * db * pComp_weights[2]);
+         }
+
+         template<uint num_palette_colors, typename source>
+         static uint64 find_best_selectors(
+            const source& src,
+            const color_quad_u8* pPalette,
+            const int* pComp_weights,
+            uint64 max_error,
+            uint8* pSelectors)
+         {
+            uint64 total_error = 0;
+
+            for (uint i = 0; i < src.m_num_colors; i++)
+            {
+               int r, g, b;
+               uint weight;
+               src.get(i, r, g, b, weight);
+
+               uint best_error = color_distance(r, g, b, pPalette[0], pComp_weights);
+               uint best_index = 0;
+
+               for (uint k = 1; k < num_palette_colors; k++)
+               {
+                  uint err = color_distance(r, g, b, pPalette[k], pComp_weights);
+                  if (err < best_error) { best_error = err; best_index = k; }
+               }
+
+               total_error += best_error * static_cast<uint64>(weight);
+               if (total_error >= max_error)
+                  break;
+
+               if (pSelectors)
+                  pSelectors[i] = static_cast<uint8>(best_index);
+            }
+
+            return total_error;
+         }
+
+         template<uint num_palette_colors, typename source>
+         static uint64 find_projected_selectors(
+            const source& src,
+            const color_quad_u8* pPalette,
+            const int* pDir, const int* pPoints,
+            const int* pComp_weights,
+            uint64 max_error,
+            uint8* pSelectors)
+         {
+            uint64 total_error = 0;
+
+            for (uint i = 0; i < src.m_num_colors; i++)
+            {
+               int r, g, b;
+               uint weight;
+               src.get(i, r, g, b, weight);
+
+               int dot = r * pDir[0] + g * pDir[1] + b * pDir[2];
+
+               uint8 best_index;
+               if (num_palette_colors == 4)
+               {
+                  if (dot < pPoints[0])
+                     best_index = (dot < pPoints[1]) ? 0 : 2;
+                  else
+                     best_index = (dot < pPoints[2]) ? 3 : 1;
+               }
+               else if (dot < pPoints[0])
+                  best_index = 0;
+               else if (dot < pPoints[1])
+                  best_index = 2;
+               else
+                  best_index = 1;
+
+               uint best_error = color_distance(r, g, b, pPalette[best_index], pComp_weights);
+
+               total_error += best_error * static_cast<uint64>(weight);
+               if (total_error >= max_error)
+                  break;
+
+               if (pSelectors)
+                  pSelectors[i] = best_index;
+            }
+
+            return total_error;
+         }
+
+      } // namespace scalar
+
+#if CRNLIB_X86_SIMD
+      namespace sse2
+      {
+#define CRNLIB_DXT1_KERNELS_SSE41 0
+#include "crn_dxt1_kernels_sse.inl"
+#undef CRNLIB_DXT1_KERNELS_SSE41
+      } // namespace sse2
+
+#if defined(__clang__)
+   #pragma clang attribute push(__attribute__((target("sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+   #pragma GCC push_options
+   #pragma GCC target("sse4.1")
+#endif
+
+      namespace sse41
+      {
+#define CRNLIB_DXT1_KERNELS_SSE41 1
+#include "crn_dxt1_kernels_sse.inl"
+#undef CRNLIB_DXT1_KERNELS_SSE41
+      } // namespace sse41
+
+#if defined(__clang__)
+   #pragma clang attribute pop
+#elif defined(__GNUC__)
+   #pragma GCC pop_options
+#endif
+
+#if CRNLIB_X86_AVX2
+#if defined(__clang__)
+   #pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+   #pragma GCC push_options
+   #pragma GCC target("avx2")
+#endif
+
+      namespace avx2
+      {
+#include "crn_dxt1_kernels_avx2.inl"
+      } // namespace avx2
+
+#if defined(__clang__)
+   #pragma clang attribute pop
+#elif defined(__GNUC__)
+   #pragma GCC pop_options
+#endif
+#endif // CRNLIB_X86_AVX2
+#endif // CRNLIB_X86_SIMD
+
+      typedef uint64 (*find_best_selectors_soa_func)(const int16* pR, const int16* pG, const int16* pB, const uint32* pWeights, uint num_colors,
+         const color_quad_u8* pPalette, uint num_palette_colors, const int* pComp_weights, uint64 max_error, uint8* pSelectors);
+
+      typedef uint64 (*find_projected_selectors_soa_func)(const int16* pR, const int16* pG, const int16* pB, const uint32* pWeights, uint num_colors,
+         const color_quad_u8* pPalette, uint num_palette_colors, const int* pDir, const int* pPoints, const int* pComp_weights, uint64 max_error, uint8* pSelectors);
+
+      typedef uint64 (*find_best_selectors_aos_func)(const color_quad_u8* pPixels, uint num_pixels,
+         const color_quad_u8* pPalette, uint num_palette_colors, const int* pComp_weights, uint64 max_error, uint8* pSelectors);
+
+      typedef uint64 (*find_projected_selectors_aos_func)(const color_quad_u8* pPixels, uint num_pixels,
+         const color_quad_u8* pPalette, uint num_palette_colors, const int* pDir, const int* pPoints, const int* pComp_weights, uint64 max_error, uint8* pSelectors);
+
+      // Non-template entry points for each instruction set. The sources are built here, outside of the target regions above.
+      template<typename soa_source, uint64 (*pFind3)(const soa_source&, const color_quad_u8*, const int*, uint64, uint8*), uint64 (*pFind4)(const soa_source&, const color_quad_u8*, const int*, uint64, uint8*)>
+      static uint64 find_best_selectors_soa(const int16* pR, const int16* pG, const int16* pB, const uint32* pWeights, uint num_colors,
+         const color_quad_u8* pPalette, uint num_palette_colors, const int* pComp_weights, uint64 max_error, uint8* pSelectors)
+      {
+         const soa_source src = { pR, pG, pB, pWeights, num_colors };
+         return (num_palette_colors == 4) ? pFind4(src, pPalette, pComp_weights, max_error, pSelectors) : pFind3(src, pPalette, pComp_weights, max_error, pSelectors);
+      }
+
+      template<typename soa_source, uint64 (*pFind3)(const soa_source&, const color_quad_u8*, const int*, const int*, const int*, uint64, uint8*), uint64 (*pFind4)(const soa_source&, const color_quad_u8*, const int*, const int*, const int*, uint64, uint8*)>
+      static uint64 find_projected_selectors_soa(const int16* pR, const int16* pG, const int16* pB, const uint32* pWeights, uint num_colors,
+         const color_quad_u8* pPalette, uint num_palette_colors, const int* pDir, const int* pPoints, const int* pComp_weights, uint64 max_error, uint8* pSelectors)
+      {
+         const soa_source src = { pR, pG, pB, pWeights, num_colors };
+         return (num_palette_colors == 4) ? pFind4(src, pPalette, pDir, pPoints, pComp_weights, max_error, pSelectors) : pFind3(src, pPalette, pDir, pPoints, pComp_weights, max_error, pSelectors);
+      }
+
+      template<typename aos_source, uint64 (*pFind3)(const aos_source&, const color_quad_u8*, const int*, uint64, uint8*), uint64 (*pFind4)(const aos_source&, const color_quad_u8*, const int*, uint64, uint8*)>
+      static uint64 find_best_selectors_aos(const color_quad_u8* pPixels, uint num_pixels,
+         const color_quad_u8* pPalette, uint num_palette_colors, const int* pComp_weights, uint64 max_error, uint8* pSelectors)
+      {
+         const aos_source src = { pPixels, num_pixels };
+         return (num_palette_colors == 4) ? pFind4(src, pPalette, pComp_weights, max_error, pSelectors) : pFind3(src, pPalette, pComp_weights, max_error, pSelectors);
+      }
+
+      template<typename aos_source, uint64 (*pFind3)(const aos_source&, const color_quad_u8*, const int*, const int*, const int*, uint64, uint8*), uint64 (*pFind4)(const aos_source&, const color_quad_u8*, const int*, const int*, const int*, uint64, uint8*)>
+      static uint64 find_projected_selectors_aos(const color_quad_u8* pPixels, uint num_pixels,
+         const color_quad_u8* pPalette, uint num_palette_colors, const int* pDir, const int* pPoints, const int* pComp_weights, uint64 max_error, uint8* pSelectors)
+      {
+         const aos_source src = { pPixels, num_pixels };
+         return (num_palette_colors == 4) ? pFind4(src, pPalette, pDir, pPoints, pComp_weights, max_error, pSelectors) : pFind3(src, pPalette, pDir, pPoints, pComp_weights, max_error, pSelectors);
+      }
+
+      struct kernel_funcs
+      {
+         find_best_selectors_soa_func m_pFind_best_selectors_soa;
+         find_projected_selectors_soa_func m_pFind_projected_selectors_soa;
+         find_best_selectors_aos_func m_pFind_best_selectors_aos;
+         find_projected_selectors_aos_func m_pFind_projected_selectors_aos;
+      };
+
+#define CRNLIB_DXT1_KERNEL_FUNCS(ns) \
+      { \
+         find_best_selectors_soa<ns::soa_source, ns::find_best_selectors<3, ns::soa_source>, ns::find_best_selectors<4, ns::soa_source> >, \
+         find_projected_selectors_soa<ns::soa_source, ns::find_projected_selectors<3, ns::soa_source>, ns::find_projected_selectors<4, ns::soa_source> >, \
+         find_best_selectors_aos<ns::aos_source, ns::find_best_selectors<3, ns::aos_source>, ns::find_best_selectors<4, ns::aos_source> >, \
+         find_projected_selectors_aos<ns::aos_source, ns::find_projected_selectors<3, ns::aos_source>, ns::find_projected_selectors<4, ns::aos_source> > \
+      }
+
+      static const kernel_funcs g_kernel_funcs[cCPUTotalLevels] =
+      {
+         CRNLIB_DXT1_KERNEL_FUNCS(scalar),
+#if CRNLIB_X86_SIMD
+         CRNLIB_DXT1_KERNEL_FUNCS(sse2),
+         CRNLIB_DXT1_KERNEL_FUNCS(sse41),
+   #if CRNLIB_X86_AVX2
+         CRNLIB_DXT1_KERNEL_FUNCS(avx2),
+   #else
+         CRNLIB_DXT1_KERNEL_FUNCS(sse41),
+   #endif
+#else
+         CRNLIB_DXT1_KERNEL_FUNCS(scalar),
+         CRNLIB_DXT1_KERNEL_FUNCS(scalar),
+         CRNLIB_DXT1_KERNEL_FUNCS(scalar),
+#endif
+      };
+
+#undef CRNLIB_DXT1_KERNEL_FUNCS
+
+      uint64 find_best_selectors(
+         const color_set& colors,
+         const color_quad_u8* pPalette, uint num_palette_colors,
+         const int* pComp_weights,
+         uint64 max_error,
+         uint8* pSelectors)
+      {
+         CRNLIB_ASSERT((num_palette_colors == 3) || (num_palette_colors == 4));
+         return g_kernel_funcs[cpu_features::get_level()].m_pFind_best_selectors_soa(colors.get_r(), colors.get_g(), colors.get_b(), colors.get_weights(), colors.size(),
+            pPalette, num_palette_colors, pComp_weights, max_error, pSelectors);
+      }
+
+      uint64 find_projected_selectors(
+         const color_set& colors,
+         const color_quad_u8* pPalette, uint num_palette_colors,
+         const int* pDir, const int* pPoints,
+         const int* pComp_weights,
+         uint64 max_error,
+         uint8* pSelectors)
+      {
+         CRNLIB_ASSERT((num_palette_colors == 3) || (num_palette_colors == 4));
+         return g_kernel_funcs[cpu_features::get_level()].m_pFind_projected_selectors_soa(colors.get_r(), colors.get_g(), colors.get_b(), colors.get_weights(), colors.size(),
+            pPalette, num_palette_colors, pDir, pPoints, pComp_weights, max_error, pSelectors);
+      }
+
+      uint64 find_best_selectors(
+         const color_quad_u8* pPixels, uint num_pixels,
+         const color_quad_u8* pPalette, uint num_palette_colors,
+         const int* pComp_weights,
+         uint64 max_error,
+         uint8* pSelectors)
+      {
+         CRNLIB_ASSERT((num_palette_colors == 3) || (num_palette_colors == 4));
+         return g_kernel_funcs[cpu_features::get_level()].m_pFind_best_selectors_aos(pPixels, num_pixels,
+            pPalette, num_palette_colors, pComp_weights, max_error, pSelectors);
+      }
+
+      uint64 find_projected_selectors(
+         const color_quad_u8* pPixels, uint num_pixels,
+         const color_quad_u8* pPalette, uint num_palette_colors,
+         const int* pDir, const int* pPoints,
+         const int* pComp_weights,
+         uint64 max_error,
+         uint8* pSelectors)
+      {
+         CRNLIB_ASSERT((num_palette_colors == 3) || (num_palette_colors == 4));
+         return g_kernel_funcs[cpu_features::get_level()].m_pFind_projected_selectors_aos(pPixels, num_pixels,
+            pPalette, num_palette_colors, pDir, pPoints, pComp_weights, max_error, pSelectors);
+      }
+
+   } // namespace dxt1_kernels
+
+} // namespace crnlib
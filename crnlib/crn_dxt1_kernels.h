@@ -0,0 +1,88 @@
+// File: crn_dxt1_kernels.h
+// This software is in the public domain. Please see license.txt.
+#pragma once
+#include "crn_color.h"
+#include "crn_vector.h"
+
+namespace crnlib
+{
+   // Inner loops of dxt1_endpoint_optimizer's candidate evaluation (also used by dxt_fast and etc1_optimizer): given a palette of 3 or 4
+   // colors, find each color's selector and sum the weighted error. Scalar, SSE2, SSE4.1 and AVX2 versions are provided, all of which
+   // return bit identical results. The version is picked by cpu_features::get_level() on every call.
+   namespace dxt1_kernels
+   {
+      enum { cBatchSize = 16 };
+
+      // The block's unique colors in structure of arrays form, padded to a multiple of cBatchSize with zero weight colors.
+      class color_set
+      {
+      public:
+         color_set() : m_num_colors(0) { }
+
+         void resize(uint num_colors);
+
+         inline void set(uint index, const color_quad_u8& c, uint weight)
+         {
+            m_r[index] = c.r;
+            m_g[index] = c.g;
+            m_b[index] = c.b;
+            m_weights[index] = weight;
+         }
+
+         inline uint size() const { return m_num_colors; }
+
+         const int16* get_r() const { return m_r.get_ptr(); }
+         const int16* get_g() const { return m_g.get_ptr(); }
+         const int16* get_b() const { return m_b.get_ptr(); }
+         const uint32* get_weights() const { return m_weights.get_ptr(); }
+
+      private:
+         uint m_num_colors;
+         crnlib::vector<int16> m_r;
+         crnlib::vector<int16> m_g;
+         crnlib::vector<int16> m_b;
+         crnlib::vector<uint32> m_weights;
+      };
+
+      // The kernels compute distances in 16-bit lanes, so each per component weight must lie in [0, cMaxComponentWeight].
+      const int cMaxComponentWeight = 128;
+
+      // Picks the closest palette entry for every color, lowest index first on ties.
+      // Stops early and returns an error >= max_error once the running total reaches max_error, in which case the selectors are undefined.
+      // pSelectors may be NULL if only the error is needed.
+      uint64 find_best_selectors(
+         const color_set& colors,
+         const color_quad_u8* pPalette, uint num_palette_colors,
+         const int* pComp_weights,
+         uint64 max_error,
+         uint8* pSelectors);
+
+      // Picks each color's selector by projecting it onto pDir and comparing against the palette's midpoints along the same axis
+      // (pPoints[0..2] = half/c3/c0 for 4 color blocks, pPoints[0..1] = c02/c21 for 3 color blocks), then sums the weighted error.
+      uint64 find_projected_selectors(
+         const color_set& colors,
+         const color_quad_u8* pPalette, uint num_palette_colors,
+         const int* pDir, const int* pPoints,
+         const int* pComp_weights,
+         uint64 max_error,
+         uint8* pSelectors);
+
+      // Same as above, for raw pixels with a weight of 1 each. Alpha is ignored.
+      uint64 find_best_selectors(
+         const color_quad_u8* pPixels, uint num_pixels,
+         const color_quad_u8* pPalette, uint num_palette_colors,
+         const int* pComp_weights,
+         uint64 max_error,
+         uint8* pSelectors);
+
+      uint64 find_projected_selectors(
+         const color_quad_u8* pPixels, uint num_pixels,
+         const color_quad_u8* pPalette, uint num_palette_colors,
+         const int* pDir, const int* pPoints,
+         const int* pComp_weights,
+         uint64 max_error,
+         uint8* pSelectors);
+
+   } // namespace dxt1_kernels
+
+} // namespace crnlib
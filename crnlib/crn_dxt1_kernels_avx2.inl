@@ -0,0 +1,273 @@
+// File: crn_dxt1_kernels_avx2.inl
+// This software is in the public domain. Please see license.txt.
+//
+// AVX2 versions of the DXT1 selector kernels, 16 colors per iteration. Included by crn_dxt1_kernels.cpp inside its own namespace,
+// with AVX2 code generation enabled. Only raw pointers and intrinsics may be used in here - anything else could get instantiated
+// with the wrong target options.
+//
+// The 16-bit color lanes are kept in natural order. Unpacking them to 32 bits works within each 128-bit half, so the "lo" vectors
+// hold colors 0-3 and 8-11 and the "hi" vectors hold colors 4-7 and 12-15. Packing back to 16 bits restores the natural order.
+
+// Loads 16 colors as 16-bit r/g/b lanes, plus their weights in the lo/hi lane order described above.
+struct soa_source
+{
+   const int16* m_pR;
+   const int16* m_pG;
+   const int16* m_pB;
+   const uint32* m_pWeights;
+   uint m_num_colors;
+
+   inline void load(uint i, __m256i& r, __m256i& g, __m256i& b, __m256i& w_lo, __m256i& w_hi) const
+   {
+      // The color set is padded to a multiple of 16 colors, so full batches can always be loaded.
+      r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_pR + i));
+      g = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_pG + i));
+      b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_pB + i));
+
+      const __m256i w0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_pWeights + i));
+      const __m256i w1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_pWeights + i + 8));
+      w_lo = _mm256_permute2x128_si256(w0, w1, 0x20);
+      w_hi = _mm256_permute2x128_si256(w0, w1, 0x31);
+   }
+};
+
+// Deinterleaves 16 RGBA pixels, each with a weight of 1. Lanes past the end get a weight of 0.
+struct aos_source
+{
+   const color_quad_u8* m_pPixels;
+   uint m_num_colors;
+
+   inline void load(uint i, __m256i& r, __m256i& g, __m256i& b, __m256i& w_lo, __m256i& w_hi) const
+   {
+      const __m256i one = _mm256_set1_epi32(1);
+      __m256i p0, p1, w0, w1;
+
+      const uint n = m_num_colors - i;
+      if (n >= 16)
+      {
+         p0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_pPixels + i));
+         p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_pPixels + i + 8));
+         w0 = one;
+         w1 = one;
+      }
+      else
+      {
+         uint32 tmp[16];
+         memset(tmp, 0, sizeof(tmp));
+         memcpy(tmp, m_pPixels + i, n * sizeof(uint32));
+         p0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tmp));
+         p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tmp + 8));
+
+         const __m256i remaining = _mm256_set1_epi32(n);
+         w0 = _mm256_and_si256(_mm256_cmpgt_epi32(remaining, _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)), one);
+         w1 = _mm256_and_si256(_mm256_cmpgt_epi32(remaining, _mm256_setr_epi32(8, 9, 10, 11, 12, 13, 14, 15)), one);
+      }
+
+      w_lo = _mm256_permute2x128_si256(w0, w1, 0x20);
+      w_hi = _mm256_permute2x128_si256(w0, w1, 0x31);
+
+      // Packing two vectors of 8 pixels interleaves their 128-bit halves, the permute puts the 64-bit groups back in order.
+      const __m256i mask = _mm256_set1_epi32(0xFF);
+      r = _mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_and_si256(p0, mask), _mm256_and_si256(p1, mask)), 0xD8);
+      g = _mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(p0, 8), mask), _mm256_and_si256(_mm256_srli_epi32(p1, 8), mask)), 0xD8);
+      b = _mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(p0, 16), mask), _mm256_and_si256(_mm256_srli_epi32(p1, 16), mask)), 0xD8);
+   }
+};
+
+// Weighted squared distances between 16 colors and 16 palette colors, returned as two vectors of 8 int32's.
+static inline void color_distance16(
+   __m256i r, __m256i g, __m256i b,
+   __m256i pr, __m256i pg, __m256i pb,
+   __m256i wr, __m256i wg, __m256i wb,
+   __m256i& lo, __m256i& hi)
+{
+   const __m256i zero = _mm256_setzero_si256();
+
+   __m256i dr = _mm256_sub_epi16(r, pr);
+   __m256i dg = _mm256_sub_epi16(g, pg);
+   __m256i db = _mm256_sub_epi16(b, pb);
+
+   __m256i wdr = _mm256_mullo_epi16(dr, wr);
+   __m256i wdg = _mm256_mullo_epi16(dg, wg);
+   __m256i wdb = _mm256_mullo_epi16(db, wb);
+
+   lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(dr, dg), _mm256_unpacklo_epi16(wdr, wdg)), _mm256_madd_epi16(_mm256_unpacklo_epi16(db, zero), _mm256_unpacklo_epi16(wdb, zero)));
+   hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(dr, dg), _mm256_unpackhi_epi16(wdr, wdg)), _mm256_madd_epi16(_mm256_unpackhi_epi16(db, zero), _mm256_unpackhi_epi16(wdb, zero)));
+}
+
+// Adds dist[i] * weights[i] to the four 64-bit lanes of acc.
+static inline __m256i accumulate_weighted(__m256i acc, __m256i dist, __m256i weights)
+{
+   __m256i even = _mm256_mul_epu32(dist, weights);
+   __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(dist, 32), _mm256_srli_epi64(weights, 32));
+   return _mm256_add_epi64(acc, _mm256_add_epi64(even, odd));
+}
+
+static inline uint64 horizontal_sum(__m256i acc)
+{
+   uint64 sums[2];
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)));
+   return sums[0] + sums[1];
+}
+
+// Writes the low byte of each of the 16 16-bit lanes of sel.
+static inline void store_selectors(uint8* pDst, uint n, __m256i sel)
+{
+   const __m128i packed = _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(sel, sel), 0xD8));
+   if (n >= 16)
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), packed);
+   else
+   {
+      uint8 tmp[16];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(tmp), packed);
+      memcpy(pDst, tmp, n);
+   }
+}
+
+template<uint num_palette_colors, typename source>
+static uint64 find_best_selectors(
+   const source& src,
+   const color_quad_u8* pPalette,
+   const int* pComp_weights,
+   uint64 max_error,
+   uint8* pSelectors)
+{
+   const __m256i wr = _mm256_set1_epi16(static_cast<int16>(pComp_weights[0]));
+   const __m256i wg = _mm256_set1_epi16(static_cast<int16>(pComp_weights[1]));
+   const __m256i wb = _mm256_set1_epi16(static_cast<int16>(pComp_weights[2]));
+
+   __m256i pr[num_palette_colors], pg[num_palette_colors], pb[num_palette_colors];
+   for (uint k = 0; k < num_palette_colors; k++)
+   {
+      pr[k] = _mm256_set1_epi16(pPalette[k].r);
+      pg[k] = _mm256_set1_epi16(pPalette[k].g);
+      pb[k] = _mm256_set1_epi16(pPalette[k].b);
+   }
+
+   __m256i acc = _mm256_setzero_si256();
+   uint64 total_error = 0;
+
+   for (uint i = 0; i < src.m_num_colors; i += 16)
+   {
+      __m256i r, g, b, w_lo, w_hi;
+      src.load(i, r, g, b, w_lo, w_hi);
+
+      __m256i best_lo, best_hi;
+      color_distance16(r, g, b, pr[0], pg[0], pb[0], wr, wg, wb, best_lo, best_hi);
+
+      __m256i index_lo = _mm256_setzero_si256();
+      __m256i index_hi = _mm256_setzero_si256();
+
+      for (uint k = 1; k < num_palette_colors; k++)
+      {
+         __m256i dist_lo, dist_hi;
+         color_distance16(r, g, b, pr[k], pg[k], pb[k], wr, wg, wb, dist_lo, dist_hi);
+
+         const __m256i kv = _mm256_set1_epi32(k);
+         const __m256i less_lo = _mm256_cmpgt_epi32(best_lo, dist_lo);
+         const __m256i less_hi = _mm256_cmpgt_epi32(best_hi, dist_hi);
+
+         best_lo = _mm256_min_epi32(dist_lo, best_lo);
+         best_hi = _mm256_min_epi32(dist_hi, best_hi);
+         index_lo = _mm256_blendv_epi8(index_lo, kv, less_lo);
+         index_hi = _mm256_blendv_epi8(index_hi, kv, less_hi);
+      }
+
+      acc = accumulate_weighted(acc, best_lo, w_lo);
+      acc = accumulate_weighted(acc, best_hi, w_hi);
+
+      total_error = horizontal_sum(acc);
+      if (total_error >= max_error)
+         break;
+
+      if (pSelectors)
+         store_selectors(pSelectors + i, src.m_num_colors - i, _mm256_packs_epi32(index_lo, index_hi));
+   }
+
+   return total_error;
+}
+
+template<uint num_palette_colors, typename source>
+static uint64 find_projected_selectors(
+   const source& src,
+   const color_quad_u8* pPalette,
+   const int* pDir, const int* pPoints,
+   const int* pComp_weights,
+   uint64 max_error,
+   uint8* pSelectors)
+{
+   const __m256i zero = _mm256_setzero_si256();
+   const __m256i one = _mm256_set1_epi16(1);
+   const __m256i two = _mm256_set1_epi16(2);
+
+   const __m256i wr = _mm256_set1_epi16(static_cast<int16>(pComp_weights[0]));
+   const __m256i wg = _mm256_set1_epi16(static_cast<int16>(pComp_weights[1]));
+   const __m256i wb = _mm256_set1_epi16(static_cast<int16>(pComp_weights[2]));
+
+   const __m256i dir_rg = _mm256_set1_epi32((static_cast<uint>(pDir[1]) << 16) | (static_cast<uint>(pDir[0]) & 0xFFFF));
+   const __m256i dir_b = _mm256_set1_epi32(static_cast<uint>(pDir[2]) & 0xFFFF);
+
+   const __m256i point0 = _mm256_set1_epi32(pPoints[0]);
+   const __m256i point1 = _mm256_set1_epi32(pPoints[1]);
+   const __m256i point2 = _mm256_set1_epi32((num_palette_colors == 4) ? pPoints[2] : 0);
+
+   __m256i pr[num_palette_colors], pg[num_palette_colors], pb[num_palette_colors];
+   for (uint k = 0; k < num_palette_colors; k++)
+   {
+      pr[k] = _mm256_set1_epi16(pPalette[k].r);
+      pg[k] = _mm256_set1_epi16(pPalette[k].g);
+      pb[k] = _mm256_set1_epi16(pPalette[k].b);
+   }
+
+   __m256i acc = zero;
+   uint64 total_error = 0;
+
+   for (uint i = 0; i < src.m_num_colors; i += 16)
+   {
+      __m256i r, g, b, w_lo, w_hi;
+      src.load(i, r, g, b, w_lo, w_hi);
+
+      const __m256i dot_lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(r, g), dir_rg), _mm256_madd_epi16(_mm256_unpacklo_epi16(b, zero), dir_b));
+      const __m256i dot_hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(r, g), dir_rg), _mm256_madd_epi16(_mm256_unpackhi_epi16(b, zero), dir_b));
+
+      const __m256i below0 = _mm256_packs_epi32(_mm256_cmpgt_epi32(point0, dot_lo), _mm256_cmpgt_epi32(point0, dot_hi));
+      const __m256i below1 = _mm256_packs_epi32(_mm256_cmpgt_epi32(point1, dot_lo), _mm256_cmpgt_epi32(point1, dot_hi));
+
+      __m256i sel;
+      if (num_palette_colors == 4)
+      {
+         // dot < half ? (dot < c3 ? 0 : 2) : (dot < c0 ? 3 : 1)
+         const __m256i below2 = _mm256_packs_epi32(_mm256_cmpgt_epi32(point2, dot_lo), _mm256_cmpgt_epi32(point2, dot_hi));
+         sel = _mm256_blendv_epi8(_mm256_or_si256(one, _mm256_and_si256(below2, two)), _mm256_andnot_si256(below1, two), below0);
+      }
+      else
+      {
+         // dot < c02 ? 0 : (dot < c21 ? 2 : 1)
+         sel = _mm256_andnot_si256(below0, _mm256_blendv_epi8(one, two, below1));
+      }
+
+      __m256i sr = pr[0], sg = pg[0], sb = pb[0];
+      for (uint k = 1; k < num_palette_colors; k++)
+      {
+         const __m256i is_k = _mm256_cmpeq_epi16(sel, _mm256_set1_epi16(static_cast<int16>(k)));
+         sr = _mm256_blendv_epi8(sr, pr[k], is_k);
+         sg = _mm256_blendv_epi8(sg, pg[k], is_k);
+         sb = _mm256_blendv_epi8(sb, pb[k], is_k);
+      }
+
+      __m256i dist_lo, dist_hi;
+      color_distance16(r, g, b, sr, sg, sb, wr, wg, wb, dist_lo, dist_hi);
+
+      acc = accumulate_weighted(acc, dist_lo, w_lo);
+      acc = accumulate_weighted(acc, dist_hi, w_hi);
+
+      total_error = horizontal_sum(acc);
+      if (total_error >= max_error)
+         break;
+
+      if (pSelectors)
+         store_selectors(pSelectors + i, src.m_num_colors - i, sel);
+   }
+
+   return total_error;
+}
@@ -0,0 +1,277 @@
+// File: crn_dxt1_kernels_sse.inl
+// This software is in the public domain. Please see license.txt.
+//
+// SSE versions of the DXT1 selector kernels, 8 colors per iteration. Included by crn_dxt1_kernels.cpp once per instruction set,
+// inside its own namespace, with CRNLIB_DXT1_KERNELS_SSE41 set to 0 or 1. Only raw pointers and intrinsics may be used in here -
+// anything else could get instantiated with the wrong target options.
+
+// mask ? a : b, where each lane of mask is all ones or all zeros.
+static inline __m128i select_si128(__m128i mask, __m128i a, __m128i b)
+{
+#if CRNLIB_DXT1_KERNELS_SSE41
+   return _mm_blendv_epi8(b, a, mask);
+#else
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+#endif
+}
+
+// Loads 8 colors as 16-bit r/g/b lanes, plus their weights as two vectors of 4 uint32's.
+struct soa_source
+{
+   const int16* m_pR;
+   const int16* m_pG;
+   const int16* m_pB;
+   const uint32* m_pWeights;
+   uint m_num_colors;
+
+   inline void load(uint i, __m128i& r, __m128i& g, __m128i& b, __m128i& w_lo, __m128i& w_hi) const
+   {
+      // The color set is padded, so full batches can always be loaded.
+      r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_pR + i));
+      g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_pG + i));
+      b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_pB + i));
+      w_lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_pWeights + i));
+      w_hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_pWeights + i + 4));
+   }
+};
+
+// Deinterleaves 8 RGBA pixels, each with a weight of 1. Lanes past the end get a weight of 0.
+struct aos_source
+{
+   const color_quad_u8* m_pPixels;
+   uint m_num_colors;
+
+   inline void load(uint i, __m128i& r, __m128i& g, __m128i& b, __m128i& w_lo, __m128i& w_hi) const
+   {
+      const __m128i one = _mm_set1_epi32(1);
+      __m128i p0, p1;
+
+      const uint n = m_num_colors - i;
+      if (n >= 8)
+      {
+         p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_pPixels + i));
+         p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_pPixels + i + 4));
+         w_lo = one;
+         w_hi = one;
+      }
+      else
+      {
+         uint32 tmp[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+         memcpy(tmp, m_pPixels + i, n * sizeof(uint32));
+         p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tmp));
+         p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tmp + 4));
+
+         const __m128i remaining = _mm_set1_epi32(n);
+         w_lo = _mm_and_si128(_mm_cmpgt_epi32(remaining, _mm_setr_epi32(0, 1, 2, 3)), one);
+         w_hi = _mm_and_si128(_mm_cmpgt_epi32(remaining, _mm_setr_epi32(4, 5, 6, 7)), one);
+      }
+
+      const __m128i mask = _mm_set1_epi32(0xFF);
+      r = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+      g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask), _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+      b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask), _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+   }
+};
+
+// Weighted squared distances between 8 colors and 8 palette colors, returned as two vectors of 4 int32's.
+static inline void color_distance8(
+   __m128i r, __m128i g, __m128i b,
+   __m128i pr, __m128i pg, __m128i pb,
+   __m128i wr, __m128i wg, __m128i wb,
+   __m128i& lo, __m128i& hi)
+{
+   const __m128i zero = _mm_setzero_si128();
+
+   __m128i dr = _mm_sub_epi16(r, pr);
+   __m128i dg = _mm_sub_epi16(g, pg);
+   __m128i db = _mm_sub_epi16(b, pb);
+
+   __m128i wdr = _mm_mullo_epi16(dr, wr);
+   __m128i wdg = _mm_mullo_epi16(dg, wg);
+   __m128i wdb = _mm_mullo_epi16(db, wb);
+
+   lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(dr, dg), _mm_unpacklo_epi16(wdr, wdg)), _mm_madd_epi16(_mm_unpacklo_epi16(db, zero), _mm_unpacklo_epi16(wdb, zero)));
+   hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(dr, dg), _mm_unpackhi_epi16(wdr, wdg)), _mm_madd_epi16(_mm_unpackhi_epi16(db, zero), _mm_unpackhi_epi16(wdb, zero)));
+}
+
+// Adds dist[i] * weights[i] to the two 64-bit lanes of acc.
+static inline __m128i accumulate_weighted(__m128i acc, __m128i dist, __m128i weights)
+{
+   __m128i even = _mm_mul_epu32(dist, weights);
+   __m128i odd = _mm_mul_epu32(_mm_srli_epi64(dist, 32), _mm_srli_epi64(weights, 32));
+   return _mm_add_epi64(acc, _mm_add_epi64(even, odd));
+}
+
+static inline uint64 horizontal_sum(__m128i acc)
+{
+   uint64 sums[2];
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), acc);
+   return sums[0] + sums[1];
+}
+
+// Writes the low byte of each of the 8 16-bit lanes of sel.
+static inline void store_selectors(uint8* pDst, uint n, __m128i sel)
+{
+   sel = _mm_packus_epi16(sel, sel);
+   if (n >= 8)
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst), sel);
+   else
+   {
+      uint8 tmp[16];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(tmp), sel);
+      memcpy(pDst, tmp, n);
+   }
+}
+
+template<uint num_palette_colors, typename source>
+static uint64 find_best_selectors(
+   const source& src,
+   const color_quad_u8* pPalette,
+   const int* pComp_weights,
+   uint64 max_error,
+   uint8* pSelectors)
+{
+   const __m128i wr = _mm_set1_epi16(static_cast<int16>(pComp_weights[0]));
+   const __m128i wg = _mm_set1_epi16(static_cast<int16>(pComp_weights[1]));
+   const __m128i wb = _mm_set1_epi16(static_cast<int16>(pComp_weights[2]));
+
+   __m128i pr[num_palette_colors], pg[num_palette_colors], pb[num_palette_colors];
+   for (uint k = 0; k < num_palette_colors; k++)
+   {
+      pr[k] = _mm_set1_epi16(pPalette[k].r);
+      pg[k] = _mm_set1_epi16(pPalette[k].g);
+      pb[k] = _mm_set1_epi16(pPalette[k].b);
+   }
+
+   __m128i acc = _mm_setzero_si128();
+   uint64 total_error = 0;
+
+   for (uint i = 0; i < src.m_num_colors; i += 8)
+   {
+      __m128i r, g, b, w_lo, w_hi;
+      src.load(i, r, g, b, w_lo, w_hi);
+
+      __m128i best_lo, best_hi;
+      color_distance8(r, g, b, pr[0], pg[0], pb[0], wr, wg, wb, best_lo, best_hi);
+
+      __m128i index_lo = _mm_setzero_si128();
+      __m128i index_hi = _mm_setzero_si128();
+
+      for (uint k = 1; k < num_palette_colors; k++)
+      {
+         __m128i dist_lo, dist_hi;
+         color_distance8(r, g, b, pr[k], pg[k], pb[k], wr, wg, wb, dist_lo, dist_hi);
+
+         const __m128i kv = _mm_set1_epi32(k);
+         const __m128i less_lo = _mm_cmplt_epi32(dist_lo, best_lo);
+         const __m128i less_hi = _mm_cmplt_epi32(dist_hi, best_hi);
+
+#if CRNLIB_DXT1_KERNELS_SSE41
+         best_lo = _mm_min_epi32(dist_lo, best_lo);
+         best_hi = _mm_min_epi32(dist_hi, best_hi);
+#else
+         best_lo = select_si128(less_lo, dist_lo, best_lo);
+         best_hi = select_si128(less_hi, dist_hi, best_hi);
+#endif
+         index_lo = select_si128(less_lo, kv, index_lo);
+         index_hi = select_si128(less_hi, kv, index_hi);
+      }
+
+      acc = accumulate_weighted(acc, best_lo, w_lo);
+      acc = accumulate_weighted(acc, best_hi, w_hi);
+
+      total_error = horizontal_sum(acc);
+      if (total_error >= max_error)
+         break;
+
+      if (pSelectors)
+         store_selectors(pSelectors + i, src.m_num_colors - i, _mm_packs_epi32(index_lo, index_hi));
+   }
+
+   return total_error;
+}
+
+template<uint num_palette_colors, typename source>
+static uint64 find_projected_selectors(
+   const source& src,
+   const color_quad_u8* pPalette,
+   const int* pDir, const int* pPoints,
+   const int* pComp_weights,
+   uint64 max_error,
+   uint8* pSelectors)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i one = _mm_set1_epi16(1);
+   const __m128i two = _mm_set1_epi16(2);
+
+   const __m128i wr = _mm_set1_epi16(static_cast<int16>(pComp_weights[0]));
+   const __m128i wg = _mm_set1_epi16(static_cast<int16>(pComp_weights[1]));
+   const __m128i wb = _mm_set1_epi16(static_cast<int16>(pComp_weights[2]));
+
+   const __m128i dir_rg = _mm_set1_epi32((static_cast<uint>(pDir[1]) << 16) | (static_cast<uint>(pDir[0]) & 0xFFFF));
+   const __m128i dir_b = _mm_set1_epi32(static_cast<uint>(pDir[2]) & 0xFFFF);
+
+   const __m128i point0 = _mm_set1_epi32(pPoints[0]);
+   const __m128i point1 = _mm_set1_epi32(pPoints[1]);
+   const __m128i point2 = _mm_set1_epi32((num_palette_colors == 4) ? pPoints[2] : 0);
+
+   __m128i pr[num_palette_colors], pg[num_palette_colors], pb[num_palette_colors];
+   for (uint k = 0; k < num_palette_colors; k++)
+   {
+      pr[k] = _mm_set1_epi16(pPalette[k].r);
+      pg[k] = _mm_set1_epi16(pPalette[k].g);
+      pb[k] = _mm_set1_epi16(pPalette[k].b);
+   }
+
+   __m128i acc = zero;
+   uint64 total_error = 0;
+
+   for (uint i = 0; i < src.m_num_colors; i += 8)
+   {
+      __m128i r, g, b, w_lo, w_hi;
+      src.load(i, r, g, b, w_lo, w_hi);
+
+      const __m128i dot_lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(r, g), dir_rg), _mm_madd_epi16(_mm_unpacklo_epi16(b, zero), dir_b));
+      const __m128i dot_hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(r, g), dir_rg), _mm_madd_epi16(_mm_unpackhi_epi16(b, zero), dir_b));
+
+      const __m128i below0 = _mm_packs_epi32(_mm_cmplt_epi32(dot_lo, point0), _mm_cmplt_epi32(dot_hi, point0));
+      const __m128i below1 = _mm_packs_epi32(_mm_cmplt_epi32(dot_lo, point1), _mm_cmplt_epi32(dot_hi, point1));
+
+      __m128i sel;
+      if (num_palette_colors == 4)
+      {
+         // dot < half ? (dot < c3 ? 0 : 2) : (dot < c0 ? 3 : 1)
+         const __m128i below2 = _mm_packs_epi32(_mm_cmplt_epi32(dot_lo, point2), _mm_cmplt_epi32(dot_hi, point2));
+         sel = select_si128(below0, _mm_andnot_si128(below1, two), _mm_or_si128(one, _mm_and_si128(below2, two)));
+      }
+      else
+      {
+         // dot < c02 ? 0 : (dot < c21 ? 2 : 1)
+         sel = _mm_andnot_si128(below0, select_si128(below1, two, one));
+      }
+
+      __m128i sr = pr[0], sg = pg[0], sb = pb[0];
+      for (uint k = 1; k < num_palette_colors; k++)
+      {
+         const __m128i is_k = _mm_cmpeq_epi16(sel, _mm_set1_epi16(static_cast<int16>(k)));
+         sr = select_si128(is_k, pr[k], sr);
+         sg = select_si128(is_k, pg[k], sg);
+         sb = select_si128(is_k, pb[k], sb);
+      }
+
+      __m128i dist_lo, dist_hi;
+      color_distance8(r, g, b, sr, sg, sb, wr, wg, wb, dist_lo, dist_hi);
+
+      acc = accumulate_weighted(acc, dist_lo, w_lo);
+      acc = accumulate_weighted(acc, dist_hi, w_hi);
+
+      total_error = horizontal_sum(acc);
+      if (total_error >= max_error)
+         break;
+
+      if (pSelectors)
+         store_selectors(pSelectors + i, src.m_num_colors - i, sel);
+   }
+
+   return total_error;
+}
@@ -4,6 +4,7 @@
 #include "crn_core.h"
 #include "crn_dxt_fast.h"
 #include "crn_ryg_dxt.hpp"
+#include "crn_dxt1_kernels.h"
 
 namespace crnlib
 {
@@ -55,10 +56,12 @@ namespace crnlib
          pColors[2].r = (pColors[0].r*2+pColors[1].r)/3;
          pColors[2].g = (pColors[0].g*2+pColors[1].g)/3;
          pColors[2].b = (pColors[0].b*2+pColors[1].b)/3;
+         pColors[2].a = 0;
          
          pColors[3].r = (pColors[1].r*2+pColors[0].r)/3;
          pColors[3].g = (pColors[1].g*2+pColors[0].g)/3;
          pColors[3].b = (pColors[1].b*2+pColors[0].b)/3;
+         pColors[3].a = 0;
 #endif         
       }
       
@@ -336,39 +339,14 @@ namespace crnlib
          halfPoint >>= 1;
          c3Point >>= 1;
 
-         uint64 total_error = 0;
-         
-         for (uint i = 0; i < n; i++)
-         {
-            const color_quad_u8& a = block[i];
-            
-            uint s = 0;
-            if (min16 != max16)
-            {
-               int dot = a.r*dirr + a.g*dirg + a.b*dirb;
-
-               if (dot < halfPoint)
-                  s = (dot < c0Point) ? 1 : 3;
-               else
-                  s = (dot < c3Point) ? 2 : 0;
-            }                  
-         
-            const color_quad_u8& b = color[s];
-
-            int e = a[0] - b[0];
-            total_error += e * e;
+         // The kernels' 4 color palette order is 0 2 3 1 from the low endpoint, so swap each pair of colors: kernel selector k is selector k^1 here.
+         // When min16 == max16 the direction is zero, every dot product lands on color[0], and the result matches the solid case.
+         const color_quad_u8 palette[4] = { color[1], color[0], color[3], color[2] };
+         const int dir[3] = { dirr, dirg, dirb };
+         const int points[3] = { halfPoint, c0Point, c3Point };
+         const int comp_weights[3] = { 1, 1, 1 };
 
-            e = a[1] - b[1];
-            total_error += e * e;
-
-            e = a[2] - b[2];
-            total_error += e * e;
-            
-            if (total_error >= early_out_error)
-               break;
-         }
-         
-         return total_error;
+         return dxt1_kernels::find_projected_selectors(block, n, palette, 4, dir, points, comp_weights, early_out_error, NULL);
       }
                   
       static bool refine_endpoints(uint n, const color_quad_u8* pBlock, uint& low16, uint& high16, uint8* pSelectors)
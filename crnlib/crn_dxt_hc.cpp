@@ -5,6 +5,7 @@
 #include "crn_image_utils.h"
 #include "crn_console.h"
 #include "crn_dxt_fast.h"
+#include "crn_timer.h"
 
 #define CRNLIB_USE_FAST_DXT 1
 #define CRNLIB_ENABLE_DEBUG_MESSAGES 0
@@ -36,6 +37,9 @@ namespace crnlib
       m_main_thread_id(crn_get_current_thread_id()),
       m_canceled(false),
       m_pTask_pool(NULL),
+      m_pPhase(NULL),
+      m_pAnalysis(NULL),
+      m_reuse_analysis(false),
       m_prev_phase_index(-1),
       m_prev_percentage_complete(-1)
    {
@@ -95,25 +99,57 @@ namespace crnlib
 
       m_dbg_chunk_pixels_final.clear();
 
+      m_phase_stats.clear();
+
       m_canceled = false;
 
       m_prev_phase_index = -1;
       m_prev_percentage_complete = -1;
    }
 
-   bool dxt_hc::compress(const params& p, uint num_chunks, const pixel_chunk* pChunks, task_pool& task_pool)
+   void dxt_hc::chunk_analysis::clear()
+   {
+      m_valid = false;
+
+      for (uint i = 0; i < cNumCompressedChunkVecs; i++)
+         m_compressed_chunks[i].clear();
+      utils::zero_object(m_encoding_hist);
+      m_total_tiles = 0;
+
+      m_color_training_vecs.clear();
+      m_color_vq.clear();
+
+      m_alpha_clusters_state.m_vq.clear();
+      for (uint i = 0; i < 2; i++)
+         m_alpha_clusters_state.m_training_vecs[i].clear();
+   }
+
+   bool dxt_hc::compress(const params& p, uint num_chunks, const pixel_chunk* pChunks, task_pool& task_pool, chunk_analysis* pAnalysis)
    {
       m_pTask_pool = &task_pool;
       m_main_thread_id = crn_get_current_thread_id();
 
+      // The debug images of the first stage aren't kept, so always redo it when debugging.
+      m_pAnalysis = pAnalysis;
+      m_reuse_analysis = (pAnalysis) && (pAnalysis->m_valid) && (!p.m_debugging);
+      if ((pAnalysis) && (!m_reuse_analysis))
+         pAnalysis->clear();
+
       bool result = compress_internal(p, num_chunks, pChunks);
 
+      if ((pAnalysis) && (result))
+         pAnalysis->m_valid = true;
+
+      if ((result) && (m_params.m_debugging))
+         print_phase_stats();
+
       m_pTask_pool = NULL;
+      m_pAnalysis = NULL;
 
       return result;
    }
 
-   bool dxt_hc::compress_internal(const params& p, uint num_chunks, const pixel_chunk* pChunks)
+   bool dxt_hc::init_chunks(const params& p, uint num_chunks, const pixel_chunk* pChunks)
    {
       if ((!num_chunks) || (!pChunks))
          return false;
@@ -130,6 +166,7 @@ namespace crnlib
       switch (m_params.m_format)
       {
          case cDXT1:
+         case cETC1:
          {
             m_has_color_blocks = true;
             break;
@@ -161,7 +198,38 @@ namespace crnlib
          }
       }
 
-      determine_compressed_chunks();
+      return true;
+   }
+
+   bool dxt_hc::compress_internal(const params& p, uint num_chunks, const pixel_chunk* pChunks)
+   {
+      if (!init_chunks(p, num_chunks, pChunks))
+         return false;
+
+      if (m_reuse_analysis)
+      {
+         CRNLIB_ASSERT(m_pAnalysis->m_compressed_chunks[m_has_color_blocks ? cColorChunks : cAlpha0Chunks].size() == m_num_chunks);
+
+         for (uint i = 0; i < cNumCompressedChunkVecs; i++)
+            m_compressed_chunks[i] = m_pAnalysis->m_compressed_chunks[i];
+         for (uint i = 0; i < cNumChunkEncodings; i++)
+            m_encoding_hist[i] = m_pAnalysis->m_encoding_hist[i];
+         m_total_tiles = m_pAnalysis->m_total_tiles;
+      }
+      else
+      {
+         if (!determine_compressed_chunks())
+            return false;
+
+         if (m_pAnalysis)
+         {
+            for (uint i = 0; i < cNumCompressedChunkVecs; i++)
+               m_pAnalysis->m_compressed_chunks[i] = m_compressed_chunks[i];
+            for (uint i = 0; i < cNumChunkEncodings; i++)
+               m_pAnalysis->m_encoding_hist[i] = m_encoding_hist[i];
+            m_pAnalysis->m_total_tiles = m_total_tiles;
+         }
+      }
 
       if (m_has_color_blocks)
       {
@@ -187,40 +255,636 @@ namespace crnlib
             return false;
       }
 
-      if (m_num_alpha_blocks)
-      {
-         if (!create_selector_codebook(true))
-            return false;
+      if (m_num_alpha_blocks)
+      {
+         if (!create_selector_codebook(true))
+            return false;
+      }
+
+      if (m_has_color_blocks)
+      {
+         if (!refine_quantized_color_selectors())
+            return false;
+
+         if (!refine_quantized_color_endpoints())
+            return false;
+      }
+
+      if (m_num_alpha_blocks)
+      {
+         if (!refine_quantized_alpha_endpoints())
+            return false;
+
+         if (!refine_quantized_alpha_selectors())
+            return false;
+      }
+
+      create_final_debug_image();
+
+      if (!create_chunk_encodings())
+         return false;
+
+      return true;
+   }
+
+   // A chunk is requantized by compress_incremental() if its previous encoding's error, divided by the error of the best unconstrained DXTn
+   // encoding of its blocks, is more than cIncrementalChangedRatio times the median of that ratio over all chunks.
+   const float cIncrementalChangedRatio = 2.0f;
+
+   // Number of codebook endpoints (closest to a block's own DXTn endpoints) whose combinations with every codebook selector are tried when
+   // requantizing the block. The block's previous endpoint is always tried too.
+   const uint cIncrementalEndpointCandidates = 4;
+
+   // Added for each pixel of a plain DXT1 block using the fourth color of a 3 color endpoint pair, which is transparent black.
+   // (Formats with alpha, where those pixels may be meant to be transparent, are never penalized.)
+   const uint cIncrementalTransparentPenalty = 999999;
+
+   struct dxt_hc::incremental_state
+   {
+      incremental_state() : m_pCodebooks(NULL), m_pPrev_encodings(NULL), m_error_floor(0), m_max_ratio(0.0f) { }
+
+      const codebooks* m_pCodebooks;
+      const chunk_encoding_vec* m_pPrev_encodings;
+
+      // The colors (4 per endpoint) and alpha values (8 per endpoint) the codebook endpoints expand to, indexed by selector.
+      crnlib::vector<color_quad_u8> m_endpoint_colors;
+      // Whether selector 3 of each endpoint pair gets cIncrementalTransparentPenalty.
+      crnlib::vector<bool> m_endpoint_transparent;
+      crnlib::vector<uint8> m_endpoint_values;
+
+      struct chunk_errors
+      {
+         uint64 m_prev;
+         uint64 m_ideal;
+         uint64 m_final;
+         bool m_requantize;
+      };
+      crnlib::vector<chunk_errors> m_chunks;
+
+      // Added to both errors of the ratio, so chunks the codebooks encode almost perfectly don't look changed because of tiny differences.
+      uint m_error_floor;
+
+      // Chunks with a higher ratio are requantized.
+      float m_max_ratio;
+   };
+
+   static uint get_chunk_block_tile(const chunk_encoding_desc& desc, uint block_x, uint block_y)
+   {
+      const uint x = block_x * cBlockPixelWidth, y = block_y * cBlockPixelHeight;
+      for (uint t = 0; t < desc.m_num_tiles; t++)
+      {
+         const chunk_tile_desc& tile = desc.m_tiles[t];
+         if ((x >= tile.m_x_ofs) && (x < tile.m_x_ofs + tile.m_width) && (y >= tile.m_y_ofs) && (y < tile.m_y_ofs + tile.m_height))
+            return t;
+      }
+      CRNLIB_ASSERT(0);
+      return 0;
+   }
+
+   void dxt_hc::set_chunk_encoding_tiles(chunk_encoding& encoding, const uint16 block_endpoint_indices[3][cChunkBlockHeight][cChunkBlockWidth], bool hierarchical)
+   {
+      // The encodings are ordered by their number of tiles.
+      uint e;
+      for (e = hierarchical ? 0 : (cNumChunkEncodings - 1); e < (cNumChunkEncodings - 1); e++)
+      {
+         const chunk_encoding_desc& desc = g_chunk_encodings[e];
+
+         bool fits = true;
+         for (uint by = 0; (by < cChunkBlockHeight) && (fits); by++)
+         {
+            for (uint bx = 0; (bx < cChunkBlockWidth) && (fits); bx++)
+            {
+               const chunk_tile_desc& tile = desc.m_tiles[get_chunk_block_tile(desc, bx, by)];
+               const uint tile_bx = tile.m_x_ofs / cBlockPixelWidth, tile_by = tile.m_y_ofs / cBlockPixelHeight;
+
+               for (uint q = 0; q < 3; q++)
+                  if (block_endpoint_indices[q][by][bx] != block_endpoint_indices[q][tile_by][tile_bx])
+                     fits = false;
+            }
+         }
+
+         if (fits)
+            break;
+      }
+
+      const chunk_encoding_desc& desc = g_chunk_encodings[e];
+
+      encoding.m_encoding_index = static_cast<uint8>(e);
+      encoding.m_num_tiles = static_cast<uint8>(desc.m_num_tiles);
+
+      for (uint t = 0; t < desc.m_num_tiles; t++)
+      {
+         const chunk_tile_desc& tile = desc.m_tiles[t];
+         for (uint q = 0; q < 3; q++)
+            encoding.m_endpoint_indices[q][t] = block_endpoint_indices[q][tile.m_y_ofs / cBlockPixelHeight][tile.m_x_ofs / cBlockPixelWidth];
+      }
+   }
+
+   bool dxt_hc::compress_incremental(const params& p, uint num_chunks, const pixel_chunk* pChunks, const codebooks& cb, const chunk_encoding_vec& prev_encodings,
+      float max_error_increase, task_pool& task_pool)
+   {
+      m_pTask_pool = &task_pool;
+      m_main_thread_id = crn_get_current_thread_id();
+
+      bool result = compress_incremental_internal(p, num_chunks, pChunks, cb, prev_encodings, max_error_increase);
+
+      if ((result) && (m_params.m_debugging))
+         print_phase_stats();
+
+      m_pTask_pool = NULL;
+
+      return result;
+   }
+
+   bool dxt_hc::compress_incremental_internal(const params& p, uint num_chunks, const pixel_chunk* pChunks, const codebooks& cb, const chunk_encoding_vec& prev_encodings,
+      float max_error_increase)
+   {
+      if (!init_chunks(p, num_chunks, pChunks))
+         return false;
+
+      if ((m_params.m_format == cETC1) || (prev_encodings.size() != m_num_chunks))
+         return false;
+      if ((m_has_color_blocks) && ((cb.m_color_endpoints.empty()) || (cb.m_color_selectors.empty())))
+         return false;
+      if ((m_num_alpha_blocks) && ((cb.m_alpha_endpoints.empty()) || (cb.m_alpha_selectors.empty())))
+         return false;
+
+      for (uint chunk_index = 0; chunk_index < m_num_chunks; chunk_index++)
+      {
+         const chunk_encoding& encoding = prev_encodings[chunk_index];
+         if ((encoding.m_encoding_index >= cNumChunkEncodings) || (encoding.m_num_tiles != g_chunk_encodings[encoding.m_encoding_index].m_num_tiles))
+            return false;
+
+         for (uint q = 0; q < cNumCompressedChunkVecs; q++)
+         {
+            if (q == cColorChunks ? !m_has_color_blocks : (q > m_num_alpha_blocks))
+               continue;
+
+            const uint num_endpoints = q ? cb.m_alpha_endpoints.size() : cb.m_color_endpoints.size();
+            const uint num_selectors = q ? cb.m_alpha_selectors.size() : cb.m_color_selectors.size();
+
+            for (uint t = 0; t < encoding.m_num_tiles; t++)
+               if (encoding.m_endpoint_indices[q][t] >= num_endpoints)
+                  return false;
+
+            for (uint y = 0; y < cChunkBlockHeight; y++)
+               for (uint x = 0; x < cChunkBlockWidth; x++)
+                  if (encoding.m_selector_indices[q][y][x] >= num_selectors)
+                     return false;
+         }
+      }
+
+      incremental_state state;
+      state.m_pCodebooks = &cb;
+      state.m_pPrev_encodings = &prev_encodings;
+
+      if (m_has_color_blocks)
+      {
+         state.m_endpoint_colors.resize(cb.m_color_endpoints.size() * cDXT1SelectorValues);
+         state.m_endpoint_transparent.resize(cb.m_color_endpoints.size());
+         for (uint i = 0; i < cb.m_color_endpoints.size(); i++)
+         {
+            const uint16 color0 = static_cast<uint16>(cb.m_color_endpoints[i] & 0xFFFF);
+            const uint16 color1 = static_cast<uint16>(cb.m_color_endpoints[i] >> 16U);
+            dxt1_block::get_block_colors(&state.m_endpoint_colors[i * cDXT1SelectorValues], color0, color1);
+            state.m_endpoint_transparent[i] = (m_params.m_format == cDXT1) && (color0 <= color1);
+         }
+
+         state.m_error_floor += cChunkPixelWidth * cChunkPixelHeight * color::color_distance(m_params.m_perceptual, color_quad_u8(0, 0, 0, 255), color_quad_u8(2, 2, 2, 255), false);
+      }
+
+      if (m_num_alpha_blocks)
+      {
+         state.m_endpoint_values.resize(cb.m_alpha_endpoints.size() * cDXT5SelectorValues);
+         for (uint i = 0; i < cb.m_alpha_endpoints.size(); i++)
+         {
+            uint values[cDXT5SelectorValues];
+            dxt5_block::get_block_values(values, cb.m_alpha_endpoints[i] & 0xFF, (cb.m_alpha_endpoints[i] >> 8U) & 0xFF);
+            for (uint s = 0; s < cDXT5SelectorValues; s++)
+               state.m_endpoint_values[i * cDXT5SelectorValues + s] = static_cast<uint8>(values[s]);
+         }
+
+         state.m_error_floor += m_num_alpha_blocks * cChunkPixelWidth * cChunkPixelHeight * 2 * 2;
+      }
+
+      state.m_chunks.resize(m_num_chunks);
+      m_chunk_encoding = prev_encodings;
+
+      if (!run_phase("incremental analysis", m_num_chunks, &dxt_hc::analyze_incremental_chunks_task, &state))
+         return false;
+
+      crnlib::vector<float> ratios(m_num_chunks);
+      for (uint i = 0; i < m_num_chunks; i++)
+         ratios[i] = static_cast<float>(state.m_chunks[i].m_prev + state.m_error_floor) / static_cast<float>(state.m_chunks[i].m_ideal + state.m_error_floor);
+
+      std::nth_element(ratios.begin(), ratios.begin() + m_num_chunks / 2, ratios.end());
+      const float median_ratio = ratios[m_num_chunks / 2];
+      state.m_max_ratio = median_ratio * cIncrementalChangedRatio;
+
+      if (!run_phase("incremental requantization", m_num_chunks, &dxt_hc::requantize_incremental_chunks_task, &state))
+         return false;
+
+      // How much more error the requantized chunks have than they would at the median ratio, relative to the total.
+      uint num_requantized = 0;
+      double total_error = 0.0, requantized_error = 0.0, requantized_ideal_error = 0.0;
+      for (uint i = 0; i < m_num_chunks; i++)
+      {
+         const incremental_state::chunk_errors& errors = state.m_chunks[i];
+         total_error += static_cast<double>(errors.m_final + state.m_error_floor);
+         if (errors.m_requantize)
+         {
+            num_requantized++;
+            requantized_error += static_cast<double>(errors.m_final + state.m_error_floor);
+            requantized_ideal_error += static_cast<double>(errors.m_ideal + state.m_error_floor);
+         }
+      }
+
+      const double error_increase = (requantized_error - requantized_ideal_error * median_ratio) / total_error;
+
+      if (m_params.m_debugging)
+         console::debug("Incremental compression: %u of %u chunks requantized, median error ratio %3.3f, error increase %3.2f%%", num_requantized, m_num_chunks, median_ratio, error_increase * 100.0f);
+
+      if (error_increase > max_error_increase)
+         return false;
+
+      compact_incremental_codebooks(cb);
+
+      return true;
+   }
+
+   uint dxt_hc::get_incremental_block_error(const incremental_state& state, uint chunk_index, uint q, uint block_x, uint block_y, uint endpoint_index, uint selector_index, uint max_error) const
+   {
+      const color_quad_u8* pPixels = &m_pChunks[chunk_index].m_blocks[block_y][block_x].m_pixels[0][0];
+
+      uint error = 0;
+
+      if (q == cColorChunks)
+      {
+         const selectors& sel = state.m_pCodebooks->m_color_selectors[selector_index];
+         const color_quad_u8* pColors = &state.m_endpoint_colors[endpoint_index * cDXT1SelectorValues];
+         const bool transparent = state.m_endpoint_transparent[endpoint_index];
+
+         for (uint i = 0; (i < cBlockPixelWidth * cBlockPixelHeight) && (error <= max_error); i++)
+         {
+            const uint s = sel.get_by_index(i);
+            error += color::color_distance(m_params.m_perceptual, pPixels[i], pColors[s], false);
+            if ((transparent) && (s == 3))
+               error += cIncrementalTransparentPenalty;
+         }
+      }
+      else
+      {
+         const selectors& sel = state.m_pCodebooks->m_alpha_selectors[selector_index];
+         const uint8* pValues = &state.m_endpoint_values[endpoint_index * cDXT5SelectorValues];
+         const uint comp_index = m_params.m_alpha_component_indices[q - cAlpha0Chunks];
+
+         for (uint i = 0; (i < cBlockPixelWidth * cBlockPixelHeight) && (error <= max_error); i++)
+            error += math::square(static_cast<int>(pPixels[i][comp_index]) - static_cast<int>(pValues[sel.get_by_index(i)]));
+      }
+
+      return error;
+   }
+
+   uint dxt_hc::get_ideal_block_error(uint chunk_index, uint q, uint block_x, uint block_y) const
+   {
+      const color_quad_u8* pPixels = &m_pChunks[chunk_index].m_blocks[block_y][block_x].m_pixels[0][0];
+      const uint num_pixels = cBlockPixelWidth * cBlockPixelHeight;
+
+      uint8 block_selectors[cBlockPixelWidth * cBlockPixelHeight];
+      uint error = 0;
+
+      if (q == cColorChunks)
+      {
+         uint low16, high16;
+         dxt_fast::compress_color_block(num_pixels, pPixels, low16, high16, block_selectors);
+
+         color_quad_u8 colors[cDXT1SelectorValues];
+         dxt1_block::get_block_colors4(colors, static_cast<uint16>(low16), static_cast<uint16>(high16));
+
+         for (uint i = 0; i < num_pixels; i++)
+         {
+            uint best_error = UINT_MAX;
+            for (uint s = 0; s < cDXT1SelectorValues; s++)
+               best_error = math::minimum(best_error, color::color_distance(m_params.m_perceptual, pPixels[i], colors[s], false));
+            error += best_error;
+         }
+      }
+      else
+      {
+         const uint comp_index = m_params.m_alpha_component_indices[q - cAlpha0Chunks];
+
+         uint low8, high8;
+         dxt_fast::compress_alpha_block(num_pixels, pPixels, low8, high8, block_selectors, comp_index);
+
+         uint values[cDXT5SelectorValues];
+         dxt5_block::get_block_values(values, low8, high8);
+
+         for (uint i = 0; i < num_pixels; i++)
+         {
+            uint best_error = UINT_MAX;
+            for (uint s = 0; s < cDXT5SelectorValues; s++)
+               best_error = math::minimum<uint>(best_error, math::square(static_cast<int>(pPixels[i][comp_index]) - static_cast<int>(values[s])));
+            error += best_error;
+         }
+      }
+
+      return error;
+   }
+
+   // Finds the codebook endpoint and selector that encode a block best, among the combinations of every selector with the block's previous
+   // endpoint and the endpoints closest to the block's own DXTn endpoints. Returns the block's error.
+   uint dxt_hc::requantize_incremental_block(const incremental_state& state, uint chunk_index, uint q, uint block_x, uint block_y, uint prev_endpoint_index,
+      uint16& endpoint_index, uint16& selector_index) const
+   {
+      const color_quad_u8* pPixels = &m_pChunks[chunk_index].m_blocks[block_y][block_x].m_pixels[0][0];
+      const uint num_pixels = cBlockPixelWidth * cBlockPixelHeight;
+      const bool color = q == cColorChunks;
+      const uint comp_index = color ? 0 : m_params.m_alpha_component_indices[q - cAlpha0Chunks];
+
+      // The block's own endpoints, as colors or alpha values.
+      uint8 block_selectors[cBlockPixelWidth * cBlockPixelHeight];
+      color_quad_u8 block_lo, block_hi;
+      if (color)
+      {
+         uint low16, high16;
+         dxt_fast::compress_color_block(num_pixels, pPixels, low16, high16, block_selectors);
+         block_lo = dxt1_block::unpack_color(static_cast<uint16>(low16), true);
+         block_hi = dxt1_block::unpack_color(static_cast<uint16>(high16), true);
+      }
+      else
+      {
+         uint low8, high8;
+         dxt_fast::compress_alpha_block(num_pixels, pPixels, low8, high8, block_selectors, comp_index);
+         block_lo.set(low8, low8, low8, 255);
+         block_hi.set(high8, high8, high8, 255);
+      }
+
+      uint candidates[cIncrementalEndpointCandidates + 1];
+      uint candidate_dists[cIncrementalEndpointCandidates];
+      uint num_candidates = 0;
+
+      const uint num_endpoints = color ? state.m_pCodebooks->m_color_endpoints.size() : state.m_pCodebooks->m_alpha_endpoints.size();
+      for (uint e = 0; e < num_endpoints; e++)
+      {
+         color_quad_u8 lo, hi;
+         if (color)
+         {
+            lo = state.m_endpoint_colors[e * cDXT1SelectorValues];
+            hi = state.m_endpoint_colors[e * cDXT1SelectorValues + 1];
+         }
+         else
+         {
+            const uint8 l = state.m_endpoint_values[e * cDXT5SelectorValues], h = state.m_endpoint_values[e * cDXT5SelectorValues + 1];
+            lo.set(l, l, l, 255);
+            hi.set(h, h, h, 255);
+         }
+
+         // Either endpoint order works, as the selectors can be swapped.
+         const uint dist = math::minimum(
+            color::elucidian_distance(lo, block_lo, false) + color::elucidian_distance(hi, block_hi, false),
+            color::elucidian_distance(lo, block_hi, false) + color::elucidian_distance(hi, block_lo, false));
+
+         if ((num_candidates == cIncrementalEndpointCandidates) && (dist >= candidate_dists[num_candidates - 1]))
+            continue;
+
+         uint i = math::minimum(num_candidates, cIncrementalEndpointCandidates - 1);
+         for ( ; (i > 0) && (candidate_dists[i - 1] > dist); i--)
+         {
+            candidates[i] = candidates[i - 1];
+            candidate_dists[i] = candidate_dists[i - 1];
+         }
+         candidates[i] = e;
+         candidate_dists[i] = dist;
+
+         num_candidates = math::minimum(num_candidates + 1, cIncrementalEndpointCandidates);
+      }
+
+      uint i;
+      for (i = 0; i < num_candidates; i++)
+         if (candidates[i] == prev_endpoint_index)
+            break;
+      if (i == num_candidates)
+         candidates[num_candidates++] = prev_endpoint_index;
+
+      const selectors_vec& codebook_selectors = color ? state.m_pCodebooks->m_color_selectors : state.m_pCodebooks->m_alpha_selectors;
+
+      uint best_error = UINT_MAX;
+      endpoint_index = static_cast<uint16>(prev_endpoint_index);
+      selector_index = 0;
+
+      for (uint c = 0; c < num_candidates; c++)
+      {
+         const uint e = candidates[c];
+
+         // The error of each pixel at each selector value, so each codebook selector only costs a table lookup per pixel.
+         uint pixel_errors[cBlockPixelWidth * cBlockPixelHeight][cDXT5SelectorValues];
+         if (color)
+         {
+            const color_quad_u8* pColors = &state.m_endpoint_colors[e * cDXT1SelectorValues];
+            for (uint p = 0; p < num_pixels; p++)
+            {
+               for (uint s = 0; s < cDXT1SelectorValues; s++)
+                  pixel_errors[p][s] = color::color_distance(m_params.m_perceptual, pPixels[p], pColors[s], false);
+               if (state.m_endpoint_transparent[e])
+                  pixel_errors[p][3] += cIncrementalTransparentPenalty;
+            }
+         }
+         else
+         {
+            const uint8* pValues = &state.m_endpoint_values[e * cDXT5SelectorValues];
+            for (uint p = 0; p < num_pixels; p++)
+               for (uint s = 0; s < cDXT5SelectorValues; s++)
+                  pixel_errors[p][s] = math::square(static_cast<int>(pPixels[p][comp_index]) - static_cast<int>(pValues[s]));
+         }
+
+         for (uint s = 0; s < codebook_selectors.size(); s++)
+         {
+            const uint8* pSelectors = &codebook_selectors[s].m_selectors[0][0];
+
+            uint error = 0;
+            for (uint p = 0; (p < num_pixels) && (error < best_error); p++)
+               error += pixel_errors[p][pSelectors[p]];
+
+            if (error < best_error)
+            {
+               best_error = error;
+               endpoint_index = static_cast<uint16>(e);
+               selector_index = static_cast<uint16>(s);
+            }
+         }
+      }
+
+      return best_error;
+   }
+
+   void dxt_hc::analyze_incremental_chunks_task(uint64 data, void* pData_ptr)
+   {
+      data;
+      incremental_state& state = *static_cast<incremental_state*>(pData_ptr);
+
+      work_cursor cursor;
+      uint chunk_index;
+      while (get_next_work_item(cursor, chunk_index))
+      {
+         if (m_canceled)
+            return;
+
+         if ((cursor.m_new_range) && (crn_get_current_thread_id() == m_main_thread_id))
+         {
+            if (!update_progress(0, chunk_index, m_num_chunks))
+               return;
+         }
+
+         const chunk_encoding& encoding = (*state.m_pPrev_encodings)[chunk_index];
+         const chunk_encoding_desc& desc = g_chunk_encodings[encoding.m_encoding_index];
+
+         uint64 prev_error = 0, ideal_error = 0;
+
+         for (uint q = 0; q < cNumCompressedChunkVecs; q++)
+         {
+            if (q == cColorChunks ? !m_has_color_blocks : (q > m_num_alpha_blocks))
+               continue;
+
+            for (uint by = 0; by < cChunkBlockHeight; by++)
+            {
+               for (uint bx = 0; bx < cChunkBlockWidth; bx++)
+               {
+                  const uint endpoint_index = encoding.m_endpoint_indices[q][get_chunk_block_tile(desc, bx, by)];
+                  prev_error += get_incremental_block_error(state, chunk_index, q, bx, by, endpoint_index, encoding.m_selector_indices[q][by][bx]);
+                  ideal_error += get_ideal_block_error(chunk_index, q, bx, by);
+               }
+            }
+         }
+
+         incremental_state::chunk_errors& errors = state.m_chunks[chunk_index];
+         errors.m_prev = prev_error;
+         errors.m_ideal = ideal_error;
+         errors.m_final = prev_error;
+         errors.m_requantize = false;
+      }
+   }
+
+   void dxt_hc::requantize_incremental_chunks_task(uint64 data, void* pData_ptr)
+   {
+      data;
+      incremental_state& state = *static_cast<incremental_state*>(pData_ptr);
+
+      work_cursor cursor;
+      uint chunk_index;
+      while (get_next_work_item(cursor, chunk_index))
+      {
+         if (m_canceled)
+            return;
+
+         if ((cursor.m_new_range) && (crn_get_current_thread_id() == m_main_thread_id))
+         {
+            if (!update_progress(1, chunk_index, m_num_chunks))
+               return;
+         }
+
+         incremental_state::chunk_errors& errors = state.m_chunks[chunk_index];
+         if ((errors.m_prev + state.m_error_floor) <= state.m_max_ratio * (errors.m_ideal + state.m_error_floor))
+            continue;
+
+         errors.m_requantize = true;
+
+         const chunk_encoding& prev_encoding = (*state.m_pPrev_encodings)[chunk_index];
+         const chunk_encoding_desc& prev_desc = g_chunk_encodings[prev_encoding.m_encoding_index];
+
+         chunk_encoding encoding;
+         uint16 block_endpoint_indices[3][cChunkBlockHeight][cChunkBlockWidth];
+         utils::zero_object(block_endpoint_indices);
+
+         uint64 error = 0;
+
+         for (uint q = 0; q < cNumCompressedChunkVecs; q++)
+         {
+            if (q == cColorChunks ? !m_has_color_blocks : (q > m_num_alpha_blocks))
+               continue;
+
+            for (uint by = 0; by < cChunkBlockHeight; by++)
+            {
+               for (uint bx = 0; bx < cChunkBlockWidth; bx++)
+               {
+                  const uint prev_endpoint_index = prev_encoding.m_endpoint_indices[q][get_chunk_block_tile(prev_desc, bx, by)];
+                  error += requantize_incremental_block(state, chunk_index, q, bx, by, prev_endpoint_index, block_endpoint_indices[q][by][bx], encoding.m_selector_indices[q][by][bx]);
+               }
+            }
+         }
+
+         if (error >= errors.m_prev)
+            continue;
+
+         set_chunk_encoding_tiles(encoding, block_endpoint_indices, m_params.m_hierarchical);
+
+         m_chunk_encoding[chunk_index] = encoding;
+         errors.m_final = error;
       }
+   }
 
-      if (m_has_color_blocks)
+   // Drops the codebook entries no chunk uses anymore, and fills in the codebook accessors.
+   void dxt_hc::compact_incremental_codebooks(const codebooks& cb)
+   {
+      for (uint q = 0; q < cNumCompressedChunkVecs; q++)
       {
-         if (!refine_quantized_color_selectors())
-            return false;
+         if (q == cColorChunks ? !m_has_color_blocks : (q > m_num_alpha_blocks))
+            continue;
 
-         if (!refine_quantized_color_endpoints())
-            return false;
-      }
+         // The alpha blocks share their codebooks, so they're compacted together.
+         if (q == cAlpha1Chunks)
+            continue;
+         const uint last_q = q ? m_num_alpha_blocks : cColorChunks;
 
-      if (m_num_alpha_blocks)
-      {
-         if (!refine_quantized_alpha_endpoints())
-            return false;
+         const crnlib::vector<uint>& endpoints = q ? cb.m_alpha_endpoints : cb.m_color_endpoints;
+         const selectors_vec& sels = q ? cb.m_alpha_selectors : cb.m_color_selectors;
 
-         if (!refine_quantized_alpha_selectors())
-            return false;
-      }
+         crnlib::vector<int> endpoint_remap(endpoints.size());
+         crnlib::vector<int> selector_remap(sels.size());
+         endpoint_remap.set_all(-1);
+         selector_remap.set_all(-1);
 
-      create_final_debug_image();
+         crnlib::vector<uint>& new_endpoints = q ? m_alpha_endpoints : m_color_endpoints;
+         selectors_vec& new_selectors = q ? m_alpha_selectors : m_color_selectors;
+         new_endpoints.resize(0);
+         new_selectors.resize(0);
 
-      if (!create_chunk_encodings())
-         return false;
+         for (uint chunk_index = 0; chunk_index < m_num_chunks; chunk_index++)
+         {
+            chunk_encoding& encoding = m_chunk_encoding[chunk_index];
 
-      return true;
+            for (uint k = q; k <= last_q; k++)
+            {
+               for (uint t = 0; t < encoding.m_num_tiles; t++)
+               {
+                  int& r = endpoint_remap[encoding.m_endpoint_indices[k][t]];
+                  if (r < 0)
+                  {
+                     r = new_endpoints.size();
+                     new_endpoints.push_back(endpoints[encoding.m_endpoint_indices[k][t]]);
+                  }
+                  encoding.m_endpoint_indices[k][t] = static_cast<uint16>(r);
+               }
+
+               for (uint y = 0; y < cChunkBlockHeight; y++)
+               {
+                  for (uint x = 0; x < cChunkBlockWidth; x++)
+                  {
+                     int& r = selector_remap[encoding.m_selector_indices[k][y][x]];
+                     if (r < 0)
+                     {
+                        r = new_selectors.size();
+                        new_selectors.push_back(sels[encoding.m_selector_indices[k][y][x]]);
+                     }
+                     encoding.m_selector_indices[k][y][x] = static_cast<uint16>(r);
+                  }
+               }
+            }
+         }
+      }
    }
 
    void dxt_hc::compress_dxt1_block(
-      dxt1_endpoint_optimizer::results& results,
+      dxt1_endpoint_optimizer& optimizer, dxt1_endpoint_optimizer::results& results,
       uint chunk_index, const image_u8& chunk, uint x_ofs, uint y_ofs, uint width, uint height,
       uint8* pColor_Selectors)
    {
@@ -242,9 +906,8 @@ namespace crnlib
       results.m_alpha_block = false;
       results.m_error = INT_MAX;
       results.m_pSelectors = pColor_Selectors;
+      optimizer;
 #else
-      dxt1_endpoint_optimizer optimizer;
-
       dxt1_endpoint_optimizer::params params;
       params.m_block_index = chunk_index;
       params.m_pPixels = pixels;
@@ -261,8 +924,55 @@ namespace crnlib
 #endif
    }
 
+   uint dxt_hc::compress_etc1_block(
+      etc1_optimizer& optimizer,
+      const image_u8& chunk, uint x_ofs, uint y_ofs, uint width, uint height,
+      uint8* pColor_selectors)
+   {
+      color_quad_u8 pixels[cChunkPixelWidth * cChunkPixelHeight];
+
+      for (uint y = 0; y < height; y++)
+         for (uint x = 0; x < width; x++)
+            pixels[x + y * width] = chunk(x_ofs + x, y_ofs + y);
+
+      etc1_optimizer::params params;
+      params.m_num_src_pixels = width * height;
+      params.m_pSrc_pixels = pixels;
+      params.m_perceptual = m_params.m_perceptual;
+      params.m_quality = cCRNETCQualityFast;
+
+      etc1_optimizer::results results;
+      results.m_n = width * height;
+      results.m_pSelectors = pColor_selectors;
+
+      optimizer.init(params, results);
+      optimizer.compute();
+
+      // The optimizer returns intensity table indices, which are linear.
+      for (uint i = 0; i < width * height; i++)
+         pColor_selectors[i] = g_dxt1_from_linear[pColor_selectors[i]];
+
+      return pack_etc1_endpoint(results.m_block_color_unscaled, results.m_block_inten_table);
+   }
+
+   void dxt_hc::get_color_block_colors(color_quad_u8* pBlock_colors, uint first_endpoint, uint second_endpoint, bool four_colors) const
+   {
+      if (m_params.m_format == cETC1)
+      {
+         color_quad_u8 linear_colors[cETC1SelectorValues];
+         unpack_etc1_endpoint(first_endpoint).get_block_colors(linear_colors);
+
+         for (uint s = 0; s < cDXT1SelectorValues; s++)
+            pBlock_colors[s] = linear_colors[g_dxt1_to_linear[s]];
+      }
+      else if (four_colors)
+         dxt1_block::get_block_colors4(pBlock_colors, static_cast<uint16>(first_endpoint), static_cast<uint16>(second_endpoint));
+      else
+         dxt1_block::get_block_colors(pBlock_colors, static_cast<uint16>(first_endpoint), static_cast<uint16>(second_endpoint));
+   }
+
    void dxt_hc::compress_dxt5_block(
-      dxt5_endpoint_optimizer::results& results,
+      dxt5_endpoint_optimizer& optimizer, dxt5_endpoint_optimizer::results& results,
       uint chunk_index, const image_u8& chunk, uint x_ofs, uint y_ofs, uint width, uint height, uint component_index,
       uint8* pAlpha_selectors)
    {
@@ -282,8 +992,8 @@ namespace crnlib
       results.m_first_endpoint = static_cast<uint8>(low);
       results.m_second_endpoint = static_cast<uint8>(high);
       results.m_block_type = 0;
+      optimizer;
 #else
-      dxt5_endpoint_optimizer optimizer;
       dxt5_endpoint_optimizer::params params;
       params.m_block_index = chunk_index;
       params.m_pPixels = pixels;
@@ -301,7 +1011,7 @@ namespace crnlib
    void dxt_hc::determine_compressed_chunks_task(uint64 data, void* pData_ptr)
    {
       pData_ptr;
-      const uint thread_index = static_cast<uint>(data);
+      data;
 
       image_u8 orig_chunk;
       image_u8 decomp_chunk[cNumChunkEncodings];
@@ -312,11 +1022,15 @@ namespace crnlib
 
       image_utils::error_metrics color_error_metrics[cNumChunkEncodings];
       dxt1_endpoint_optimizer::results color_optimizer_results[cNumChunkTileLayouts];
+      uint layout_color_endpoints[cNumChunkTileLayouts][2];
       uint8 layout_color_selectors[cNumChunkTileLayouts][cChunkPixelWidth * cChunkPixelHeight];
+      dxt1_endpoint_optimizer color_optimizer;
+      etc1_optimizer etc_optimizer;
 
       image_utils::error_metrics alpha_error_metrics[2][cNumChunkEncodings];
       dxt5_endpoint_optimizer::results alpha_optimizer_results[2][cNumChunkTileLayouts];
       uint8 layout_alpha_selectors[2][cNumChunkTileLayouts][cChunkPixelWidth * cChunkPixelHeight];
+      dxt5_endpoint_optimizer alpha_optimizer;
 
       uint first_layout = 0;
       uint last_layout = cNumChunkTileLayouts;
@@ -330,32 +1044,24 @@ namespace crnlib
          first_encoding = cNumChunkEncodings - 1;
       }
 
-      for (uint chunk_index = 0; chunk_index < m_num_chunks; chunk_index++)
+      uint level_index = 0;
+
+      work_cursor cursor;
+      uint chunk_index;
+      while (get_next_work_item(cursor, chunk_index))
       {
          if (m_canceled)
             return;
 
-         if ((crn_get_current_thread_id() == m_main_thread_id) && ((chunk_index & 511) == 0))
+         if ((cursor.m_new_range) && (crn_get_current_thread_id() == m_main_thread_id))
          {
             if (!update_progress(0, chunk_index, m_num_chunks))
                return;
          }
 
-         if (m_pTask_pool->get_num_threads())
-         {
-            if ((chunk_index % (m_pTask_pool->get_num_threads() + 1)) != thread_index)
-               continue;
-         }
-
-         uint level_index = 0;
-         for (uint i = 0; i < m_params.m_num_levels; i++)
-         {
-            if ((chunk_index >= m_params.m_levels[i].m_first_chunk) && (chunk_index < m_params.m_levels[i].m_first_chunk + m_params.m_levels[i].m_num_chunks))
-            {
-               level_index = i;
-               break;
-            }
-         }
+         // Chunks within a range are consecutive, so the level only needs to be searched for at the start of each range.
+         if ((cursor.m_new_range) || (chunk_index >= m_params.m_levels[level_index].m_first_chunk + m_params.m_levels[level_index].m_num_chunks))
+            level_index = get_chunk_level_index(chunk_index);
 
          for (uint cy = 0; cy < cChunkPixelHeight; cy++)
             for (uint cx = 0; cx < cChunkPixelWidth; cx++)
@@ -367,12 +1073,30 @@ namespace crnlib
             {
                utils::zero_object(layout_color_selectors[l]);
 
-               compress_dxt1_block(
-                  color_optimizer_results[l], chunk_index,
-                  orig_chunk,
-                  g_chunk_tile_layouts[l].m_x_ofs, g_chunk_tile_layouts[l].m_y_ofs,
-                  g_chunk_tile_layouts[l].m_width, g_chunk_tile_layouts[l].m_height,
-                  layout_color_selectors[l]);
+               if (m_params.m_format == cETC1)
+               {
+                  layout_color_endpoints[l][0] = compress_etc1_block(
+                     etc_optimizer,
+                     orig_chunk,
+                     g_chunk_tile_layouts[l].m_x_ofs, g_chunk_tile_layouts[l].m_y_ofs,
+                     g_chunk_tile_layouts[l].m_width, g_chunk_tile_layouts[l].m_height,
+                     layout_color_selectors[l]);
+                  layout_color_endpoints[l][1] = 0;
+
+                  color_optimizer_results[l].m_alpha_block = false;
+               }
+               else
+               {
+                  compress_dxt1_block(
+                     color_optimizer, color_optimizer_results[l], chunk_index,
+                     orig_chunk,
+                     g_chunk_tile_layouts[l].m_x_ofs, g_chunk_tile_layouts[l].m_y_ofs,
+                     g_chunk_tile_layouts[l].m_width, g_chunk_tile_layouts[l].m_height,
+                     layout_color_selectors[l]);
+
+                  layout_color_endpoints[l][0] = color_optimizer_results[l].m_low_color;
+                  layout_color_endpoints[l][1] = color_optimizer_results[l].m_high_color;
+               }
             }
          }
 
@@ -386,7 +1110,7 @@ namespace crnlib
                utils::zero_object(layout_alpha_selectors[a][l]);
 
                compress_dxt5_block(
-                  alpha_optimizer_results[a][l], chunk_index,
+                  alpha_optimizer, alpha_optimizer_results[a][l], chunk_index,
                   orig_chunk,
                   g_chunk_tile_layouts[l].m_x_ofs, g_chunk_tile_layouts[l].m_y_ofs,
                   g_chunk_tile_layouts[l].m_width, g_chunk_tile_layouts[l].m_height,
@@ -431,13 +1155,13 @@ namespace crnlib
 
                if (m_has_color_blocks)
                {
-                  const dxt1_endpoint_optimizer::results& color_results = color_optimizer_results[layout_index];
+                  const uint* pColor_endpoints = layout_color_endpoints[layout_index];
                   const uint8* pColor_selectors = layout_color_selectors[layout_index];
 
                   color_quad_u8 block_colors[cDXT1SelectorValues];
-                  CRNLIB_ASSERT(color_results.m_low_color >= color_results.m_high_color);
-                  // it's okay if color_results.m_low_color == color_results.m_high_color, because in this case only selector 0 should be used
-                  dxt1_block::get_block_colors4(block_colors, color_results.m_low_color, color_results.m_high_color);
+                  CRNLIB_ASSERT(pColor_endpoints[0] >= pColor_endpoints[1]);
+                  // it's okay if the endpoints are equal, because in this case only selector 0 should be used
+                  get_color_block_colors(block_colors, pColor_endpoints[0], pColor_endpoints[1]);
 
                   for (uint cy = 0; cy < g_chunk_encodings[e].m_tiles[t].m_height; cy++)
                   {
@@ -569,13 +1293,18 @@ namespace crnlib
             output.m_encoding_index = static_cast<uint8>(best_encoding);
             output.m_num_tiles = static_cast<uint8>(g_chunk_encodings[best_encoding].m_num_tiles);
 
+            uint selector_ofs = 0;
+
             for (uint t = 0; t < g_chunk_encodings[best_encoding].m_num_tiles; t++)
             {
                const uint layout_index = g_chunk_encodings[best_encoding].m_tiles[t].m_layout_index;
+               const uint total_pixels = g_chunk_encodings[best_encoding].m_tiles[t].m_width * g_chunk_encodings[best_encoding].m_tiles[t].m_height;
 
                output.m_tiles[t].m_layout_index = static_cast<uint8>(layout_index);
                output.m_tiles[t].m_pixel_width = static_cast<uint8>(g_chunk_encodings[best_encoding].m_tiles[t].m_width);
                output.m_tiles[t].m_pixel_height = static_cast<uint8>(g_chunk_encodings[best_encoding].m_tiles[t].m_height);
+               output.m_tiles[t].m_selector_ofs = static_cast<uint8>(selector_ofs);
+               selector_ofs += total_pixels;
 
                if (q == cColorChunks)
                {
@@ -583,10 +1312,10 @@ namespace crnlib
                   const uint8* pColor_selectors = layout_color_selectors[layout_index];
 
                   output.m_tiles[t].m_endpoint_cluster_index = 0;
-                  output.m_tiles[t].m_first_endpoint = color_results.m_low_color;
-                  output.m_tiles[t].m_second_endpoint = color_results.m_high_color;
+                  output.m_tiles[t].m_first_endpoint = layout_color_endpoints[layout_index][0];
+                  output.m_tiles[t].m_second_endpoint = layout_color_endpoints[layout_index][1];
 
-                  memcpy(output.m_tiles[t].m_selectors, pColor_selectors, cChunkPixelWidth * cChunkPixelHeight);
+                  memcpy(output.get_selectors(t), pColor_selectors, total_pixels);
                   output.m_tiles[t].m_alpha_encoding = color_results.m_alpha_block;
                }
                else
@@ -600,7 +1329,7 @@ namespace crnlib
                   output.m_tiles[t].m_first_endpoint = alpha_results.m_first_endpoint;
                   output.m_tiles[t].m_second_endpoint = alpha_results.m_second_endpoint;
 
-                  memcpy(output.m_tiles[t].m_selectors, pAlpha_selectors, cChunkPixelWidth * cChunkPixelHeight);
+                  memcpy(output.get_selectors(t), pAlpha_selectors, total_pixels);
                   output.m_tiles[t].m_alpha_encoding = alpha_results.m_block_type != 0;
                }
             } // t
@@ -654,11 +1383,7 @@ namespace crnlib
 
       m_total_tiles = 0;
 
-      for (uint i = 0; i <= m_pTask_pool->get_num_threads(); i++)
-         m_pTask_pool->queue_object_task(this, &dxt_hc::determine_compressed_chunks_task, i);
-
-      m_pTask_pool->join();
-      if (m_canceled)
+      if (!run_phase("compressed chunks", m_num_chunks, &dxt_hc::determine_compressed_chunks_task))
          return false;
 
 #if CRNLIB_ENABLE_DEBUG_MESSAGES
@@ -681,26 +1406,22 @@ namespace crnlib
 
    void dxt_hc::assign_color_endpoint_clusters_task(uint64 data, void* pData_ptr)
    {
-      const uint thread_index = (uint)data;
+      data;
       assign_color_endpoint_clusters_state& state = *static_cast<assign_color_endpoint_clusters_state*>(pData_ptr);
 
-      for (uint chunk_index = 0; chunk_index < m_num_chunks; chunk_index++)
+      work_cursor cursor;
+      uint chunk_index;
+      while (get_next_work_item(cursor, chunk_index))
       {
          if (m_canceled)
             return;
 
-         if ((crn_get_current_thread_id() == m_main_thread_id) && ((chunk_index & 63) == 0))
+         if ((cursor.m_new_range) && (crn_get_current_thread_id() == m_main_thread_id))
          {
             if (!update_progress(2, chunk_index, m_num_chunks))
                return;
          }
 
-         if (m_pTask_pool->get_num_threads())
-         {
-            if ((chunk_index % (m_pTask_pool->get_num_threads() + 1)) != thread_index)
-               continue;
-         }
-
          compressed_chunk& chunk = m_compressed_chunks[cColorChunks][chunk_index];
 
          for (uint tile_index = 0; tile_index < chunk.m_num_tiles; tile_index++)
@@ -725,80 +1446,86 @@ namespace crnlib
       const float r_scale = .5f;
       const float b_scale = .25f;
 
-      vec6F_tree_vq vq;
+      // The training vectors only depend on each chunk's tile layout and endpoints, so they can be reused from a previous compress().
+      vec6F_tree_vq local_vq;
+      crnlib::vector< crnlib::vector<vec6F> > local_training_vecs;
 
-      crnlib::vector< crnlib::vector<vec6F> > training_vecs;
+      vec6F_tree_vq& vq = m_pAnalysis ? m_pAnalysis->m_color_vq : local_vq;
+      crnlib::vector< crnlib::vector<vec6F> >& training_vecs = m_pAnalysis ? m_pAnalysis->m_color_training_vecs : local_training_vecs;
 
-      training_vecs.resize(m_num_chunks);
-
-      for (uint chunk_index = 0; chunk_index < m_num_chunks; chunk_index++)
+      if (!m_reuse_analysis)
       {
-         if ((chunk_index & 255) == 0)
+         training_vecs.resize(m_num_chunks);
+
+         for (uint chunk_index = 0; chunk_index < m_num_chunks; chunk_index++)
          {
-            if (!update_progress(1, chunk_index, m_num_chunks))
-               return false;
-         }
+            if ((chunk_index & 255) == 0)
+            {
+               if (!update_progress(1, chunk_index, m_num_chunks))
+                  return false;
+            }
 
-         const compressed_chunk& chunk = m_compressed_chunks[cColorChunks][chunk_index];
+            const compressed_chunk& chunk = m_compressed_chunks[cColorChunks][chunk_index];
 
-         training_vecs[chunk_index].resize(chunk.m_num_tiles);
+            training_vecs[chunk_index].resize(chunk.m_num_tiles);
 
-         for (uint tile_index = 0; tile_index < chunk.m_num_tiles; tile_index++)
-         {
-            const compressed_tile& tile = chunk.m_tiles[tile_index];
+            for (uint tile_index = 0; tile_index < chunk.m_num_tiles; tile_index++)
+            {
+               const compressed_tile& tile = chunk.m_tiles[tile_index];
 
-            const chunk_tile_desc& layout = g_chunk_tile_layouts[tile.m_layout_index];
+               const chunk_tile_desc& layout = g_chunk_tile_layouts[tile.m_layout_index];
 
-            tree_clusterizer<vec3F> palettizer;
-            for (uint y = 0; y < layout.m_height; y++)
-            {
-               for (uint x = 0; x < layout.m_width; x++)
+               tree_clusterizer<vec3F> palettizer;
+               for (uint y = 0; y < layout.m_height; y++)
                {
-                  const color_quad_u8& c =  m_pChunks[chunk_index](layout.m_x_ofs + x, layout.m_y_ofs + y);
-
-                  vec3F v;
-                  if (m_params.m_perceptual)
-                  {
-                     v.set(c[0] * 1.0f/255.0f, c[1] * 1.0f/255.0f, c[2] * 1.0f/255.0f);
-                     v[0] *= r_scale;
-                     v[2] *= b_scale;
-                  }
-                  else
+                  for (uint x = 0; x < layout.m_width; x++)
                   {
-                     v.set(c[0] * 1.0f/255.0f, c[1] * 1.0f/255.0f, c[2] * 1.0f/255.0f);
-                  }
+                     const color_quad_u8& c =  m_pChunks[chunk_index](layout.m_x_ofs + x, layout.m_y_ofs + y);
+
+                     vec3F v;
+                     if (m_params.m_perceptual)
+                     {
+                        v.set(c[0] * 1.0f/255.0f, c[1] * 1.0f/255.0f, c[2] * 1.0f/255.0f);
+                        v[0] *= r_scale;
+                        v[2] *= b_scale;
+                     }
+                     else
+                     {
+                        v.set(c[0] * 1.0f/255.0f, c[1] * 1.0f/255.0f, c[2] * 1.0f/255.0f);
+                     }
 
-                  palettizer.add_training_vec(v, 1);
+                     palettizer.add_training_vec(v, 1);
+                  }
                }
-            }
 
-            palettizer.generate_codebook(2);
+               palettizer.generate_codebook(2);
 
-            uint tile_weight = tile.m_pixel_width * tile.m_pixel_height;
-            tile_weight = static_cast<uint>(tile_weight * m_pChunks[chunk_index].m_weight);
+               uint tile_weight = tile.m_pixel_width * tile.m_pixel_height;
+               tile_weight = static_cast<uint>(tile_weight * m_pChunks[chunk_index].m_weight);
 
-            vec3F v[2];
-            utils::zero_object(v);
+               vec3F v[2];
+               utils::zero_object(v);
 
-            for (uint i = 0; i < palettizer.get_codebook_size(); i++)
-               v[i] = palettizer.get_codebook_entry(i);
+               for (uint i = 0; i < palettizer.get_codebook_size(); i++)
+                  v[i] = palettizer.get_codebook_entry(i);
 
-            if (palettizer.get_codebook_size() == 1)
-               v[1] = v[0];
-            if (v[0].length() > v[1].length())
-               utils::swap(v[0], v[1]);
+               if (palettizer.get_codebook_size() == 1)
+                  v[1] = v[0];
+               if (v[0].length() > v[1].length())
+                  utils::swap(v[0], v[1]);
 
-            vec6F vv;
-            for (uint i = 0; i < 2; i++)
-            {
-               vv[i*3+0] = v[i][0];
-               vv[i*3+1] = v[i][1];
-               vv[i*3+2] = v[i][2];
-            }
+               vec6F vv;
+               for (uint i = 0; i < 2; i++)
+               {
+                  vv[i*3+0] = v[i][0];
+                  vv[i*3+1] = v[i][1];
+                  vv[i*3+2] = v[i][2];
+               }
 
-            vq.add_training_vec(vv, tile_weight);
+               vq.add_training_vec(vv, tile_weight);
 
-            training_vecs[chunk_index][tile_index] = vv;
+               training_vecs[chunk_index][tile_index] = vv;
+            }
          }
       }
 
@@ -829,11 +1556,7 @@ namespace crnlib
 
       assign_color_endpoint_clusters_state state(vq, training_vecs);
 
-      for (uint i = 0; i <= m_pTask_pool->get_num_threads(); i++)
-         m_pTask_pool->queue_object_task(this, &dxt_hc::assign_color_endpoint_clusters_task, i, &state);
-
-      m_pTask_pool->join();
-      if (m_canceled)
+      if (!run_phase("color endpoint clusters", m_num_chunks, &dxt_hc::assign_color_endpoint_clusters_task, &state))
          return false;
 
       for (uint chunk_index = 0; chunk_index < m_num_chunks; chunk_index++)
@@ -858,36 +1581,33 @@ namespace crnlib
 
    void dxt_hc::determine_alpha_endpoint_clusters_task(uint64 data, void* pData_ptr)
    {
-      const uint thread_index = static_cast<uint>(data);
+      data;
       const determine_alpha_endpoint_clusters_state& state = *static_cast<determine_alpha_endpoint_clusters_state*>(pData_ptr);
 
-      for (uint a = 0; a < m_num_alpha_blocks; a++)
+      // The items are the chunks of each alpha block in turn.
+      work_cursor cursor;
+      uint item;
+      while (get_next_work_item(cursor, item))
       {
-         for (uint chunk_index = 0; chunk_index < m_num_chunks; chunk_index++)
-         {
-            if (m_canceled)
-               return;
+         const uint a = item / m_num_chunks;
+         const uint chunk_index = item % m_num_chunks;
 
-            if ((crn_get_current_thread_id() == m_main_thread_id) && ((chunk_index & 63) == 0))
-            {
-               if (!update_progress(7, m_num_chunks * a + chunk_index, m_num_chunks * m_num_alpha_blocks))
-                  return;
-            }
+         if (m_canceled)
+            return;
 
-            if (m_pTask_pool->get_num_threads())
-            {
-               if ((chunk_index % (m_pTask_pool->get_num_threads() + 1)) != thread_index)
-                  continue;
-            }
+         if ((cursor.m_new_range) && (crn_get_current_thread_id() == m_main_thread_id))
+         {
+            if (!update_progress(7, item, m_num_chunks * m_num_alpha_blocks))
+               return;
+         }
 
-            compressed_chunk& chunk = m_compressed_chunks[cAlpha0Chunks + a][chunk_index];
+         compressed_chunk& chunk = m_compressed_chunks[cAlpha0Chunks + a][chunk_index];
 
-            for (uint tile_index = 0; tile_index < chunk.m_num_tiles; tile_index++)
-            {
-               uint cluster_index = state.m_vq.find_best_codebook_entry_fs(state.m_training_vecs[a][chunk_index][tile_index]);
+         for (uint tile_index = 0; tile_index < chunk.m_num_tiles; tile_index++)
+         {
+            uint cluster_index = state.m_vq.find_best_codebook_entry_fs(state.m_training_vecs[a][chunk_index][tile_index]);
 
-               chunk.m_endpoint_cluster_index[tile_index] = static_cast<uint16>(cluster_index);
-            }
+            chunk.m_endpoint_cluster_index[tile_index] = static_cast<uint16>(cluster_index);
          }
       }
    }
@@ -902,67 +1622,72 @@ namespace crnlib
          console::info("Generating alpha training vectors");
 #endif
 
-      determine_alpha_endpoint_clusters_state state;
+      // Like the color training vectors, these can be reused from a previous compress().
+      determine_alpha_endpoint_clusters_state local_state;
+      determine_alpha_endpoint_clusters_state& state = m_pAnalysis ? m_pAnalysis->m_alpha_clusters_state : local_state;
 
-      for (uint a = 0; a < m_num_alpha_blocks; a++)
+      if (!m_reuse_analysis)
       {
-         state.m_training_vecs[a].resize(m_num_chunks);
-
-         for (uint chunk_index = 0; chunk_index < m_num_chunks; chunk_index++)
+         for (uint a = 0; a < m_num_alpha_blocks; a++)
          {
-            if ((chunk_index & 63) == 0)
+            state.m_training_vecs[a].resize(m_num_chunks);
+
+            for (uint chunk_index = 0; chunk_index < m_num_chunks; chunk_index++)
             {
-               if (!update_progress(6, m_num_chunks * a + chunk_index, m_num_chunks * m_num_alpha_blocks))
-                  return false;
-            }
+               if ((chunk_index & 63) == 0)
+               {
+                  if (!update_progress(6, m_num_chunks * a + chunk_index, m_num_chunks * m_num_alpha_blocks))
+                     return false;
+               }
 
-            const compressed_chunk& chunk = m_compressed_chunks[cAlpha0Chunks + a][chunk_index];
+               const compressed_chunk& chunk = m_compressed_chunks[cAlpha0Chunks + a][chunk_index];
 
-            state.m_training_vecs[a][chunk_index].resize(chunk.m_num_tiles);
+               state.m_training_vecs[a][chunk_index].resize(chunk.m_num_tiles);
 
-            for (uint tile_index = 0; tile_index < chunk.m_num_tiles; tile_index++)
-            {
-               const compressed_tile& tile = chunk.m_tiles[tile_index];
+               for (uint tile_index = 0; tile_index < chunk.m_num_tiles; tile_index++)
+               {
+                  const compressed_tile& tile = chunk.m_tiles[tile_index];
 
-               const chunk_tile_desc& layout = g_chunk_tile_layouts[tile.m_layout_index];
+                  const chunk_tile_desc& layout = g_chunk_tile_layouts[tile.m_layout_index];
 
-               tree_clusterizer<vec1F> palettizer;
+                  tree_clusterizer<vec1F> palettizer;
 
-               for (uint y = 0; y < layout.m_height; y++)
-               {
-                  for (uint x = 0; x < layout.m_width; x++)
+                  for (uint y = 0; y < layout.m_height; y++)
                   {
-                     uint c = m_pChunks[chunk_index](layout.m_x_ofs + x, layout.m_y_ofs + y)[m_params.m_alpha_component_indices[a]];
+                     for (uint x = 0; x < layout.m_width; x++)
+                     {
+                        uint c = m_pChunks[chunk_index](layout.m_x_ofs + x, layout.m_y_ofs + y)[m_params.m_alpha_component_indices[a]];
 
-                     vec1F v(c * 1.0f/255.0f);
+                        vec1F v(c * 1.0f/255.0f);
 
-                     palettizer.add_training_vec(v, 1);
+                        palettizer.add_training_vec(v, 1);
+                     }
                   }
-               }
-               palettizer.generate_codebook(2);
+                  palettizer.generate_codebook(2);
 
-               const uint tile_weight = tile.m_pixel_width * tile.m_pixel_height;
+                  const uint tile_weight = tile.m_pixel_width * tile.m_pixel_height;
 
-               vec1F v[2];
-               utils::zero_object(v);
+                  vec1F v[2];
+                  utils::zero_object(v);
 
-               for (uint i = 0; i < palettizer.get_codebook_size(); i++)
-                  v[i] = palettizer.get_codebook_entry(i);
+                  for (uint i = 0; i < palettizer.get_codebook_size(); i++)
+                     v[i] = palettizer.get_codebook_entry(i);
 
-               if (palettizer.get_codebook_size() == 1)
-                  v[1] = v[0];
-               if (v[0] > v[1])
-                  utils::swap(v[0], v[1]);
+                  if (palettizer.get_codebook_size() == 1)
+                     v[1] = v[0];
+                  if (v[0] > v[1])
+                     utils::swap(v[0], v[1]);
 
-               vec2F vv(v[0][0], v[1][0]);
+                  vec2F vv(v[0][0], v[1][0]);
 
-               state.m_vq.add_training_vec(vv, tile_weight);
+                  state.m_vq.add_training_vec(vv, tile_weight);
 
-               state.m_training_vecs[a][chunk_index][tile_index] = vv;
+                  state.m_training_vecs[a][chunk_index][tile_index] = vv;
 
-            } // tile_index
-         } // chunk_index
-      } // a
+               } // tile_index
+            } // chunk_index
+         } // a
+      }
 
 #if CRNLIB_ENABLE_DEBUG_MESSAGES
       if (m_params.m_debugging)
@@ -989,11 +1714,7 @@ namespace crnlib
          console::info("Begin alpha cluster assignment");
 #endif
 
-      for (uint i = 0; i <= m_pTask_pool->get_num_threads(); i++)
-         m_pTask_pool->queue_object_task(this, &dxt_hc::determine_alpha_endpoint_clusters_task, i, &state);
-
-      m_pTask_pool->join();
-      if (m_canceled)
+      if (!run_phase("alpha endpoint clusters", m_num_chunks * m_num_alpha_blocks, &dxt_hc::determine_alpha_endpoint_clusters_task, &state))
          return false;
 
       for (uint a = 0; a < m_num_alpha_blocks; a++)
@@ -1022,7 +1743,7 @@ namespace crnlib
    void dxt_hc::determine_color_endpoint_codebook_task(uint64 data, void* pData_ptr)
    {
       pData_ptr;
-      const uint thread_index = static_cast<uint>(data);
+      data;
 
       if (!m_has_color_blocks)
          return;
@@ -1032,26 +1753,25 @@ namespace crnlib
 
       crnlib::vector<uint8> selectors;
 
+      dxt1_endpoint_optimizer optimizer;
+      etc1_optimizer etc_optimizer;
+
       uint total_pixels = 0;
 
       uint total_empty_clusters = 0;
-      for (uint cluster_index = 0; cluster_index < m_color_clusters.size(); cluster_index++)
+      work_cursor cursor;
+      uint cluster_index;
+      while (get_next_work_item(cursor, cluster_index))
       {
          if (m_canceled)
             return;
 
-         if ((crn_get_current_thread_id() == m_main_thread_id) && ((cluster_index & 63) == 0))
+         if ((cursor.m_new_range) && (crn_get_current_thread_id() == m_main_thread_id))
          {
             if (!update_progress(3, cluster_index, m_color_clusters.size()))
                return;
          }
 
-         if (m_pTask_pool->get_num_threads())
-         {
-            if ((cluster_index % (m_pTask_pool->get_num_threads() + 1)) != thread_index)
-               continue;
-         }
-
          tile_cluster& cluster = m_color_clusters[cluster_index];
          if (cluster.m_tiles.empty())
          {
@@ -1084,27 +1804,56 @@ namespace crnlib
 
          selectors.resize(pixels.size());
 
-         dxt1_endpoint_optimizer::params params;
-         params.m_block_index = cluster_index;
-         params.m_pPixels = &pixels[0];
-         params.m_num_pixels = pixels.size();
-         params.m_pixels_have_alpha = false;
-         params.m_use_alpha_blocks = false;
-         params.m_perceptual = m_params.m_perceptual;
-         params.m_quality = cCRNDXTQualityUber;
-         params.m_endpoint_caching = false;
-
-         dxt1_endpoint_optimizer::results results;
-         results.m_pSelectors = &selectors[0];
-
-         dxt1_endpoint_optimizer optimizer;
-         const bool all_transparent = optimizer.compute(params, results);
-         all_transparent;
-
-         cluster.m_first_endpoint = results.m_low_color;
-         cluster.m_second_endpoint = results.m_high_color;
-         cluster.m_alpha_encoding = results.m_alpha_block;
-         cluster.m_error = results.m_error;
+         if (m_params.m_format == cETC1)
+         {
+            static const int s_scan_deltas[] = { -1, 0, 1 };
+
+            etc1_optimizer::params params;
+            params.m_num_src_pixels = pixels.size();
+            params.m_pSrc_pixels = &pixels[0];
+            params.m_perceptual = m_params.m_perceptual;
+            params.m_quality = cCRNETCQualityMedium;
+            params.m_pScan_deltas = s_scan_deltas;
+            params.m_scan_delta_size = CRNLIB_ARRAY_SIZE(s_scan_deltas);
+
+            etc1_optimizer::results results;
+            results.m_n = pixels.size();
+            results.m_pSelectors = &selectors[0];
+
+            etc_optimizer.init(params, results);
+            etc_optimizer.compute();
+
+            for (uint i = 0; i < selectors.size(); i++)
+               selectors[i] = g_dxt1_from_linear[selectors[i]];
+
+            cluster.m_first_endpoint = pack_etc1_endpoint(results.m_block_color_unscaled, results.m_block_inten_table);
+            cluster.m_second_endpoint = 0;
+            cluster.m_alpha_encoding = false;
+            cluster.m_error = results.m_error;
+         }
+         else
+         {
+            dxt1_endpoint_optimizer::params params;
+            params.m_block_index = cluster_index;
+            params.m_pPixels = &pixels[0];
+            params.m_num_pixels = pixels.size();
+            params.m_pixels_have_alpha = false;
+            params.m_use_alpha_blocks = false;
+            params.m_perceptual = m_params.m_perceptual;
+            params.m_quality = cCRNDXTQualityUber;
+            params.m_endpoint_caching = false;
+
+            dxt1_endpoint_optimizer::results results;
+            results.m_pSelectors = &selectors[0];
+
+            const bool all_transparent = optimizer.compute(params, results);
+            all_transparent;
+
+            cluster.m_first_endpoint = results.m_low_color;
+            cluster.m_second_endpoint = results.m_high_color;
+            cluster.m_alpha_encoding = results.m_alpha_block;
+            cluster.m_error = results.m_error;
+         }
 
          uint pixel_index = 0;
 
@@ -1131,15 +1880,16 @@ namespace crnlib
             const uint total_pixels = tile.m_pixel_width * tile.m_pixel_height;
 
             quantized_tile.m_endpoint_cluster_index = cluster_index;
-            quantized_tile.m_first_endpoint = results.m_low_color;
-            quantized_tile.m_second_endpoint = results.m_high_color;
+            quantized_tile.m_first_endpoint = cluster.m_first_endpoint;
+            quantized_tile.m_second_endpoint = cluster.m_second_endpoint;
             //quantized_tile.m_error = results.m_error;
-            quantized_tile.m_alpha_encoding = results.m_alpha_block;
+            quantized_tile.m_alpha_encoding = cluster.m_alpha_encoding;
             quantized_tile.m_pixel_width = tile.m_pixel_width;
             quantized_tile.m_pixel_height = tile.m_pixel_height;
             quantized_tile.m_layout_index = tile.m_layout_index;
+            quantized_tile.m_selector_ofs = tile.m_selector_ofs;
 
-            memcpy(quantized_tile.m_selectors, &selectors[pixel_index], total_pixels);
+            memcpy(chunk.get_quantized_selectors(tile_index), &selectors[pixel_index], total_pixels);
 
             pixel_index += total_pixels;
          }
@@ -1166,19 +1916,14 @@ namespace crnlib
          console::info("Computing optimal color cluster endpoints");
 #endif
 
-      for (uint i = 0; i <= m_pTask_pool->get_num_threads(); i++)
-         m_pTask_pool->queue_object_task(this, &dxt_hc::determine_color_endpoint_codebook_task, i, NULL);
-
-      m_pTask_pool->join();
-
-      return !m_canceled;
+      return run_phase("color endpoint codebook", m_color_clusters.size(), &dxt_hc::determine_color_endpoint_codebook_task);
    }
 
    void dxt_hc::determine_alpha_endpoint_codebook_task(uint64 data, void* pData_ptr)
    {
       pData_ptr;
 
-      const uint thread_index = static_cast<uint>(data);
+      data;
 
       crnlib::vector<color_quad_u8> pixels;
       pixels.reserve(512);
@@ -1186,24 +1931,22 @@ namespace crnlib
       crnlib::vector<uint8> selectors;
       selectors.reserve(512);
 
+      dxt5_endpoint_optimizer optimizer;
+
       uint total_empty_clusters = 0;
-      for (uint cluster_index = 0; cluster_index < m_alpha_clusters.size(); cluster_index++)
+      work_cursor cursor;
+      uint cluster_index;
+      while (get_next_work_item(cursor, cluster_index))
       {
          if (m_canceled)
             return;
 
-         if ((crn_get_current_thread_id() == m_main_thread_id) && ((cluster_index & 63) == 0))
+         if ((cursor.m_new_range) && (crn_get_current_thread_id() == m_main_thread_id))
          {
             if (!update_progress(8, cluster_index, m_alpha_clusters.size()))
                return;
          }
 
-         if (m_pTask_pool->get_num_threads())
-         {
-            if ((cluster_index % (m_pTask_pool->get_num_threads() + 1)) != thread_index)
-               continue;
-         }
-
          tile_cluster& cluster = m_alpha_clusters[cluster_index];
          if (cluster.m_tiles.empty())
          {
@@ -1258,7 +2001,6 @@ namespace crnlib
          dxt5_endpoint_optimizer::results results;
          results.m_pSelectors = &selectors[0];
 
-         dxt5_endpoint_optimizer optimizer;
          const bool all_transparent = optimizer.compute(params, results);
          all_transparent;
 
@@ -1300,8 +2042,9 @@ namespace crnlib
             quantized_tile.m_pixel_width = tile.m_pixel_width;
             quantized_tile.m_pixel_height = tile.m_pixel_height;
             quantized_tile.m_layout_index = tile.m_layout_index;
+            quantized_tile.m_selector_ofs = tile.m_selector_ofs;
 
-            memcpy(quantized_tile.m_selectors, &selectors[pixel_index], total_pixels);
+            memcpy(chunk.get_quantized_selectors(tile_index), &selectors[pixel_index], total_pixels);
 
             pixel_index += total_pixels;
          }
@@ -1326,12 +2069,7 @@ namespace crnlib
          console::info("Computing optimal alpha cluster endpoints");
 #endif
 
-      for (uint i = 0; i <= m_pTask_pool->get_num_threads(); i++)
-         m_pTask_pool->queue_object_task(this, &dxt_hc::determine_alpha_endpoint_codebook_task, i, NULL);
-
-      m_pTask_pool->join();
-
-      return !m_canceled;
+      return run_phase("alpha endpoint codebook", m_alpha_clusters.size(), &dxt_hc::determine_alpha_endpoint_codebook_task);
    }
 
    void dxt_hc::create_quantized_debug_images()
@@ -1383,11 +2121,11 @@ namespace crnlib
 
                const chunk_tile_desc& layout = g_chunk_tile_layouts[quantized_tile.m_layout_index];
 
-               const uint8* pColor_Selectors = quantized_tile.m_selectors;
+               const uint8* pColor_Selectors = color_chunk.get_quantized_selectors(tile_index);
 
                color_quad_u8 block_colors[cDXT1SelectorValues];
                CRNLIB_ASSERT(quantized_tile.m_first_endpoint >= quantized_tile.m_second_endpoint);
-               dxt1_block::get_block_colors(block_colors, static_cast<uint16>(quantized_tile.m_first_endpoint), static_cast<uint16>(quantized_tile.m_second_endpoint));
+               get_color_block_colors(block_colors, quantized_tile.m_first_endpoint, quantized_tile.m_second_endpoint, false);
 
                for (uint y = 0; y < layout.m_height; y++)
                {
@@ -1397,7 +2135,7 @@ namespace crnlib
 
                      output_chunk_selectors(x + layout.m_x_ofs, y + layout.m_y_ofs) = selector*255/(cDXT1SelectorValues-1);
 
-                     output_chunk_orig_selectors(x + layout.m_x_ofs, y + layout.m_y_ofs) = color_chunk.m_tiles[tile_index].m_selectors[x + y * layout.m_width] * 255 / (cDXT1SelectorValues-1);
+                     output_chunk_orig_selectors(x + layout.m_x_ofs, y + layout.m_y_ofs) = color_chunk.get_selectors(tile_index)[x + y * layout.m_width] * 255 / (cDXT1SelectorValues-1);
 
                      output_chunk_color_quantized(x + layout.m_x_ofs, y + layout.m_y_ofs) = block_colors[selector];
                   }
@@ -1419,7 +2157,7 @@ namespace crnlib
 
                const chunk_tile_desc& layout = g_chunk_tile_layouts[quantized_tile.m_layout_index];
 
-               const uint8* pAlpha_selectors = quantized_tile.m_selectors;
+               const uint8* pAlpha_selectors = alpha_chunk.get_quantized_selectors(tile_index);
 
                uint block_values[cDXT5SelectorValues];
                CRNLIB_ASSERT(quantized_tile.m_first_endpoint >= quantized_tile.m_second_endpoint);
@@ -1435,7 +2173,7 @@ namespace crnlib
 
                      output_chunk_selectors(x + layout.m_x_ofs, y + layout.m_y_ofs)[m_params.m_alpha_component_indices[a]] = static_cast<uint8>(selector*255/(cDXT5SelectorValues-1));
 
-                     output_chunk_orig_selectors(x + layout.m_x_ofs, y + layout.m_y_ofs)[m_params.m_alpha_component_indices[a]] = static_cast<uint8>(alpha_chunk.m_tiles[tile_index].m_selectors[x + y * layout.m_width]*255/(cDXT5SelectorValues-1));
+                     output_chunk_orig_selectors(x + layout.m_x_ofs, y + layout.m_y_ofs)[m_params.m_alpha_component_indices[a]] = static_cast<uint8>(alpha_chunk.get_selectors(tile_index)[x + y * layout.m_width]*255/(cDXT5SelectorValues-1));
 
                      output_chunk_alpha_quantized(x + layout.m_x_ofs, y + layout.m_y_ofs)[m_params.m_alpha_component_indices[a]] = static_cast<uint8>(block_values[selector]);
                   }
@@ -1448,184 +2186,180 @@ namespace crnlib
 
    void dxt_hc::create_selector_codebook_task(uint64 data, void* pData_ptr)
    {
-      const uint thread_index = static_cast<uint>(data);
+      data;
       const create_selector_codebook_state& state = *static_cast<create_selector_codebook_state*>(pData_ptr);
 
-      for (uint comp_chunk_index = state.m_comp_index_start; comp_chunk_index <= state.m_comp_index_end; comp_chunk_index++)
+      // The items are the chunks of each component in turn.
+      work_cursor cursor;
+      uint item;
+      while (get_next_work_item(cursor, item))
       {
+         const uint comp_chunk_index = state.m_comp_index_start + item / m_num_chunks;
+         const uint chunk_index = item % m_num_chunks;
+
          const uint alpha_index = state.m_alpha_blocks ? (comp_chunk_index - cAlpha0Chunks) : 0;
          const uint alpha_pixel_comp = state.m_alpha_blocks ? m_params.m_alpha_component_indices[alpha_index] : 0;
 
-         for (uint chunk_index = 0; chunk_index < m_num_chunks; chunk_index++)
+         if (m_canceled)
+            return;
+
+         if ((cursor.m_new_range) && (crn_get_current_thread_id() == m_main_thread_id))
          {
-            if (m_canceled)
+            if (!update_progress(12 + comp_chunk_index, chunk_index, m_num_chunks))
                return;
+         }
 
-            if ((crn_get_current_thread_id() == m_main_thread_id) && ((chunk_index & 127) == 0))
-            {
-               if (!update_progress(12 + comp_chunk_index, chunk_index, m_num_chunks))
-                  return;
-            }
-
-            if (m_pTask_pool->get_num_threads())
-            {
-               if ((chunk_index % (m_pTask_pool->get_num_threads() + 1)) != thread_index)
-                  continue;
-            }
-
-            compressed_chunk& chunk = m_compressed_chunks[comp_chunk_index][chunk_index];
+         compressed_chunk& chunk = m_compressed_chunks[comp_chunk_index][chunk_index];
 
-            for (uint tile_index = 0; tile_index < chunk.m_num_tiles; tile_index++)
-            {
-               compressed_tile& quantized_tile = chunk.m_quantized_tiles[tile_index];
+         for (uint tile_index = 0; tile_index < chunk.m_num_tiles; tile_index++)
+         {
+            compressed_tile& quantized_tile = chunk.m_quantized_tiles[tile_index];
 
-               const chunk_tile_desc& layout = g_chunk_tile_layouts[quantized_tile.m_layout_index];
+            const chunk_tile_desc& layout = g_chunk_tile_layouts[quantized_tile.m_layout_index];
 
-               const uint tile_blocks_x = layout.m_width >> 2;
-               const uint tile_blocks_y = layout.m_height >> 2;
+            const uint tile_blocks_x = layout.m_width >> 2;
+            const uint tile_blocks_y = layout.m_height >> 2;
 
-               const uint tile_block_ofs_x = layout.m_x_ofs >> 2;
-               const uint tile_block_ofs_y = layout.m_y_ofs >> 2;
+            const uint tile_block_ofs_x = layout.m_x_ofs >> 2;
+            const uint tile_block_ofs_y = layout.m_y_ofs >> 2;
 
-               if (state.m_alpha_blocks)
-               {
-                  uint block_values[cDXT5SelectorValues];
-                  dxt5_block::get_block_values(block_values, quantized_tile.m_first_endpoint, quantized_tile.m_second_endpoint);
+            if (state.m_alpha_blocks)
+            {
+               uint block_values[cDXT5SelectorValues];
+               dxt5_block::get_block_values(block_values, quantized_tile.m_first_endpoint, quantized_tile.m_second_endpoint);
 
-                  for (uint by = 0; by < tile_blocks_y; by++)
+               for (uint by = 0; by < tile_blocks_y; by++)
+               {
+                  for (uint bx = 0; bx < tile_blocks_x; bx++)
                   {
-                     for (uint bx = 0; bx < tile_blocks_x; bx++)
-                     {
    #if 0
-                        uint best_index = selector_vq.find_best_codebook_entry_fs(training_vecs[comp_chunk_index][(tile_block_ofs_x+bx)+(tile_block_ofs_y+by)*2][chunk_index]);
-   #else
-                        const dxt_pixel_block& block = m_pChunks[chunk_index].m_blocks[tile_block_ofs_y + by][tile_block_ofs_x + bx];
+                     uint best_index = selector_vq.find_best_codebook_entry_fs(training_vecs[comp_chunk_index][(tile_block_ofs_x+bx)+(tile_block_ofs_y+by)*2][chunk_index]);
+#else
+                     const dxt_pixel_block& block = m_pChunks[chunk_index].m_blocks[tile_block_ofs_y + by][tile_block_ofs_x + bx];
 
-                        uint best_error = UINT_MAX;
-                        uint best_index = 0;
+                     uint best_error = UINT_MAX;
+                     uint best_index = 0;
 
-                        for (uint i = 0; i < state.m_selectors_cb.size(); i++)
-                        {
-                           const selectors& s = state.m_selectors_cb[i];
+                     for (uint i = 0; i < state.m_selectors_cb.size(); i++)
+                     {
+                        const selectors& s = state.m_selectors_cb[i];
 
-                           uint total_error = 0;
+                        uint total_error = 0;
 
-                           for (uint y = 0; y < cBlockPixelHeight; y++)
+                        for (uint y = 0; y < cBlockPixelHeight; y++)
+                        {
+                           for (uint x = 0; x < cBlockPixelWidth; x++)
                            {
-                              for (uint x = 0; x < cBlockPixelWidth; x++)
-                              {
-                                 int a = block.m_pixels[y][x][alpha_pixel_comp];
-                                 int b = block_values[s.m_selectors[y][x]];
-                                 int error = a - b;
-                                 error *= error;
-
-                                 total_error += error;
-                                 if (total_error > best_error)
-                                    goto early_out;
-                              } // x
-                           } //y
+                              int a = block.m_pixels[y][x][alpha_pixel_comp];
+                              int b = block_values[s.m_selectors[y][x]];
+                              int error = a - b;
+                              error *= error;
+
+                              total_error += error;
+                              if (total_error > best_error)
+                                 goto early_out;
+                           } // x
+                        } //y
 
    early_out:
-                           if (total_error < best_error)
-                           {
-                              best_error = total_error;
-                              best_index = i;
+                        if (total_error < best_error)
+                        {
+                           best_error = total_error;
+                           best_index = i;
 
-                              if (best_error == 0)
-                                 break;
-                           }
-                        } // i
+                           if (best_error == 0)
+                              break;
+                        }
+                     } // i
    #endif
 
-                        CRNLIB_ASSERT( (tile_block_ofs_x + bx) < 2 );
-                        CRNLIB_ASSERT( (tile_block_ofs_y + by) < 2 );
+                     CRNLIB_ASSERT( (tile_block_ofs_x + bx) < 2 );
+                     CRNLIB_ASSERT( (tile_block_ofs_y + by) < 2 );
 
-                        chunk.m_selector_cluster_index[tile_block_ofs_y + by][tile_block_ofs_x + bx] = static_cast<uint16>(best_index);
+                     chunk.m_selector_cluster_index[tile_block_ofs_y + by][tile_block_ofs_x + bx] = static_cast<uint16>(best_index);
 
-                        {
-                           scoped_spinlock lock(state.m_chunk_blocks_using_selectors_lock);
-                           state.m_chunk_blocks_using_selectors[best_index].push_back( block_id(chunk_index, alpha_index, tile_index, tile_block_ofs_x + bx, tile_block_ofs_y + by ) );
-                        }
-                        //   std::make_pair(chunk_index, (tile_index << 16) | ((tile_block_ofs_y + by) << 8) | (tile_block_ofs_x + bx) ) );
+                     {
+                        scoped_spinlock lock(state.m_chunk_blocks_using_selectors_lock);
+                        state.m_chunk_blocks_using_selectors[best_index].push_back( block_id(chunk_index, alpha_index, tile_index, tile_block_ofs_x + bx, tile_block_ofs_y + by ) );
+                     }
+                     //   std::make_pair(chunk_index, (tile_index << 16) | ((tile_block_ofs_y + by) << 8) | (tile_block_ofs_x + bx) ) );
 
-                     } // bx
-                  } // by
+                  } // bx
+               } // by
 
-               }
-               else
-               {
-                  color_quad_u8 block_colors[cDXT1SelectorValues];
-                  dxt1_block::get_block_colors4(block_colors, static_cast<uint16>(quantized_tile.m_first_endpoint), static_cast<uint16>(quantized_tile.m_second_endpoint));
+            }
+            else
+            {
+               color_quad_u8 block_colors[cDXT1SelectorValues];
+               get_color_block_colors(block_colors, quantized_tile.m_first_endpoint, quantized_tile.m_second_endpoint);
 
-                  const bool block_with_alpha = quantized_tile.m_first_endpoint == quantized_tile.m_second_endpoint;
+               const bool block_with_alpha = (m_params.m_format != cETC1) && (quantized_tile.m_first_endpoint == quantized_tile.m_second_endpoint);
 
-                  for (uint by = 0; by < tile_blocks_y; by++)
+               for (uint by = 0; by < tile_blocks_y; by++)
+               {
+                  for (uint bx = 0; bx < tile_blocks_x; bx++)
                   {
-                     for (uint bx = 0; bx < tile_blocks_x; bx++)
-                     {
-                        const dxt_pixel_block& block = m_pChunks[chunk_index].m_blocks[tile_block_ofs_y + by][tile_block_ofs_x + bx];
+                     const dxt_pixel_block& block = m_pChunks[chunk_index].m_blocks[tile_block_ofs_y + by][tile_block_ofs_x + bx];
 
-                        uint best_error = UINT_MAX;
-                        uint best_index = 0;
+                     uint best_error = UINT_MAX;
+                     uint best_index = 0;
 
-                        for (uint i = 0; i < state.m_selectors_cb.size(); i++)
-                        {
-                           const selectors& s = state.m_selectors_cb[i];
+                     for (uint i = 0; i < state.m_selectors_cb.size(); i++)
+                     {
+                        const selectors& s = state.m_selectors_cb[i];
 
-                           uint total_error = 0;
+                        uint total_error = 0;
 
-                           for (uint y = 0; y < cBlockPixelHeight; y++)
+                        for (uint y = 0; y < cBlockPixelHeight; y++)
+                        {
+                           for (uint x = 0; x < cBlockPixelWidth; x++)
                            {
-                              for (uint x = 0; x < cBlockPixelWidth; x++)
-                              {
-                                 const color_quad_u8& a = block.m_pixels[y][x];
+                              const color_quad_u8& a = block.m_pixels[y][x];
 
-                                 uint selector_index = s.m_selectors[y][x];
-                                 if ((block_with_alpha) && (selector_index == 3))
-                                    total_error += 999999;
+                              uint selector_index = s.m_selectors[y][x];
+                              if ((block_with_alpha) && (selector_index == 3))
+                                 total_error += 999999;
 
-                                 const color_quad_u8& b = block_colors[selector_index];
+                              const color_quad_u8& b = block_colors[selector_index];
 
-                                 uint error = color::color_distance(m_params.m_perceptual, a, b, false);
+                              uint error = color::color_distance(m_params.m_perceptual, a, b, false);
 
-                                 total_error += error;
-                                 if (total_error > best_error)
-                                    goto early_out2;
-                              } // x
-                           } //y
+                              total_error += error;
+                              if (total_error > best_error)
+                                 goto early_out2;
+                           } // x
+                        } //y
 
    early_out2:
-                           if (total_error < best_error)
-                           {
-                              best_error = total_error;
-                              best_index = i;
-
-                              if (best_error == 0)
-                                 break;
-                           }
-                        } // i
+                        if (total_error < best_error)
+                        {
+                           best_error = total_error;
+                           best_index = i;
 
-                        CRNLIB_ASSERT( (tile_block_ofs_x + bx) < 2 );
-                        CRNLIB_ASSERT( (tile_block_ofs_y + by) < 2 );
+                           if (best_error == 0)
+                              break;
+                        }
+                     } // i
 
-                        chunk.m_selector_cluster_index[tile_block_ofs_y + by][tile_block_ofs_x + bx] = static_cast<uint16>(best_index);
+                     CRNLIB_ASSERT( (tile_block_ofs_x + bx) < 2 );
+                     CRNLIB_ASSERT( (tile_block_ofs_y + by) < 2 );
 
-                        {
-                           scoped_spinlock lock(state.m_chunk_blocks_using_selectors_lock);
-                           state.m_chunk_blocks_using_selectors[best_index].push_back( block_id(chunk_index, 0, tile_index, tile_block_ofs_x + bx, tile_block_ofs_y + by ) );
-                        }
-                        //   std::make_pair(chunk_index, (tile_index << 16) | ((tile_block_ofs_y + by) << 8) | (tile_block_ofs_x + bx) ) );
+                     chunk.m_selector_cluster_index[tile_block_ofs_y + by][tile_block_ofs_x + bx] = static_cast<uint16>(best_index);
 
-                     } // bx
-                  } // by
+                     {
+                        scoped_spinlock lock(state.m_chunk_blocks_using_selectors_lock);
+                        state.m_chunk_blocks_using_selectors[best_index].push_back( block_id(chunk_index, 0, tile_index, tile_block_ofs_x + bx, tile_block_ofs_y + by ) );
+                     }
+                     //   std::make_pair(chunk_index, (tile_index << 16) | ((tile_block_ofs_y + by) << 8) | (tile_block_ofs_x + bx) ) );
 
-               } // if alpha_blocks
+                  } // bx
+               } // by
 
-            } // tile_index
+            } // if alpha_blocks
 
-         } // chunk_index
+         } // tile_index
 
-      } // comp_chunk_index
+      } // item
    }
 
    bool dxt_hc::create_selector_codebook(bool alpha_blocks)
@@ -1675,9 +2409,9 @@ namespace crnlib
                uint weight;
                if (comp_chunk_index == cColorChunks)
                {
-                  const color_quad_u8 first_color(dxt1_block::unpack_color(static_cast<uint16>(quantized_tile.m_first_endpoint), true));
-                  const color_quad_u8 second_color(dxt1_block::unpack_color(static_cast<uint16>(quantized_tile.m_second_endpoint), true));
-                  const uint dist = color::color_distance(m_params.m_perceptual, first_color, second_color, false);
+                  color_quad_u8 block_colors[cDXT1SelectorValues];
+                  get_color_block_colors(block_colors, quantized_tile.m_first_endpoint, quantized_tile.m_second_endpoint);
+                  const uint dist = color::color_distance(m_params.m_perceptual, block_colors[0], block_colors[1], false);
 
                   weight = dist / cColorDistToWeight;
 
@@ -1707,7 +2441,7 @@ namespace crnlib
                   for (uint x = 0; x < (layout.m_width >> 2); x++)
                      block_weight[x + (layout.m_x_ofs >> 2)][y + (layout.m_y_ofs >> 2)] = weight;
 
-               const uint8* pSelectors = quantized_tile.m_selectors;
+               const uint8* pSelectors = chunk.get_quantized_selectors(tile_index);
 
                for (uint y = 0; y < layout.m_height; y++)
                {
@@ -1812,34 +2546,29 @@ namespace crnlib
 
       create_selector_codebook_state state(*this, alpha_blocks, comp_index_start, comp_index_end, selector_vq, chunk_blocks_using_selectors, selectors_cb);
 
-      for (uint i = 0; i <= m_pTask_pool->get_num_threads(); i++)
-         m_pTask_pool->queue_object_task(this, &dxt_hc::create_selector_codebook_task, i, &state);
-
-      m_pTask_pool->join();
-
-      return !m_canceled;
+      return run_phase((alpha_blocks ? "alpha selector codebook" : "color selector codebook"), m_num_chunks * (comp_index_end - comp_index_start + 1), &dxt_hc::create_selector_codebook_task, &state);
    }
 
-   bool dxt_hc::refine_quantized_color_selectors()
+   void dxt_hc::refine_quantized_color_selectors_task(uint64 data, void* pData_ptr)
    {
-      if (!m_has_color_blocks)
-         return true;
-
-#if CRNLIB_ENABLE_DEBUG_MESSAGES
-      if (m_params.m_debugging)
-         console::info("Refining quantized color selectors");
-#endif
+      data;
+      refine_stats& stats = *static_cast<refine_stats*>(pData_ptr);
 
       uint total_refined_selectors = 0;
       uint total_refined_pixels = 0;
       uint total_selectors = 0;
 
-      for (uint selector_index = 0; selector_index < m_color_selectors.size(); selector_index++)
+      work_cursor cursor;
+      uint selector_index;
+      while (get_next_work_item(cursor, selector_index))
       {
-         if ((selector_index & 255) == 0)
+         if (m_canceled)
+            return;
+
+         if ((cursor.m_new_range) && (crn_get_current_thread_id() == m_main_thread_id))
          {
             if (!update_progress(15, selector_index, m_color_selectors.size()))
-               return false;
+               return;
          }
 
          if (m_chunk_blocks_using_color_selectors[selector_index].empty())
@@ -1879,9 +2608,9 @@ namespace crnlib
 
                      color_quad_u8 block_colors[cDXT1SelectorValues];
                      CRNLIB_ASSERT(tile.m_first_endpoint >= tile.m_second_endpoint);
-                     dxt1_block::get_block_colors4(block_colors, static_cast<uint16>(tile.m_first_endpoint), static_cast<uint16>(tile.m_second_endpoint));
+                     get_color_block_colors(block_colors, tile.m_first_endpoint, tile.m_second_endpoint);
 
-                     if ((tile.m_first_endpoint == tile.m_second_endpoint) && (s == 3))
+                     if ((m_params.m_format != cETC1) && (tile.m_first_endpoint == tile.m_second_endpoint) && (s == 3))
                         total_error += 999999;
 
                      const color_quad_u8& orig_pixel = m_pChunks[chunk_index](chunk_block_x * cBlockPixelWidth + x, chunk_block_y * cBlockPixelHeight + y);
@@ -1915,34 +2644,54 @@ namespace crnlib
 
       } // selector_index
 
+      atomic_exchange_add32(&stats.m_total_refined, total_refined_selectors);
+      atomic_exchange_add32(&stats.m_total_refined_pixels, total_refined_pixels);
+      atomic_exchange_add32(&stats.m_total, total_selectors);
+   }
+
+   bool dxt_hc::refine_quantized_color_selectors()
+   {
+      if (!m_has_color_blocks)
+         return true;
+
 #if CRNLIB_ENABLE_DEBUG_MESSAGES
       if (m_params.m_debugging)
-         console::info("Total refined pixels: %u, selectors: %u out of %u", total_refined_pixels, total_refined_selectors, total_selectors);
+         console::info("Refining quantized color selectors");
 #endif
 
-      return true;
-   }
+      refine_stats stats;
 
-   bool dxt_hc::refine_quantized_alpha_selectors()
-   {
-      if (!m_num_alpha_blocks)
-         return true;
+      if (!run_phase("color selector refinement", m_color_selectors.size(), &dxt_hc::refine_quantized_color_selectors_task, &stats))
+         return false;
 
 #if CRNLIB_ENABLE_DEBUG_MESSAGES
       if (m_params.m_debugging)
-         console::info("Refining quantized alpha selectors");
+         console::info("Total refined pixels: %u, selectors: %u out of %u", stats.m_total_refined_pixels, stats.m_total_refined, stats.m_total);
 #endif
 
+      return true;
+   }
+
+   void dxt_hc::refine_quantized_alpha_selectors_task(uint64 data, void* pData_ptr)
+   {
+      data;
+      refine_stats& stats = *static_cast<refine_stats*>(pData_ptr);
+
       uint total_refined_selectors = 0;
       uint total_refined_pixels = 0;
       uint total_selectors = 0;
 
-      for (uint selector_index = 0; selector_index < m_alpha_selectors.size(); selector_index++)
+      work_cursor cursor;
+      uint selector_index;
+      while (get_next_work_item(cursor, selector_index))
       {
-         if ((selector_index & 255) == 0)
+         if (m_canceled)
+            return;
+
+         if ((cursor.m_new_range) && (crn_get_current_thread_id() == m_main_thread_id))
          {
             if (!update_progress(16, selector_index, m_alpha_selectors.size()))
-               return false;
+               return;
          }
 
          if (m_chunk_blocks_using_alpha_selectors[selector_index].empty())
@@ -2019,33 +2768,108 @@ namespace crnlib
 
       } // selector_index
 
+      atomic_exchange_add32(&stats.m_total_refined, total_refined_selectors);
+      atomic_exchange_add32(&stats.m_total_refined_pixels, total_refined_pixels);
+      atomic_exchange_add32(&stats.m_total, total_selectors);
+   }
+
+   bool dxt_hc::refine_quantized_alpha_selectors()
+   {
+      if (!m_num_alpha_blocks)
+         return true;
+
+#if CRNLIB_ENABLE_DEBUG_MESSAGES
+      if (m_params.m_debugging)
+         console::info("Refining quantized alpha selectors");
+#endif
+
+      refine_stats stats;
+
+      if (!run_phase("alpha selector refinement", m_alpha_selectors.size(), &dxt_hc::refine_quantized_alpha_selectors_task, &stats))
+         return false;
+
 #if CRNLIB_ENABLE_DEBUG_MESSAGES
       if (m_params.m_debugging)
-         console::info("Total refined pixels: %u, selectors: %u out of %u", total_refined_pixels, total_refined_selectors, total_selectors);
+         console::info("Total refined pixels: %u, selectors: %u out of %u", stats.m_total_refined_pixels, stats.m_total_refined, stats.m_total);
 #endif
 
       return true;
    }
 
-   bool dxt_hc::refine_quantized_color_endpoints()
+   static uint64 compute_etc1_endpoint_error(uint endpoint, bool perceptual, const color_quad_u8* pPixels, const uint8* pSelectors, uint num_pixels)
    {
-      if (!m_has_color_blocks)
-         return true;
+      color_quad_u8 block_colors[cETC1SelectorValues];
+      unpack_etc1_endpoint(endpoint).get_block_colors(block_colors);
+
+      uint64 total_error = 0;
+      for (uint i = 0; i < num_pixels; i++)
+         total_error += color::color_distance(perceptual, pPixels[i], block_colors[g_dxt1_to_linear[pSelectors[i]]], false);
+
+      return total_error;
+   }
+
+   // Refines a clustered ETC1 endpoint against fixed (DXT1 ordered) selectors. For each intensity table, the least squares base color
+   // is the average of each pixel minus its intensity modifier. Returns false if no table beats the current endpoint.
+   static bool refine_etc1_endpoint(uint& endpoint, uint64& error, bool perceptual, const color_quad_u8* pPixels, const uint8* pSelectors, uint num_pixels)
+   {
+      uint best_endpoint = endpoint;
+      uint64 best_error = compute_etc1_endpoint_error(endpoint, perceptual, pPixels, pSelectors, num_pixels);
+
+      for (uint t = 0; t < cETC1IntenModifierValues; t++)
+      {
+         const int* pInten_table = g_etc1_inten_tables[t];
+
+         int sum[3] = { 0, 0, 0 };
+         for (uint i = 0; i < num_pixels; i++)
+         {
+            const int delta = pInten_table[g_dxt1_to_linear[pSelectors[i]]];
+            for (uint c = 0; c < 3; c++)
+               sum[c] += pPixels[i][c] - delta;
+         }
+
+         color_quad_u8 color5;
+         for (uint c = 0; c < 3; c++)
+            color5[c] = static_cast<uint8>(math::clamp<int>(static_cast<int>(floor(sum[c] * 31.0f / (255.0f * num_pixels) + .5f)), 0, 31));
+
+         const uint trial_endpoint = pack_etc1_endpoint(color5, t);
+         if (trial_endpoint == best_endpoint)
+            continue;
+
+         const uint64 trial_error = compute_etc1_endpoint_error(trial_endpoint, perceptual, pPixels, pSelectors, num_pixels);
+         if (trial_error < best_error)
+         {
+            best_error = trial_error;
+            best_endpoint = trial_endpoint;
+         }
+      }
+
+      if (best_endpoint == endpoint)
+         return false;
+
+      endpoint = best_endpoint;
+      error = best_error;
+      return true;
+   }
+
+   void dxt_hc::refine_quantized_color_endpoints_task(uint64 data, void* pData_ptr)
+   {
+      data;
+      refine_stats& stats = *static_cast<refine_stats*>(pData_ptr);
 
       uint total_refined_tiles = 0;
       uint total_refined_pixels = 0;
 
-#if CRNLIB_ENABLE_DEBUG_MESSAGES
-      if (m_params.m_debugging)
-         console::info("Refining quantized color endpoints");
-#endif
-
-      for (uint cluster_index = 0; cluster_index < m_color_clusters.size(); cluster_index++)
+      work_cursor cursor;
+      uint cluster_index;
+      while (get_next_work_item(cursor, cluster_index))
       {
-         if ((cluster_index & 255) == 0)
+         if (m_canceled)
+            return;
+
+         if ((cursor.m_new_range) && (crn_get_current_thread_id() == m_main_thread_id))
          {
             if (!update_progress(17, cluster_index, m_color_clusters.size()))
-               return false;
+               return;
          }
 
          tile_cluster& cluster = m_color_clusters[cluster_index];
@@ -2081,6 +2905,7 @@ namespace crnlib
 
             compressed_chunk& chunk = m_compressed_chunks[cColorChunks][chunk_index];
             compressed_tile& tile = chunk.m_quantized_tiles[tile_index];
+            const uint8* pTile_selectors = chunk.get_quantized_selectors(tile_index);
 
             const pixel_chunk& src_pixels = m_pChunks[chunk_index];
 
@@ -2093,13 +2918,32 @@ namespace crnlib
             {
                for (uint x = 0; x < tile.m_pixel_width; x++)
                {
-                  selectors.push_back(tile.m_selectors[x + y * tile.m_pixel_width]);
+                  selectors.push_back(pTile_selectors[x + y * tile.m_pixel_width]);
 
                   pixels.push_back(src_pixels(x + tile_layout.m_x_ofs, y + tile_layout.m_y_ofs));
                }
             }
          }
 
+         if (m_params.m_format == cETC1)
+         {
+            if (!refine_etc1_endpoint(cluster.m_first_endpoint, cluster.m_error, m_params.m_perceptual, &pixels[0], &selectors[0], total_pixels))
+               continue;
+
+            total_refined_tiles++;
+            total_refined_pixels += total_pixels;
+
+            for (uint tile_iter = 0; tile_iter < cluster.m_tiles.size(); tile_iter++)
+            {
+               const uint chunk_index = cluster.m_tiles[tile_iter].first;
+               const uint tile_index = cluster.m_tiles[tile_iter].second;
+
+               m_compressed_chunks[cColorChunks][chunk_index].m_quantized_tiles[tile_index].m_first_endpoint = cluster.m_first_endpoint;
+            }
+
+            continue;
+         }
+
          dxt_endpoint_refiner refiner;
          dxt_endpoint_refiner::params p;
          dxt_endpoint_refiner::results r;
@@ -2136,32 +2980,52 @@ namespace crnlib
          }
       }
 
+      atomic_exchange_add32(&stats.m_total_refined, total_refined_tiles);
+      atomic_exchange_add32(&stats.m_total_refined_pixels, total_refined_pixels);
+   }
+
+   bool dxt_hc::refine_quantized_color_endpoints()
+   {
+      if (!m_has_color_blocks)
+         return true;
+
+#if CRNLIB_ENABLE_DEBUG_MESSAGES
+      if (m_params.m_debugging)
+         console::info("Refining quantized color endpoints");
+#endif
+
+      refine_stats stats;
+
+      if (!run_phase("color endpoint refinement", m_color_clusters.size(), &dxt_hc::refine_quantized_color_endpoints_task, &stats))
+         return false;
+
 #if CRNLIB_ENABLE_DEBUG_MESSAGES
       if (m_params.m_debugging)
-         console::info("Total refined pixels: %u, endpoints: %u out of %u", total_refined_pixels, total_refined_tiles, m_color_clusters.size());
+         console::info("Total refined pixels: %u, endpoints: %u out of %u", stats.m_total_refined_pixels, stats.m_total_refined, m_color_clusters.size());
 #endif
 
       return true;
    }
 
-   bool dxt_hc::refine_quantized_alpha_endpoints()
+   void dxt_hc::refine_quantized_alpha_endpoints_task(uint64 data, void* pData_ptr)
    {
-      if (!m_num_alpha_blocks)
-         return true;
+      data;
+      refine_stats& stats = *static_cast<refine_stats*>(pData_ptr);
 
       uint total_refined_tiles = 0;
       uint total_refined_pixels = 0;
-#if CRNLIB_ENABLE_DEBUG_MESSAGES
-      if (m_params.m_debugging)
-         console::info("Refining quantized alpha endpoints");
-#endif
 
-      for (uint cluster_index = 0; cluster_index < m_alpha_clusters.size(); cluster_index++)
+      work_cursor cursor;
+      uint cluster_index;
+      while (get_next_work_item(cursor, cluster_index))
       {
-         if ((cluster_index & 255) == 0)
+         if (m_canceled)
+            return;
+
+         if ((cursor.m_new_range) && (crn_get_current_thread_id() == m_main_thread_id))
          {
             if (!update_progress(18, cluster_index, m_alpha_clusters.size()))
-               return false;
+               return;
          }
 
          tile_cluster& cluster = m_alpha_clusters[cluster_index];
@@ -2199,6 +3063,7 @@ namespace crnlib
 
             compressed_chunk& chunk = m_compressed_chunks[cAlpha0Chunks + alpha_index][chunk_index];
             compressed_tile& tile = chunk.m_quantized_tiles[tile_index];
+            const uint8* pTile_selectors = chunk.get_quantized_selectors(tile_index);
 
             const pixel_chunk& src_pixels = m_pChunks[chunk_index];
 
@@ -2211,7 +3076,7 @@ namespace crnlib
             {
                for (uint x = 0; x < tile.m_pixel_width; x++)
                {
-                  selectors.push_back(tile.m_selectors[x + y * tile.m_pixel_width]);
+                  selectors.push_back(pTile_selectors[x + y * tile.m_pixel_width]);
 
                   pixels.push_back(color_quad_u8(src_pixels(x + tile_layout.m_x_ofs, y + tile_layout.m_y_ofs)[m_params.m_alpha_component_indices[alpha_index]]));
                }
@@ -2255,9 +3120,28 @@ namespace crnlib
          }
       }
 
+      atomic_exchange_add32(&stats.m_total_refined, total_refined_tiles);
+      atomic_exchange_add32(&stats.m_total_refined_pixels, total_refined_pixels);
+   }
+
+   bool dxt_hc::refine_quantized_alpha_endpoints()
+   {
+      if (!m_num_alpha_blocks)
+         return true;
+
+#if CRNLIB_ENABLE_DEBUG_MESSAGES
+      if (m_params.m_debugging)
+         console::info("Refining quantized alpha endpoints");
+#endif
+
+      refine_stats stats;
+
+      if (!run_phase("alpha endpoint refinement", m_alpha_clusters.size(), &dxt_hc::refine_quantized_alpha_endpoints_task, &stats))
+         return false;
+
 #if CRNLIB_ENABLE_DEBUG_MESSAGES
       if (m_params.m_debugging)
-         console::info("Total refined pixels: %u, endpoints: %u out of %u", total_refined_pixels, total_refined_tiles, m_alpha_clusters.size());
+         console::info("Total refined pixels: %u, endpoints: %u out of %u", stats.m_total_refined_pixels, stats.m_total_refined, m_alpha_clusters.size());
 #endif
 
       return true;
@@ -2303,7 +3187,7 @@ namespace crnlib
                const chunk_tile_desc& layout = g_chunk_tile_layouts[quantized_tile.m_layout_index];
 
                color_quad_u8 block_colors[cDXT1SelectorValues];
-               dxt1_block::get_block_colors(block_colors, static_cast<uint16>(quantized_tile.m_first_endpoint), static_cast<uint16>(quantized_tile.m_second_endpoint));
+               get_color_block_colors(block_colors, quantized_tile.m_first_endpoint, quantized_tile.m_second_endpoint, false);
 
                for (uint y = 0; y < layout.m_height; y++)
                {
@@ -2451,7 +3335,12 @@ namespace crnlib
       {
          m_color_endpoints.resize(m_color_clusters.size());
          for (uint i = 0; i < m_color_clusters.size(); i++)
-            m_color_endpoints[i] = dxt1_block::pack_endpoints(m_color_clusters[i].m_first_endpoint, m_color_clusters[i].m_second_endpoint);
+         {
+            if (m_params.m_format == cETC1)
+               m_color_endpoints[i] = m_color_clusters[i].m_first_endpoint;
+            else
+               m_color_endpoints[i] = dxt1_block::pack_endpoints(m_color_clusters[i].m_first_endpoint, m_color_clusters[i].m_second_endpoint);
+         }
       }
 
       if (m_num_alpha_blocks)
@@ -2513,6 +3402,132 @@ namespace crnlib
       }
    }
 
+   struct dxt_hc::phase_state
+   {
+      phase_task_func m_pTask;
+      void* m_pData_ptr;
+
+      uint m_num_items;
+      uint m_num_tasks;
+      volatile atomic32_t m_next_item;
+
+      crnlib::vector<double> m_task_times;
+   };
+
+   // Runs one of the multithreaded phases: a task per thread, which all call pTask(0, pData_ptr). pTask gets the phase's items
+   // (numbered 0 to num_items-1) from get_next_work_item(). Returns false if the compression was canceled.
+   bool dxt_hc::run_phase(const char* pName, uint num_items, phase_task_func pTask, void* pData_ptr)
+   {
+      CRNLIB_ASSERT(!m_pPhase);
+
+      phase_state phase;
+      phase.m_pTask = pTask;
+      phase.m_pData_ptr = pData_ptr;
+      phase.m_num_items = num_items;
+      phase.m_num_tasks = m_pTask_pool->get_num_threads() + 1;
+      phase.m_next_item = 0;
+      phase.m_task_times.resize(phase.m_num_tasks);
+
+      m_pPhase = &phase;
+
+      timer tm;
+      tm.start();
+
+      for (uint i = 0; i < phase.m_num_tasks; i++)
+         m_pTask_pool->queue_object_task(this, &dxt_hc::run_phase_task, i, &phase);
+
+      m_pTask_pool->join();
+
+      m_pPhase = NULL;
+
+      phase_stats* pStats = m_phase_stats.enlarge(1);
+      pStats->m_pName = pName;
+      pStats->m_num_items = num_items;
+      pStats->m_num_tasks = phase.m_num_tasks;
+      pStats->m_time = tm.get_elapsed_secs();
+
+      double total_task_time = 0.0f, max_task_time = 0.0f;
+      for (uint i = 0; i < phase.m_num_tasks; i++)
+      {
+         total_task_time += phase.m_task_times[i];
+         max_task_time = math::maximum(max_task_time, phase.m_task_times[i]);
+      }
+      pStats->m_imbalance = (total_task_time > 0.0f) ? (max_task_time * phase.m_num_tasks / total_task_time) : 1.0f;
+
+      return !m_canceled;
+   }
+
+   void dxt_hc::run_phase_task(uint64 data, void* pData_ptr)
+   {
+      phase_state& phase = *static_cast<phase_state*>(pData_ptr);
+
+      timer tm;
+      tm.start();
+
+      (this->*phase.m_pTask)(0, phase.m_pData_ptr);
+
+      phase.m_task_times[static_cast<uint>(data)] = tm.get_elapsed_secs();
+   }
+
+   // Returns the calling task's next item of the current phase, or false once they've all been handed out.
+   bool dxt_hc::get_next_work_item(work_cursor& cursor, uint& item)
+   {
+      cursor.m_new_range = false;
+
+      if (cursor.m_next == cursor.m_end)
+      {
+         phase_state& phase = *m_pPhase;
+
+         // Guided scheduling: each range is a share of the remaining items, so the ranges are large (and the cursor rarely touched)
+         // early on, and small enough near the end that the tasks all run out of work at about the same time.
+         for ( ; ; )
+         {
+            const uint first = static_cast<uint>(phase.m_next_item);
+            if (first >= phase.m_num_items)
+               return false;
+
+            const uint range_size = math::maximum(1U, (phase.m_num_items - first) / (phase.m_num_tasks * 2));
+            const uint end = math::minimum(phase.m_num_items, first + range_size);
+
+            if (static_cast<uint>(atomic_compare_exchange32(&phase.m_next_item, end, first)) == first)
+            {
+               cursor.m_next = first;
+               cursor.m_end = end;
+               cursor.m_new_range = true;
+               break;
+            }
+         }
+      }
+
+      item = cursor.m_next++;
+      return true;
+   }
+
+   uint dxt_hc::get_chunk_level_index(uint chunk_index) const
+   {
+      // The levels' chunks are consecutive, in level order.
+      uint lo = 0, hi = m_params.m_num_levels;
+      while (hi - lo > 1)
+      {
+         const uint mid = (lo + hi) >> 1;
+         if (chunk_index >= m_params.m_levels[mid].m_first_chunk)
+            lo = mid;
+         else
+            hi = mid;
+      }
+      return lo;
+   }
+
+   void dxt_hc::print_phase_stats() const
+   {
+      console::debug("Phase                         Items  Time (ms)  Imbalance");
+      for (uint i = 0; i < m_phase_stats.size(); i++)
+      {
+         const phase_stats& stats = m_phase_stats[i];
+         console::debug("%-28s %6u %10.1f %10.3f", stats.m_pName, stats.m_num_items, stats.m_time * 1000.0f, stats.m_imbalance);
+      }
+   }
+
    bool dxt_hc::update_progress(uint phase_index, uint subphase_index, uint subphase_total)
    {
       CRNLIB_ASSERT(crn_get_current_thread_id() == m_main_thread_id);
@@ -4,6 +4,7 @@
 #include "crn_dxt1.h"
 #include "crn_dxt5a.h"
 #include "crn_dxt_endpoint_refiner.h"
+#include "crn_etc.h"
 #include "crn_image.h"
 #include "crn_dxt.h"
 #include "crn_image.h"
@@ -129,10 +130,16 @@ namespace crnlib
 
       void clear();
 
+      // Quality independent results of compress(), see below.
+      struct chunk_analysis;
+
       // Main compression function
-      bool compress(const params& p, uint num_chunks, const pixel_chunk* pChunks, task_pool& task_pool);
+      // If pAnalysis is not NULL, the tile layout and endpoints picked for each chunk and the endpoint clusterizers' training vectors are kept in it,
+      // and reused by later calls on the same chunks with params that only differ in the codebook sizes or progress callback.
+      bool compress(const params& p, uint num_chunks, const pixel_chunk* pChunks, task_pool& task_pool, chunk_analysis* pAnalysis = NULL);
 
       // Output accessors
+      inline dxt_format get_format() const { return m_params.m_format; }
       inline uint get_num_chunks() const { return m_num_chunks; }
 
       struct chunk_encoding
@@ -167,6 +174,28 @@ namespace crnlib
       };
       typedef crnlib::vector<selectors> selectors_vec;
 
+      // Codebooks for compress_incremental(), in the same form as the accessors below return them.
+      struct codebooks
+      {
+         crnlib::vector<uint> m_color_endpoints;
+         selectors_vec m_color_selectors;
+         crnlib::vector<uint> m_alpha_endpoints;
+         selectors_vec m_alpha_selectors;
+      };
+
+      // Incremental compression: quantizes the chunks against existing codebooks instead of creating new ones, which is much faster than compress().
+      // prev_encodings holds each chunk's encoding from a previous compression with these codebooks, usually of an older version of the same image.
+      // Chunks that encoding still fits about as well as it fits most chunks are kept as they are, and only the rest (usually the edited parts
+      // of the image) are requantized. Unused codebook entries are dropped. Returns false if the requantized chunks come out worse than
+      // the kept ones by more than max_error_increase (a fraction of the total error), in which case the codebooks no longer suit the image
+      // and compress() should be used instead. Only the DXTn formats are supported.
+      bool compress_incremental(const params& p, uint num_chunks, const pixel_chunk* pChunks, const codebooks& cb, const chunk_encoding_vec& prev_encodings,
+         float max_error_increase, task_pool& task_pool);
+
+      // Sets a chunk encoding's tiles from the endpoint index each of its blocks uses ([comp][block_y][block_x]), picking the encoding with the
+      // fewest tiles that fits, or the 4 tile encoding if !hierarchical. The selector indices are left alone.
+      static void set_chunk_encoding_tiles(chunk_encoding& encoding, const uint16 block_endpoint_indices[3][cChunkBlockHeight][cChunkBlockWidth], bool hierarchical);
+
       // Color endpoints
       inline uint get_color_endpoint_codebook_size() const { return m_color_endpoints.size(); }
       inline uint get_color_endpoint(uint codebook_index) const { return m_color_endpoints[codebook_index]; }
@@ -202,6 +231,19 @@ namespace crnlib
       const pixel_chunk_vec& get_compressed_chunk_pixels_quantized_alpha_selectors() const { return m_dbg_chunk_pixels_quantized_alpha_selectors; }
       const pixel_chunk_vec& get_compressed_chunk_pixels_final_alpha_selectors() const { return m_dbg_chunk_pixels_final_alpha_selectors; }
 
+      // Timing of each multithreaded phase run by the last compress() or compress_incremental(), in the order they ran.
+      struct phase_stats
+      {
+         const char* m_pName;
+         uint m_num_items;          // Chunks, clusters or selectors processed
+         uint m_num_tasks;
+         double m_time;             // Wall clock time in seconds
+         double m_imbalance;        // Busy time of the slowest task divided by the average task's, 1.0=perfectly balanced
+      };
+      typedef crnlib::vector<phase_stats> phase_stats_vec;
+      const phase_stats_vec& get_phase_stats() const { return m_phase_stats; }
+      void print_phase_stats() const;
+
       static void create_debug_image_from_chunks(uint num_chunks_x, uint num_chunks_y, const pixel_chunk_vec& chunks, const chunk_encoding_vec *pChunk_encodings, image_u8& img, bool serpentine_scan, int comp_index = -1);
 
    private:
@@ -223,25 +265,14 @@ namespace crnlib
          uint m_first_endpoint;
          uint m_second_endpoint;
 
-         uint8 m_selectors[cChunkPixelWidth * cChunkPixelHeight];
-
-         void set_selector(uint x, uint y, uint s)
-         {
-            CRNLIB_ASSERT((x < m_pixel_width) && (y < m_pixel_height));
-            m_selectors[x + y * m_pixel_width] = static_cast<uint8>(s);
-         }
-
-         uint get_selector(uint x, uint y) const
-         {
-            CRNLIB_ASSERT((x < m_pixel_width) && (y < m_pixel_height));
-            return m_selectors[x + y * m_pixel_width];
-         }
-
          uint8 m_pixel_width;
          uint8 m_pixel_height;
 
          uint8 m_layout_index;
 
+         // Offset of this tile's (row major) selectors in its chunk's selector array.
+         uint8 m_selector_ofs;
+
          bool m_alpha_encoding;
       };
 
@@ -258,6 +289,17 @@ namespace crnlib
 
          uint16 m_endpoint_cluster_index[cChunkMaxTiles];
          uint16 m_selector_cluster_index[cChunkBlockHeight][cChunkBlockWidth];
+
+         // The tiles of a chunk never overlap, so their selectors are packed back to back instead of each tile reserving room for
+         // a whole chunk. This keeps compressed_chunk small enough for levels with millions of chunks.
+         uint8 m_selectors[cChunkPixelWidth * cChunkPixelHeight];
+         uint8 m_quantized_selectors[cChunkPixelWidth * cChunkPixelHeight];
+
+         uint8* get_selectors(uint tile_index) { CRNLIB_ASSERT(tile_index < m_num_tiles); return m_selectors + m_tiles[tile_index].m_selector_ofs; }
+         const uint8* get_selectors(uint tile_index) const { CRNLIB_ASSERT(tile_index < m_num_tiles); return m_selectors + m_tiles[tile_index].m_selector_ofs; }
+
+         uint8* get_quantized_selectors(uint tile_index) { CRNLIB_ASSERT(tile_index < m_num_tiles); return m_quantized_selectors + m_tiles[tile_index].m_selector_ofs; }
+         const uint8* get_quantized_selectors(uint tile_index) const { CRNLIB_ASSERT(tile_index < m_num_tiles); return m_quantized_selectors + m_tiles[tile_index].m_selector_ofs; }
       };
 
       typedef crnlib::vector<compressed_chunk> compressed_chunk_vec;
@@ -275,16 +317,25 @@ namespace crnlib
 
       atomic32_t m_total_tiles;
 
+      // The optimizers are passed in so each thread can reuse one, instead of reallocating their buffers for every tile.
       void compress_dxt1_block(
-         dxt1_endpoint_optimizer::results& results,
+         dxt1_endpoint_optimizer& optimizer, dxt1_endpoint_optimizer::results& results,
          uint chunk_index, const image_u8& chunk, uint x_ofs, uint y_ofs, uint width, uint height,
          uint8* pSelectors);
 
+      uint compress_etc1_block(
+         etc1_optimizer& optimizer,
+         const image_u8& chunk, uint x_ofs, uint y_ofs, uint width, uint height,
+         uint8* pColor_selectors);
+
       void compress_dxt5_block(
-         dxt5_endpoint_optimizer::results& results,
+         dxt5_endpoint_optimizer& optimizer, dxt5_endpoint_optimizer::results& results,
          uint chunk_index, const image_u8& chunk, uint x_ofs, uint y_ofs, uint width, uint height, uint component_index,
          uint8* pAlpha_selectors);
 
+      // Selectors of ETC1 tiles use the DXT1 ordering, so pBlock_colors[0] and [1] are always the extremes.
+      void get_color_block_colors(color_quad_u8* pBlock_colors, uint first_endpoint, uint second_endpoint, bool four_colors = true) const;
+
       void determine_compressed_chunks_task(uint64 data, void* pData_ptr);
       bool determine_compressed_chunks();
 
@@ -353,6 +404,30 @@ namespace crnlib
       bool m_canceled;
       task_pool* m_pTask_pool;
 
+      // The phases' tasks don't each get a fixed share of the items: every task repeatedly claims the next range of items from the
+      // phase's cursor, with ranges shrinking as the items run out, so the tasks that happen to get cheap items go on to take more.
+      typedef void (dxt_hc::*phase_task_func)(uint64 data, void* pData_ptr);
+      struct phase_state;
+      phase_state* m_pPhase;
+      phase_stats_vec m_phase_stats;
+
+      struct work_cursor
+      {
+         work_cursor() : m_next(0), m_end(0), m_new_range(false) { }
+
+         uint m_next;
+         uint m_end;
+         bool m_new_range;          // True if the last item returned started a new range
+      };
+
+      bool run_phase(const char* pName, uint num_items, phase_task_func pTask, void* pData_ptr = NULL);
+      void run_phase_task(uint64 data, void* pData_ptr);
+      bool get_next_work_item(work_cursor& cursor, uint& item);
+      uint get_chunk_level_index(uint chunk_index) const;
+
+      chunk_analysis* m_pAnalysis;
+      bool m_reuse_analysis;
+
       int m_prev_phase_index;
       int m_prev_percentage_complete;
 
@@ -422,14 +497,57 @@ namespace crnlib
       void create_selector_codebook_task(uint64 data, void* pData_ptr);
       bool create_selector_codebook(bool alpha_blocks);
 
+      // Totals gathered by the refine tasks, only reported when debugging.
+      struct refine_stats
+      {
+         refine_stats() { utils::zero_object(*this); }
+
+         volatile atomic32_t m_total_refined;
+         volatile atomic32_t m_total_refined_pixels;
+         volatile atomic32_t m_total;
+      };
+
+      void refine_quantized_color_endpoints_task(uint64 data, void* pData_ptr);
       bool refine_quantized_color_endpoints();
+      void refine_quantized_color_selectors_task(uint64 data, void* pData_ptr);
       bool refine_quantized_color_selectors();
+      void refine_quantized_alpha_endpoints_task(uint64 data, void* pData_ptr);
       bool refine_quantized_alpha_endpoints();
+      void refine_quantized_alpha_selectors_task(uint64 data, void* pData_ptr);
       bool refine_quantized_alpha_selectors();
       void create_final_debug_image();
       bool create_chunk_encodings();
       bool update_progress(uint phase_index, uint subphase_index, uint subphase_total);
+      bool init_chunks(const params& p, uint num_chunks, const pixel_chunk* pChunks);
       bool compress_internal(const params& p, uint num_chunks, const pixel_chunk* pChunks);
+
+      struct incremental_state;
+      bool compress_incremental_internal(const params& p, uint num_chunks, const pixel_chunk* pChunks, const codebooks& cb, const chunk_encoding_vec& prev_encodings, float max_error_increase);
+      uint get_incremental_block_error(const incremental_state& state, uint chunk_index, uint q, uint block_x, uint block_y, uint endpoint_index, uint selector_index, uint max_error = UINT_MAX) const;
+      uint get_ideal_block_error(uint chunk_index, uint q, uint block_x, uint block_y) const;
+      uint requantize_incremental_block(const incremental_state& state, uint chunk_index, uint q, uint block_x, uint block_y, uint prev_endpoint_index, uint16& endpoint_index, uint16& selector_index) const;
+      void analyze_incremental_chunks_task(uint64 data, void* pData_ptr);
+      void requantize_incremental_chunks_task(uint64 data, void* pData_ptr);
+      void compact_incremental_codebooks(const codebooks& cb);
+   };
+
+   struct dxt_hc::chunk_analysis
+   {
+      chunk_analysis() { clear(); }
+
+      void clear();
+
+      // Set once a compress() call using this analysis succeeds.
+      bool m_valid;
+
+      compressed_chunk_vec m_compressed_chunks[cNumCompressedChunkVecs];
+      uint m_encoding_hist[cNumChunkEncodings];
+      uint m_total_tiles;
+
+      crnlib::vector< crnlib::vector<vec6F> > m_color_training_vecs;
+      vec6F_tree_vq m_color_vq;
+
+      determine_alpha_endpoint_clusters_state m_alpha_clusters_state;
    };
 
    CRNLIB_DEFINE_BITWISE_COPYABLE(dxt_hc::pixel_chunk);
@@ -495,7 +495,7 @@ namespace crnlib
 
    void dxt_image::endian_swap()
    {
-      utils::endian_switch_words(reinterpret_cast<uint16*>(m_elements.get_ptr()), m_elements.size_in_bytes() / sizeof(uint16));
+      utils::endian_switch_words(reinterpret_cast<uint16*>(m_pElements), get_size_in_bytes() / sizeof(uint16));
    }
 
    const dxt_image::element& dxt_image::get_element(uint block_x, uint block_y, uint element_index) const
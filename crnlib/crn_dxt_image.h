@@ -79,6 +79,7 @@ namespace crnlib
       typedef crnlib::vector<element> element_vec;
                   
       bool init(dxt_format fmt, uint width, uint height, bool clear_elements);
+      // If create_copy is false the image aliases pElements, which must outlive it (or the next init()).
       bool init(dxt_format fmt, uint width, uint height, uint num_elements, element* pElements, bool create_copy);
       
       struct pack_params
@@ -156,8 +157,9 @@ namespace crnlib
       
       void endian_swap();
       
-      uint get_total_elements() const { return m_elements.size(); }
+      uint get_total_elements() const { return m_total_elements; }
                   
+      // Empty if the image aliases external data - prefer get_element_ptr().
       const element_vec& get_element_vec() const   { return m_elements; }
             element_vec& get_element_vec()         { return m_elements; }
                   
@@ -167,7 +169,7 @@ namespace crnlib
       const element* get_element_ptr() const { return m_pElements; } 
             element* get_element_ptr()       { return m_pElements; } 
       
-      uint get_size_in_bytes() const { return m_elements.size() * sizeof(element); }
+      uint get_size_in_bytes() const { return m_total_elements * sizeof(element); }
       uint get_row_pitch_in_bytes() const { return m_blocks_x * m_bytes_per_block; }
             
       color_quad_u8 get_pixel(uint x, uint y) const;
@@ -4,6 +4,7 @@
 #include "crn_etc.h"
 #include "crn_radix_sort.h"
 #include "crn_ryg_dxt.hpp"
+#include "crn_dxt1_kernels.h"
 
 namespace crnlib
 {
@@ -745,43 +746,9 @@ namespace crnlib
             block_colors[s].set(base_color.r + yd, base_color.g + yd, base_color.b + yd, 0);
          }
          
-         uint64 total_error = 0;
-         
-         const color_quad_u8* pSrc_pixels = m_pParams->m_pSrc_pixels;
-         for (uint c = 0; c < n; c++)
-         {
-            const color_quad_u8& src_pixel = *pSrc_pixels++;
-            
-            uint best_selector_index = 0;
-            uint best_error = math::square(src_pixel.r - block_colors[0].r) + math::square(src_pixel.g - block_colors[0].g) + math::square(src_pixel.b - block_colors[0].b);
-
-            uint trial_error = math::square(src_pixel.r - block_colors[1].r) + math::square(src_pixel.g - block_colors[1].g) + math::square(src_pixel.b - block_colors[1].b);
-            if (trial_error < best_error)
-            {
-               best_error = trial_error;
-               best_selector_index = 1;
-            }
-
-            trial_error = math::square(src_pixel.r - block_colors[2].r) + math::square(src_pixel.g - block_colors[2].g) + math::square(src_pixel.b - block_colors[2].b);
-            if (trial_error < best_error)
-            {
-               best_error = trial_error;
-               best_selector_index = 2;
-            }
-
-            trial_error = math::square(src_pixel.r - block_colors[3].r) + math::square(src_pixel.g - block_colors[3].g) + math::square(src_pixel.b - block_colors[3].b);
-            if (trial_error < best_error)
-            {
-               best_error = trial_error;
-               best_selector_index = 3;
-            }
-
-            m_temp_selectors[c] = static_cast<uint8>(best_selector_index);
-
-            total_error += best_error;
-            if (total_error >= trial_solution.m_error)
-               break;
-         }
+         // Same closest color search as the DXT1 endpoint optimizer, with equal component weights.
+         static const int s_comp_weights[3] = { 1, 1, 1 };
+         const uint64 total_error = dxt1_kernels::find_best_selectors(m_pParams->m_pSrc_pixels, n, block_colors, 4, s_comp_weights, trial_solution.m_error, &m_temp_selectors[0]);
          
          if (total_error < trial_solution.m_error)
          {
@@ -455,6 +455,19 @@ namespace crnlib
       uint m_inten_table;
       bool m_color4;
    };
+
+   // Clustered ETC1 endpoints (as stored in .CRN files) are an 18-bit value: a 5:5:5 differential mode base color in bits [0,15), and the intensity table index in bits [15,18).
+   // Both subblocks of each block share the endpoint.
+   inline uint pack_etc1_endpoint(const color_quad_u8& unscaled_color5, uint inten_table)
+   {
+      CRNLIB_ASSERT((unscaled_color5.r < 32) && (unscaled_color5.g < 32) && (unscaled_color5.b < 32) && (inten_table < cETC1IntenModifierValues));
+      return unscaled_color5.r | (unscaled_color5.g << 5) | (unscaled_color5.b << 10) | (inten_table << 15);
+   }
+
+   inline etc1_solution_coordinates unpack_etc1_endpoint(uint packed)
+   {
+      return etc1_solution_coordinates(packed & 31, (packed >> 5) & 31, (packed >> 10) & 31, (packed >> 15) & 7, false);
+   }
   
    class etc1_optimizer
    {
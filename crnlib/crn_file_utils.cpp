@@ -16,6 +16,7 @@
 #include <sys/stat.h>
 #include <sys/stat.h>
 #include <libgen.h>
+#include <utime.h>
 #endif
 
 namespace crnlib
@@ -105,6 +106,36 @@ namespace crnlib
 
       return true;
    }
+
+   bool file_utils::get_file_time(const char* pFilename, uint64& file_time)
+   {
+      file_time = 0;
+
+      WIN32_FILE_ATTRIBUTE_DATA attr;
+
+      if (0 == GetFileAttributesExA(pFilename, GetFileExInfoStandard, &attr))
+         return false;
+
+      file_time = static_cast<uint64>(attr.ftLastWriteTime.dwLowDateTime) | (static_cast<uint64>(attr.ftLastWriteTime.dwHighDateTime) << 32U);
+
+      return true;
+   }
+
+   bool file_utils::touch_file(const char* pFilename)
+   {
+      HANDLE hFile = CreateFileA(pFilename, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+      if (hFile == INVALID_HANDLE_VALUE)
+         return false;
+
+      FILETIME now;
+      GetSystemTimeAsFileTime(&now);
+
+      const BOOL result = SetFileTime(hFile, NULL, NULL, &now);
+
+      CloseHandle(hFile);
+
+      return result != FALSE;
+   }
 #elif defined( __GNUC__ )
    bool file_utils::is_read_only(const char* pFilename)
    {
@@ -122,9 +153,11 @@ namespace crnlib
 
    bool file_utils::is_older_than(const char *pSrcFilename, const char* pDstFilename)
    {
-      pSrcFilename, pDstFilename;
-      // TODO
-      return false;
+      uint64 src_file_time, dst_file_time;
+      if ((!get_file_time(pSrcFilename, src_file_time)) || (!get_file_time(pDstFilename, dst_file_time)))
+         return false;
+
+      return src_file_time < dst_file_time;
    }
 
    bool file_utils::does_file_exist(const char* pFilename)
@@ -161,6 +194,26 @@ namespace crnlib
       file_size = stat_buf.st_size;
       return true;
    }
+
+   bool file_utils::get_file_time(const char* pFilename, uint64& file_time)
+   {
+      file_time = 0;
+      struct stat stat_buf;
+      int result = stat(pFilename, &stat_buf);
+      if (result)
+         return false;
+#ifdef __APPLE__
+      file_time = static_cast<uint64>(stat_buf.st_mtimespec.tv_sec) * 1000000000U + stat_buf.st_mtimespec.tv_nsec;
+#else
+      file_time = static_cast<uint64>(stat_buf.st_mtim.tv_sec) * 1000000000U + stat_buf.st_mtim.tv_nsec;
+#endif
+      return true;
+   }
+
+   bool file_utils::touch_file(const char* pFilename)
+   {
+      return utime(pFilename, NULL) == 0;
+   }
 #else
    bool file_utils::is_read_only(const char* pFilename)
    {
@@ -205,6 +258,19 @@ namespace crnlib
       fclose(pFile);
       return true;
    }
+
+   bool file_utils::get_file_time(const char* pFilename, uint64& file_time)
+   {
+      pFilename;
+      file_time = 0;
+      return false;
+   }
+
+   bool file_utils::touch_file(const char* pFilename)
+   {
+      pFilename;
+      return false;
+   }
 #endif
 
    bool file_utils::get_file_size(const char* pFilename, uint32& file_size)
@@ -315,8 +381,8 @@ namespace crnlib
       if (pExt)
       {
          pExt->set(pBaseName);
-         get_extension(*pExt);
-         *pExt = "." + *pExt;
+         if (get_extension(*pExt))
+            *pExt = "." + *pExt;
       }
 #endif // #ifdef WIN32
 
@@ -417,7 +483,7 @@ namespace crnlib
          sep = filename.find_right('/');
 
       int dot = filename.find_right('.');
-      if (dot < sep)
+      if ((dot < 0) || (dot < sep))
       {
          filename.clear();
          return false;
@@ -15,6 +15,11 @@ namespace crnlib
       static bool get_file_size(const char* pFilename, uint64& file_size);
       static bool get_file_size(const char* pFilename, uint32& file_size);
 
+      // Last modification time, in platform specific units. Only useful for comparing against other file times.
+      static bool get_file_time(const char* pFilename, uint64& file_time);
+      // Sets a file's modification time to the current time.
+      static bool touch_file(const char* pFilename);
+
       static bool is_path_separator(char c);
       static bool is_path_or_drive_separator(char c);
       static bool is_drive_separator(char c);
@@ -65,4 +65,80 @@ namespace crnlib
       return hash;
    }
 
+   static const uint64 cMurmur64M = 0xc6a4a7935bd1e995ULL;
+   static const int cMurmur64R = 47;
+
+   static inline uint64 murmur64_mix(uint64 h, uint64 k)
+   {
+      k *= cMurmur64M;
+      k ^= k >> cMurmur64R;
+      k *= cMurmur64M;
+
+      h ^= k;
+      h *= cMurmur64M;
+      return h;
+   }
+
+   void hash64::clear(uint64 seed)
+   {
+      m_hash = seed;
+      m_total_len = 0;
+      m_buf_size = 0;
+   }
+
+   void hash64::update(const void* p, size_t len)
+   {
+      const uint8* pSrc = static_cast<const uint8*>(p);
+
+      m_total_len += len;
+
+      if (m_buf_size)
+      {
+         const uint n = static_cast<uint>(math::minimum<size_t>(len, 8 - m_buf_size));
+         memcpy(m_buf + m_buf_size, pSrc, n);
+         m_buf_size += n;
+         pSrc += n;
+         len -= n;
+
+         if (m_buf_size < 8)
+            return;
+
+         uint64 k;
+         memcpy(&k, m_buf, 8);
+         m_hash = murmur64_mix(m_hash, k);
+         m_buf_size = 0;
+      }
+
+      for ( ; len >= 8; pSrc += 8, len -= 8)
+      {
+         uint64 k;
+         memcpy(&k, pSrc, 8);
+         m_hash = murmur64_mix(m_hash, k);
+      }
+
+      memcpy(m_buf, pSrc, len);
+      m_buf_size = static_cast<uint>(len);
+   }
+
+   uint64 hash64::get_result() const
+   {
+      // The length is folded in at the end (rather than into the seed, as MurmurHash64A does) since it isn't known up front.
+      uint64 h = m_hash ^ (m_total_len * cMurmur64M);
+
+      if (m_buf_size)
+      {
+         uint64 k = 0;
+         for (uint i = 0; i < m_buf_size; i++)
+            k |= static_cast<uint64>(m_buf[i]) << (i * 8U);
+         h ^= k;
+         h *= cMurmur64M;
+      }
+
+      h ^= h >> cMurmur64R;
+      h *= cMurmur64M;
+      h ^= h >> cMurmur64R;
+
+      return h;
+   }
+
 }  // namespace crnlib
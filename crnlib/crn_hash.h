@@ -5,6 +5,28 @@
 namespace crnlib
 {
    uint32 fast_hash (const void* p, int len);
+
+   // Incremental 64-bit hash (MurmurHash64A), for keying data too large to compare directly. Not cryptographic.
+   // The result doesn't depend on how the input is split between update() calls, but does depend on the CPU's byte order.
+   class hash64
+   {
+   public:
+      hash64(uint64 seed = 0) { clear(seed); }
+
+      void clear(uint64 seed = 0);
+
+      void update(const void* p, size_t len);
+
+      template<typename T> inline void update_obj(const T& obj) { update(&obj, sizeof(obj)); }
+
+      uint64 get_result() const;
+
+   private:
+      uint64 m_hash;
+      uint64 m_total_len;
+      uint8 m_buf[8];
+      uint m_buf_size;
+   };
    
    // 4-byte integer hash, full avalanche
    inline uint32 bitmix32c(uint32 a)
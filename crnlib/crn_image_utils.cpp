@@ -602,7 +602,7 @@ namespace crnlib
          }
 
          task_pool tp;
-         tp.init(g_number_of_processors - 1);
+         tp.init(math::minimum<uint>(g_number_of_processors - 1, params.m_max_helper_threads));
 
          threaded_resampler resampler(tp);
          threaded_resampler::params p;
@@ -712,7 +712,7 @@ namespace crnlib
 
       bool resample(const image_u8& src, image_u8& dst, const resample_params& params)
       {
-         if ((params.m_multithreaded) && (g_number_of_processors > 1))
+         if ((params.m_multithreaded) && (g_number_of_processors > 1) && (params.m_max_helper_threads))
             return resample_multithreaded(src, dst, params);
          else
             return resample_single_thread(src, dst, params);
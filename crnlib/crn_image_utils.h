@@ -62,7 +62,8 @@ namespace crnlib
             m_first_comp(0),
             m_num_comps(4),
             m_source_gamma(2.2f), // 1.75f
-            m_multithreaded(true)
+            m_multithreaded(true),
+            m_max_helper_threads(cUINT32_MAX)
          {
          }
 
@@ -76,6 +77,7 @@ namespace crnlib
          uint        m_num_comps;
          float       m_source_gamma;
          bool        m_multithreaded;
+         uint        m_max_helper_threads; // caps the (g_number_of_processors - 1) helper threads used when m_multithreaded is true
       };
 
       bool resample_single_thread(const image_u8& src, image_u8& dst, const resample_params& params);
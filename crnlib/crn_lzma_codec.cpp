@@ -9,11 +9,17 @@
 
 namespace crnlib
 {
-   lzma_codec::lzma_codec() :
+   lzma_codec::lzma_codec(uint level, uint dict_size) :
       m_pCompress(LzmaCompress),
-      m_pUncompress(LzmaUncompress)
+      m_pUncompress(LzmaUncompress),
+      m_level(cDefaultLevel),
+      m_dict_size(0),
+      m_multithreaded(true)
    {
       CRNLIB_ASSUME(cLZMAPropsSize == LZMA_PROPS_SIZE);
+
+      set_level(level);
+      set_dict_size(dict_size);
    }
 
    lzma_codec::~lzma_codec()
@@ -49,17 +55,13 @@ namespace crnlib
 
             status = (*m_pCompress)(pComp_data, &destLen, reinterpret_cast<const unsigned char*>(p), n,
                pHDR->m_lzma_props, &outPropsSize,
-               -1,      /* 0 <= level <= 9, default = 5 */
-               0,       /* default = (1 << 24) */
+               m_level,      /* 0 <= level <= 9, default = 5 */
+               m_dict_size,  /* default = (1 << 24) */
                -1,        /* 0 <= lc <= 8, default = 3  */
                -1,        /* 0 <= lp <= 4, default = 0  */
                -1,        /* 0 <= pb <= 4, default = 2  */
                -1,        /* 5 <= fb <= 273, default = 32 */
-#ifdef WIN32
-               (g_number_of_processors > 1) ? 2 : 1
-#else
-               1
-#endif
+               ((m_multithreaded) && (g_number_of_processors > 1)) ? 2 : 1
                );
 
             if (status != SZ_ERROR_OUTPUT_EOF)
@@ -88,6 +90,148 @@ namespace crnlib
       return true;
    }
 
+   // The costs are in bits, and were fit to pack()'s output for clustered DDS files of various formats and quality levels.
+   static const float cEstimateRep0MatchCost = 3.1f;
+   static const float cEstimateRepMatchCost = 4.3f;
+   static const float cEstimateMatchDistCostScale = .96f;
+   static const float cEstimateLiteralPrior = .6f;
+   static const uint cEstimateMinMatchLen = 3;
+   static const uint cEstimateMaxMatchLen = 273;
+   static const uint cEstimateMaxHashBits = 18;
+
+   uint lzma_codec::estimate_packed_size(const void* p, uint n, uint element_size)
+   {
+      CRNLIB_ASSERT((element_size >= 1) && (element_size <= cMaxEstimateElementSize));
+      element_size = math::clamp<uint>(element_size, 1, cMaxEstimateElementSize);
+
+      const uint8* pSrc = static_cast<const uint8*>(p);
+
+      // Each bucket holds the two most recent positions with the same first 4 bytes.
+      uint hash_bits = 10;
+      while ((hash_bits < cEstimateMaxHashBits) && ((1U << hash_bits) < n))
+         hash_bits++;
+
+      crnlib::vector<int> hash_table(2U << hash_bits);
+      hash_table.set_all(-1);
+
+      crnlib::vector<uint> literal_counts(cMaxEstimateElementSize * 256);
+      uint literal_totals[cMaxEstimateElementSize];
+      utils::zero_object(literal_totals);
+
+      uint reps[4] = { 0, 0, 0, 0 };
+
+      // Fixed costs in bits, and the log2 costs of match distances and literals in nats.
+      double total_bits = 0.0;
+      double total_nats = 0.0;
+
+      uint ofs = 0;
+      while (ofs < n)
+      {
+         const uint max_len = math::minimum(cEstimateMaxMatchLen, n - ofs);
+
+         uint best_len = 0, best_dist = 0;
+         int best_rep = -1;
+
+         for (uint r = 0; r < 4; r++)
+         {
+            const uint dist = reps[r];
+            if ((!dist) || (dist > ofs))
+               continue;
+
+            uint len = 0;
+            while ((len < max_len) && (pSrc[ofs + len] == pSrc[ofs + len - dist]))
+               len++;
+
+            if (len > best_len)
+            {
+               best_len = len;
+               best_dist = dist;
+               best_rep = r;
+            }
+         }
+
+         if ((n - ofs) >= sizeof(uint32))
+         {
+            uint32 v;
+            memcpy(&v, pSrc + ofs, sizeof(v));
+            const uint hash_index = ((v * 2654435761U) >> (32U - hash_bits)) * 2U;
+
+            for (uint i = 0; i < 2; i++)
+            {
+               const int prev_ofs = hash_table[hash_index + i];
+               if (prev_ofs < 0)
+                  break;
+
+               const uint dist = ofs - prev_ofs;
+
+               uint len = 0;
+               while ((len < max_len) && (pSrc[ofs + len] == pSrc[ofs + len - dist]))
+                  len++;
+
+               // A new distance costs more than a rep, so it must be longer to be worth it.
+               if ((len >= cEstimateMinMatchLen) && (len > (best_len + 1)))
+               {
+                  best_len = len;
+                  best_dist = dist;
+                  best_rep = -1;
+               }
+            }
+
+            hash_table[hash_index + 1] = hash_table[hash_index];
+            hash_table[hash_index] = ofs;
+         }
+
+         if (((best_rep >= 0) && (best_len >= 2)) || ((best_rep < 0) && (best_len >= cEstimateMinMatchLen)))
+         {
+            if (best_rep == 0)
+               total_bits += cEstimateRep0MatchCost;
+            else if (best_rep > 0)
+               total_bits += cEstimateRepMatchCost;
+            else
+               total_nats += cEstimateMatchDistCostScale * log(static_cast<float>(best_dist));
+
+            if (best_rep != 0)
+            {
+               for (uint r = (best_rep < 0) ? 3 : best_rep; r > 0; r--)
+                  reps[r] = reps[r - 1];
+               reps[0] = best_dist;
+            }
+
+            for (uint i = 1; i < best_len; i++)
+            {
+               const uint match_ofs = ofs + i;
+               if ((n - match_ofs) < sizeof(uint32))
+                  break;
+
+               uint32 v;
+               memcpy(&v, pSrc + match_ofs, sizeof(v));
+               const uint hash_index = ((v * 2654435761U) >> (32U - hash_bits)) * 2U;
+
+               hash_table[hash_index + 1] = hash_table[hash_index];
+               hash_table[hash_index] = match_ofs;
+            }
+
+            ofs += best_len;
+         }
+         else
+         {
+            // Adaptive order-0 model of the literals at each position within an element.
+            const uint lane = ofs % element_size;
+            uint& count = literal_counts[lane * 256 + pSrc[ofs]];
+
+            total_nats += log((literal_totals[lane] + cEstimateLiteralPrior * 256.0f) / (count + cEstimateLiteralPrior));
+
+            count++;
+            literal_totals[lane]++;
+            ofs++;
+         }
+      }
+
+      total_bits += total_nats / log(2.0f);
+
+      return sizeof(header) + static_cast<uint>(ceil(total_bits / 8.0f));
+   }
+
    bool lzma_codec::unpack(const void* p, uint n, crnlib::vector<uint8>& buf)
    {
       buf.resize(0);
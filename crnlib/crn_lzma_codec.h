@@ -8,16 +8,47 @@ namespace crnlib
    class lzma_codec
    {
    public:
-      lzma_codec();
+      enum
+      {
+         cDefaultLevel = 5,
+         cMaxLevel = 9,
+
+         // Dictionary sizes pack() accepts. 0 uses the level's default (16MB at level 5).
+         cMinDictSize = 4096,
+         cMaxDictSize = 128U * 1024U * 1024U
+      };
+
+      // Higher levels search harder for matches. The dictionary size only matters for data larger than it.
+      lzma_codec(uint level = cDefaultLevel, uint dict_size = 0);
       ~lzma_codec();
 
       // Always available, because we're statically linking in lzmalib now vs. dynamically loading the DLL.
       bool is_initialized() const { return true; }
 
+      uint get_level() const { return m_level; }
+      void set_level(uint level) { m_level = math::minimum<uint>(level, cMaxLevel); }
+
+      uint get_dict_size() const { return m_dict_size; }
+      void set_dict_size(uint dict_size) { m_dict_size = dict_size ? math::clamp<uint>(dict_size, cMinDictSize, cMaxDictSize) : 0; }
+
+      // When multithreading is enabled (the default), pack() runs the match finder on a second thread if there's more than one
+      // processor. Callers that have to stay within a thread budget (like a compressor with no helper threads) should disable it.
+      // The output doesn't depend on it.
+      bool get_multithreaded() const { return m_multithreaded; }
+      void set_multithreaded(bool multithreaded) { m_multithreaded = multithreaded; }
+
       bool pack(const void* p, uint n, crnlib::vector<uint8>& buf);
 
       bool unpack(const void* p, uint n, crnlib::vector<uint8>& buf);
 
+      // Quickly estimates the size of pack()'s output, by greedily parsing the data into matches and literals and adding up
+      // their approximate LZMA costs. About 22 times faster than a single threaded pack() overall (from 12 to 55 times, depending
+      // on the texture and format, in crunch's lzmaest benchmark suite). The estimates of DXTn textures are usually within 10% of
+      // the actual size, and much closer than that relative to each other for similar data (like the same texture compressed at
+      // different quality levels), so they're best scaled by the ratio of the actual and estimated sizes of similar data.
+      // Literals are modelled per byte within each element, so element_size should be the size of the data's records, if any.
+      static uint estimate_packed_size(const void* p, uint n, uint element_size = 1);
+
    private:
       typedef int (CRNLIB_STDCALL *LzmaCompressFuncPtr)(unsigned char *dest, size_t *destLen, const unsigned char *src, size_t srcLen,
          unsigned char *outProps, size_t *outPropsSize, /* *outPropsSize must be = 5 */
@@ -36,7 +67,11 @@ namespace crnlib
       LzmaCompressFuncPtr     m_pCompress;
       LzmaUncompressFuncPtr   m_pUncompress;
 
-      enum { cLZMAPropsSize = 5 };
+      uint                    m_level;
+      uint                    m_dict_size;
+      bool                    m_multithreaded;
+
+      enum { cLZMAPropsSize = 5, cMaxEstimateElementSize = 16 };
 
 #pragma pack(push)
 #pragma pack(1)
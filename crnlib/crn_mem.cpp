@@ -2,6 +2,7 @@
 // This software is in the public domain. Please see license.txt.
 #include "crn_core.h"
 #include "crn_console.h"
+#include "crn_atomics.h"
 #include "../inc/crnlib.h"
 #include <malloc.h>
 #if CRNLIB_USE_WIN32_API
@@ -10,6 +11,10 @@
 
 #define CRNLIB_MEM_STATS 0
 
+// Set to 1 to count the blocks allocated, for crnlib_get_total_allocations(). Off by default, because every allocation on every
+// thread would update the same counter.
+#define CRNLIB_MEM_COUNT_ALLOCATIONS 0
+
 #if !CRNLIB_USE_WIN32_API
 #define _msize malloc_usable_size
 #endif
@@ -61,6 +66,20 @@ namespace crnlib
    }
 #endif // CRNLIB_MEM_STATS
 
+#if CRNLIB_MEM_COUNT_ALLOCATIONS
+   static volatile atomic64_t g_total_allocations;
+
+   static void count_allocation()
+   {
+      for ( ; ; )
+      {
+         const atomic64_t cur_total = g_total_allocations;
+         if (atomic_compare_exchange64(&g_total_allocations, cur_total + 1, cur_total) == cur_total)
+            break;
+      }
+   }
+#endif
+
    static void* crnlib_default_realloc(void* p, size_t size, size_t* pActual_size, bool movable, void* pUser_data)
    {
       pUser_data;
@@ -246,6 +265,10 @@ namespace crnlib
 
       CRNLIB_ASSERT((reinterpret_cast<ptr_bits_t>(p_new) & (CRNLIB_MIN_ALLOC_ALIGNMENT - 1)) == 0);
 
+#if CRNLIB_MEM_COUNT_ALLOCATIONS
+      count_allocation();
+#endif
+
 #if CRNLIB_MEM_STATS
       CRNLIB_ASSERT((*g_pMSize)(p_new, g_pUser_data) == actual_size);
       update_total_allocated(1, static_cast<mem_stat_t>(actual_size));
@@ -283,6 +306,11 @@ namespace crnlib
 
       CRNLIB_ASSERT((reinterpret_cast<ptr_bits_t>(p_new) & (CRNLIB_MIN_ALLOC_ALIGNMENT - 1)) == 0);
 
+#if CRNLIB_MEM_COUNT_ALLOCATIONS
+      if ((p_new) && (p_new != p))
+         count_allocation();
+#endif
+
 #if CRNLIB_MEM_STATS
       CRNLIB_ASSERT(!p_new || ((*g_pMSize)(p_new, g_pUser_data) == actual_size));
 
@@ -344,14 +372,28 @@ namespace crnlib
       return (*g_pMSize)(p, g_pUser_data);
    }
 
+   uint64 crnlib_get_total_allocations()
+   {
+#if CRNLIB_MEM_COUNT_ALLOCATIONS
+      return static_cast<uint64>(g_total_allocations);
+#else
+      return 0;
+#endif
+   }
+
    void crnlib_print_mem_stats()
    {
-#if CRNLIB_MEM_STATS
       if (console::is_initialized())
       {
          console::debug("crnlib_print_mem_stats:");
+#if CRNLIB_MEM_STATS
          console::debug("Current blocks: %u, allocated: " CRNLIB_INT64_FORMAT_SPECIFIER ", max ever allocated: " CRNLIB_INT64_FORMAT_SPECIFIER, g_total_blocks, (int64)g_total_allocated, (int64)g_max_allocated);
+#endif
+#if CRNLIB_MEM_COUNT_ALLOCATIONS
+         console::debug("Total allocations: " CRNLIB_UINT64_FORMAT_SPECIFIER, crnlib_get_total_allocations());
+#endif
       }
+#if CRNLIB_MEM_STATS
       else
       {
          printf("crnlib_print_mem_stats:\n");
@@ -21,6 +21,9 @@ namespace crnlib
    void     crnlib_free(void* p);
    size_t   crnlib_msize(void* p);
    void     crnlib_print_mem_stats();
+   // Number of blocks allocated so far (including blocks moved by crnlib_realloc()), for spotting code that allocates too often.
+   // Always 0 unless crn_mem.cpp is built with CRNLIB_MEM_COUNT_ALLOCATIONS.
+   uint64   crnlib_get_total_allocations();
    void     crnlib_mem_error(const char* p_msg);
    
    // omfg - there must be a better way
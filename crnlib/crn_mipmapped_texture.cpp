@@ -3,6 +3,7 @@
 #include "crn_core.h"
 #include "crn_mipmapped_texture.h"
 #include "crn_cfile_stream.h"
+#include "crn_mmap_stream.h"
 #include "crn_image_utils.h"
 #include "crn_console.h"
 #include "crn_texture_comp.h"
@@ -445,6 +446,7 @@ namespace crnlib
       m_height(0),
       m_comp_flags(pixel_format_helpers::cDefaultCompFlags),
       m_format(PIXEL_FMT_INVALID),
+      m_pMapped_file(NULL),
       m_source_file_type(texture_file_types::cFormatInvalid)
    {
    }
@@ -474,13 +476,20 @@ namespace crnlib
             crnlib_delete(m_faces[i][j]);
 
       m_faces.clear();
+
+      if (m_pMapped_file)
+      {
+         crnlib_delete(m_pMapped_file);
+         m_pMapped_file = NULL;
+      }
    }
 
    mipmapped_texture::mipmapped_texture(const mipmapped_texture& other) :
       m_width(0),
       m_height(0),
       m_comp_flags(pixel_format_helpers::cDefaultCompFlags),
-      m_format(PIXEL_FMT_INVALID)
+      m_format(PIXEL_FMT_INVALID),
+      m_pMapped_file(NULL)
    {
       *this = other;
    }
@@ -515,7 +524,7 @@ namespace crnlib
    
    bool mipmapped_texture::read_dds(data_stream_serializer& serializer)
    {
-      if (!read_dds_internal(serializer))
+      if (!read_dds_internal(serializer, false))
       {
          clear();
          return false;
@@ -524,7 +533,8 @@ namespace crnlib
       return true;
    }
 
-   bool mipmapped_texture::read_dds_internal(data_stream_serializer& serializer)
+   // If alias_mapped_data is true, the stream's get_ptr() must stay valid for as long as the texture's levels do.
+   bool mipmapped_texture::read_dds_internal(data_stream_serializer& serializer, bool alias_mapped_data)
    {
       CRNLIB_ASSERT(serializer.get_little_endian());
 
@@ -784,6 +794,9 @@ namespace crnlib
 
       bool dxt1_alpha = false;
 
+      data_stream* pStream = serializer.get_stream();
+      uint8* pMapped_data = alias_mapped_data ? static_cast<uint8*>(const_cast<void*>(pStream->get_ptr())) : NULL;
+
       for (uint face_index = 0; face_index < num_faces; face_index++)
       {
          m_faces[face_index].resize(num_mip_levels);
@@ -807,21 +820,38 @@ namespace crnlib
                const uint level_pitch = level_index ? actual_level_pitch : pitch;
 
                dxt_image* pDXTImage = crnlib_new<dxt_image>();
-               if (!pDXTImage->init(dxt_fmt, width, height, false))
+
+               const uint64 level_ofs = pStream->get_ofs();
+               if ((pMapped_data) && (!(level_ofs & (sizeof(dxt_image::element) - 1))))
                {
-                  crnlib_delete(pDXTImage);
+                  // Point the image straight at the level's blocks in the (copy-on-write) mapping.
+                  if ((pStream->get_remaining() < actual_level_pitch) ||
+                      (!pDXTImage->init(dxt_fmt, width, height, actual_level_pitch / sizeof(dxt_image::element), reinterpret_cast<dxt_image::element*>(pMapped_data + level_ofs), false)) ||
+                      (!serializer.skip(actual_level_pitch)))
+                  {
+                     crnlib_delete(pDXTImage);
 
-                  CRNLIB_ASSERT(0);
-                  return false;
+                     return false;
+                  }
                }
-               
-               CRNLIB_ASSERT(pDXTImage->get_element_vec().size() * sizeof(dxt_image::element) == actual_level_pitch);
-
-               if (!serializer.read(&pDXTImage->get_element_vec()[0], actual_level_pitch))
+               else
                {
-                  crnlib_delete(pDXTImage);
+                  if (!pDXTImage->init(dxt_fmt, width, height, false))
+                  {
+                     crnlib_delete(pDXTImage);
 
-                  return false;
+                     CRNLIB_ASSERT(0);
+                     return false;
+                  }
+
+                  CRNLIB_ASSERT(pDXTImage->get_size_in_bytes() == actual_level_pitch);
+
+                  if (!serializer.read(pDXTImage->get_element_ptr(), actual_level_pitch))
+                  {
+                     crnlib_delete(pDXTImage);
+
+                     return false;
+                  }
                }
 
                // DDS image in memory are always assumed to be little endian - the same as DDS itself.
@@ -1000,16 +1030,8 @@ namespace crnlib
       return true;
    }
 
-   bool mipmapped_texture::write_dds(data_stream_serializer& serializer) const
+   bool mipmapped_texture::write_dds_header(data_stream_serializer& serializer, uint width, uint height, uint num_levels, uint num_faces, pixel_format fmt)
    {
-      if (!m_width)
-      {
-         set_last_error("Nothing to write");
-         return false;
-      }
-
-      set_last_error("write_dds() failed");
-
       if (!serializer.write("DDS ", sizeof(uint32)))
          return false;
 
@@ -1019,34 +1041,31 @@ namespace crnlib
       desc.dwSize = sizeof(desc);
       desc.dwFlags = DDSD_WIDTH | DDSD_HEIGHT | DDSD_PIXELFORMAT | DDSD_CAPS;
             
-      desc.dwWidth = m_width;
-      desc.dwHeight = m_height;
+      desc.dwWidth = width;
+      desc.dwHeight = height;
 
       desc.ddsCaps.dwCaps = DDSCAPS_TEXTURE;
       desc.ddpfPixelFormat.dwSize = sizeof(desc.ddpfPixelFormat);
 
-      if (get_num_levels() > 1)
+      if (num_levels > 1)
       {
-         desc.dwMipMapCount = get_num_levels();
+         desc.dwMipMapCount = num_levels;
          desc.dwFlags |= DDSD_MIPMAPCOUNT;
          desc.ddsCaps.dwCaps |= (DDSCAPS_MIPMAP | DDSCAPS_COMPLEX);
       }
 
-      if (get_num_faces() > 1)
+      if (num_faces > 1)
       {
          desc.ddsCaps.dwCaps |= DDSCAPS_COMPLEX;
          desc.ddsCaps.dwCaps2 |= DDSCAPS2_CUBEMAP;
          desc.ddsCaps.dwCaps2 |= DDSCAPS2_CUBEMAP_POSITIVEX|DDSCAPS2_CUBEMAP_NEGATIVEX|DDSCAPS2_CUBEMAP_POSITIVEY|DDSCAPS2_CUBEMAP_NEGATIVEY|DDSCAPS2_CUBEMAP_POSITIVEZ|DDSCAPS2_CUBEMAP_NEGATIVEZ;
       }
 
-      bool dxt_format = false;
-      if (pixel_format_helpers::is_dxt(m_format))
+      if (pixel_format_helpers::is_dxt(fmt))
       {
-         dxt_format = true;
-
          desc.ddpfPixelFormat.dwFlags |= DDPF_FOURCC;
 
-         switch (m_format)
+         switch (fmt)
          {
             case PIXEL_FMT_ETC1:
             {
@@ -1092,19 +1111,19 @@ namespace crnlib
             }
             default:
             {
-               desc.ddpfPixelFormat.dwFourCC = (uint32)m_format;
+               desc.ddpfPixelFormat.dwFourCC = (uint32)fmt;
                desc.ddpfPixelFormat.dwRGBBitCount = 0;
                break;
             }
          }
 
-         uint bits_per_pixel = pixel_format_helpers::get_bpp(m_format);
+         uint bits_per_pixel = pixel_format_helpers::get_bpp(fmt);
          desc.lPitch = (((desc.dwWidth + 3) & ~3) * ((desc.dwHeight + 3) & ~3) * bits_per_pixel) >> 3;
          desc.dwFlags |= DDSD_LINEARSIZE;
       }
       else
       {
-         switch (m_format)
+         switch (fmt)
          {
             case PIXEL_FMT_A8R8G8B8:
             {
@@ -1165,8 +1184,23 @@ namespace crnlib
       if (!serializer.write(&desc, sizeof(desc)))
          return false;
 
-      if (!c_crnlib_little_endian_platform)
-         utils::endian_switch_dwords(reinterpret_cast<uint32*>(&desc), sizeof(desc) / sizeof(uint32));
+      return true;
+   }
+
+   bool mipmapped_texture::write_dds(data_stream_serializer& serializer) const
+   {
+      if (!m_width)
+      {
+         set_last_error("Nothing to write");
+         return false;
+      }
+
+      set_last_error("write_dds() failed");
+
+      if (!write_dds_header(serializer, m_width, m_height, get_num_levels(), get_num_faces(), m_format))
+         return false;
+
+      const bool dxt_format = pixel_format_helpers::is_dxt(m_format);
 
       crnlib::vector<uint8> write_buf;
 
@@ -1216,17 +1250,10 @@ namespace crnlib
                width, height, num_blocks_x, num_blocks_y;
 
                const uint size_in_bytes = p->get_total_elements() * sizeof(dxt_image::element);
-               if (size_in_bytes > write_buf.size())
-                  write_buf.resize(size_in_bytes);
-
-               memcpy(&write_buf[0], p->get_element_ptr(), size_in_bytes);
 
-               // DXT data is always little endian in memory, just like the DDS format.
+               // DXT data is always little endian in memory, just like the DDS format, so it's written as is.
                // (Except for ETC1, which contains big endian 64-bit QWORD's).
-               //if (!c_crnlib_little_endian_platform)
-               //   utils::endian_switch_words(reinterpret_cast<WORD*>(&write_buf[0]), size_in_bytes / sizeof(WORD));
-
-               if (!serializer.write(&write_buf[0], size_in_bytes))
+               if (!serializer.write(p->get_element_ptr(), size_in_bytes))
                   return false;
             }
             else
@@ -1241,7 +1268,7 @@ namespace crnlib
                   p = pLevel->get_unpacked_image(tmp, cUnpackFlagUnflip);
                }
 
-               const uint bits_per_pixel = desc.ddpfPixelFormat.dwRGBBitCount;
+               const uint bits_per_pixel = pixel_format_helpers::get_bpp(m_format);
                const uint bytes_per_pixel = bits_per_pixel >> 3;
 
                const uint pitch = width * bytes_per_pixel;
@@ -1321,6 +1348,29 @@ namespace crnlib
       return true;
    }
 
+   uint64 mipmapped_texture::get_dds_file_size() const
+   {
+      uint64 total_size = sizeof(uint32) + sizeof(DDSURFACEDESC2);
+
+      const bool dxt_format = pixel_format_helpers::is_dxt(m_format);
+
+      for (uint face = 0; face < get_num_faces(); face++)
+      {
+         for (uint level = 0; level < get_num_levels(); level++)
+         {
+            const uint width = math::maximum<uint>(1, m_width >> level);
+            const uint height = math::maximum<uint>(1, m_height >> level);
+
+            if (dxt_format)
+               total_size += ((width + 3) >> 2) * ((height + 3) >> 2) * pixel_format_helpers::get_dxt_bytes_per_block(m_format);
+            else
+               total_size += width * height * (pixel_format_helpers::get_bpp(m_format) >> 3);
+         }
+      }
+
+      return total_size;
+   }
+
    bool mipmapped_texture::read_ktx(data_stream_serializer& serializer)
    {
       clear();
@@ -1608,8 +1658,9 @@ namespace crnlib
             mip_level* pMip = crnlib_new<mip_level>();
             m_faces[face_index][level_index] = pMip;
 
-            const crnlib::vector<uint8>& image_data = kt.get_image_data(level_index, 0, face_index, 0);
-            
+            // Each image is released as soon as it's been converted, so only one level is ever held twice.
+            crnlib::vector<uint8>& image_data = kt.get_image_data(level_index, 0, face_index, 0);
+
             if (is_compressed_texture)
             {
                const uint bytes_per_block = pixel_format_helpers::get_dxt_bytes_per_block(m_format);
@@ -1630,9 +1681,9 @@ namespace crnlib
                   return false;
                }
 
-               CRNLIB_ASSERT(pDXTImage->get_element_vec().size() * sizeof(dxt_image::element) == level_pitch);
-               
-               memcpy(&pDXTImage->get_element_vec()[0], image_data.get_ptr(), image_data.size());
+               CRNLIB_ASSERT(pDXTImage->get_size_in_bytes() == level_pitch);
+
+               memcpy(pDXTImage->get_element_ptr(), image_data.get_ptr(), image_data.size());
 
                if ((m_format == PIXEL_FMT_DXT1) && (!dxt1_alpha))
                   dxt1_alpha = pDXTImage->has_alpha();
@@ -1666,6 +1717,8 @@ namespace crnlib
 
                CRNLIB_ASSERT(pMip->get_comp_flags() == m_comp_flags);
             }
+
+            image_data.clear();
          }
       }
 
@@ -1886,6 +1939,7 @@ namespace crnlib
       utils::swap(m_comp_flags, img.m_comp_flags);
       utils::swap(m_format, img.m_format);
       m_faces.swap(img.m_faces);
+      utils::swap(m_pMapped_file, img.m_pMapped_file);
       m_last_error.swap(img.m_last_error);
       utils::swap(m_source_file_type, img.m_source_file_type);
 
@@ -2247,6 +2301,7 @@ namespace crnlib
          rparams.m_wrapping = params.m_wrapping;
          rparams.m_pFilter = params.m_pFilter;
          rparams.m_multithreaded = params.m_multithreaded;
+         rparams.m_max_helper_threads = params.m_max_helper_threads;
 
          if (!image_utils::resample(*pImg, *pMip, rparams))
          {
@@ -2335,6 +2390,7 @@ namespace crnlib
                rparams.m_wrapping = params.m_wrapping;
                rparams.m_pFilter = params.m_pFilter;
                rparams.m_multithreaded = params.m_multithreaded;
+               rparams.m_max_helper_threads = params.m_max_helper_threads;
 
                if (!image_utils::resample(*pImg, *pMip, rparams))
                {
@@ -2785,20 +2841,48 @@ namespace crnlib
 
       bool success = false;
 
-      cfile_stream in_stream;
-      if (in_stream.open(pFilename))
+      // Win32 won't let anything open a mapped file for writing, so aliasing the mapping there would stop the texture from ever
+      // being written back over its own source. Copy the levels out instead, and let the mapping go right away.
+#if CRNLIB_USE_WIN32_API
+      const bool alias_mapped_data = false;
+#else
+      const bool alias_mapped_data = true;
+#endif
+
+      mmap_stream* pMapped_file = crnlib_new<mmap_stream>();
+      if (pMapped_file->open(pFilename))
       {
-         data_stream_serializer serializer(in_stream);
-         success = read_from_stream(serializer, file_format);
+         data_stream_serializer serializer(*pMapped_file);
+         success = read_from_stream_internal(serializer, file_format, alias_mapped_data);
       }
-            
+      else
+      {
+         // Empty files, or the mapping failed - read it the old fashioned way.
+         cfile_stream in_stream;
+         if (in_stream.open(pFilename))
+         {
+            data_stream_serializer serializer(in_stream);
+            success = read_from_stream_internal(serializer, file_format, false);
+         }
+      }
+
+      if ((success) && (alias_mapped_data) && (m_source_file_type == texture_file_types::cFormatDDS) && (is_packed()))
+         m_pMapped_file = pMapped_file;
+      else
+         crnlib_delete(pMapped_file);
+
       return success;
    }
 
    bool mipmapped_texture::read_from_stream(data_stream_serializer& serializer, texture_file_types::format file_format)
    {
       clear();
-      
+
+      return read_from_stream_internal(serializer, file_format, false);
+   }
+
+   bool mipmapped_texture::read_from_stream_internal(data_stream_serializer& serializer, texture_file_types::format file_format, bool alias_mapped_data)
+   {
       if (!serializer.get_stream())
       {
          set_last_error("Invalid stream");
@@ -2828,7 +2912,9 @@ namespace crnlib
          {
             case texture_file_types::cFormatDDS:
             {
-               success = read_dds(serializer);
+               success = read_dds_internal(serializer, alias_mapped_data);
+               if (!success)
+                  clear();
                break;
             }
             case texture_file_types::cFormatCRN:
@@ -2919,13 +3005,6 @@ namespace crnlib
             faces[f][l] = crnlib_new<mip_level>();
       }
 
-      const uint tex_num_blocks_x = (tex_info.m_width + 3) >> 2;
-      const uint tex_num_blocks_y = (tex_info.m_height + 3) >> 2;
-
-      vector<uint8> dxt_data;
-      // Create temp buffer big enough to hold the largest mip level, and all faces if it's a cubemap.
-      dxt_data.resize(tex_info.m_bytes_per_block * tex_num_blocks_x * tex_num_blocks_y * tex_info.m_faces);
-
       set_last_error("CRN unpack failed");
 
 #if 0
@@ -2966,34 +3045,11 @@ namespace crnlib
 
          total_pixels += num_blocks_x * num_blocks_y * 4 * 4 * tex_info.m_faces;
 
-#if 0
-         t.start();
-#endif
-
-         for (uint f = 0; f < tex_info.m_faces; f++)
-            pFaces[f] = &dxt_data[f * size_of_face];
-
-         if (!crnd::crnd_unpack_level(pContext, pFaces, dxt_data.size(), row_pitch, l))
-         {
-            crnd::crnd_unpack_end(pContext);
-            for (uint f = 0; f < faces.size(); f++)
-               for (uint l = 0; l < faces[f].size(); l++)
-                  crnlib_delete(faces[f][l]);
-            return false;
-         }
-
-#if 0
-         total_time += t.get_elapsed_secs();
-#endif
-
+         // Each face's level is unpacked straight into its dxt_image, whose element layout matches the DXT block layout.
          for (uint f = 0; f < tex_info.m_faces; f++)
          {
             dxt_image* pDXT_image = crnlib_new<dxt_image>();
-
-            if (!pDXT_image->init(
-               dxt_fmt, level_width, level_height,
-               num_blocks_x * num_blocks_y * (tex_info.m_bytes_per_block / sizeof(dxt_image::element)),
-               reinterpret_cast<dxt_image::element*>(pFaces[f]), true))
+            if (!pDXT_image->init(dxt_fmt, level_width, level_height, false))
             {
                crnlib_delete(pDXT_image);
 
@@ -3005,8 +3061,28 @@ namespace crnlib
                return false;
             }
 
+            CRNLIB_ASSERT(pDXT_image->get_size_in_bytes() == size_of_face);
+
             faces[f][l]->assign(pDXT_image, dds_fmt);
+            pFaces[f] = pDXT_image->get_element_ptr();
          }
+
+#if 0
+         t.start();
+#endif
+
+         if (!crnd::crnd_unpack_level(pContext, pFaces, size_of_face, row_pitch, l))
+         {
+            crnd::crnd_unpack_end(pContext);
+            for (uint f = 0; f < faces.size(); f++)
+               for (uint l = 0; l < faces[f].size(); l++)
+                  crnlib_delete(faces[f][l]);
+            return false;
+         }
+
+#if 0
+         total_time += t.get_elapsed_secs();
+#endif
       }
 
 #if 0
@@ -3030,6 +3106,12 @@ namespace crnlib
 
    bool mipmapped_texture::read_crn(data_stream_serializer& serializer)
    {
+      // Memory backed streams (including mapped files) are unpacked in place.
+      data_stream* pStream = serializer.get_stream();
+      const uint8* pStream_data = static_cast<const uint8*>(pStream->get_ptr());
+      if ((pStream_data) && (pStream->get_remaining() <= cUINT32_MAX))
+         return read_crn_from_memory(pStream_data + pStream->get_ofs(), static_cast<uint>(pStream->get_remaining()), serializer.get_name().get_ptr());
+
       crnlib::vector<uint8> crn_data;
       if (!serializer.read_entire_file(crn_data))
       {
@@ -3064,6 +3146,13 @@ namespace crnlib
          return false;
       }
 
+      // The file may be this (or another) texture's source, still aliased by its levels.
+      if (!mmap_stream::unlink_if_mapped(pFilename))
+      {
+         set_last_error(dynamic_string(cVarArg, "Unable to replace file \"%s\", which is still in use", pFilename).get_ptr());
+         return false;
+      }
+
       bool success = false;
 
       if ( ((pComp_params) && (file_format == texture_file_types::cFormatDDS)) || 
@@ -3084,6 +3173,29 @@ namespace crnlib
             console::warning("mipmapped_texture::write_to_file: Ignoring CRN compression parameters (currently unsupported for this file type).");
          }
 
+         if (file_format == texture_file_types::cFormatDDS)
+         {
+            // The size of a .DDS file is known up front, so its levels are written straight into a pre-sized mapping of the file.
+            const uint64 file_size = get_dds_file_size();
+
+            mmap_stream mapped_stream;
+            if (mapped_stream.open_for_writing(pFilename, file_size))
+            {
+               data_stream_serializer serializer(mapped_stream);
+               success = write_dds(serializer);
+
+               CRNLIB_ASSERT((!success) || (!mapped_stream.get_remaining()));
+
+               if (!mapped_stream.close())
+               {
+                  set_last_error(dynamic_string(cVarArg, "Failed writing output file \"%s\"", pFilename).get_ptr());
+                  success = false;
+               }
+
+               return success;
+            }
+         }
+
          cfile_stream write_stream;
          if (!write_stream.open(pFilename, cDataStreamWritable | cDataStreamSeekable))
          {
@@ -3144,6 +3256,7 @@ namespace crnlib
       console::debug("Color selectors: %u", p.m_crn_color_selector_palette_size);
       console::debug("Alpha endpoints: %u", p.m_crn_alpha_endpoint_palette_size);
       console::debug("Alpha selectors: %u", p.m_crn_alpha_selector_palette_size);
+      console::debug("Restart interval: %u", p.m_crn_restart_interval);
       console::debug("Flags:");
       console::debug("    Perceptual: %u", p.get_flag(cCRNCompFlagPerceptual));
       console::debug("  Hierarchical: %u", p.get_flag(cCRNCompFlagHierarchical));
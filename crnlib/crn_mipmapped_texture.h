@@ -14,6 +14,8 @@
 
 namespace crnlib
 {
+   class mmap_stream;
+
    extern const vec2I g_vertical_cross_image_offsets[6];
 
    enum orientation_flags_t
@@ -181,6 +183,9 @@ namespace crnlib
       bool read_dds(data_stream_serializer& serializer);
       bool write_dds(data_stream_serializer& serializer) const;
 
+      // Writes just the "DDS " signature and surface description, for writers that produce the level data themselves.
+      static bool write_dds_header(data_stream_serializer& serializer, uint width, uint height, uint num_levels, uint num_faces, pixel_format fmt);
+
       bool read_ktx(data_stream_serializer& serializer);
       bool write_ktx(data_stream_serializer& serializer) const;
  
@@ -188,6 +193,9 @@ namespace crnlib
       bool read_crn_from_memory(const void *pData, uint data_size, const char* pFilename);
       
       // If file_format is texture_file_types::cFormatInvalid, the format will be determined from the filename's extension.
+      // Files are memory mapped where possible: the levels of packed .DDS files alias the mapping (which the texture keeps open until
+      // its mips are freed) instead of being copied out of it, and .CRN files are unpacked straight from it. On Win32 the levels are
+      // always copied, so the source file can be overwritten while the texture is still alive.
       bool read_from_file(const char* pFilename, texture_file_types::format file_format = texture_file_types::cFormatInvalid);
       bool read_from_stream(data_stream_serializer& serializer, texture_file_types::format file_format = texture_file_types::cFormatInvalid);
 
@@ -221,7 +229,8 @@ namespace crnlib
             m_renormalize(false),
             m_filter_scale(.9f),
             m_gamma(1.75f),    // or 2.2f
-            m_multithreaded(true)
+            m_multithreaded(true),
+            m_max_helper_threads(cUINT32_MAX)
          {
          }
 
@@ -232,6 +241,7 @@ namespace crnlib
          float       m_filter_scale;
          float       m_gamma;
          bool        m_multithreaded;
+         uint        m_max_helper_threads;
       };
 
       bool resize(uint new_width, uint new_height, const resample_params& params);
@@ -314,6 +324,9 @@ namespace crnlib
 
       face_vec                               m_faces;
 
+      // Set when the levels alias a file mapped by read_from_file().
+      mmap_stream*                           m_pMapped_file;
+
       texture_file_types::format             m_source_file_type;
 
       mutable dynamic_string                 m_last_error;
@@ -324,7 +337,9 @@ namespace crnlib
       void free_all_mips();
       bool read_regular_image(data_stream_serializer &serializer, texture_file_types::format file_format);
       bool write_regular_image(const char* pFilename, uint32 image_write_flags);
-      bool read_dds_internal(data_stream_serializer& serializer);
+      bool read_from_stream_internal(data_stream_serializer& serializer, texture_file_types::format file_format, bool alias_mapped_data);
+      bool read_dds_internal(data_stream_serializer& serializer, bool alias_mapped_data);
+      uint64 get_dds_file_size() const;
       void print_crn_comp_params(const crn_comp_params& p);
       bool write_comp_texture(const char* pFilename, const crn_comp_params &comp_params, uint32 *pActual_quality_level, float *pActual_bitrate);
       void change_dxt1_to_dxt1a();
@@ -0,0 +1,385 @@
+// File: crn_mmap_stream.cpp
+// This software is in the public domain. Please see license.txt.
+#include "crn_core.h"
+#include "crn_mmap_stream.h"
+#include "crn_threading.h"
+
+#if CRNLIB_USE_WIN32_API
+#include "crn_winhdr.h"
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace crnlib
+{
+   mmap_stream::mmap_stream() :
+      data_stream(),
+      m_pBuf(NULL),
+      m_size(0),
+      m_ofs(0),
+      m_file_dev(0),
+      m_file_ino(0)
+   {
+   }
+
+   mmap_stream::mmap_stream(const char* pFilename) :
+      data_stream(),
+      m_pBuf(NULL),
+      m_size(0),
+      m_ofs(0),
+      m_file_dev(0),
+      m_file_ino(0)
+   {
+      open(pFilename);
+   }
+
+   mmap_stream::~mmap_stream()
+   {
+      close();
+   }
+
+   bool mmap_stream::open(const char* pFilename)
+   {
+      CRNLIB_ASSERT(pFilename);
+
+      close();
+
+      if (!map(pFilename, 0, false))
+      {
+         set_error();
+         return false;
+      }
+
+      set_name(pFilename);
+      m_attribs = cDataStreamReadable | cDataStreamSeekable;
+      m_opened = true;
+      return true;
+   }
+
+   bool mmap_stream::open_for_writing(const char* pFilename, uint64 size)
+   {
+      CRNLIB_ASSERT(pFilename);
+
+      close();
+
+      if ((!size) || (!map(pFilename, size, true)))
+      {
+         set_error();
+         return false;
+      }
+
+      set_name(pFilename);
+      m_attribs = cDataStreamReadable | cDataStreamWritable | cDataStreamSeekable;
+      m_opened = true;
+      return true;
+   }
+
+#if CRNLIB_USE_WIN32_API
+   bool mmap_stream::map(const char* pFilename, uint64 size, bool writable)
+   {
+      HANDLE hFile;
+      if (writable)
+         hFile = CreateFileA(pFilename, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+      else
+         hFile = CreateFileA(pFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+      if (hFile == INVALID_HANDLE_VALUE)
+         return false;
+
+      if (!writable)
+      {
+         LARGE_INTEGER file_size;
+         if (!GetFileSizeEx(hFile, &file_size))
+         {
+            CloseHandle(hFile);
+            return false;
+         }
+         size = file_size.QuadPart;
+      }
+
+      if ((!size) || (static_cast<size_t>(size) != size))
+      {
+         CloseHandle(hFile);
+         return false;
+      }
+
+      // Creating a read/write mapping larger than the file extends the file to the mapping's size.
+      HANDLE hMapping = CreateFileMappingA(hFile, NULL, writable ? PAGE_READWRITE : PAGE_WRITECOPY, static_cast<DWORD>(size >> 32U), static_cast<DWORD>(size), NULL);
+      CloseHandle(hFile);
+      if (!hMapping)
+         return false;
+
+      // The view keeps the mapping (and the file) open, so both handles can go right away.
+      void* p = MapViewOfFile(hMapping, writable ? FILE_MAP_WRITE : FILE_MAP_COPY, 0, 0, static_cast<SIZE_T>(size));
+      CloseHandle(hMapping);
+      if (!p)
+         return false;
+
+      m_pBuf = static_cast<uint8*>(p);
+      m_size = size;
+      m_ofs = 0;
+      return true;
+   }
+
+   bool mmap_stream::close()
+   {
+      clear_error();
+
+      if (!m_opened)
+         return false;
+
+      bool status = UnmapViewOfFile(m_pBuf) != FALSE;
+
+      m_pBuf = NULL;
+      m_size = 0;
+      m_ofs = 0;
+      m_opened = false;
+
+      return status;
+   }
+
+   bool mmap_stream::unlink_if_mapped(const char* pFilename)
+   {
+      pFilename;
+      return true;
+   }
+
+   bool mmap_stream::flush()
+   {
+      if ((!m_opened) || (!is_writable()))
+         return false;
+
+      if (!FlushViewOfFile(m_pBuf, 0))
+      {
+         set_error();
+         return false;
+      }
+
+      return true;
+   }
+#else
+   struct mapped_file_id
+   {
+      uint64 m_dev;
+      uint64 m_ino;
+   };
+
+   // Files currently mapped for reading by any mmap_stream.
+   static mutex s_mapped_files_mutex;
+   static crnlib::vector<mapped_file_id> s_mapped_files;
+
+   bool mmap_stream::map(const char* pFilename, uint64 size, bool writable)
+   {
+      int fd = writable ? ::open(pFilename, O_RDWR | O_CREAT | O_TRUNC, 0666) : ::open(pFilename, O_RDONLY);
+      if (fd < 0)
+         return false;
+
+      if (!writable)
+      {
+         struct stat st;
+         if (fstat(fd, &st) != 0)
+         {
+            ::close(fd);
+            return false;
+         }
+         size = st.st_size;
+
+         m_file_dev = st.st_dev;
+         m_file_ino = st.st_ino;
+      }
+
+      if ((!size) || (static_cast<size_t>(size) != size))
+      {
+         ::close(fd);
+         return false;
+      }
+
+      if (writable)
+      {
+         // Stores into a mapping past the end of the disk's free space raise SIGBUS instead of failing a write call,
+         // so reserve the blocks now where we can and fail cleanly instead.
+#ifdef __linux__
+         if (posix_fallocate(fd, 0, static_cast<off_t>(size)) != 0)
+#else
+         if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+#endif
+         {
+            ::close(fd);
+            return false;
+         }
+      }
+
+      // Read mappings are private, so pages written to by the caller are copied rather than written back to the file.
+      void* p = mmap(NULL, static_cast<size_t>(size), PROT_READ | PROT_WRITE, writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+      ::close(fd);
+      if (p == MAP_FAILED)
+         return false;
+
+      m_pBuf = static_cast<uint8*>(p);
+      m_size = size;
+      m_ofs = 0;
+
+      if (!writable)
+      {
+         scoped_mutex lock(s_mapped_files_mutex);
+         mapped_file_id id = { m_file_dev, m_file_ino };
+         s_mapped_files.push_back(id);
+      }
+
+      return true;
+   }
+
+   bool mmap_stream::close()
+   {
+      clear_error();
+
+      if (!m_opened)
+         return false;
+
+      if (!is_writable())
+      {
+         scoped_mutex lock(s_mapped_files_mutex);
+         for (uint i = 0; i < s_mapped_files.size(); i++)
+         {
+            if ((s_mapped_files[i].m_dev == m_file_dev) && (s_mapped_files[i].m_ino == m_file_ino))
+            {
+               s_mapped_files.erase_unordered(i);
+               break;
+            }
+         }
+      }
+
+      bool status = munmap(m_pBuf, static_cast<size_t>(m_size)) == 0;
+
+      m_pBuf = NULL;
+      m_size = 0;
+      m_ofs = 0;
+      m_opened = false;
+
+      return status;
+   }
+
+   bool mmap_stream::unlink_if_mapped(const char* pFilename)
+   {
+      struct stat st;
+      if (stat(pFilename, &st) != 0)
+         return true;
+
+      scoped_mutex lock(s_mapped_files_mutex);
+      for (uint i = 0; i < s_mapped_files.size(); i++)
+      {
+         if ((s_mapped_files[i].m_dev == static_cast<uint64>(st.st_dev)) && (s_mapped_files[i].m_ino == static_cast<uint64>(st.st_ino)))
+            return unlink(pFilename) == 0;
+      }
+
+      return true;
+   }
+
+   bool mmap_stream::flush()
+   {
+      if ((!m_opened) || (!is_writable()))
+         return false;
+
+      if (msync(m_pBuf, static_cast<size_t>(m_size), MS_SYNC) != 0)
+      {
+         set_error();
+         return false;
+      }
+
+      return true;
+   }
+#endif
+
+   uint mmap_stream::read(void* pBuf, uint len)
+   {
+      CRNLIB_ASSERT(pBuf && (len <= 0x7FFFFFFF));
+
+      if ((!m_opened) || (!is_readable()) || (!len))
+         return 0;
+
+      len = static_cast<uint>(math::minimum<uint64>(len, get_remaining()));
+
+      memcpy(pBuf, m_pBuf + m_ofs, len);
+
+      m_ofs += len;
+      return len;
+   }
+
+   uint64 mmap_stream::skip(uint64 len)
+   {
+      if ((!m_opened) || (!is_readable()))
+         return 0;
+
+      len = math::minimum<uint64>(len, get_remaining());
+
+      m_ofs += len;
+      return len;
+   }
+
+   uint mmap_stream::write(const void* pBuf, uint len)
+   {
+      CRNLIB_ASSERT(pBuf && (len <= 0x7FFFFFFF));
+
+      if ((!m_opened) || (!is_writable()) || (!len))
+         return 0;
+
+      // The file's size was fixed when it was opened.
+      if (len > get_remaining())
+      {
+         set_error();
+         len = static_cast<uint>(get_remaining());
+      }
+
+      memcpy(m_pBuf + m_ofs, pBuf, len);
+
+      m_ofs += len;
+      return len;
+   }
+
+   uint64 mmap_stream::get_size()
+   {
+      if (!m_opened)
+         return 0;
+
+      return m_size;
+   }
+
+   uint64 mmap_stream::get_remaining()
+   {
+      if (!m_opened)
+         return 0;
+
+      CRNLIB_ASSERT(m_ofs <= m_size);
+      return m_size - m_ofs;
+   }
+
+   uint64 mmap_stream::get_ofs()
+   {
+      if (!m_opened)
+         return 0;
+
+      return m_ofs;
+   }
+
+   bool mmap_stream::seek(int64 ofs, bool relative)
+   {
+      if ((!m_opened) || (!is_seekable()))
+         return false;
+
+      int64 new_ofs = relative ? (m_ofs + ofs) : ofs;
+      if (new_ofs < 0)
+         return false;
+      else if (static_cast<uint64>(new_ofs) > m_size)
+         return false;
+
+      m_ofs = static_cast<uint64>(new_ofs);
+
+      post_seek();
+
+      return true;
+   }
+
+} // namespace crnlib
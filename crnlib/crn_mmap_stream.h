@@ -0,0 +1,60 @@
+// File: crn_mmap_stream.h
+// This software is in the public domain. Please see license.txt.
+#pragma once
+#include "crn_data_stream.h"
+
+namespace crnlib
+{
+   // A data_stream over a memory mapped file.
+   // Files opened for reading are mapped copy-on-write: get_ptr() returns the file's contents, which callers may alias (and even
+   // modify through get_writable_ptr()) for as long as the stream stays open, without the file itself ever changing.
+   // Files opened for writing must be given their final size up front. The file is created at that size and mapped shared, so
+   // anything written through the stream or get_writable_ptr() lands in the file without being buffered.
+   // Empty files can't be mapped, so open() fails on them - callers should fall back to cfile_stream.
+   class mmap_stream : public data_stream
+   {
+   public:
+      mmap_stream();
+      mmap_stream(const char* pFilename);
+      virtual ~mmap_stream();
+
+      bool open(const char* pFilename);
+      bool open_for_writing(const char* pFilename, uint64 size);
+
+      virtual bool close();
+
+      virtual uint read(void* pBuf, uint len);
+      virtual uint64 skip(uint64 len);
+
+      virtual uint write(const void* pBuf, uint len);
+      virtual bool flush();
+
+      virtual uint64 get_size();
+      virtual uint64 get_remaining();
+
+      virtual uint64 get_ofs();
+      virtual bool seek(int64 ofs, bool relative);
+
+      virtual const void* get_ptr() const { return m_pBuf; }
+      uint8* get_writable_ptr() { return m_pBuf; }
+
+      // A file mapped for reading can stay aliased long after it was opened (see mipmapped_texture::read_from_file()), and
+      // truncating it to write over it would pull the data out from under its users. Call this before creating pFilename: if
+      // it's mapped, it gets unlinked so the new file takes its place while the old one lives on until it's unmapped.
+      // Returns false if that wasn't possible. (Win32 refuses to open mapped files for writing, so nothing there keeps a
+      // mapping aliased past the read and this does nothing.)
+      static bool unlink_if_mapped(const char* pFilename);
+
+   private:
+      uint8* m_pBuf;
+      uint64 m_size;
+      uint64 m_ofs;
+
+      // Identifies a file mapped for reading, for unlink_if_mapped(). (Unused on Win32.)
+      uint64 m_file_dev;
+      uint64 m_file_ino;
+
+      bool map(const char* pFilename, uint64 size, bool writable);
+   };
+
+} // namespace crnlib
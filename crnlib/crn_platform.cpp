@@ -4,6 +4,8 @@
 
 #if CRNLIB_USE_WIN32_API
 #include "crn_winhdr.h"
+#else
+#include <unistd.h>
 #endif
 #ifndef _MSC_VER
 int sprintf_s(char *buffer, size_t sizeOfBuffer, const char *format, ...)
@@ -79,6 +81,11 @@ void crnlib_output_debug_string(const char* p)
 {
    OutputDebugStringA(p);
 }
+
+unsigned int crnlib_get_current_process_id(void)
+{
+   return GetCurrentProcessId();
+}
 #else
 bool crnlib_is_debugger_present(void)
 {
@@ -89,4 +96,9 @@ void crnlib_output_debug_string(const char* p)
 {
    puts(p);
 }
+
+unsigned int crnlib_get_current_process_id(void)
+{
+   return static_cast<unsigned int>(getpid());
+}
 #endif // CRNLIB_USE_WIN32_API
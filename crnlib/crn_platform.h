@@ -5,6 +5,7 @@
 bool crnlib_is_debugger_present(void);
 void crnlib_debug_break(void);
 void crnlib_output_debug_string(const char* p);
+unsigned int crnlib_get_current_process_id(void);
 
 // actually in crnlib_assert.cpp
 void crnlib_assert(const char* pExp, const char* pFile, unsigned line);
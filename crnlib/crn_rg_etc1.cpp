@@ -7,6 +7,7 @@
 // v1.03 - 5/12/13 - Initial public release
 #include "crn_core.h"
 #include "crn_rg_etc1.h"
+#include "crn_cpu_features.h"
 
 #include <stdlib.h>
 #include <memory.h>
@@ -14,6 +15,13 @@
 //#include <stdio.h>
 #include <math.h>
 
+#if CRNLIB_X86_SIMD
+#include <emmintrin.h>
+#if CRNLIB_X86_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
 #if defined(_MSC_VER)
 #pragma warning (disable: 4201) //  nonstandard extension used : nameless struct/union
 #endif
@@ -1664,6 +1672,114 @@ namespace rg_etc1
       m_best_solution.m_error = cUINT64_MAX;
    }
 
+#if CRNLIB_X86_SIMD
+   // g_etc1_inten_tables transposed for evaluate_inten_tables_sse2/avx2(): for each selector, the modifiers of all 8 tables as 16-bit (r,g) pairs and (b,0) pairs.
+   static int16 g_inten_rg[cETC1SelectorValues][cETC1IntenModifierValues * 2];
+   static int16 g_inten_b[cETC1SelectorValues][cETC1IntenModifierValues * 2];
+
+   // Computes the error of all 8 intensity tables at once, one 32-bit lane per table. Each pixel's squared RGB distance to a block color comes from two pmaddwd's
+   // on the (r,g) and (b,0) differences. Ties go to the lowest selector, like the scalar loop, so the results are identical.
+   // pSelectors[i][t] receives the best selector of pixel i for table t.
+   static void evaluate_inten_tables_sse2(const color_quad_u8* pSrc_pixels, const color_quad_u8& base_color, uint32* pTotals, uint32 (*pSelectors)[cETC1IntenModifierValues])
+   {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i max_comp = _mm_set1_epi16(255);
+      const __m128i base_rg = _mm_set1_epi32(base_color.r | (base_color.g << 16));
+      const __m128i base_b = _mm_set1_epi32(base_color.b);
+
+      // [selector][0] holds tables 0-3, [selector][1] tables 4-7.
+      __m128i block_rg[cETC1SelectorValues][2], block_b[cETC1SelectorValues][2];
+      for (uint s = 0; s < cETC1SelectorValues; s++)
+      {
+         for (uint h = 0; h < 2; h++)
+         {
+            block_rg[s][h] = _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(base_rg, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&g_inten_rg[s][h * 8]))), zero), max_comp);
+            block_b[s][h] = _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(base_b, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&g_inten_b[s][h * 8]))), zero), max_comp);
+         }
+      }
+
+      __m128i totals[2] = { zero, zero };
+      for (uint i = 0; i < 8; i++)
+      {
+         const color_quad_u8& c = pSrc_pixels[i];
+         const __m128i pixel_rg = _mm_set1_epi32(c.r | (c.g << 16));
+         const __m128i pixel_b = _mm_set1_epi32(c.b);
+
+         for (uint h = 0; h < 2; h++)
+         {
+            __m128i best_error = zero, best_selector = zero;
+            for (uint s = 0; s < cETC1SelectorValues; s++)
+            {
+               const __m128i d_rg = _mm_sub_epi16(pixel_rg, block_rg[s][h]);
+               const __m128i d_b = _mm_sub_epi16(pixel_b, block_b[s][h]);
+               const __m128i error = _mm_add_epi32(_mm_madd_epi16(d_rg, d_rg), _mm_madd_epi16(d_b, d_b));
+               if (!s)
+               {
+                  best_error = error;
+                  continue;
+               }
+               const __m128i less = _mm_cmplt_epi32(error, best_error);
+               best_error = _mm_or_si128(_mm_and_si128(less, error), _mm_andnot_si128(less, best_error));
+               best_selector = _mm_or_si128(_mm_and_si128(less, _mm_set1_epi32(s)), _mm_andnot_si128(less, best_selector));
+            }
+
+            totals[h] = _mm_add_epi32(totals[h], best_error);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&pSelectors[i][h * 4]), best_selector);
+         }
+      }
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(pTotals), totals[0]);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(pTotals + 4), totals[1]);
+   }
+
+#if CRNLIB_X86_AVX2
+   // Same as evaluate_inten_tables_sse2(), with all 8 tables in one register.
+   CRNLIB_TARGET_AVX2 static void evaluate_inten_tables_avx2(const color_quad_u8* pSrc_pixels, const color_quad_u8& base_color, uint32* pTotals, uint32 (*pSelectors)[cETC1IntenModifierValues])
+   {
+      const __m256i zero = _mm256_setzero_si256();
+      const __m256i max_comp = _mm256_set1_epi16(255);
+      const __m256i base_rg = _mm256_set1_epi32(base_color.r | (base_color.g << 16));
+      const __m256i base_b = _mm256_set1_epi32(base_color.b);
+
+      __m256i block_rg[cETC1SelectorValues], block_b[cETC1SelectorValues];
+      for (uint s = 0; s < cETC1SelectorValues; s++)
+      {
+         block_rg[s] = _mm256_min_epi16(_mm256_max_epi16(_mm256_add_epi16(base_rg, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(g_inten_rg[s]))), zero), max_comp);
+         block_b[s] = _mm256_min_epi16(_mm256_max_epi16(_mm256_add_epi16(base_b, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(g_inten_b[s]))), zero), max_comp);
+      }
+
+      __m256i total = zero;
+      for (uint i = 0; i < 8; i++)
+      {
+         const color_quad_u8& c = pSrc_pixels[i];
+         const __m256i pixel_rg = _mm256_set1_epi32(c.r | (c.g << 16));
+         const __m256i pixel_b = _mm256_set1_epi32(c.b);
+
+         __m256i best_error = zero, best_selector = zero;
+         for (uint s = 0; s < cETC1SelectorValues; s++)
+         {
+            const __m256i d_rg = _mm256_sub_epi16(pixel_rg, block_rg[s]);
+            const __m256i d_b = _mm256_sub_epi16(pixel_b, block_b[s]);
+            const __m256i error = _mm256_add_epi32(_mm256_madd_epi16(d_rg, d_rg), _mm256_madd_epi16(d_b, d_b));
+            if (!s)
+            {
+               best_error = error;
+               continue;
+            }
+            const __m256i less = _mm256_cmpgt_epi32(best_error, error);
+            best_error = _mm256_min_epi32(best_error, error);
+            best_selector = _mm256_blendv_epi8(best_selector, _mm256_set1_epi32(s), less);
+         }
+
+         total = _mm256_add_epi32(total, best_error);
+         _mm256_storeu_si256(reinterpret_cast<__m256i*>(pSelectors[i]), best_selector);
+      }
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(pTotals), total);
+   }
+#endif // CRNLIB_X86_AVX2
+#endif // CRNLIB_X86_SIMD
+
    bool etc1_optimizer::evaluate_solution(const etc1_solution_coordinates& coords, potential_solution& trial_solution, potential_solution* pBest_solution)
    {
       trial_solution.m_valid = false;
@@ -1684,61 +1800,89 @@ namespace rg_etc1
 
       trial_solution.m_error = cUINT64_MAX;
 
-      for (uint inten_table = 0; inten_table < cETC1IntenModifierValues; inten_table++)
+#if CRNLIB_X86_SIMD
+      const cpu_level level = cpu_features::get_level();
+      if (level != cCPULevelScalar)
       {
-         const int* pInten_table = g_etc1_inten_tables[inten_table];
-
-         color_quad_u8 block_colors[4];
-         for (uint s = 0; s < 4; s++)
-         {
-            const int yd = pInten_table[s];
-            block_colors[s].set(base_color.r + yd, base_color.g + yd, base_color.b + yd, 0);
-         }
+         uint32 totals[cETC1IntenModifierValues];
+         uint32 selectors[8][cETC1IntenModifierValues];
+#if CRNLIB_X86_AVX2
+         if (level == cCPULevelAVX2)
+            evaluate_inten_tables_avx2(m_pParams->m_pSrc_pixels, base_color, totals, selectors);
+         else
+#endif
+            evaluate_inten_tables_sse2(m_pParams->m_pSrc_pixels, base_color, totals, selectors);
 
-         uint64 total_error = 0;
+         uint best_inten_table = 0;
+         for (uint inten_table = 1; inten_table < cETC1IntenModifierValues; inten_table++)
+            if (totals[inten_table] < totals[best_inten_table])
+               best_inten_table = inten_table;
 
-         const color_quad_u8* pSrc_pixels = m_pParams->m_pSrc_pixels;
+         trial_solution.m_error = totals[best_inten_table];
+         trial_solution.m_coords.m_inten_table = best_inten_table;
          for (uint c = 0; c < n; c++)
+            trial_solution.m_selectors[c] = static_cast<uint8>(selectors[c][best_inten_table]);
+         trial_solution.m_valid = true;
+      }
+      else
+#endif
+      {
+         for (uint inten_table = 0; inten_table < cETC1IntenModifierValues; inten_table++)
          {
-            const color_quad_u8& src_pixel = *pSrc_pixels++;
+            const int* pInten_table = g_etc1_inten_tables[inten_table];
 
-            uint best_selector_index = 0;
-            uint best_error = rg_etc1::square(src_pixel.r - block_colors[0].r) + rg_etc1::square(src_pixel.g - block_colors[0].g) + rg_etc1::square(src_pixel.b - block_colors[0].b);
-
-            uint trial_error = rg_etc1::square(src_pixel.r - block_colors[1].r) + rg_etc1::square(src_pixel.g - block_colors[1].g) + rg_etc1::square(src_pixel.b - block_colors[1].b);
-            if (trial_error < best_error)
+            color_quad_u8 block_colors[4];
+            for (uint s = 0; s < 4; s++)
             {
-               best_error = trial_error;
-               best_selector_index = 1;
+               const int yd = pInten_table[s];
+               block_colors[s].set(base_color.r + yd, base_color.g + yd, base_color.b + yd, 0);
             }
 
-            trial_error = rg_etc1::square(src_pixel.r - block_colors[2].r) + rg_etc1::square(src_pixel.g - block_colors[2].g) + rg_etc1::square(src_pixel.b - block_colors[2].b);
-            if (trial_error < best_error)
-            {
-               best_error = trial_error;
-               best_selector_index = 2;
-            }
+            uint64 total_error = 0;
 
-            trial_error = rg_etc1::square(src_pixel.r - block_colors[3].r) + rg_etc1::square(src_pixel.g - block_colors[3].g) + rg_etc1::square(src_pixel.b - block_colors[3].b);
-            if (trial_error < best_error)
+            const color_quad_u8* pSrc_pixels = m_pParams->m_pSrc_pixels;
+            for (uint c = 0; c < n; c++)
             {
-               best_error = trial_error;
-               best_selector_index = 3;
-            }
+               const color_quad_u8& src_pixel = *pSrc_pixels++;
 
-            m_temp_selectors[c] = static_cast<uint8>(best_selector_index);
+               uint best_selector_index = 0;
+               uint best_error = rg_etc1::square(src_pixel.r - block_colors[0].r) + rg_etc1::square(src_pixel.g - block_colors[0].g) + rg_etc1::square(src_pixel.b - block_colors[0].b);
 
-            total_error += best_error;
-            if (total_error >= trial_solution.m_error)
-               break;
-         }
+               uint trial_error = rg_etc1::square(src_pixel.r - block_colors[1].r) + rg_etc1::square(src_pixel.g - block_colors[1].g) + rg_etc1::square(src_pixel.b - block_colors[1].b);
+               if (trial_error < best_error)
+               {
+                  best_error = trial_error;
+                  best_selector_index = 1;
+               }
 
-         if (total_error < trial_solution.m_error)
-         {
-            trial_solution.m_error = total_error;
-            trial_solution.m_coords.m_inten_table = inten_table;
-            memcpy(trial_solution.m_selectors, m_temp_selectors, 8);
-            trial_solution.m_valid = true;
+               trial_error = rg_etc1::square(src_pixel.r - block_colors[2].r) + rg_etc1::square(src_pixel.g - block_colors[2].g) + rg_etc1::square(src_pixel.b - block_colors[2].b);
+               if (trial_error < best_error)
+               {
+                  best_error = trial_error;
+                  best_selector_index = 2;
+               }
+
+               trial_error = rg_etc1::square(src_pixel.r - block_colors[3].r) + rg_etc1::square(src_pixel.g - block_colors[3].g) + rg_etc1::square(src_pixel.b - block_colors[3].b);
+               if (trial_error < best_error)
+               {
+                  best_error = trial_error;
+                  best_selector_index = 3;
+               }
+
+               m_temp_selectors[c] = static_cast<uint8>(best_selector_index);
+
+               total_error += best_error;
+               if (total_error >= trial_solution.m_error)
+                  break;
+            }
+
+            if (total_error < trial_solution.m_error)
+            {
+               trial_solution.m_error = total_error;
+               trial_solution.m_coords.m_inten_table = inten_table;
+               memcpy(trial_solution.m_selectors, m_temp_selectors, 8);
+               trial_solution.m_valid = true;
+            }
          }
       }
       trial_solution.m_coords.m_unscaled_color = coords.m_unscaled_color;
@@ -1926,6 +2070,19 @@ done:
          }
       }
 
+#if CRNLIB_X86_SIMD
+      for (uint s = 0; s < cETC1SelectorValues; s++)
+      {
+         for (uint t = 0; t < cETC1IntenModifierValues; t++)
+         {
+            g_inten_rg[s][t * 2] = static_cast<int16>(g_etc1_inten_tables[t][s]);
+            g_inten_rg[s][t * 2 + 1] = static_cast<int16>(g_etc1_inten_tables[t][s]);
+            g_inten_b[s][t * 2] = static_cast<int16>(g_etc1_inten_tables[t][s]);
+            g_inten_b[s][t * 2 + 1] = 0;
+         }
+      }
+#endif
+
       uint expand5[32];
       for(int i = 0; i < 32; i++)
          expand5[i] = (i << 3) | (i >> 2);
@@ -2444,6 +2601,64 @@ found_perfect_match:
       return static_cast<unsigned int>(best_error);
    }
 
+   unsigned long long pack_etc1_blocks(void* pETC1_blocks, const unsigned int* pSrc_pixels_rgba, unsigned int width, unsigned int height, unsigned int src_pitch, etc1_pack_params& pack_params)
+   {
+      RG_ETC1_ASSERT((width) && (height) && (src_pitch >= width));
+
+      const uint blocks_x = (width + 3) >> 2;
+      const uint blocks_y = (height + 3) >> 2;
+
+      // Not etc1_block*, its trailing members make it larger than cETC1BytesPerBlock.
+      uint8* pDst_block = static_cast<uint8*>(pETC1_blocks);
+
+      uint32 block_pixels[2][16];
+      uint cur_pixels = 0;
+      const uint8* pPrev_block = NULL;
+      unsigned int prev_error = 0;
+
+      uint64 total_error = 0;
+
+      for (uint block_y = 0; block_y < blocks_y; block_y++)
+      {
+         const unsigned int* pSrc_rows[4];
+         for (uint y = 0; y < 4; y++)
+            pSrc_rows[y] = pSrc_pixels_rgba + rg_etc1::minimum(block_y * 4 + y, height - 1) * src_pitch;
+
+         for (uint block_x = 0; block_x < blocks_x; block_x++, pDst_block += cETC1BytesPerBlock)
+         {
+            uint32* pPixels = block_pixels[cur_pixels];
+
+            const uint x = block_x * 4;
+            if ((x + 4) <= width)
+            {
+               for (uint y = 0; y < 4; y++)
+                  memcpy(pPixels + y * 4, pSrc_rows[y] + x, sizeof(uint32) * 4);
+            }
+            else
+            {
+               for (uint y = 0; y < 4; y++)
+                  for (uint i = 0; i < 4; i++)
+                     pPixels[y * 4 + i] = pSrc_rows[y][rg_etc1::minimum(x + i, width - 1)];
+            }
+
+            // Flat or repeating areas are common in textures, and the packer is deterministic.
+            if ((pPrev_block) && (!memcmp(pPixels, block_pixels[cur_pixels ^ 1], sizeof(block_pixels[0]))))
+            {
+               memcpy(pDst_block, pPrev_block, cETC1BytesPerBlock);
+               total_error += prev_error;
+               continue;
+            }
+
+            prev_error = pack_etc1_block(pDst_block, pPixels, pack_params);
+            total_error += prev_error;
+            pPrev_block = pDst_block;
+            cur_pixels ^= 1;
+         }
+      }
+
+      return total_error;
+   }
+
 } // namespace rg_etc1
 
 } // namespace crnlib
@@ -47,6 +47,11 @@ namespace rg_etc1
    // This function is thread safe, and does not dynamically allocate any memory.
    // pack_etc1_block() does not currently support "perceptual" colorspace metrics - it primarily optimizes for RGB RMSE.
    unsigned int pack_etc1_block(void* pETC1_block, const unsigned int* pSrc_pixels_rgba, etc1_pack_params& pack_params);
+
+   // Packs all the 4x4 blocks of a width x height image of 32bpp RGBA pixels, src_pitch pixels per row, to ((width + 3) / 4) * ((height + 3) / 4) ETC1 blocks in row major order.
+   // Partial blocks at the right and bottom edges are padded by replicating the last column/row. A block identical to the previous one reuses its packed result.
+   // Returns the total squared error. This function is thread safe, so large images can be split into bands of block rows and packed from multiple threads.
+   unsigned long long pack_etc1_blocks(void* pETC1_blocks, const unsigned int* pSrc_pixels_rgba, unsigned int width, unsigned int height, unsigned int src_pitch, etc1_pack_params& pack_params);
             
 } // namespace rg_etc1
 
@@ -0,0 +1,719 @@
+// File: crn_stream_comp.cpp
+// This software is in the public domain. Please see license.txt.
+#include "crn_core.h"
+#include "crn_stream_comp.h"
+#include "crn_cfile_stream.h"
+#include "crn_console.h"
+#include "crn_data_stream_serializer.h"
+#include "crn_file_utils.h"
+#include "crn_jpgd.h"
+#include "crn_mipmapped_texture.h"
+#include "crn_resampler.h"
+#include "crn_texture_comp.h"
+
+namespace crnlib
+{
+   // Fallback for formats that can't be decoded incrementally: loads the whole image.
+   class image_scanline_reader : public scanline_reader
+   {
+   public:
+      image_scanline_reader() : m_cur_y(0) { }
+
+      bool open(const char* pFilename)
+      {
+         return image_utils::read_from_file(m_img, pFilename, 0);
+      }
+
+      virtual uint get_width() const { return m_img.get_width(); }
+      virtual uint get_height() const { return m_img.get_height(); }
+      virtual bool has_alpha() const { return m_img.has_alpha(); }
+
+      virtual bool read_line(color_quad_u8* pDst)
+      {
+         if (m_cur_y >= m_img.get_height())
+            return false;
+
+         memcpy(static_cast<void*>(pDst), m_img.get_scanline(m_cur_y), m_img.get_width() * sizeof(color_quad_u8));
+         m_cur_y++;
+         return true;
+      }
+
+   private:
+      image_u8 m_img;
+      uint m_cur_y;
+   };
+
+   // Decodes the same TGA variants as stb_image, minus the color mapped ones. Bottom-up files are read back to front: raw
+   // files by seeking to each row, RLE files (whose packets may span rows) by first recording the packet state at the
+   // start of every row.
+   class tga_scanline_reader : public scanline_reader
+   {
+   public:
+      tga_scanline_reader() :
+         m_width(0), m_height(0), m_bytes_per_pixel(0), m_rle(false), m_bottom_up(false), m_data_ofs(0), m_cur_y(0)
+      {
+         utils::zero_object(m_rle_state);
+      }
+
+      bool open(const char* pFilename)
+      {
+         if (!m_stream.open(pFilename))
+            return false;
+
+         uint8 hdr[18];
+         if (m_stream.read(hdr, sizeof(hdr)) != sizeof(hdr))
+            return false;
+
+         const uint id_len = hdr[0];
+         const uint cmap_type = hdr[1];
+         const uint image_type = hdr[2];
+         const uint bits_per_pixel = hdr[16];
+
+         m_width = hdr[12] | (hdr[13] << 8U);
+         m_height = hdr[14] | (hdr[15] << 8U);
+         m_rle = (image_type >= 8);
+         m_bottom_up = (hdr[17] & 0x20) == 0;
+
+         const uint base_type = m_rle ? (image_type - 8) : image_type;
+         if ((cmap_type) || ((base_type != 2) && (base_type != 3)) || (!m_width) || (!m_height))
+            return false;
+         if ((bits_per_pixel != 8) && (bits_per_pixel != 16) && (bits_per_pixel != 24) && (bits_per_pixel != 32))
+            return false;
+
+         m_bytes_per_pixel = bits_per_pixel >> 3;
+         m_data_ofs = sizeof(hdr) + id_len;
+         m_row_buf.resize(m_width * m_bytes_per_pixel);
+
+         if (!m_stream.seek(m_data_ofs, false))
+            return false;
+
+         if ((m_rle) && (m_bottom_up))
+         {
+            m_row_states.resize(m_height);
+            for (uint y = 0; y < m_height; y++)
+            {
+               m_row_states[y] = m_rle_state;
+               m_row_states[y].m_ofs = m_stream.get_ofs();
+
+               if (!decode_rle_row(m_row_buf.get_ptr()))
+                  return false;
+            }
+         }
+
+         return true;
+      }
+
+      virtual uint get_width() const { return m_width; }
+      virtual uint get_height() const { return m_height; }
+      virtual bool has_alpha() const { return (m_bytes_per_pixel == 2) || (m_bytes_per_pixel == 4); }
+
+      virtual bool read_line(color_quad_u8* pDst)
+      {
+         if (m_cur_y >= m_height)
+            return false;
+
+         const uint file_y = m_bottom_up ? (m_height - 1 - m_cur_y) : m_cur_y;
+         m_cur_y++;
+
+         if (m_rle)
+         {
+            if (m_bottom_up)
+            {
+               m_rle_state = m_row_states[file_y];
+               if (!m_stream.seek(m_rle_state.m_ofs, false))
+                  return false;
+            }
+
+            if (!decode_rle_row(m_row_buf.get_ptr()))
+               return false;
+         }
+         else
+         {
+            if ((m_bottom_up) && (!m_stream.seek(m_data_ofs + static_cast<uint64>(file_y) * m_row_buf.size(), false)))
+               return false;
+
+            if (m_stream.read(m_row_buf.get_ptr(), m_row_buf.size()) != m_row_buf.size())
+               return false;
+         }
+
+         const uint8* pSrc = m_row_buf.get_ptr();
+         for (uint x = 0; x < m_width; x++, pSrc += m_bytes_per_pixel)
+         {
+            switch (m_bytes_per_pixel)
+            {
+               case 1: pDst[x].set(pSrc[0], pSrc[0], pSrc[0], 255); break;
+               case 2: pDst[x].set(pSrc[0], pSrc[0], pSrc[0], pSrc[1]); break;
+               case 3: pDst[x].set(pSrc[2], pSrc[1], pSrc[0], 255); break;
+               default: pDst[x].set(pSrc[2], pSrc[1], pSrc[0], pSrc[3]); break;
+            }
+         }
+
+         return true;
+      }
+
+   private:
+      struct rle_state
+      {
+         uint64 m_ofs;
+         uint m_count;
+         bool m_repeating;
+         uint8 m_pixel[4];
+      };
+
+      cfile_stream m_stream;
+      uint m_width;
+      uint m_height;
+      uint m_bytes_per_pixel;
+      bool m_rle;
+      bool m_bottom_up;
+      uint64 m_data_ofs;
+      uint m_cur_y;
+
+      crnlib::vector<uint8> m_row_buf;
+      rle_state m_rle_state;
+      crnlib::vector<rle_state> m_row_states;
+
+      bool decode_rle_row(uint8* pDst)
+      {
+         const uint bpp = m_bytes_per_pixel;
+
+         uint x = 0;
+         while (x < m_width)
+         {
+            if (!m_rle_state.m_count)
+            {
+               uint8 cmd;
+               if (m_stream.read(&cmd, 1) != 1)
+                  return false;
+
+               m_rle_state.m_count = 1 + (cmd & 127);
+               m_rle_state.m_repeating = (cmd & 128) != 0;
+
+               if ((m_rle_state.m_repeating) && (m_stream.read(m_rle_state.m_pixel, bpp) != bpp))
+                  return false;
+            }
+
+            const uint n = math::minimum(m_rle_state.m_count, m_width - x);
+            if (m_rle_state.m_repeating)
+            {
+               for (uint i = 0; i < n; i++)
+                  memcpy(pDst + (x + i) * bpp, m_rle_state.m_pixel, bpp);
+            }
+            else if (m_stream.read(pDst + x * bpp, n * bpp) != n * bpp)
+               return false;
+
+            x += n;
+            m_rle_state.m_count -= n;
+         }
+
+         return true;
+      }
+   };
+
+   // Baseline JPEG's are decoded an MCU row at a time. (Progressive files are still buffered whole by the decoder.)
+   class jpeg_scanline_reader : public scanline_reader
+   {
+   public:
+      jpeg_scanline_reader() : m_pDecoder(NULL) { }
+
+      virtual ~jpeg_scanline_reader()
+      {
+         crnlib_delete(m_pDecoder);
+      }
+
+      bool open(const char* pFilename)
+      {
+         if (!m_stream.open(pFilename))
+            return false;
+
+         jpgd::jpeg_decoder_stream* pStream = &m_stream;
+         m_pDecoder = crnlib_new<jpgd::jpeg_decoder>(pStream);
+         if (m_pDecoder->get_error_code() != jpgd::JPGD_SUCCESS)
+            return false;
+
+         return m_pDecoder->begin_decoding() == jpgd::JPGD_SUCCESS;
+      }
+
+      virtual uint get_width() const { return m_pDecoder->get_width(); }
+      virtual uint get_height() const { return m_pDecoder->get_height(); }
+      virtual bool has_alpha() const { return false; }
+
+      virtual bool read_line(color_quad_u8* pDst)
+      {
+         const uint8* pScan_line;
+         uint scan_line_len;
+         if (m_pDecoder->decode((const void**)&pScan_line, &scan_line_len) != jpgd::JPGD_SUCCESS)
+            return false;
+
+         const uint width = get_width();
+         if (m_pDecoder->get_bytes_per_pixel() == 1)
+         {
+            for (uint x = 0; x < width; x++)
+               pDst[x].set(pScan_line[x], pScan_line[x], pScan_line[x], 255);
+         }
+         else
+            memcpy(static_cast<void*>(pDst), pScan_line, width * sizeof(color_quad_u8));
+
+         return true;
+      }
+
+   private:
+      jpgd::jpeg_decoder_file_stream m_stream;
+      jpgd::jpeg_decoder* m_pDecoder;
+   };
+
+   template<typename T>
+   static scanline_reader* try_open_scanline_reader(const char* pFilename)
+   {
+      T* pReader = crnlib_new<T>();
+      if (pReader->open(pFilename))
+         return pReader;
+
+      crnlib_delete(pReader);
+      return NULL;
+   }
+
+   scanline_reader* create_scanline_reader(const char* pFilename)
+   {
+      dynamic_string ext(pFilename);
+      file_utils::get_extension(ext);
+
+      scanline_reader* pReader = NULL;
+      if (ext == "tga")
+         pReader = try_open_scanline_reader<tga_scanline_reader>(pFilename);
+      else if ((ext == "jpg") || (ext == "jpeg"))
+         pReader = try_open_scanline_reader<jpeg_scanline_reader>(pFilename);
+
+      if (!pReader)
+         pReader = try_open_scanline_reader<image_scanline_reader>(pFilename);
+
+      return pReader;
+   }
+
+   stream_dds_comp::stream_dds_comp() :
+      m_pDst(NULL),
+      m_fmt(PIXEL_FMT_INVALID),
+      m_has_alpha(false),
+      m_alpha_from_luma(false),
+      m_conv_type(image_utils::cConversion_Invalid),
+      m_renormalize(false)
+   {
+   }
+
+   stream_dds_comp::~stream_dds_comp()
+   {
+      clear();
+   }
+
+   void stream_dds_comp::clear()
+   {
+      for (uint i = 0; i < m_levels.size(); i++)
+      {
+         stream_level* pLevel = m_levels[i];
+
+         for (uint c = 0; c < 4; c++)
+            crnlib_delete(pLevel->m_pResamplers[c]);
+
+         for (uint t = 0; t < pLevel->m_contexts.size(); t++)
+            crnlib_delete(pLevel->m_contexts[t]);
+
+         crnlib_delete(pLevel);
+      }
+      m_levels.clear();
+
+      m_task_pool.deinit();
+
+      m_pDst = NULL;
+      m_fmt = PIXEL_FMT_INVALID;
+      m_has_alpha = false;
+      m_alpha_from_luma = false;
+      m_conv_type = image_utils::cConversion_Invalid;
+      m_renormalize = false;
+   }
+
+   bool stream_dds_comp::compress(
+      scanline_reader& reader, data_stream& dst,
+      pixel_format fmt, const crn_comp_params& comp_params, const crn_mipmap_params& mipmap_params,
+      dxt_image::pack_params::progress_callback_func pProgress_callback, void* pProgress_callback_user_data_ptr)
+   {
+      clear();
+
+      if (!pixel_format_helpers::is_dxt(fmt))
+      {
+         console::error("stream_dds_comp::compress: Only DXTn and ETC1 pixel formats can be streamed");
+         return false;
+      }
+
+      const uint width = reader.get_width();
+      const uint height = reader.get_height();
+      if ((!width) || (!height))
+         return false;
+
+      m_pDst = &dst;
+      m_fmt = fmt;
+      m_has_alpha = reader.has_alpha();
+      m_conv_type = image_utils::get_conversion_type(true, fmt);
+      m_renormalize = mipmap_params.m_renormalize != 0;
+
+      // Like texture_conversion::process(), alpha only formats take their alpha from luma before the mips are filtered.
+      if ((pixel_format_helpers::is_alpha_only(fmt)) && (!m_has_alpha))
+      {
+         m_alpha_from_luma = true;
+         m_has_alpha = true;
+      }
+
+      m_pack_params.init(comp_params);
+      m_pack_params.m_num_helper_threads = get_num_helper_threads(comp_params);
+      m_pack_params.m_use_both_block_types = comp_params.get_flag(cCRNCompFlagUseBothBlockTypes) || comp_params.get_flag(cCRNCompFlagDXT1AForTransparency);
+      if ((pixel_format_helpers::is_pixel_format_non_srgb(fmt)) || (pixel_format_helpers::is_normal_map(fmt)))
+         m_pack_params.m_perceptual = false;
+
+      // Same level count as mipmapped_texture::generate_mipmaps().
+      uint num_levels = 1;
+      if ((mipmap_params.m_mode == cCRNMipModeGenerateMips) || (mipmap_params.m_mode == cCRNMipModeUseSourceOrGenerateMips))
+      {
+         uint level_width = width;
+         uint level_height = height;
+         while ((level_width > mipmap_params.m_min_mip_size) || (level_height > mipmap_params.m_min_mip_size))
+         {
+            level_width >>= 1U;
+            level_height >>= 1U;
+            num_levels++;
+         }
+
+         if ((mipmap_params.m_max_levels > 0) && (num_levels > mipmap_params.m_max_levels))
+            num_levels = mipmap_params.m_max_levels;
+      }
+
+      if ((num_levels > 1) && (math::maximum(width, height) > CRNLIB_RESAMPLER_MAX_DIMENSION))
+      {
+         console::warning("stream_dds_comp::compress: Image is too large to resample, only writing the top mip level");
+         num_levels = 1;
+      }
+
+      m_resample_params.m_pFilter = crn_get_mip_filter_name(mipmap_params.m_filter);
+      m_resample_params.m_filter_scale = mipmap_params.m_blurriness;
+      m_resample_params.m_srgb = mipmap_params.m_gamma_filtering != 0;
+      m_resample_params.m_wrapping = mipmap_params.m_tiled != 0;
+      m_resample_params.m_first_comp = 0;
+      m_resample_params.m_num_comps = m_has_alpha ? 4 : 3;
+      m_resample_params.m_multithreaded = false;
+
+      if (m_resample_params.m_srgb)
+      {
+         const float source_gamma = m_resample_params.m_source_gamma;
+         for (int i = 0; i < 256; ++i)
+            m_srgb_to_linear[i] = (float)pow(i * 1.0f/255.0f, source_gamma);
+
+         const float inv_linear_to_srgb_table_size = 1.0f / cLinearToSRGBTableSize;
+         const float inv_source_gamma = 1.0f / source_gamma;
+         for (int i = 0; i < cLinearToSRGBTableSize; ++i)
+         {
+            int k = (int)(255.0f * pow(i * inv_linear_to_srgb_table_size, inv_source_gamma) + .5f);
+            if (k < 0) k = 0; else if (k > 255) k = 255;
+            m_linear_to_srgb[i] = (uint8)k;
+         }
+      }
+
+      if (!m_task_pool.init(m_pack_params.m_num_helper_threads))
+         return false;
+
+      if (!init_levels(width, height, num_levels))
+         return false;
+
+      data_stream_serializer serializer(dst);
+      if (!mipmapped_texture::write_dds_header(serializer, width, height, num_levels, 1, fmt))
+         return false;
+
+      uint64 data_size = 0;
+      for (uint i = 0; i < num_levels; i++)
+      {
+         m_levels[i]->m_data_ofs = dst.get_ofs() + data_size;
+         data_size += static_cast<uint64>(m_levels[i]->m_row_size_in_bytes) * m_levels[i]->m_blocks_y;
+      }
+
+      // The levels are filled in side by side, and streams can't seek past their end, so reserve the whole file first.
+      uint8 zeros[4096];
+      memset(zeros, 0, sizeof(zeros));
+      while (data_size)
+      {
+         const uint n = static_cast<uint>(math::minimum<uint64>(data_size, sizeof(zeros)));
+         if (dst.write(zeros, n) != n)
+            return false;
+         data_size -= n;
+      }
+
+      crnlib::vector<float> samples[4];
+      if (num_levels > 1)
+      {
+         for (uint c = 0; c < m_resample_params.m_num_comps; c++)
+            samples[c].resize(width);
+      }
+
+      stream_level& top = *m_levels[0];
+      int prev_percentage = -1;
+
+      for (uint y = 0; y < height; y++)
+      {
+         color_quad_u8* pLine = top.m_band.get_scanline(y & (cDXTBlockSize - 1));
+         if (!reader.read_line(pLine))
+         {
+            console::error("stream_dds_comp::compress: Failed reading source scanline %u", y);
+            return false;
+         }
+
+         if (m_alpha_from_luma)
+         {
+            for (uint x = 0; x < width; x++)
+               pLine[x].a = static_cast<uint8>(pLine[x].get_luma());
+         }
+
+         // Feed the mips before the band is cooked and packed in place.
+         if ((num_levels > 1) && (!resample_line(pLine, samples)))
+            return false;
+
+         top.m_next_y++;
+         if ((!(top.m_next_y & (cDXTBlockSize - 1))) || (top.m_next_y == height))
+         {
+            if (!flush_band(0))
+               return false;
+         }
+
+         if (pProgress_callback)
+         {
+            const int percentage = static_cast<int>(((y + 1) * 100ULL) / height);
+            if (percentage != prev_percentage)
+            {
+               prev_percentage = percentage;
+               if (!pProgress_callback(percentage, pProgress_callback_user_data_ptr))
+                  return false;
+            }
+         }
+      }
+
+      for (uint i = 0; i < num_levels; i++)
+      {
+         if (m_levels[i]->m_next_block_y != m_levels[i]->m_blocks_y)
+         {
+            console::error("stream_dds_comp::compress: Mip level %u is incomplete", i);
+            return false;
+         }
+      }
+
+      return dst.flush();
+   }
+
+   bool stream_dds_comp::init_levels(uint width, uint height, uint num_levels)
+   {
+      const dxt_format dxt_fmt = pixel_format_helpers::get_dxt_format(m_fmt);
+
+      m_levels.resize(num_levels);
+      for (uint i = 0; i < num_levels; i++)
+      {
+         stream_level* pLevel = crnlib_new<stream_level>();
+         m_levels[i] = pLevel;
+
+         utils::zero_object(pLevel->m_pResamplers);
+
+         pLevel->m_width = math::maximum<uint>(1U, width >> i);
+         pLevel->m_height = math::maximum<uint>(1U, height >> i);
+         pLevel->m_blocks_x = (pLevel->m_width + cDXTBlockSize - 1) >> cDXTBlockShift;
+         pLevel->m_blocks_y = (pLevel->m_height + cDXTBlockSize - 1) >> cDXTBlockShift;
+         pLevel->m_next_y = 0;
+         pLevel->m_next_block_y = 0;
+         pLevel->m_data_ofs = 0;
+
+         if (!pLevel->m_band.resize(pLevel->m_width, cDXTBlockSize))
+            return false;
+
+         if (!pLevel->m_dxt.init(dxt_fmt, pLevel->m_width, cDXTBlockSize, true))
+            return false;
+         pLevel->m_row_size_in_bytes = pLevel->m_blocks_x * pLevel->m_dxt.get_bytes_per_block();
+
+         pLevel->m_contexts.resize(m_pack_params.m_num_helper_threads + 1);
+         for (uint t = 0; t < pLevel->m_contexts.size(); t++)
+            pLevel->m_contexts[t] = crnlib_new<dxt_image::set_block_pixels_context>();
+
+         if (!i)
+            continue;
+
+         const image_utils::resample_params& p = m_resample_params;
+         const Resampler::Boundary_Op boundary_op = p.m_wrapping ? Resampler::BOUNDARY_WRAP : Resampler::BOUNDARY_CLAMP;
+
+         pLevel->m_pResamplers[0] = crnlib_new<Resampler>(width, height, pLevel->m_width, pLevel->m_height,
+            boundary_op, 0.0f, 1.0f,
+            p.m_pFilter, (Resampler::Contrib_List*)NULL, (Resampler::Contrib_List*)NULL, p.m_filter_scale, p.m_filter_scale);
+
+         for (uint c = 1; c < p.m_num_comps; c++)
+         {
+            pLevel->m_pResamplers[c] = crnlib_new<Resampler>(width, height, pLevel->m_width, pLevel->m_height,
+               boundary_op, 0.0f, 1.0f,
+               p.m_pFilter, pLevel->m_pResamplers[0]->get_clist_x(), pLevel->m_pResamplers[0]->get_clist_y(), p.m_filter_scale, p.m_filter_scale);
+         }
+
+         for (uint c = 0; c < p.m_num_comps; c++)
+         {
+            if (pLevel->m_pResamplers[c]->status() != Resampler::STATUS_OKAY)
+            {
+               console::error("stream_dds_comp::init_levels: Failed creating resampler");
+               return false;
+            }
+         }
+      }
+
+      return true;
+   }
+
+   // Same conversions and quantization as image_utils::resample_single_thread().
+   bool stream_dds_comp::resample_line(const color_quad_u8* pSrc, crnlib::vector<float>* pSamples)
+   {
+      const uint src_width = m_levels[0]->m_width;
+      const uint num_comps = m_resample_params.m_num_comps;
+      const bool srgb = m_resample_params.m_srgb;
+
+      for (uint x = 0; x < src_width; x++)
+      {
+         for (uint c = 0; c < num_comps; c++)
+         {
+            const uint8 v = pSrc[x][c];
+
+            if ((!srgb) || (c == 3))
+               pSamples[c][x] = v * (1.0f/255.0f);
+            else
+               pSamples[c][x] = m_srgb_to_linear[v];
+         }
+      }
+
+      for (uint level_index = 1; level_index < m_levels.size(); level_index++)
+      {
+         stream_level& level = *m_levels[level_index];
+
+         for (uint c = 0; c < num_comps; c++)
+         {
+            if (!level.m_pResamplers[c]->put_line(&pSamples[c][0]))
+            {
+               console::error("stream_dds_comp::resample_line: Resampler failed");
+               return false;
+            }
+         }
+
+         for ( ; ; )
+         {
+            color_quad_u8* pDst = level.m_band.get_scanline(level.m_next_y & (cDXTBlockSize - 1));
+
+            uint c;
+            for (c = 0; c < num_comps; c++)
+            {
+               const float* pOutput_samples = level.m_pResamplers[c]->get_line();
+               if (!pOutput_samples)
+                  break;
+
+               CRNLIB_ASSERT(level.m_next_y < level.m_height);
+
+               if ((!srgb) || (c == 3))
+               {
+                  for (uint x = 0; x < level.m_width; x++)
+                  {
+                     int k = (int)(255.0f * pOutput_samples[x] + .5f);
+                     if (k < 0) k = 0; else if (k > 255) k = 255;
+                     pDst[x][c] = (uint8)k;
+                  }
+               }
+               else
+               {
+                  for (uint x = 0; x < level.m_width; x++)
+                  {
+                     int j = (int)(cLinearToSRGBTableSize * pOutput_samples[x] + .5f);
+                     if (j < 0) j = 0; else if (j >= cLinearToSRGBTableSize) j = cLinearToSRGBTableSize - 1;
+                     pDst[x][c] = m_linear_to_srgb[j];
+                  }
+               }
+            }
+            if (c < num_comps)
+               break;
+
+            if (num_comps < 4)
+            {
+               for (uint x = 0; x < level.m_width; x++)
+                  pDst[x].a = 255;
+            }
+
+            level.m_next_y++;
+            if ((!(level.m_next_y & (cDXTBlockSize - 1))) || (level.m_next_y == level.m_height))
+            {
+               if (!flush_band(level_index))
+                  return false;
+            }
+         }
+      }
+
+      return true;
+   }
+
+   bool stream_dds_comp::flush_band(uint level_index)
+   {
+      stream_level& level = *m_levels[level_index];
+      image_u8& band = level.m_band;
+
+      // Pad a partial band with its last row, which is what dxt_image::init() does at the bottom edge.
+      const uint num_rows = ((level.m_next_y - 1) & (cDXTBlockSize - 1)) + 1;
+      for (uint y = num_rows; y < cDXTBlockSize; y++)
+         memcpy(static_cast<void*>(band.get_scanline(y)), band.get_scanline(num_rows - 1), level.m_width * sizeof(color_quad_u8));
+
+      if ((level_index) && (m_renormalize))
+         image_utils::renorm_normal_map(band);
+
+      if (m_conv_type != image_utils::cConversion_Invalid)
+         image_utils::convert_image(band, m_conv_type);
+
+      if (m_pack_params.m_num_helper_threads)
+      {
+         m_task_pool.queue_multiple_object_tasks(this, &stream_dds_comp::pack_band_task, 0, m_pack_params.m_num_helper_threads + 1, &level);
+         m_task_pool.join();
+      }
+      else
+         pack_band_task(0, &level);
+
+      if (!m_pDst->seek(level.m_data_ofs + static_cast<uint64>(level.m_next_block_y) * level.m_row_size_in_bytes, false))
+         return false;
+
+      if (m_pDst->write(level.m_dxt.get_element_ptr(), level.m_row_size_in_bytes) != level.m_row_size_in_bytes)
+         return false;
+
+      level.m_next_block_y++;
+
+      return true;
+   }
+
+   void stream_dds_comp::pack_band_task(uint64 data, void* pData_ptr)
+   {
+      const uint thread_index = static_cast<uint>(data);
+      stream_level& level = *static_cast<stream_level*>(pData_ptr);
+      const uint num_threads = m_pack_params.m_num_helper_threads + 1;
+
+      // Blocks are dealt out by their index in the whole level, exactly as in dxt_image::init_task(), so each thread's
+      // optimizer context (which remembers previous solutions) sees the same blocks in the same order.
+      uint block_index = level.m_next_block_y * level.m_blocks_x;
+
+      for (uint block_x = 0; block_x < level.m_blocks_x; block_x++, block_index++)
+      {
+         if ((block_index % num_threads) != thread_index)
+            continue;
+
+         color_quad_u8 pixels[cDXTBlockSize * cDXTBlockSize];
+
+         const uint pixel_ofs_x = block_x * cDXTBlockSize;
+
+         for (uint y = 0; y < cDXTBlockSize; y++)
+         {
+            const color_quad_u8* pSrc = level.m_band.get_scanline(y);
+
+            for (uint x = 0; x < cDXTBlockSize; x++)
+               pixels[x + y * cDXTBlockSize] = pSrc[math::minimum(pixel_ofs_x + x, level.m_width - 1)];
+         }
+
+         level.m_dxt.set_block_pixels(block_x, 0, pixels, m_pack_params, *level.m_contexts[thread_index]);
+      }
+   }
+
+} // namespace crnlib
@@ -0,0 +1,96 @@
+// File: crn_stream_comp.h
+// This software is in the public domain. Please see license.txt.
+#pragma once
+#include "crn_dxt_image.h"
+#include "crn_image_utils.h"
+#include "crn_threading.h"
+#include "../inc/crnlib.h"
+
+namespace crnlib
+{
+   class data_stream;
+   class Resampler;
+
+   // Hands out an image one scanline at a time, top to bottom.
+   class scanline_reader
+   {
+   public:
+      virtual ~scanline_reader() { }
+
+      virtual uint get_width() const = 0;
+      virtual uint get_height() const = 0;
+      virtual bool has_alpha() const = 0;
+
+      // Reads the next get_width() pixels. Alpha is 255 if the image has no alpha channel.
+      virtual bool read_line(color_quad_u8* pDst) = 0;
+   };
+
+   // Non color mapped .TGA files (raw or RLE) and .JPG files are decoded a line at a time. Anything else is loaded whole with
+   // image_utils::read_from_file() and handed out line by line, so it takes as much memory as it always did.
+   // Returns NULL on failure, free the reader with crnlib_delete().
+   scanline_reader* create_scanline_reader(const char* pFilename);
+
+   // Compresses an image straight from a scanline_reader to a .DDS stream, without ever holding the whole image.
+   // Source lines are consumed in bands of 4, every mip level is resampled from them as they arrive, and each row of blocks
+   // is written out as soon as it's packed, so memory use grows with the image's width rather than its area.
+   // The output is identical to resampling the mips with mipmapped_texture::generate_mipmaps() (single threaded) and
+   // packing them with dxt_image::init(). The destination stream must be seekable.
+   class stream_dds_comp
+   {
+      CRNLIB_NO_COPY_OR_ASSIGNMENT_OP(stream_dds_comp);
+
+   public:
+      stream_dds_comp();
+      ~stream_dds_comp();
+
+      bool compress(
+         scanline_reader& reader, data_stream& dst,
+         pixel_format fmt, const crn_comp_params& comp_params, const crn_mipmap_params& mipmap_params,
+         dxt_image::pack_params::progress_callback_func pProgress_callback = NULL, void* pProgress_callback_user_data_ptr = NULL);
+
+      uint get_num_levels() const { return m_levels.size(); }
+
+   private:
+      struct stream_level
+      {
+         uint m_width;
+         uint m_height;
+         uint m_blocks_x;
+         uint m_blocks_y;
+         uint m_row_size_in_bytes;
+         uint64 m_data_ofs;
+
+         uint m_next_y;
+         uint m_next_block_y;
+
+         image_u8 m_band;
+         dxt_image m_dxt;
+         Resampler* m_pResamplers[4];
+         crnlib::vector<dxt_image::set_block_pixels_context*> m_contexts;
+      };
+
+      crnlib::vector<stream_level*> m_levels;
+
+      data_stream* m_pDst;
+      pixel_format m_fmt;
+      bool m_has_alpha;
+      bool m_alpha_from_luma;
+      image_utils::conversion_type m_conv_type;
+      image_utils::resample_params m_resample_params;
+      bool m_renormalize;
+
+      dxt_image::pack_params m_pack_params;
+      task_pool m_task_pool;
+
+      float m_srgb_to_linear[256];
+      enum { cLinearToSRGBTableSize = 8192 };
+      uint8 m_linear_to_srgb[cLinearToSRGBTableSize];
+
+      void clear();
+      bool init_levels(uint width, uint height, uint num_levels);
+      bool resample_line(const color_quad_u8* pSrc, crnlib::vector<float>* pSamples);
+      bool flush_band(uint level_index);
+      void pack_band_task(uint64 data, void* pData_ptr);
+   };
+
+} // namespace crnlib
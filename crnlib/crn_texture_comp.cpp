@@ -18,9 +18,56 @@ namespace crnlib
          return NULL;
    }
 
-   bool create_compressed_texture(const crn_comp_params &params, crnlib::vector<uint8> &comp_data, uint32 *pActual_quality_level, float *pActual_bitrate)
+   // One quality level being evaluated by the target bitrate search in create_compressed_texture().
+   struct bitrate_trial
    {
-      crn_comp_params local_params(params);
+      CRNLIB_NO_COPY_OR_ASSIGNMENT_OP(bitrate_trial);
+
+   public:
+      bitrate_trial() : m_pComp(NULL), m_bitrate(0.0f), m_status(false) { }
+      ~bitrate_trial() { crnlib_delete(m_pComp); }
+
+      bool init(const crn_comp_params& params, uint num_helper_threads, bool report_progress)
+      {
+         crnlib_delete(m_pComp);
+
+         m_params = params;
+         m_params.m_num_helper_threads = num_helper_threads;
+         if (!report_progress)
+            m_params.m_pProgress_func = NULL;
+
+         // The compressor may keep a pointer to the params passed to compress_init(), so the same object must be passed to each compress_pass().
+         m_pComp = create_texture_comp(m_params.m_file_type);
+         return m_pComp && m_pComp->compress_init(m_params);
+      }
+
+      crn_comp_params m_params;
+      itexture_comp* m_pComp;
+      float m_bitrate;
+      bool m_status;
+   };
+
+   // Number of quality levels compressed at once by each step of the cCRNCompFlagParallelBitrateSearch search.
+   const uint cMaxParallelBitrateTrials = 4;
+
+   static void compress_bitrate_trial(uint64 data, void* pData_ptr)
+   {
+      bitrate_trial& trial = static_cast<bitrate_trial*>(pData_ptr)[data];
+      trial.m_status = trial.m_pComp->compress_pass(trial.m_params, &trial.m_bitrate);
+   }
+
+   uint get_num_helper_threads(const crn_comp_params &params)
+   {
+      if (params.m_num_helper_threads == cCRNHelperThreadsAuto)
+         return math::minimum<uint>(crn_get_max_helper_threads(), cCRNMaxHelperThreads);
+
+      return params.m_num_helper_threads;
+   }
+
+   static void init_local_comp_params(crn_comp_params &local_params, const crn_comp_params &params)
+   {
+      local_params = params;
+      local_params.m_num_helper_threads = get_num_helper_threads(params);
 
       if (pixel_format_helpers::is_crn_format_non_srgb(local_params.m_format))
       {
@@ -32,27 +79,34 @@ namespace crnlib
             local_params.set_flag(cCRNCompFlagPerceptual, false);
          }
       }
+   }
+
+   bool create_compressed_texture(const crn_comp_params &params, crnlib::vector<uint8> &comp_data, uint32 *pActual_quality_level, float *pActual_bitrate)
+   {
+      crn_comp_params local_params;
+      init_local_comp_params(local_params, params);
 
       if (pActual_quality_level) *pActual_quality_level = 0;
       if (pActual_bitrate) *pActual_bitrate = 0.0f;
 
       comp_data.resize(0);
 
-      itexture_comp *pTexture_comp = create_texture_comp(local_params.m_file_type);
-      if (!pTexture_comp)
-         return false;
-
-      if (!pTexture_comp->compress_init(local_params))
-      {
-         crnlib_delete(pTexture_comp);
-         return false;
-      }
-
       if ( (local_params.m_target_bitrate <= 0.0f) ||
            (local_params.m_format == cCRNFmtDXT3) ||
-           ((local_params.m_file_type == cCRNFileTypeCRN) && ((local_params.m_flags & cCRNCompFlagManualPaletteSizes) != 0))
+           ((local_params.m_file_type == cCRNFileTypeCRN) && ((local_params.m_flags & cCRNCompFlagManualPaletteSizes) != 0)) ||
+           ((local_params.m_file_type == cCRNFileTypeCRN) && (local_params.m_pCRN_reference))
           )
       {
+         itexture_comp *pTexture_comp = create_texture_comp(local_params.m_file_type);
+         if (!pTexture_comp)
+            return false;
+
+         if (!pTexture_comp->compress_init(local_params))
+         {
+            crnlib_delete(pTexture_comp);
+            return false;
+         }
+
          if ( (local_params.m_file_type == cCRNFileTypeCRN) ||
               ((local_params.m_file_type == cCRNFileTypeDDS) && (local_params.m_quality_level < cCRNMaxQualityLevel)) )
          {
@@ -89,8 +143,33 @@ namespace crnlib
       int best_quality_level = -1;
       const uint cMaxIterations = 8;
 
+      // The parallel search compresses a fixed number of quality levels per step, so its result doesn't depend on the number of helper threads.
+      const bool parallel_search = (local_params.m_flags & cCRNCompFlagParallelBitrateSearch) != 0;
+      const uint num_trials = parallel_search ? cMaxParallelBitrateTrials : 1;
+
+      bitrate_trial trials[cMaxParallelBitrateTrials];
+      uint trial_helper_threads = local_params.m_num_helper_threads;
+
+      task_pool trial_pool;
+      if (parallel_search)
+      {
+         const uint total_threads = local_params.m_num_helper_threads + 1;
+         const uint concurrent_trials = math::minimum(num_trials, total_threads);
+
+         trial_helper_threads = (total_threads / concurrent_trials) - 1;
+
+         if (!trial_pool.init(concurrent_trials - 1))
+            return false;
+      }
+
       for ( ; ; )
       {
+         for (uint i = 0; i < num_trials; i++)
+         {
+            if (!trials[i].init(local_params, trial_helper_threads, i == 0))
+               return false;
+         }
+
          int low_quality = cLowestQuality;
          int high_quality = cHighestQuality;
 
@@ -102,8 +181,9 @@ namespace crnlib
 
          uint iter_count = 0;
          bool force_binary_search = false;
+         bool found_target = false;
 
-         while (low_quality <= high_quality)
+         while ((low_quality <= high_quality) && (!found_target))
          {
             if (params.m_flags & cCRNCompFlagDebugging)
             {
@@ -149,46 +229,92 @@ namespace crnlib
                }
             }
 
-            console::info("Compressing to quality level %u", trial_quality);
+            uint num_step_trials = 0;
+            trials[num_step_trials++].m_params.m_quality_level = trial_quality;
 
-            float bitrate = 0.0f;
+            if (parallel_search)
+            {
+               // Try the interpolated guess plus quality levels evenly splitting up the rest of the bracket. The first step has no guess, so evenly split the whole bracket.
+               const uint num_splits = iter_count ? (num_trials - 1) : num_trials;
+               if (!iter_count)
+                  num_step_trials = 0;
+
+               for (uint i = 0; i < num_splits; i++)
+               {
+                  const int quality = low_quality + static_cast<int>(((high_quality - low_quality) * (i + 1)) / (num_splits + 1));
+
+                  bool duplicate = cached_bitrates[quality] >= 0;
+                  for (uint j = 0; (j < num_step_trials) && (!duplicate); j++)
+                     duplicate = (trials[j].m_params.m_quality_level == (uint)quality);
+
+                  if (!duplicate)
+                     trials[num_step_trials++].m_params.m_quality_level = quality;
+               }
+
+               if (!num_step_trials)
+                  trials[num_step_trials++].m_params.m_quality_level = trial_quality;
 
-            local_params.m_quality_level = trial_quality;
+               // Evaluate the results from lowest to highest quality.
+               for (uint i = 1; i < num_step_trials; i++)
+                  for (uint j = i; (j > 0) && (trials[j - 1].m_params.m_quality_level > trials[j].m_params.m_quality_level); j--)
+                     utils::swap(trials[j - 1].m_params.m_quality_level, trials[j].m_params.m_quality_level);
 
-            if (!pTexture_comp->compress_pass(local_params, &bitrate))
+               dynamic_string levels, level;
+               for (uint i = 0; i < num_step_trials; i++)
+                  levels += level.format("%s%u", i ? ", " : "", trials[i].m_params.m_quality_level);
+               console::info("Compressing to quality levels %s", levels.get_ptr());
+
+               for (uint i = 0; i < num_step_trials; i++)
+                  trial_pool.queue_task(compress_bitrate_trial, i, trials);
+               trial_pool.join();
+            }
+            else
             {
-               crnlib_delete(pTexture_comp);
-               return false;
+               console::info("Compressing to quality level %u", trial_quality);
+
+               compress_bitrate_trial(0, trials);
             }
 
-            cached_bitrates[trial_quality] = bitrate;
+            for (uint i = 0; i < num_step_trials; i++)
+            {
+               if (!trials[i].m_status)
+                  return false;
+            }
 
-            highest_bitrate = math::maximum(highest_bitrate, bitrate);
+            for (uint i = 0; (i < num_step_trials) && (!found_target); i++)
+            {
+               const int quality = trials[i].m_params.m_quality_level;
+               const float bitrate = trials[i].m_bitrate;
 
-            console::info("\nTried quality level %u, bpp: %3.3f", trial_quality, bitrate);
+               cached_bitrates[quality] = bitrate;
 
-            if ( (best_quality_level < 0) ||
-                 ((bitrate <= local_params.m_target_bitrate) && (best_bitrate > local_params.m_target_bitrate)) ||
-                 (((bitrate <= local_params.m_target_bitrate) || (best_bitrate > local_params.m_target_bitrate)) && (fabs(bitrate - local_params.m_target_bitrate) < fabs(best_bitrate - local_params.m_target_bitrate)))
-                )
-            {
-               best_bitrate = bitrate;
-               comp_data.swap(pTexture_comp->get_comp_data());
-               best_quality_level = trial_quality;
-               if (params.m_flags & cCRNCompFlagDebugging)
+               highest_bitrate = math::maximum(highest_bitrate, bitrate);
+
+               console::info("\nTried quality level %u, bpp: %3.3f", quality, bitrate);
+
+               if ( (best_quality_level < 0) ||
+                    ((bitrate <= local_params.m_target_bitrate) && (best_bitrate > local_params.m_target_bitrate)) ||
+                    (((bitrate <= local_params.m_target_bitrate) || (best_bitrate > local_params.m_target_bitrate)) && (fabs(bitrate - local_params.m_target_bitrate) < fabs(best_bitrate - local_params.m_target_bitrate)))
+                   )
                {
-                  console::debug("Choose new best quality level");
+                  best_bitrate = bitrate;
+                  comp_data.swap(trials[i].m_pComp->get_comp_data());
+                  best_quality_level = quality;
+                  if (params.m_flags & cCRNCompFlagDebugging)
+                  {
+                     console::debug("Choose new best quality level");
+                  }
+
+                  if ((best_bitrate <= local_params.m_target_bitrate) && (fabs(best_bitrate - local_params.m_target_bitrate) < .005f))
+                     found_target = true;
                }
 
-               if ((best_bitrate <= local_params.m_target_bitrate) && (fabs(best_bitrate - local_params.m_target_bitrate) < .005f))
-                  break;
+               if (bitrate > local_params.m_target_bitrate)
+                  high_quality = math::minimum(high_quality, quality - 1);
+               else
+                  low_quality = math::maximum(low_quality, quality + 1);
             }
 
-            if (bitrate > local_params.m_target_bitrate)
-               high_quality = trial_quality - 1;
-            else
-               low_quality = trial_quality + 1;
-
             iter_count++;
             if (iter_count > cMaxIterations)
             {
@@ -203,23 +329,11 @@ namespace crnlib
             console::info("Unable to achieve desired bitrate - disabling adaptive block sizes and retrying search.");
 
             local_params.m_flags &= ~cCRNCompFlagHierarchical;
-
-            crnlib_delete(pTexture_comp);
-            pTexture_comp = create_texture_comp(local_params.m_file_type);
-
-            if (!pTexture_comp->compress_init(local_params))
-            {
-               crnlib_delete(pTexture_comp);
-               return false;
-            }
          }
          else
             break;
       }
 
-      crnlib_delete(pTexture_comp);
-      pTexture_comp = NULL;
-
       if (best_quality_level < 0)
          return false;
 
@@ -231,6 +345,40 @@ namespace crnlib
       return true;
    }
 
+
+   bool create_compressed_textures(const crn_comp_params &params, const uint32 *pQuality_levels, uint num_quality_levels, crnlib::vector<uint8> *pComp_data)
+   {
+      crn_comp_params local_params;
+      init_local_comp_params(local_params, params);
+      local_params.m_target_bitrate = 0.0f;
+
+      for (uint i = 0; i < num_quality_levels; i++)
+         pComp_data[i].clear();
+
+      itexture_comp *pTexture_comp = create_texture_comp(local_params.m_file_type);
+      if (!pTexture_comp)
+         return false;
+
+      // The compressor keeps its quality independent work between passes, so only the first pass pays for it.
+      bool status = pTexture_comp->compress_init(local_params);
+
+      for (uint i = 0; (i < num_quality_levels) && (status); i++)
+      {
+         local_params.m_quality_level = pQuality_levels[i];
+
+         console::info("Compressing using quality level %i", local_params.m_quality_level);
+
+         status = pTexture_comp->compress_pass(local_params, NULL);
+         if (status)
+            pComp_data[i].swap(pTexture_comp->get_comp_data());
+      }
+
+      pTexture_comp->compress_deinit();
+      crnlib_delete(pTexture_comp);
+
+      return status;
+   }
+
    static bool create_dds_tex(const crn_comp_params &params, mipmapped_texture &dds_tex)
    {
       image_u8 images[cCRNMaxFaces][cCRNMaxLevels];
@@ -448,6 +596,7 @@ namespace crnlib
          res_params.m_gamma = mipmap_params.m_gamma;
          res_params.m_srgb = srgb;
          res_params.m_multithreaded = (params.m_num_helper_threads > 0);
+         res_params.m_max_helper_threads = get_num_helper_threads(params);
 
          if (!work_tex.resize(new_width, new_height, res_params))
          {
@@ -470,6 +619,7 @@ namespace crnlib
          gen_params.m_gamma = mipmap_params.m_gamma;
          gen_params.m_srgb = srgb;
          gen_params.m_multithreaded = params.m_num_helper_threads > 0;
+         gen_params.m_max_helper_threads = get_num_helper_threads(params);
          gen_params.m_max_mips = mipmap_params.m_max_levels;
          gen_params.m_min_mip_size = mipmap_params.m_min_mip_size;
 
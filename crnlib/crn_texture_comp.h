@@ -26,7 +26,11 @@ namespace crnlib
       virtual       crnlib::vector<uint8>& get_comp_data() = 0;
    };
 
+   // Returns params.m_num_helper_threads, with cCRNHelperThreadsAuto resolved to the number of processors minus one.
+   uint get_num_helper_threads(const crn_comp_params &params);
+
    bool create_compressed_texture(const crn_comp_params &params, crnlib::vector<uint8> &comp_data, uint32 *pActual_quality_level, float *pActual_bitrate);
+   bool create_compressed_textures(const crn_comp_params &params, const uint32 *pQuality_levels, uint num_quality_levels, crnlib::vector<uint8> *pComp_data);
    bool create_texture_mipmaps(mipmapped_texture &work_tex, const crn_comp_params &params, const crn_mipmap_params &mipmap_params, bool generate_mipmaps);
    bool create_compressed_texture(const crn_comp_params &params, const crn_mipmap_params &mipmap_params, crnlib::vector<uint8> &comp_data, uint32 *pActual_quality_level, float *pActual_bitrate);
 
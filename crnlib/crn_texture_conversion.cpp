@@ -5,6 +5,7 @@
 #include "crn_console.h"
 #include "crn_file_utils.h"
 #include "crn_cfile_stream.h"
+#include "crn_mmap_stream.h"
 #include "crn_image_utils.h"
 #include "crn_texture_comp.h"
 #include "crn_strutils.h"
@@ -30,7 +31,8 @@ namespace crnlib
          const char* pDst_filename,
          mipmapped_texture& src_tex,
          texture_file_types::format dst_file_type,
-         bool lzma_stats)
+         bool lzma_stats,
+         uint num_helper_threads)
       {
          m_src_filename = pSrc_filename;
          m_dst_filename = pDst_filename;
@@ -55,20 +57,17 @@ namespace crnlib
 
          if (lzma_stats)
          {
-            vector<uint8> dst_tex_bytes;
-            if (!cfile_stream::read_file_into_array(pDst_filename, dst_tex_bytes))
+            // Empty files can't be mapped either, so a failed open covers both cases.
+            mmap_stream dst_file;
+            if ((!dst_file.open(pDst_filename)) || (dst_file.get_size() > cUINT32_MAX))
             {
-               console::error("Failed loading output file: %s", pDst_filename);
-               return false;
-            }
-            if (!dst_tex_bytes.size())
-            {
-               console::error("Output file is empty: %s", pDst_filename);
+               console::error("Failed loading output file (or it's empty): %s", pDst_filename);
                return false;
             }
             vector<uint8> cmp_tex_bytes;
             lzma_codec lossless_codec;
-            if (lossless_codec.pack(dst_tex_bytes.get_ptr(), dst_tex_bytes.size(), cmp_tex_bytes))
+            lossless_codec.set_multithreaded(num_helper_threads > 0);
+            if (lossless_codec.pack(dst_file.get_ptr(), static_cast<uint>(dst_file.get_size()), cmp_tex_bytes))
             {
                m_output_comp_file_size = cmp_tex_bytes.size();
             }
@@ -456,7 +455,7 @@ namespace crnlib
 
          if (!params.m_no_stats)
          {
-            if (!stats.init(params.m_pInput_texture->get_source_filename().get_ptr(), params.m_dst_filename.get_ptr(), *params.m_pIntermediate_texture, params.m_dst_file_type, params.m_lzma_stats))
+            if (!stats.init(params.m_pInput_texture->get_source_filename().get_ptr(), params.m_dst_filename.get_ptr(), *params.m_pIntermediate_texture, params.m_dst_file_type, params.m_lzma_stats, comp_params.m_num_helper_threads))
             {
                console::warning("Unable to compute output statistics for file: %s", params.m_pInput_texture->get_source_filename().get_ptr());
             }
@@ -551,7 +550,7 @@ namespace crnlib
 
             if (!params.m_no_stats)
             {
-               if (!stats.init(params.m_pInput_texture->get_source_filename().get_ptr(), params.m_dst_filename.get_ptr(), *params.m_pIntermediate_texture, params.m_dst_file_type, params.m_lzma_stats))
+               if (!stats.init(params.m_pInput_texture->get_source_filename().get_ptr(), params.m_dst_filename.get_ptr(), *params.m_pIntermediate_texture, params.m_dst_file_type, params.m_lzma_stats, comp_params.m_num_helper_threads))
                {
                   console::warning("Unable to compute output statistics for file: %s", params.m_pInput_texture->get_source_filename().get_ptr());
                }
@@ -566,6 +565,7 @@ namespace crnlib
          texture_type tex_type = params.m_texture_type;
 
          crn_comp_params comp_params(params.m_comp_params);
+         comp_params.m_num_helper_threads = get_num_helper_threads(comp_params);
          crn_mipmap_params mipmap_params(params.m_mipmap_params);
 
          progress_params progress_state;
@@ -643,12 +643,6 @@ namespace crnlib
          else if (dst_format == PIXEL_FMT_DXT1A)
             comp_params.set_flag(cCRNCompFlagDXT1AForTransparency, true);
         
-         if ((dst_format == PIXEL_FMT_ETC1) && (params.m_dst_file_type == texture_file_types::cFormatCRN))
-         {
-            console::warning("CRN file format does not support ETC1 compressed textures - converting to DXT1 instead.");
-            dst_format = PIXEL_FMT_DXT1;
-         }
-
          if ((dst_format == PIXEL_FMT_DXT1A) && (params.m_dst_file_type == texture_file_types::cFormatCRN))
          {
             console::warning("CRN file format does not support DXT1A compressed textures - converting to DXT5 instead.");
@@ -15,12 +15,14 @@ namespace crnlib
       public:
          convert_stats();
 
+         // With lzma_stats, the output file is LZMA compressed to measure its size, using a second thread if num_helper_threads allows it.
          bool init(
             const char* pSrc_filename,
             const char* pDst_filename,
             mipmapped_texture& src_tex,
             texture_file_types::format dst_file_type,
-            bool lzma_stats);
+            bool lzma_stats,
+            uint num_helper_threads = 0);
 
          bool print(bool psnr_metrics, bool mip_stats, bool grayscale_sampling, const char *pCSVStatsFile = NULL) const;
 
@@ -36,6 +36,11 @@ namespace crnlib
 #endif
    }
 
+   uint crn_get_max_helper_threads()
+   {
+      return g_number_of_processors - 1;
+   }
+
    crn_thread_id_t crn_get_current_thread_id()
    {
       // FIXME: Not portable
@@ -219,26 +224,165 @@ namespace crnlib
       }
    }
 
+   task_pool::task_deque::task_deque() :
+      m_top(0),
+      m_bottom(0),
+      m_pArray(NULL)
+   {
+   }
+
+   task_pool::task_deque::~task_deque()
+   {
+      free_retired_arrays();
+      crnlib_free(m_pArray);
+   }
+
+   void task_pool::task_deque::clear()
+   {
+      free_retired_arrays();
+      m_top = 0;
+      m_bottom = 0;
+   }
+
+   task_pool::task_deque::task_array* task_pool::task_deque::create_array(uint size)
+   {
+      CRNLIB_ASSERT(math::is_power_of_2(size));
+
+      task_array* pArray = static_cast<task_array*>(crnlib_malloc(sizeof(task_array) + (size - 1) * sizeof(task)));
+      if (!pArray)
+         return NULL;
+
+      pArray->m_mask = size - 1;
+      pArray->m_pPrev = NULL;
+      return pArray;
+   }
+
+   // Only called by the owner, so nothing else can change the bottom or write the tasks between top and bottom meanwhile.
+   bool task_pool::task_deque::grow(atomic32_t top, atomic32_t bottom)
+   {
+      task_array* pOld_array = m_pArray;
+
+      const uint old_size = pOld_array ? (pOld_array->m_mask + 1) : 0;
+      const uint new_size = pOld_array ? (old_size * 2) : static_cast<uint>(cInitialMaxTasks);
+      if (new_size <= old_size)
+         return false;
+
+      task_array* pNew_array = create_array(new_size);
+      if (!pNew_array)
+         return false;
+
+      for (atomic32_t i = top; i < bottom; i++)
+         pNew_array->m_tasks[i & pNew_array->m_mask] = pOld_array->m_tasks[i & pOld_array->m_mask];
+
+      pNew_array->m_pPrev = pOld_array;
+
+      // Published by the full barrier in push() before the new bottom. Thieves that read the old bottom may still use the
+      // old array, which holds the same tasks.
+      m_pArray = pNew_array;
+      return true;
+   }
+
+   void task_pool::task_deque::free_retired_arrays()
+   {
+      if (!m_pArray)
+         return;
+
+      task_array* pArray = m_pArray->m_pPrev;
+      m_pArray->m_pPrev = NULL;
+
+      while (pArray)
+      {
+         task_array* pPrev = pArray->m_pPrev;
+         crnlib_free(pArray);
+         pArray = pPrev;
+      }
+   }
+
+   bool task_pool::task_deque::push(const task& tsk)
+   {
+      const atomic32_t b = m_bottom;
+      const atomic32_t t = atomic_add32(&m_top, 0);
+      if ((!m_pArray) || (static_cast<uint>(b - t) > m_pArray->m_mask))
+      {
+         if (!grow(t, b))
+            return false;
+      }
+
+      task_array* pArray = m_pArray;
+      pArray->m_tasks[b & pArray->m_mask] = tsk;
+
+      // The full barrier publishes the task before the new bottom.
+      atomic_add32(&m_bottom, 1);
+      return true;
+   }
+
+   bool task_pool::task_deque::pop(task& tsk)
+   {
+      const atomic32_t b = atomic_add32(&m_bottom, -1);
+      const atomic32_t t = atomic_add32(&m_top, 0);
+
+      if (t > b)
+      {
+         atomic_exchange32(&m_bottom, b + 1);
+         return false;
+      }
+
+      task_array* pArray = m_pArray;
+      tsk = pArray->m_tasks[b & pArray->m_mask];
+      if (t < b)
+         return true;
+
+      // Last task: race any thieves for it.
+      const bool succeeded = (atomic_compare_exchange32(&m_top, t + 1, t) == t);
+      atomic_exchange32(&m_bottom, t + 1);
+      return succeeded;
+   }
+
+   bool task_pool::task_deque::steal(task& tsk)
+   {
+      const atomic32_t t = atomic_add32(&m_top, 0);
+      const atomic32_t b = atomic_add32(&m_bottom, 0);
+      if (t >= b)
+         return false;
+
+      // Read after the bottom, so it's at least as new as the array the tasks below the bottom were pushed to.
+      task_array* pArray = m_pArray;
+      tsk = pArray->m_tasks[t & pArray->m_mask];
+      return atomic_compare_exchange32(&m_top, t + 1, t) == t;
+   }
+
    task_pool::task_pool() :
       m_num_threads(0),
+      m_pThreads(NULL),
+      m_pWorker_contexts(NULL),
+      m_num_workers(0),
+      m_pDeques(NULL),
       m_tasks_available(0, 32767),
+      m_num_idle_threads(0),
       m_all_tasks_completed(0, 1),
       m_total_submitted_tasks(0),
       m_total_completed_tasks(0),
       m_exit_flag(false)
    {
-      utils::zero_object(m_threads);
+      if (pthread_key_create(&m_context_key, NULL))
+         CRNLIB_FAIL("task_pool: pthread_key_create() failed");
    }
 
    task_pool::task_pool(uint num_threads) :
       m_num_threads(0),
+      m_pThreads(NULL),
+      m_pWorker_contexts(NULL),
+      m_num_workers(0),
+      m_pDeques(NULL),
       m_tasks_available(0, 32767),
+      m_num_idle_threads(0),
       m_all_tasks_completed(0, 1),
       m_total_submitted_tasks(0),
       m_total_completed_tasks(0),
       m_exit_flag(false)
    {
-      utils::zero_object(m_threads);
+      if (pthread_key_create(&m_context_key, NULL))
+         CRNLIB_FAIL("task_pool: pthread_key_create() failed");
 
       bool status = init(num_threads);
       CRNLIB_VERIFY(status);
@@ -247,21 +391,51 @@ namespace crnlib
    task_pool::~task_pool()
    {
       deinit();
+
+      crnlib_delete_array(m_pDeques);
+      crnlib_delete_array(m_pThreads);
+      crnlib_delete_array(m_pWorker_contexts);
+
+      pthread_key_delete(m_context_key);
    }
 
    bool task_pool::init(uint num_threads)
    {
-      CRNLIB_ASSERT(num_threads <= cMaxThreads);
-      num_threads = math::minimum<uint>(num_threads, cMaxThreads);
-
       deinit();
 
+      crnlib_delete_array(m_pDeques);
+      crnlib_delete_array(m_pThreads);
+      crnlib_delete_array(m_pWorker_contexts);
+      m_pThreads = NULL;
+      m_pWorker_contexts = NULL;
+      m_num_workers = 0;
+
+      m_pDeques = crnlib_new_array<task_deque>(num_threads + 1);
+      if (!m_pDeques)
+         return false;
+
+      if (num_threads)
+      {
+         m_pThreads = crnlib_new_array<pthread_t>(num_threads);
+         m_pWorker_contexts = crnlib_new_array<thread_context>(num_threads);
+         if ((!m_pThreads) || (!m_pWorker_contexts))
+            return false;
+      }
+
+      m_num_workers = num_threads;
+
       bool succeeded = true;
 
       m_num_threads = 0;
       while (m_num_threads < num_threads)
       {
-         int status = pthread_create(&m_threads[m_num_threads], NULL, thread_func, this);
+         thread_context& context = m_pWorker_contexts[m_num_threads];
+         context.m_pPool = this;
+         context.m_deque_index = m_num_threads;
+         context.m_rand_seed = m_num_threads + 1;
+         context.m_pGroup = NULL;
+
+         int status = pthread_create(&m_pThreads[m_num_threads], NULL, thread_func, &context);
          if (status)
          {
             succeeded = false;
@@ -291,14 +465,19 @@ namespace crnlib
          m_tasks_available.release(m_num_threads);
 
          for (uint i = 0; i < m_num_threads; i++)
-            pthread_join(m_threads[i], NULL);
+            pthread_join(m_pThreads[i], NULL);
 
          m_num_threads = 0;
 
          atomic_exchange32(&m_exit_flag, false);
       }
 
-      m_task_stack.clear();
+      if (m_pDeques)
+      {
+         for (uint i = 0; i <= m_num_workers; i++)
+            m_pDeques[i].clear();
+      }
+      m_num_idle_threads = 0;
       m_total_submitted_tasks = 0;
       m_total_completed_tasks = 0;
    }
@@ -313,16 +492,7 @@ namespace crnlib
       tsk.m_pData_ptr = pData_ptr;
       tsk.m_flags = 0;
 
-      atomic_increment32(&m_total_submitted_tasks);
-      if (!m_task_stack.try_push(tsk))
-      {
-         atomic_increment32(&m_total_completed_tasks);
-         return false;
-      }
-
-      m_tasks_available.release(1);
-
-      return true;
+      return queue(tsk);
    }
 
    // It's the object's responsibility to delete pObj within the execute_task() method, if needed!
@@ -336,25 +506,104 @@ namespace crnlib
       tsk.m_pData_ptr = pData_ptr;
       tsk.m_flags = cTaskFlagObject;
 
+      return queue(tsk);
+   }
+
+   bool task_pool::queue(task& tsk)
+   {
+      thread_context* pContext = static_cast<thread_context*>(pthread_getspecific(m_context_key));
+
+      tsk.m_pGroup = pContext ? pContext->m_pGroup : NULL;
+      if (tsk.m_pGroup)
+         atomic_increment32(tsk.m_pGroup);
       atomic_increment32(&m_total_submitted_tasks);
-      if (!m_task_stack.try_push(tsk))
+
+      // Tasks queued from a worker go to the bottom of its own deque, everything else goes to the shared deque.
+      bool pushed = false;
+      if (m_pDeques)
       {
-         atomic_increment32(&m_total_completed_tasks);
-         return false;
+         if ((pContext) && (pContext->m_deque_index < m_num_workers))
+            pushed = m_pDeques[pContext->m_deque_index].push(tsk);
+         else
+         {
+            scoped_spinlock lock(m_external_lock);
+            pushed = m_pDeques[m_num_workers].push(tsk);
+         }
+      }
+
+      if (!pushed)
+      {
+         // The pool has no threads (or a deque couldn't grow), so run the task now instead of dropping it.
+         thread_context context;
+         if (!pContext)
+         {
+            context.m_pPool = this;
+            context.m_deque_index = m_num_workers;
+            context.m_rand_seed = 1;
+            context.m_pGroup = NULL;
+            pthread_setspecific(m_context_key, &context);
+         }
+
+         process_task(pContext ? *pContext : context, tsk);
+
+         if (!pContext)
+            pthread_setspecific(m_context_key, NULL);
+         return true;
       }
 
-      m_tasks_available.release(1);
+      if (m_num_idle_threads)
+         m_tasks_available.release(1);
 
       return true;
    }
 
-   void task_pool::process_task(task& tsk)
+   bool task_pool::get_task(thread_context& context, task& tsk)
    {
+      if (!m_pDeques)
+         return false;
+
+      if ((context.m_deque_index < m_num_workers) && (m_pDeques[context.m_deque_index].pop(tsk)))
+         return true;
+
+      // Try to steal from the other deques, starting at a random victim. The shared deque has no owner to pop it, so everyone steals from it.
+      const uint num_deques = m_num_workers + 1;
+
+      context.m_rand_seed ^= context.m_rand_seed << 13;
+      context.m_rand_seed ^= context.m_rand_seed >> 17;
+      context.m_rand_seed ^= context.m_rand_seed << 5;
+
+      const uint first = context.m_rand_seed % num_deques;
+      for (uint i = 0; i < num_deques; i++)
+      {
+         uint victim = first + i;
+         if (victim >= num_deques)
+            victim -= num_deques;
+
+         if (((victim != context.m_deque_index) || (victim == m_num_workers)) && (m_pDeques[victim].steal(tsk)))
+            return true;
+      }
+
+      return false;
+   }
+
+   void task_pool::process_task(thread_context& context, task& tsk)
+   {
+      // Subtasks queued by this task are counted in children, so joining them from within the task only waits for them.
+      volatile atomic32_t children = 0;
+      volatile atomic32_t* pPrev_group = context.m_pGroup;
+      context.m_pGroup = &children;
+
       if (tsk.m_flags & cTaskFlagObject)
          tsk.m_pObj->execute_task(tsk.m_data, tsk.m_pData_ptr);
       else
          tsk.m_callback(tsk.m_data, tsk.m_pData_ptr);
 
+      wait_for_group(context, &children);
+      context.m_pGroup = pPrev_group;
+
+      if (tsk.m_pGroup)
+         atomic_decrement32(tsk.m_pGroup);
+
       if (atomic_increment32(&m_total_completed_tasks) == m_total_submitted_tasks)
       {
          // Try to signal the semaphore (the max count is 1 so this may actually fail).
@@ -362,42 +611,80 @@ namespace crnlib
       }
    }
 
+   void task_pool::wait_for_group(thread_context& context, volatile atomic32_t* pGroup)
+   {
+      // Run queued tasks while waiting, so a worker joining its subtasks never blocks the pool.
+      task tsk;
+      while (*pGroup)
+      {
+         if (get_task(context, tsk))
+            process_task(context, tsk);
+         else
+            crnlib_yield_processor();
+      }
+   }
+
    void task_pool::join()
    {
-      // Try to steal any outstanding tasks. This could cause one or more worker threads to wake up and immediately go back to sleep, which is wasteful but should be harmless.
+      thread_context* pContext = static_cast<thread_context*>(pthread_getspecific(m_context_key));
+      if ((pContext) && (pContext->m_pGroup))
+      {
+         wait_for_group(*pContext, pContext->m_pGroup);
+         return;
+      }
+
+      thread_context context;
+      context.m_pPool = this;
+      context.m_deque_index = m_num_workers;
+      context.m_rand_seed = 1;
+      context.m_pGroup = NULL;
+      pthread_setspecific(m_context_key, &context);
+
+      // Help out by running outstanding tasks, then wait for the ones still running on the workers. The m_all_tasks_completed semaphore
+      // has a max count of 1, so it's possible it could have saturated to 1 as the tasks where issued and asynchronously completed, so
+      // this loop may iterate a few times.
       task tsk;
-      while (m_task_stack.pop(tsk))
-         process_task(tsk);
-
-      // At this point the task stack is empty.
-      // Now wait for all concurrent tasks to complete. The m_all_tasks_completed semaphore has a max count of 1, so it's possible it could have saturated to 1 as the tasks
-      // where issued and asynchronously completed, so this loop may iterate a few times.
-      const int total_submitted_tasks = atomic_add32(&m_total_submitted_tasks, 0);
-      while (m_total_completed_tasks != total_submitted_tasks)
+      while (m_total_completed_tasks != atomic_add32(&m_total_submitted_tasks, 0))
       {
-         // If the previous (m_total_completed_tasks != total_submitted_tasks) check failed the semaphore MUST be eventually signalled once the last task completes.
-         // So I think this can actually be an INFINITE delay, but it shouldn't really matter if it's 1ms.
-         m_all_tasks_completed.wait(1);
+         if (get_task(context, tsk))
+            process_task(context, tsk);
+         else
+            m_all_tasks_completed.wait(1);
       }
+
+      pthread_setspecific(m_context_key, pContext);
    }
 
    void * task_pool::thread_func(void *pContext)
    {
-      task_pool* pPool = static_cast<task_pool*>(pContext);
-      task tsk;
+      // Each worker owns the deque at the index in its context.
+      thread_context& context = *static_cast<thread_context*>(pContext);
+      task_pool* pPool = context.m_pPool;
+      pthread_setspecific(pPool->m_context_key, &context);
 
+      task tsk;
       for ( ; ; )
       {
-         if (!pPool->m_tasks_available.wait())
-            break;
-
          if (pPool->m_exit_flag)
             break;
 
-         if (pPool->m_task_stack.pop(tsk))
+         if (pPool->get_task(context, tsk))
          {
-            pPool->process_task(tsk);
+            pPool->process_task(context, tsk);
+            continue;
          }
+
+         // Go idle, but check for work once more in case a task was queued before the idle count was raised.
+         atomic_increment32(&pPool->m_num_idle_threads);
+         if (pPool->get_task(context, tsk))
+         {
+            atomic_decrement32(&pPool->m_num_idle_threads);
+            pPool->process_task(context, tsk);
+            continue;
+         }
+
+         pPool->m_tasks_available.wait();
+         atomic_decrement32(&pPool->m_num_idle_threads);
       }
 
       return NULL;
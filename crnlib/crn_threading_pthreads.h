@@ -26,6 +26,7 @@ namespace crnlib
 
    void crn_sleep(unsigned int milliseconds);
 
+   // Returns the number of helper threads needed to use every processor, in addition to the calling thread.
    uint crn_get_max_helper_threads();
 
    class mutex
@@ -103,66 +104,15 @@ namespace crnlib
       spinlock& m_lock;
    };
 
-   template<typename T, uint cMaxSize>
-   class tsstack
-   {
-   public:
-      inline tsstack() :
-         m_top(0)
-      {
-      }
-
-      inline ~tsstack()
-      {
-      }
-
-      inline void clear()
-      {
-         m_spinlock.lock();
-         m_top = 0;
-         m_spinlock.unlock();
-      }
-
-      inline bool try_push(const T& obj)
-      {
-         bool result = false;
-         m_spinlock.lock();
-         if (m_top < (int)cMaxSize)
-         {
-            m_stack[m_top++] = obj;
-            result = true;
-         }
-         m_spinlock.unlock();
-         return result;
-      }
-
-      inline bool pop(T& obj)
-      {
-         bool result = false;
-         m_spinlock.lock();
-         if (m_top > 0)
-         {
-            obj = m_stack[--m_top];
-            result = true;
-         }
-         m_spinlock.unlock();
-         return result;
-      }
-
-   private:
-      spinlock m_spinlock;
-      T m_stack[cMaxSize];
-      int m_top;
-   };
-
    class task_pool
    {
+      CRNLIB_NO_COPY_OR_ASSIGNMENT_OP(task_pool);
+
    public:
       task_pool();
       task_pool(uint num_threads);
       ~task_pool();
 
-      enum { cMaxThreads = 16 };
       bool init(uint num_threads);
       void deinit();
 
@@ -188,12 +138,15 @@ namespace crnlib
       template<typename S, typename T>
       inline bool queue_multiple_object_tasks(S* pObject, T pObject_method, uint64 first_data, uint num_tasks, void* pData_ptr = NULL);
 
+      // Waits for all outstanding tasks (if any) to complete. The calling thread runs queued tasks while it waits.
+      // When called from within a task, only waits for the tasks that task has queued, so tasks may spawn and join subtasks.
+      // A task that returns without joining its subtasks is implicitly joined before it's considered complete.
       void join();
 
    private:
       struct task
       {
-         inline task() : m_data(0), m_pData_ptr(NULL), m_pObj(NULL), m_flags(0) { }
+         inline task() : m_data(0), m_pData_ptr(NULL), m_pObj(NULL), m_flags(0), m_pGroup(NULL) { }
 
          uint64 m_data;
          void* m_pData_ptr;
@@ -205,15 +158,75 @@ namespace crnlib
          };
 
          uint m_flags;
+
+         // Outstanding task count of the task that queued this one, or NULL if it was queued from outside the pool.
+         volatile atomic32_t* m_pGroup;
       };
 
-      tsstack<task, cMaxThreads> m_task_stack;
+      // Chase-Lev work stealing deque. Only the owning thread pushes and pops at the bottom, any thread may steal from the top.
+      // The circular array doubles whenever a push finds it full. Thieves may still be reading the array it replaced, so
+      // replaced arrays are kept until clear().
+      class task_deque
+      {
+         CRNLIB_NO_COPY_OR_ASSIGNMENT_OP(task_deque);
 
+      public:
+         enum { cInitialMaxTasks = 1024, cCacheLineSize = 64 };
+
+         task_deque();
+         ~task_deque();
+
+         // Only safe while no other thread is using the deque.
+         void clear();
+
+         // Returns false if the deque is full and couldn't be grown.
+         bool push(const task& tsk);
+         bool pop(task& tsk);
+         bool steal(task& tsk);
+
+      private:
+         struct task_array
+         {
+            uint m_mask;
+            task_array* m_pPrev;
+            task m_tasks[1];
+         };
+
+         volatile atomic32_t m_top;
+         uint8 m_top_padding[cCacheLineSize];
+         volatile atomic32_t m_bottom;
+         uint8 m_bottom_padding[cCacheLineSize];
+         task_array* volatile m_pArray;
+
+         static task_array* create_array(uint size);
+         bool grow(atomic32_t top, atomic32_t bottom);
+         void free_retired_arrays();
+      };
+
+      // Per thread state of a worker, or of a thread that's queueing tasks or helping out in join().
+      struct thread_context
+      {
+         task_pool* m_pPool;
+         uint m_deque_index;
+         uint32 m_rand_seed;
+         volatile atomic32_t* m_pGroup;
+      };
+
+      // Sized by init(), one entry per worker thread.
       uint m_num_threads;
-      pthread_t m_threads[cMaxThreads];
+      pthread_t* m_pThreads;
+      thread_context* m_pWorker_contexts;
+
+      // One deque per worker thread, followed by a shared deque for tasks queued by other threads. Pushes to the shared deque take m_external_lock.
+      uint m_num_workers;
+      task_deque* m_pDeques;
+      spinlock m_external_lock;
 
-      // Signalled whenever a task is queued up.
+      pthread_key_t m_context_key;
+
+      // Signalled when a task is queued while one or more workers are idle.
       semaphore m_tasks_available;
+      volatile atomic32_t m_num_idle_threads;
 
       // Signalled when all outstanding tasks are completed.
       semaphore m_all_tasks_completed;
@@ -227,7 +240,10 @@ namespace crnlib
       volatile atomic32_t m_total_completed_tasks;
       volatile atomic32_t m_exit_flag;
 
-      void process_task(task& tsk);
+      bool queue(task& tsk);
+      bool get_task(thread_context& context, task& tsk);
+      void process_task(thread_context& context, task& tsk);
+      void wait_for_group(thread_context& context, volatile atomic32_t* pGroup);
 
       static void* thread_func(void *pContext);
    };
@@ -304,41 +320,23 @@ namespace crnlib
       if (!num_tasks)
          return true;
 
-      bool status = true;
-
-      uint i;
-      for (i = 0; i < num_tasks; i++)
+      for (uint i = 0; i < num_tasks; i++)
       {
          task tsk;
 
          tsk.m_pObj = crnlib_new< object_task<S> >(pObject, pObject_method, cObjectTaskFlagDeleteAfterExecution);
          if (!tsk.m_pObj)
-         {
-            status = false;
-            break;
-         }
+            return false;
 
          tsk.m_data = first_data + i;
          tsk.m_pData_ptr = pData_ptr;
          tsk.m_flags = cTaskFlagObject;
 
-         atomic_increment32(&m_total_submitted_tasks);
-
-         if (!m_task_stack.try_push(tsk))
-         {
-            atomic_increment32(&m_total_completed_tasks);
-
-            status = false;
-            break;
-         }
-      }
-
-      if (i)
-      {
-         m_tasks_available.release(i);
+         if (!queue(tsk))
+            return false;
       }
 
-      return status;
+      return true;
    }
 
 } // namespace crnlib
@@ -32,7 +32,7 @@ namespace crnlib
       if (g_number_of_processors > 1)
       {
          // use all CPU's
-         return CRNLIB_MIN((int)task_pool::cMaxThreads, (int)g_number_of_processors - 1);
+         return g_number_of_processors - 1;
       }
 
       return 0;
@@ -220,26 +220,27 @@ namespace crnlib
    task_pool::task_pool() :
       m_pTask_stack(crnlib_new<ts_task_stack_t>()),
       m_num_threads(0),
+      m_pThreads(NULL),
+      m_pThread_ids(NULL),
       m_tasks_available(0, 32767),
       m_all_tasks_completed(0, 1),
       m_total_submitted_tasks(0),
       m_total_completed_tasks(0),
       m_exit_flag(false)
    {
-      utils::zero_object(m_threads);
    }
 
    task_pool::task_pool(uint num_threads) :
       m_pTask_stack(crnlib_new<ts_task_stack_t>()),
       m_num_threads(0),
+      m_pThreads(NULL),
+      m_pThread_ids(NULL),
       m_tasks_available(0, 32767),
       m_all_tasks_completed(0, 1),
       m_total_submitted_tasks(0),
       m_total_completed_tasks(0),
       m_exit_flag(false)
    {
-      utils::zero_object(m_threads);
-
       bool status = init(num_threads);
       CRNLIB_VERIFY(status);
    }
@@ -248,24 +249,36 @@ namespace crnlib
    {
       deinit();
       crnlib_delete(m_pTask_stack);
+      crnlib_delete_array(m_pThreads);
+      crnlib_delete_array(m_pThread_ids);
    }
 
    bool task_pool::init(uint num_threads)
    {
-      CRNLIB_ASSERT(num_threads <= cMaxThreads);
-      num_threads = math::minimum<uint>(num_threads, cMaxThreads);
-
       deinit();
 
+      crnlib_delete_array(m_pThreads);
+      m_pThreads = NULL;
+      crnlib_delete_array(m_pThread_ids);
+      m_pThread_ids = NULL;
+
+      if (num_threads)
+      {
+         m_pThreads = crnlib_new_array<HANDLE>(num_threads);
+         m_pThread_ids = crnlib_new_array<unsigned>(num_threads);
+         if ((!m_pThreads) || (!m_pThread_ids))
+            return false;
+      }
+
       bool succeeded = true;
 
       m_num_threads = 0;
       while (m_num_threads < num_threads)
       {
-         m_threads[m_num_threads] = (HANDLE)_beginthreadex(NULL, 32768, thread_func, this, 0, NULL);
-         CRNLIB_ASSERT(m_threads[m_num_threads] != 0);
+         m_pThreads[m_num_threads] = (HANDLE)_beginthreadex(NULL, 32768, thread_func, this, 0, &m_pThread_ids[m_num_threads]);
+         CRNLIB_ASSERT(m_pThreads[m_num_threads] != 0);
 
-         if (!m_threads[m_num_threads])
+         if (!m_pThreads[m_num_threads])
          {
             succeeded = false;
             break;
@@ -297,18 +310,18 @@ namespace crnlib
          // Now wait for each thread to exit.
          for (uint i = 0; i < m_num_threads; i++)
          {
-            if (m_threads[i])
+            if (m_pThreads[i])
             {
                for ( ; ; )
                {
                   // Can be an INFINITE delay, but set at 30 seconds so this function always provably exits.
-                  DWORD result = WaitForSingleObject(m_threads[i], 30000);
+                  DWORD result = WaitForSingleObject(m_pThreads[i], 30000);
                   if ((result == WAIT_OBJECT_0) || (result == WAIT_ABANDONED))
                      break;
                }
 
-               CloseHandle(m_threads[i]);
-               m_threads[i] = NULL;
+               CloseHandle(m_pThreads[i]);
+               m_pThreads[i] = NULL;
             }
          }
 
@@ -337,11 +350,13 @@ namespace crnlib
 
       if (!m_pTask_stack->try_push(tsk))
       {
-         atomic_increment32(&m_total_completed_tasks);
-         return false;
+         // Out of memory for the stack's node, so run the task now instead of dropping it.
+         process_task(tsk);
+         return true;
       }
-            
-      m_tasks_available.release(1);
+
+      // The workers drain the stack whenever they wake up, so it doesn't matter if the semaphore is already at its max count.
+      m_tasks_available.try_release(1);
       
       return true;
    }
@@ -361,11 +376,13 @@ namespace crnlib
 
       if (!m_pTask_stack->try_push(tsk))
       {
-         atomic_increment32(&m_total_completed_tasks);
-         return false;
+         // Out of memory for the stack's node, so run the task now instead of dropping it.
+         process_task(tsk);
+         return true;
       }
-            
-      m_tasks_available.release(1);
+
+      // The workers drain the stack whenever they wake up, so it doesn't matter if the semaphore is already at its max count.
+      m_tasks_available.try_release(1);
 
       return true;
    }
@@ -384,8 +401,20 @@ namespace crnlib
       }
    }
 
+   bool task_pool::is_worker_thread() const
+   {
+      const DWORD thread_id = GetCurrentThreadId();
+      for (uint i = 0; i < m_num_threads; i++)
+         if (m_pThread_ids[i] == thread_id)
+            return true;
+      return false;
+   }
+
    void task_pool::join()
    {
+      // The calling task would wait for itself to complete.
+      CRNLIB_ASSERT(!is_worker_thread());
+
       // Try to steal any outstanding tasks. This could cause one or more worker threads to wake up and immediately go back to sleep, which is wasteful but should be harmless.
       task tsk;
       while (m_pTask_stack->pop(tsk))
@@ -416,7 +445,7 @@ namespace crnlib
             break;
 
          task tsk;
-         if (pPool->m_pTask_stack->pop(tsk))
+         while (pPool->m_pTask_stack->pop(tsk))
             pPool->process_task(tsk);
       }
 
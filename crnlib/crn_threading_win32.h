@@ -222,6 +222,8 @@ namespace crnlib
    };
 
    // Simple multithreaded task pool. This class assumes a single global thread will be issuing tasks and joining.
+   // Unlike the pthreads task_pool, tasks can't join their own subtasks: join() waits for every outstanding task, including the one
+   // calling it, so it must not be called from a worker thread (which is asserted).
    class task_pool
    {
       CRNLIB_NO_COPY_OR_ASSIGNMENT_OP(task_pool);
@@ -230,7 +232,6 @@ namespace crnlib
       task_pool(uint num_threads);
       ~task_pool();
 
-      enum { cMaxThreads = 16 };
       bool init(uint num_threads);
       void deinit();
 
@@ -257,7 +258,7 @@ namespace crnlib
       inline bool queue_multiple_object_tasks(S* pObject, T pObject_method, uint64 first_data, uint num_tasks, void* pData_ptr = NULL);
 
       // Waits for all outstanding tasks (if any) to complete.
-      // The calling thread will steal any outstanding tasks from worker threads, if possible.
+      // The calling thread will steal any outstanding tasks from worker threads, if possible. Must not be called from within a task.
       void join();
 
    private:
@@ -280,8 +281,10 @@ namespace crnlib
       typedef tsstack<task> ts_task_stack_t;
       ts_task_stack_t* m_pTask_stack;
 
+      // Sized by init(), one handle and ID per worker thread.
       uint m_num_threads;
-      HANDLE m_threads[cMaxThreads];
+      HANDLE* m_pThreads;
+      unsigned* m_pThread_ids;
 
       // Signalled whenever a task is queued up.
       semaphore m_tasks_available;
@@ -300,6 +303,8 @@ namespace crnlib
 
       void process_task(task& tsk);
 
+      bool is_worker_thread() const;
+
       static unsigned __stdcall thread_func(void* pContext);
    };
 
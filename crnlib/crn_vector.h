@@ -54,7 +54,7 @@ namespace crnlib
          m_size = other.m_size;
 
          if (CRNLIB_IS_BITWISE_COPYABLE(T))
-            memcpy(m_p, other.m_p, m_size * sizeof(T));
+            memcpy(static_cast<void*>(m_p), other.m_p, m_size * sizeof(T));
          else
          {
             T* pDst = m_p;
@@ -5,115 +5,163 @@
 // http://citeseerx.ist.psu.edu/viewdoc/summary?doi=10.1.1.88.7221 
 #include "crn_core.h"
 #include "crn_zeng.h"
-#include "crn_sparse_array.h"
 #include <deque>
 
-#define USE_SPARSE_ARRAY 1
-
 namespace crnlib
 {
-#if USE_SPARSE_ARRAY         
-   typedef sparse_array<uint, 4> hist_type;
-#else   
-   typedef crnlib::vector<uint> hist_type;
-#endif   
-   
-   static inline void update_hist(hist_type& hist, int i, int j, int n)
-   {  
-      if (i == j)
-         return;
-         
-      if ((i != -1) && (j != -1) && (i < j))
-      {  
-         CRNLIB_ASSERT( (i >= 0) && (i < (int)n) );
-         CRNLIB_ASSERT( (j >= 0) && (j < (int)n) );
-
-         uint index = i * n + j;
-                  
-#if USE_SPARSE_ARRAY         
-         uint freq = hist[index];
-         freq++;
-         hist.set(index, freq);
-#else
-         hist[index]++;         
-#endif         
-      }
-   }
-   
-   static inline uint read_hist(hist_type& hist, int i, int j, int n)
+   // Sparse, symmetric co-occurrence histogram of the index stream: for each palette entry, the entries it's adjacent to and how often.
+   // Only pairs that actually occur are stored, so memory is proportional to num_indices instead of n*n.
+   class zeng_hist
    {
-      if (i > j)
-         utils::swap(i, j);
-      
-      return hist[i * n + j];
-   }
-         
-   void create_zeng_reorder_table(uint n, uint num_indices, const uint* pIndices, crnlib::vector<uint>& remap_table, zeng_similarity_func pFunc, void* pContext, float similarity_func_weight)
-   {
-      CRNLIB_ASSERT((n > 0) && (num_indices > 0));
-      CRNLIB_ASSERT_CLOSED_RANGE(similarity_func_weight, 0.0f, 1.0f);
-      
-//      printf("create_zeng_reorder_table start:\n");
+   public:
+      struct edge
+      {
+         uint m_index;
+         uint m_freq;
+      };
 
-      remap_table.clear();
-      remap_table.resize(n);
+      void init(uint n, uint num_indices, const uint* pIndices)
+      {
+         // Bucket each adjacent pair of different indices by its lower index.
+         crnlib::vector<uint> pair_start(n + 1);
+         for (uint i = 1; i < num_indices; i++)
+         {
+            if (pIndices[i - 1] != pIndices[i])
+               pair_start[math::minimum(pIndices[i - 1], pIndices[i]) + 1]++;
+         }
+         for (uint i = 0; i < n; i++)
+            pair_start[i + 1] += pair_start[i];
 
-      if (num_indices <= 1)
-         return;
+         crnlib::vector<uint> pair_cols(pair_start[n]);
+         {
+            crnlib::vector<uint> pair_ofs(pair_start);
+            for (uint i = 1; i < num_indices; i++)
+            {
+               const uint a = pIndices[i - 1], b = pIndices[i];
+               if (a < b)
+                  pair_cols[pair_ofs[a]++] = b;
+               else if (b < a)
+                  pair_cols[pair_ofs[b]++] = a;
+            }
+         }
 
-      const uint t = n * n;
-      hist_type xhist(t);
+         // Count each bucket's distinct columns, giving the distinct pairs (i < j) in order of i * n + j.
+         m_pairs.resize(0);
+         m_pair_rows.resize(0);
 
-      for (uint i = 0; i < num_indices; i++)
-      {
-         const int prev_val = (i > 0) ? pIndices[i-1] : -1;
-         const int cur_val = pIndices[i];
-         const int next_val = (i < (num_indices - 1)) ? pIndices[i+1] : -1;
+         crnlib::vector<uint> degree(n + 1);
+         crnlib::vector<uint> col_freq(n);
+         crnlib::vector<uint> cols;
+         for (uint i = 0; i < n; i++)
+         {
+            cols.resize(0);
+            for (uint k = pair_start[i]; k < pair_start[i + 1]; k++)
+            {
+               if (!col_freq[pair_cols[k]]++)
+                  cols.push_back(pair_cols[k]);
+            }
 
-         update_hist(xhist, cur_val, prev_val, n);
-         update_hist(xhist, cur_val, next_val, n);
-      }
+            std::sort(cols.begin(), cols.end());
 
-#if 0      
-      uint total1 = 0, total2 = 0;
-      for (uint i = 0; i < n; i++)
-      {
-         for (uint j = 0; j < n; j++)
+            for (uint k = 0; k < cols.size(); k++)
+            {
+               const uint j = cols[k];
+
+               edge e;
+               e.m_index = j;
+               e.m_freq = col_freq[j];
+               m_pairs.push_back(e);
+               m_pair_rows.push_back(i);
+
+               col_freq[j] = 0;
+
+               degree[i + 1]++;
+               degree[j + 1]++;
+            }
+         }
+
+         // Store each pair under both of its indices.
+         for (uint i = 0; i < n; i++)
+            degree[i + 1] += degree[i];
+
+         m_edge_start.swap(degree);
+         m_edges.resize(m_edge_start[n]);
+
+         crnlib::vector<uint> edge_ofs(m_edge_start);
+         for (uint k = 0; k < m_pairs.size(); k++)
          {
-            if (i == j)
-               continue;
-               
-            //uint a = hist[i * n + j];
-            //total1 += a;
-            
-            uint c = read_hist(xhist, i, j, n);
-            total2 += c;
+            const uint i = m_pair_rows[k];
+            const uint j = m_pairs[k].m_index;
+
+            edge& ei = m_edges[edge_ofs[i]++];
+            ei.m_index = j;
+            ei.m_freq = m_pairs[k].m_freq;
+
+            edge& ej = m_edges[edge_ofs[j]++];
+            ej.m_index = i;
+            ej.m_freq = m_pairs[k].m_freq;
          }
       }
-      
-      printf("%u %u\n", total1, total2);
-#endif      
 
-      uint max_freq = 0;
-      uint max_index = 0;
-      for (uint i = 0; i < t; i++)
+      // Returns the first most frequent pair in order of i * n + j, or (0, 0) if there are none.
+      void find_most_frequent_pair(uint& x, uint& y) const
       {
-         if (xhist[i] > max_freq)
+         uint max_freq = 0;
+         x = 0;
+         y = 0;
+
+         for (uint k = 0; k < m_pairs.size(); k++)
          {
-            max_freq = xhist[i];
-            max_index = i;
+            if (m_pairs[k].m_freq > max_freq)
+            {
+               max_freq = m_pairs[k].m_freq;
+               x = m_pair_rows[k];
+               y = m_pairs[k].m_index;
+            }
          }
       }
 
-      uint x = max_index / n;
-      uint y = max_index % n;
+      inline const edge* get_edges(uint i) const { return m_edges.get_ptr() + m_edge_start[i]; }
+      inline uint get_num_edges(uint i) const { return m_edge_start[i + 1] - m_edge_start[i]; }
+
+   private:
+      crnlib::vector<edge> m_pairs;
+      crnlib::vector<uint> m_pair_rows;
+
+      crnlib::vector<uint> m_edge_start;
+      crnlib::vector<edge> m_edges;
+   };
+
+   void create_zeng_reorder_table(uint n, uint num_indices, const uint* pIndices, crnlib::vector<uint>& remap_table, zeng_similarity_func pFunc, void* pContext, float similarity_func_weight)
+   {
+      CRNLIB_ASSERT((n > 0) && (num_indices > 0));
+      CRNLIB_ASSERT_CLOSED_RANGE(similarity_func_weight, 0.0f, 1.0f);
+
+      remap_table.clear();
+      remap_table.resize(n);
 
-      crnlib::vector<uint16> values_chosen; 
+      if (num_indices <= 1)
+         return;
+
+      zeng_hist hist;
+      hist.init(n, num_indices, pIndices);
+
+      uint x, y;
+      hist.find_most_frequent_pair(x, y);
+
+      crnlib::vector<uint16> values_chosen;
       values_chosen.reserve(n);
-      
+
       values_chosen.push_back(static_cast<uint16>(x));
       values_chosen.push_back(static_cast<uint16>(y));
 
+      // Each chosen value's position in values_chosen is its slot minus the front value's slot.
+      crnlib::vector<int> chosen_slot(n);
+      chosen_slot.set_all(INT_MIN);
+      chosen_slot[x] = 0;
+      chosen_slot[y] = 1;
+      int front_slot = 0;
+
       crnlib::vector<uint16> values_remaining;
       if (n > 2)
          values_remaining.reserve(n - 2);
@@ -122,114 +170,122 @@ namespace crnlib
             values_remaining.push_back(static_cast<uint16>(i));
 
       crnlib::vector<uint> total_freq_to_chosen_values(n);
-      for (uint i = 0; i < values_remaining.size(); i++)
+      for (uint c = 0; c < ((x != y) ? 2U : 1U); c++)
       {
-         uint u = values_remaining[i];
+         const uint l = c ? y : x;
 
-         uint total_freq = 0;
+         const zeng_hist::edge* pEdges = hist.get_edges(l);
+         for (uint k = hist.get_num_edges(l); k; k--, pEdges++)
+            if (chosen_slot[pEdges->m_index] == INT_MIN)
+               total_freq_to_chosen_values[pEdges->m_index] += pEdges->m_freq;
+      }
 
-         for (uint j = 0; j < values_chosen.size(); j++)
-         {
-            uint l = values_chosen[j];
+      // The similarity of each remaining value to the front and back chosen values, only recomputed when that end changes.
+      crnlib::vector<float> front_similarity, back_similarity;
+      if (pFunc)
+      {
+         front_similarity.resize(n);
+         back_similarity.resize(n);
 
-            total_freq += read_hist(xhist, u, l, n); //[u * n + l];
+         for (uint i = 0; i < values_remaining.size(); i++)
+         {
+            const uint u = values_remaining[i];
+            front_similarity[u] = (*pFunc)(u, values_chosen.front(), pContext);
+            back_similarity[u] = (*pFunc)(u, values_chosen.back(), pContext);
          }
-
-         total_freq_to_chosen_values[u] = total_freq;
       }
 
       while (!values_remaining.empty())
       {
          double best_freq = 0;
          uint best_i = 0;
-         
+
          for (uint i = 0; i < values_remaining.size(); i++)
          {
             uint u = values_remaining[i];
 
-   #if 0
-            double total_freq = 0;
-
-            for (uint j = 0; j < values_chosen.size(); j++)
-            {
-               uint l = values_chosen[j];
-
-               total_freq += read_hist(xhist, u, l, n); //[u * n + l];
-            }
-
-            CRNLIB_ASSERT(total_freq_to_chosen_values[u] == total_freq);
-   #else
             double total_freq = total_freq_to_chosen_values[u];
-   #endif         
-   
+
             if (pFunc)
             {
-               float weight = math::maximum<float>(
-                  (*pFunc)(u, values_chosen.front(), pContext), 
-                  (*pFunc)(u, values_chosen.back(), pContext) );
-                  
+               float weight = math::maximum<float>(front_similarity[u], back_similarity[u]);
+
                CRNLIB_ASSERT_CLOSED_RANGE(weight, 0.0f, 1.0f);
-               
+
                weight = math::lerp(1.0f - similarity_func_weight, 1.0f + similarity_func_weight, weight);
-                                          
+
                total_freq = (total_freq + 1.0f) * weight;
             }
-            
+
             if (total_freq > best_freq)
             {
                best_freq = total_freq;
-               best_i = i;  
-            }            
+               best_i = i;
+            }
          }
 
          const uint u = values_remaining[best_i];
 
-         float side = 0;
-         int left_freq = 0;
-         int right_freq = 0;
+         int64 left_freq = 0;
+         int64 right_freq = 0;
 
-         for (uint j = 0; j < values_chosen.size(); j++)
+         const zeng_hist::edge* pEdges = hist.get_edges(u);
+         for (uint k = hist.get_num_edges(u); k; k--, pEdges++)
          {
-            const uint l = values_chosen[j];
-
-            int freq = read_hist(xhist, u, l, n); //[u * n + l];
-            int scale = (values_chosen.size() + 1 - 2 * (j + 1));
+            const int slot = chosen_slot[pEdges->m_index];
+            if (slot == INT_MIN)
+               continue;
 
-            side = side + (float)(scale * freq);
+            const int j = slot - front_slot;
+            const int scale = values_chosen.size() + 1 - 2 * (j + 1);
 
             if (scale < 0)
-               right_freq += -scale * freq;
+               right_freq += -scale * (int64)pEdges->m_freq;
             else
-               left_freq += scale * freq;
+               left_freq += scale * (int64)pEdges->m_freq;
          }
 
+         float side = (float)(left_freq - right_freq);
+
          if (pFunc)
          {
-            float weight_left = (*pFunc)(u, values_chosen.front(), pContext);
-            float weight_right = (*pFunc)(u, values_chosen.back(), pContext);
-            
+            float weight_left = front_similarity[u];
+            float weight_right = back_similarity[u];
+
             weight_left = math::lerp(1.0f - similarity_func_weight, 1.0f + similarity_func_weight, weight_left);
             weight_right = math::lerp(1.0f - similarity_func_weight, 1.0f + similarity_func_weight, weight_right);
-            
+
             side = weight_left * left_freq - weight_right * right_freq;
          }
 
-         if (side > 0)
+         const bool at_front = side > 0;
+         if (at_front)
+         {
             values_chosen.push_front(static_cast<uint16>(u));
+            chosen_slot[u] = --front_slot;
+         }
          else
+         {
+            chosen_slot[u] = front_slot + values_chosen.size();
             values_chosen.push_back(static_cast<uint16>(u));
+         }
 
          values_remaining.erase(values_remaining.begin() + best_i);
 
-         for (uint i = 0; i < values_remaining.size(); i++)
-         {
-            const uint r = values_remaining[i];
+         pEdges = hist.get_edges(u);
+         for (uint k = hist.get_num_edges(u); k; k--, pEdges++)
+            if (chosen_slot[pEdges->m_index] == INT_MIN)
+               total_freq_to_chosen_values[pEdges->m_index] += pEdges->m_freq;
 
-            total_freq_to_chosen_values[r] += read_hist(xhist, r, u, n); //[r * n + u];
+         if (pFunc)
+         {
+            crnlib::vector<float>& similarity = at_front ? front_similarity : back_similarity;
+            for (uint i = 0; i < values_remaining.size(); i++)
+               similarity[values_remaining[i]] = (*pFunc)(values_remaining[i], u, pContext);
          }
       }
 
-      for (uint i = 0; i < n; i++)   
+      for (uint i = 0; i < n; i++)
       {
          uint v = values_chosen[i];
          remap_table[v] = i;
@@ -280,9 +336,7 @@ namespace crnlib
          after_sum = sum;
       }      
       printf("Before sum: %u, After sum: %u\n", before_sum, after_sum);
-   #endif   
-   
-//      printf("create_zeng_reorder_table end:\n");
+   #endif
    }
 
 } // namespace crnlib
@@ -13,6 +13,7 @@
 #include "../inc/crn_decomp.h"
 
 #include "crn_rg_etc1.h"
+#include "crn_cpu_features.h"
 
 namespace crnlib
 {
@@ -33,6 +34,8 @@ namespace crnlib
    public:
       crnlib_global_initializer()
       {
+         cpu_features::init();
+
          crn_threading_init();
          
          crnlib_enable_fail_exceptions(true);
@@ -199,6 +202,162 @@ void *crn_compress(const crn_comp_params &comp_params, const crn_mipmap_params &
    return crn_file_data.assume_ownership();
 }
 
+bool crn_compress_quality_levels(const crn_comp_params &comp_params, const crn_uint32 *pQuality_levels, crn_uint32 num_quality_levels, void **ppCompressed_data, crn_uint32 *pCompressed_sizes)
+{
+   for (crn_uint32 i = 0; i < num_quality_levels; i++)
+   {
+      ppCompressed_data[i] = NULL;
+      pCompressed_sizes[i] = 0;
+   }
+
+   if ((!comp_params.check()) || (!num_quality_levels))
+      return false;
+
+   for (crn_uint32 i = 0; i < num_quality_levels; i++)
+      if (pQuality_levels[i] > cCRNMaxQualityLevel)
+         return false;
+
+   crnlib::vector< crnlib::vector<uint8> > comp_data(num_quality_levels);
+   if (!create_compressed_textures(comp_params, pQuality_levels, num_quality_levels, comp_data.get_ptr()))
+      return false;
+
+   for (crn_uint32 i = 0; i < num_quality_levels; i++)
+   {
+      pCompressed_sizes[i] = comp_data[i].size();
+      ppCompressed_data[i] = comp_data[i].assume_ownership();
+   }
+
+   return true;
+}
+
+// Batch compression API.
+
+namespace crnlib
+{
+   class crn_compressor
+   {
+      CRNLIB_NO_COPY_OR_ASSIGNMENT_OP(crn_compressor);
+
+   public:
+      crn_compressor()
+      {
+      }
+
+      bool init(crn_uint32 num_helper_threads)
+      {
+         crn_comp_params params;
+         params.m_num_helper_threads = num_helper_threads;
+
+         return m_task_pool.init(get_num_helper_threads(params));
+      }
+
+      bool add(const crn_comp_params &comp_params, const crn_mipmap_params *pMip_params, void **ppCompressed_data, crn_uint32 *pCompressed_size)
+      {
+         *ppCompressed_data = NULL;
+         *pCompressed_size = 0;
+
+         if ((!comp_params.check()) || ((pMip_params) && (!pMip_params->check())))
+            return false;
+
+         job* pJob = m_jobs.enlarge(1);
+         pJob->m_comp_params = comp_params;
+         pJob->m_comp_params.m_num_helper_threads = 0;
+         if (pMip_params)
+            pJob->m_mip_params = *pMip_params;
+         pJob->m_has_mip_params = pMip_params != NULL;
+         pJob->m_ppCompressed_data = ppCompressed_data;
+         pJob->m_pCompressed_size = pCompressed_size;
+         pJob->m_status = false;
+
+         return true;
+      }
+
+      bool flush()
+      {
+         // Start with the largest textures, so a big one queued last doesn't leave the other threads idle at the end.
+         crnlib::vector< std::pair<uint, uint> > order(m_jobs.size());
+         for (uint i = 0; i < m_jobs.size(); i++)
+         {
+            const crn_comp_params &params = m_jobs[i].m_comp_params;
+            order[i] = std::make_pair(UINT_MAX - params.m_width * params.m_height * params.m_faces, i);
+         }
+         std::sort(order.begin(), order.end());
+
+         for (uint i = 0; i < order.size(); i++)
+            m_task_pool.queue_task(compress_job, order[i].second, m_jobs.get_ptr());
+         m_task_pool.join();
+
+         bool status = true;
+         for (uint i = 0; i < m_jobs.size(); i++)
+            status = status && m_jobs[i].m_status;
+
+         m_jobs.clear();
+
+         return status;
+      }
+
+   private:
+      struct job
+      {
+         crn_comp_params m_comp_params;
+         crn_mipmap_params m_mip_params;
+         bool m_has_mip_params;
+         void **m_ppCompressed_data;
+         crn_uint32 *m_pCompressed_size;
+         bool m_status;
+      };
+
+      crnlib::vector<job> m_jobs;
+      task_pool m_task_pool;
+
+      static void compress_job(uint64 data, void *pData_ptr)
+      {
+         job &j = static_cast<job *>(pData_ptr)[data];
+
+         crnlib::vector<uint8> crn_file_data;
+         if (j.m_has_mip_params)
+            j.m_status = create_compressed_texture(j.m_comp_params, j.m_mip_params, crn_file_data, NULL, NULL);
+         else
+            j.m_status = create_compressed_texture(j.m_comp_params, crn_file_data, NULL, NULL);
+
+         if (j.m_status)
+         {
+            *j.m_pCompressed_size = crn_file_data.size();
+            *j.m_ppCompressed_data = crn_file_data.assume_ownership();
+         }
+      }
+   };
+}
+
+crn_compressor_context_t crn_create_compressor(crn_uint32 num_helper_threads)
+{
+   crn_compressor *pComp = crnlib_new<crn_compressor>();
+   if (!pComp)
+      return NULL;
+
+   if (!pComp->init(num_helper_threads))
+   {
+      crnlib_delete(pComp);
+      return NULL;
+   }
+   return pComp;
+}
+
+bool crn_compressor_add(crn_compressor_context_t pContext, const crn_comp_params &comp_params, const crn_mipmap_params *pMip_params, void **ppCompressed_data, crn_uint32 *pCompressed_size)
+{
+   return static_cast<crn_compressor *>(pContext)->add(comp_params, pMip_params, ppCompressed_data, pCompressed_size);
+}
+
+bool crn_compressor_flush(crn_compressor_context_t pContext)
+{
+   return static_cast<crn_compressor *>(pContext)->flush();
+}
+
+void crn_free_compressor(crn_compressor_context_t pContext)
+{
+   crnlib_delete(static_cast<crn_compressor *>(pContext));
+}
+
 void *crn_decompress_crn_to_dds(const void *pCRN_file_data, crn_uint32 &file_size)
 {
    mipmapped_texture tex;
@@ -4,10 +4,14 @@ Igor Pavlov
 Public domain */
 #include "crn_core.h"
 #include "lzma_Threads.h"
+#ifdef _WIN32
 #include <process.h>
+#endif
 
 namespace crnlib {
 
+#ifdef _WIN32
+
 static WRes GetError()
 {
   DWORD res = GetLastError();
@@ -113,4 +117,164 @@ WRes CriticalSection_Init(CCriticalSection *p)
   return 0;
 }
 
+#else
+
+static void *ThreadStartAddress(void *p)
+{
+  CThread *thread = (CThread *)p;
+  thread->startAddress(thread->parameter);
+  return NULL;
+}
+
+WRes Thread_Create(CThread *thread, THREAD_FUNC_RET_TYPE (THREAD_FUNC_CALL_TYPE *startAddress)(void *), void *parameter)
+{
+  thread->startAddress = startAddress;
+  thread->parameter = parameter;
+  WRes res = pthread_create(&thread->thread, NULL, ThreadStartAddress, thread);
+  thread->created = (res == 0);
+  return res;
+}
+
+WRes Thread_Wait(CThread *thread)
+{
+  if (!thread->created)
+    return 1;
+  return pthread_join(thread->thread, NULL);
+}
+
+/* pthread_join() already released the thread. */
+WRes Thread_Close(CThread *thread)
+{
+  thread->created = 0;
+  return 0;
+}
+
+static WRes Event_Create(CEvent *p, int manualReset, int initialSignaled)
+{
+  WRes res = pthread_mutex_init(&p->mutex, NULL);
+  if (res != 0)
+    return res;
+  res = pthread_cond_init(&p->cond, NULL);
+  if (res != 0)
+  {
+    pthread_mutex_destroy(&p->mutex);
+    return res;
+  }
+  p->manualReset = manualReset;
+  p->signaled = (initialSignaled != 0);
+  p->created = 1;
+  return 0;
+}
+
+WRes ManualResetEvent_Create(CManualResetEvent *p, int initialSignaled)
+  { return Event_Create(p, 1, initialSignaled); }
+WRes ManualResetEvent_CreateNotSignaled(CManualResetEvent *p)
+  { return ManualResetEvent_Create(p, 0); }
+
+WRes AutoResetEvent_Create(CAutoResetEvent *p, int initialSignaled)
+  { return Event_Create(p, 0, initialSignaled); }
+WRes AutoResetEvent_CreateNotSignaled(CAutoResetEvent *p)
+  { return AutoResetEvent_Create(p, 0); }
+
+WRes Event_Set(CEvent *p)
+{
+  pthread_mutex_lock(&p->mutex);
+  p->signaled = 1;
+  if (p->manualReset)
+    pthread_cond_broadcast(&p->cond);
+  else
+    pthread_cond_signal(&p->cond);
+  pthread_mutex_unlock(&p->mutex);
+  return 0;
+}
+
+WRes Event_Reset(CEvent *p)
+{
+  pthread_mutex_lock(&p->mutex);
+  p->signaled = 0;
+  pthread_mutex_unlock(&p->mutex);
+  return 0;
+}
+
+WRes Event_Wait(CEvent *p)
+{
+  pthread_mutex_lock(&p->mutex);
+  while (!p->signaled)
+    pthread_cond_wait(&p->cond, &p->mutex);
+  if (!p->manualReset)
+    p->signaled = 0;
+  pthread_mutex_unlock(&p->mutex);
+  return 0;
+}
+
+WRes Event_Close(CEvent *p)
+{
+  if (!p->created)
+    return 0;
+  p->created = 0;
+  pthread_cond_destroy(&p->cond);
+  return pthread_mutex_destroy(&p->mutex);
+}
+
+WRes Semaphore_Create(CSemaphore *p, UInt32 initiallyCount, UInt32 maxCount)
+{
+  WRes res = pthread_mutex_init(&p->mutex, NULL);
+  if (res != 0)
+    return res;
+  res = pthread_cond_init(&p->cond, NULL);
+  if (res != 0)
+  {
+    pthread_mutex_destroy(&p->mutex);
+    return res;
+  }
+  p->count = initiallyCount;
+  p->maxCount = maxCount;
+  p->created = 1;
+  return 0;
+}
+
+WRes Semaphore_ReleaseN(CSemaphore *p, UInt32 releaseCount)
+{
+  pthread_mutex_lock(&p->mutex);
+  if ((p->count + releaseCount > p->maxCount) || (p->count + releaseCount < p->count))
+  {
+    pthread_mutex_unlock(&p->mutex);
+    return 1;
+  }
+  p->count += releaseCount;
+  pthread_cond_broadcast(&p->cond);
+  pthread_mutex_unlock(&p->mutex);
+  return 0;
+}
+WRes Semaphore_Release1(CSemaphore *p)
+{
+  return Semaphore_ReleaseN(p, 1);
+}
+
+WRes Semaphore_Wait(CSemaphore *p)
+{
+  pthread_mutex_lock(&p->mutex);
+  while (!p->count)
+    pthread_cond_wait(&p->cond, &p->mutex);
+  p->count--;
+  pthread_mutex_unlock(&p->mutex);
+  return 0;
+}
+
+WRes Semaphore_Close(CSemaphore *p)
+{
+  if (!p->created)
+    return 0;
+  p->created = 0;
+  pthread_cond_destroy(&p->cond);
+  return pthread_mutex_destroy(&p->mutex);
+}
+
+WRes CriticalSection_Init(CCriticalSection *p)
+{
+  return pthread_mutex_init(p, NULL);
+}
+
+#endif
+
 }
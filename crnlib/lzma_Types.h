@@ -9,6 +9,9 @@
 #if defined( _WIN32 )
 #include <windows.h>
 #define COMPRESS_MF_MT
+#elif CRNLIB_USE_PTHREADS_API
+/* lzma_Threads.cpp implements the match finder's threads with pthreads. */
+#define COMPRESS_MF_MT
 #endif
 
 namespace crnlib {
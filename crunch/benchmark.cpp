@@ -0,0 +1,1556 @@
+// File: benchmark.cpp
+// This software is in the public domain. Please see license.txt.
+#include "crn_core.h"
+#include "benchmark.h"
+#include "crn_find_files.h"
+#include "crn_console.h"
+#include "crn_cfile_stream.h"
+#include "crn_timer.h"
+#include "crn_dxt_image.h"
+#include "crn_pixel_format.h"
+#include "crn_threading.h"
+#include "crn_image_utils.h"
+#include "crn_comp.h"
+#include "crn_zeng.h"
+#include "crn_rand.h"
+#include "crn_cpu_features.h"
+#include "crn_rg_etc1.h"
+#include "crn_mipmapped_texture.h"
+#include "crn_lzma_codec.h"
+#include <malloc.h>
+
+#if !CRNLIB_USE_WIN32_API
+#define _msize malloc_usable_size
+#endif
+
+#define CRND_HEADER_FILE_ONLY
+#include "crn_decomp.h"
+
+namespace crnlib
+{
+   benchmark::benchmark() :
+      m_iters(10),
+      m_max_threads(1)
+   {
+   }
+
+   bool benchmark::run(const char* pCmd_line)
+   {
+      console::printf("Command line:\n\"%s\"", pCmd_line);
+
+      static const command_line_params::param_desc param_desc_array[] =
+      {
+         { "benchmark", 0, false },
+         { "suite", 1, false },
+         { "in", 1, true },
+         { "deep", 0, false },
+         { "iters", 1, false },
+         { "threads", 1, false },
+      };
+
+      command_line_params cmd_line_params;
+      if (!cmd_line_params.parse(pCmd_line, CRNLIB_ARRAY_SIZE(param_desc_array), param_desc_array, true))
+         return false;
+
+      m_iters = cmd_line_params.get_value_as_int("iters", 0, 10, 1, 100000);
+      m_max_threads = cmd_line_params.get_value_as_int("threads", 0, g_number_of_processors, 1, cCRNMaxHelperThreads + 1);
+
+      dynamic_string_array files;
+
+      command_line_params::param_map_const_iterator it = cmd_line_params.begin();
+      for ( ; it != cmd_line_params.end(); ++it)
+      {
+         if (it->first != "in")
+            continue;
+         if (it->second.m_values.empty())
+         {
+            console::error("Must follow /in parameter with a filename!\n");
+            return false;
+         }
+
+         for (uint in_value_index = 0; in_value_index < it->second.m_values.size(); in_value_index++)
+         {
+            const dynamic_string& filespec = it->second.m_values[in_value_index];
+
+            find_files file_finder;
+            if (!file_finder.find(filespec.get_ptr(), find_files::cFlagAllowFiles | (cmd_line_params.has_key("deep") ? find_files::cFlagRecursive : 0)))
+            {
+               console::warning("Failed finding files: %s", filespec.get_ptr());
+               continue;
+            }
+
+            for (uint i = 0; i < file_finder.get_files().size(); i++)
+               files.push_back(file_finder.get_files()[i].m_fullname);
+         }
+      }
+
+      dynamic_string suite(cmd_line_params.get_value_as_string_or_empty("suite"));
+      if (suite.is_empty())
+      {
+         console::error("Must specify a benchmark suite with /suite!");
+         return false;
+      }
+
+      console::printf("Suite: %s, Files: %u, Iterations: %u", suite.get_ptr(), files.size(), m_iters);
+
+      if (suite == "transcode")
+         return transcode(files);
+      else if (suite == "region")
+         return region(files);
+      else if (suite == "rgba")
+         return rgba(files);
+      else if (suite == "tasks")
+         return tasks();
+      else if (suite == "zeng")
+         return zeng();
+      else if (suite == "scaling")
+         return scaling(files);
+      else if (suite == "sweep")
+         return sweep(files);
+      else if (suite == "batch")
+         return batch(files);
+      else if (suite == "dxt1")
+         return dxt1(files);
+      else if (suite == "etc1")
+         return etc1(files);
+      else if (suite == "io")
+         return io(files);
+      else if (suite == "lzmaest")
+         return lzmaest(files);
+
+      console::error("Unknown benchmark suite: %s", suite.get_ptr());
+      return false;
+   }
+
+   // Measures crnd_unpack_level() throughput over every level of each .CRN file.
+   bool benchmark::transcode(const dynamic_string_array& files)
+   {
+      if (files.empty())
+      {
+         console::error("The transcode suite requires one or more .CRN files!");
+         return false;
+      }
+
+      uint64 total_crn_bytes = 0;
+      uint64 total_dxt_bytes = 0;
+      double total_time = 0.0f;
+
+      for (uint file_index = 0; file_index < files.size(); file_index++)
+      {
+         const char* pFilename = files[file_index].get_ptr();
+
+         vector<uint8> crn_bytes;
+         if (!cfile_stream::read_file_into_array(pFilename, crn_bytes) || crn_bytes.empty())
+         {
+            console::warning("Failed reading file: %s", pFilename);
+            continue;
+         }
+
+         crnd::crn_texture_info tex_info;
+         if (!crnd::crnd_get_texture_info(crn_bytes.get_ptr(), crn_bytes.size(), &tex_info))
+         {
+            console::warning("Not a valid .CRN file: %s", pFilename);
+            continue;
+         }
+
+         crnd::crnd_unpack_context pContext = crnd::crnd_unpack_begin(crn_bytes.get_ptr(), crn_bytes.size());
+         if (!pContext)
+         {
+            console::warning("crnd_unpack_begin() failed: %s", pFilename);
+            continue;
+         }
+
+         const uint bytes_per_block = crnd::crnd_get_bytes_per_dxt_block(tex_info.m_format);
+
+         vector<uint8> level_data[cCRNMaxLevels][cCRNMaxFaces];
+         uint level_size[cCRNMaxLevels];
+         uint dxt_bytes = 0;
+         for (uint level_index = 0; level_index < tex_info.m_levels; level_index++)
+         {
+            const uint width = math::maximum(1U, tex_info.m_width >> level_index);
+            const uint height = math::maximum(1U, tex_info.m_height >> level_index);
+            level_size[level_index] = ((width + 3) >> 2) * ((height + 3) >> 2) * bytes_per_block;
+
+            for (uint face_index = 0; face_index < tex_info.m_faces; face_index++)
+               level_data[level_index][face_index].resize(level_size[level_index]);
+
+            dxt_bytes += level_size[level_index] * tex_info.m_faces;
+         }
+
+         bool success = true;
+         double file_time = 0.0f;
+
+         // The first pass warms up the caches and isn't timed.
+         for (uint iter = 0; (iter <= m_iters) && (success); iter++)
+         {
+            timer tm;
+            tm.start();
+
+            for (uint level_index = 0; level_index < tex_info.m_levels; level_index++)
+            {
+               void* pFaces[cCRNMaxFaces];
+               for (uint face_index = 0; face_index < tex_info.m_faces; face_index++)
+                  pFaces[face_index] = level_data[level_index][face_index].get_ptr();
+
+               if (!crnd::crnd_unpack_level(pContext, pFaces, level_size[level_index], 0, level_index))
+               {
+                  console::warning("crnd_unpack_level() failed: %s", pFilename);
+                  success = false;
+                  break;
+               }
+            }
+
+            if (iter)
+               file_time += tm.get_elapsed_secs();
+         }
+
+         crnd::crnd_unpack_end(pContext);
+
+         if (!success)
+            continue;
+
+         file_time /= m_iters;
+
+         console::printf("%s: %ux%u, %u levels, %u faces: %3.3f ms, %3.1f MB/sec CRN, %3.1f MB/sec DXT",
+            pFilename, tex_info.m_width, tex_info.m_height, tex_info.m_levels, tex_info.m_faces,
+            file_time * 1000.0f, crn_bytes.size() / (1024.0f * 1024.0f * file_time), dxt_bytes / (1024.0f * 1024.0f * file_time));
+
+         total_crn_bytes += crn_bytes.size();
+         total_dxt_bytes += dxt_bytes;
+         total_time += file_time;
+      }
+
+      if (total_time <= 0.0f)
+         return false;
+
+      console::printf("Total: %3.3f ms, %3.1f MB/sec CRN, %3.1f MB/sec DXT",
+         total_time * 1000.0f, total_crn_bytes / (1024.0f * 1024.0f * total_time), total_dxt_bytes / (1024.0f * 1024.0f * total_time));
+
+      return true;
+   }
+
+   // Compares crnd_unpack_region() against crnd_unpack_level() when only a small rectangle near the bottom of the last face is needed.
+   // The rectangle is also checked against the corresponding blocks of the full level.
+   bool benchmark::region(const dynamic_string_array& files)
+   {
+      if (files.empty())
+      {
+         console::error("The region suite requires one or more .CRN files!");
+         return false;
+      }
+
+      bool all_succeeded = true;
+
+      for (uint file_index = 0; file_index < files.size(); file_index++)
+      {
+         const char* pFilename = files[file_index].get_ptr();
+
+         vector<uint8> crn_bytes;
+         if (!cfile_stream::read_file_into_array(pFilename, crn_bytes) || crn_bytes.empty())
+         {
+            console::warning("Failed reading file: %s", pFilename);
+            continue;
+         }
+
+         crnd::crn_texture_info tex_info;
+         if (!crnd::crnd_get_texture_info(crn_bytes.get_ptr(), crn_bytes.size(), &tex_info))
+         {
+            console::warning("Not a valid .CRN file: %s", pFilename);
+            continue;
+         }
+
+         crnd::crnd_unpack_context pContext = crnd::crnd_unpack_begin(crn_bytes.get_ptr(), crn_bytes.size());
+         if (!pContext)
+         {
+            console::warning("crnd_unpack_begin() failed: %s", pFilename);
+            continue;
+         }
+
+         const uint bytes_per_block = crnd::crnd_get_bytes_per_dxt_block(tex_info.m_format);
+         const uint blocks_x = (tex_info.m_width + 3) >> 2;
+         const uint blocks_y = (tex_info.m_height + 3) >> 2;
+         const uint level_size = blocks_x * blocks_y * bytes_per_block;
+         const uint face_index = tex_info.m_faces - 1;
+
+         const uint region_w = math::minimum(blocks_x, 8U);
+         const uint region_h = math::minimum(blocks_y, 8U);
+         const uint region_x = (blocks_x - region_w) / 2;
+         const uint region_y = blocks_y - region_h;
+         const uint region_pitch = region_w * bytes_per_block;
+
+         vector<uint8> level_data[cCRNMaxFaces];
+         void* pFaces[cCRNMaxFaces];
+         for (uint i = 0; i < tex_info.m_faces; i++)
+         {
+            level_data[i].resize(level_size);
+            pFaces[i] = level_data[i].get_ptr();
+         }
+
+         vector<uint8> region_data(region_pitch * region_h);
+
+         bool success = true;
+         double level_time = 0.0f, region_time = 0.0f;
+
+         for (uint iter = 0; (iter <= m_iters) && (success); iter++)
+         {
+            timer tm;
+            tm.start();
+            success = crnd::crnd_unpack_level(pContext, pFaces, level_size, 0, 0);
+            if (iter)
+               level_time += tm.get_elapsed_secs();
+
+            tm.start();
+            success = success && crnd::crnd_unpack_region(pContext, region_data.get_ptr(), region_data.size(), 0, 0, face_index, region_x, region_y, region_w, region_h);
+            if (iter)
+               region_time += tm.get_elapsed_secs();
+         }
+
+         crnd::crnd_unpack_end(pContext);
+
+         if (!success)
+         {
+            console::warning("Unpacking failed: %s", pFilename);
+            all_succeeded = false;
+            continue;
+         }
+
+         for (uint y = 0; y < region_h; y++)
+         {
+            if (memcmp(&region_data[y * region_pitch], &level_data[face_index][((region_y + y) * blocks_x + region_x) * bytes_per_block], region_pitch) != 0)
+            {
+               console::error("crnd_unpack_region() output doesn't match crnd_unpack_level(): %s", pFilename);
+               all_succeeded = false;
+               break;
+            }
+         }
+
+         level_time /= m_iters;
+         region_time /= m_iters;
+
+         console::printf("%s: %ux%u, %u faces, %ux%u blocks at (%u,%u): level %3.3f ms, region %3.3f ms",
+            pFilename, tex_info.m_width, tex_info.m_height, tex_info.m_faces, region_w, region_h, region_x, region_y,
+            level_time * 1000.0f, region_time * 1000.0f);
+      }
+
+      return all_succeeded;
+   }
+
+   // Compares crnd_unpack_level_rgba() against transcoding to DXT with crnd_unpack_level() and then decoding with dxt_image::unpack(),
+   // over every level and face of each .CRN file. The pixels of both paths must match.
+   bool benchmark::rgba(const dynamic_string_array& files)
+   {
+      if (files.empty())
+      {
+         console::error("The rgba suite requires one or more .CRN files!");
+         return false;
+      }
+
+      bool all_succeeded = true;
+      double total_dxt_time = 0.0f, total_rgba_time = 0.0f;
+      uint64 total_pixels = 0;
+
+      for (uint file_index = 0; file_index < files.size(); file_index++)
+      {
+         const char* pFilename = files[file_index].get_ptr();
+
+         vector<uint8> crn_bytes;
+         if (!cfile_stream::read_file_into_array(pFilename, crn_bytes) || crn_bytes.empty())
+         {
+            console::warning("Failed reading file: %s", pFilename);
+            continue;
+         }
+
+         crnd::crn_texture_info tex_info;
+         if (!crnd::crnd_get_texture_info(crn_bytes.get_ptr(), crn_bytes.size(), &tex_info))
+         {
+            console::warning("Not a valid .CRN file: %s", pFilename);
+            continue;
+         }
+
+         crnd::crnd_unpack_context pContext = crnd::crnd_unpack_begin(crn_bytes.get_ptr(), crn_bytes.size());
+         if (!pContext)
+         {
+            console::warning("crnd_unpack_begin() failed: %s", pFilename);
+            continue;
+         }
+
+         const dxt_format dxt_fmt = pixel_format_helpers::get_dxt_format(pixel_format_helpers::convert_crn_format_to_pixel_format(tex_info.m_format));
+         const uint bytes_per_block = crnd::crnd_get_bytes_per_dxt_block(tex_info.m_format);
+
+         bool success = true;
+         double dxt_time = 0.0f, rgba_time = 0.0f;
+         uint pixels = 0;
+
+         for (uint level_index = 0; (level_index < tex_info.m_levels) && (success); level_index++)
+         {
+            const uint width = math::maximum(1U, tex_info.m_width >> level_index);
+            const uint height = math::maximum(1U, tex_info.m_height >> level_index);
+            const uint dxt_size = ((width + 3) >> 2) * ((height + 3) >> 2) * bytes_per_block;
+            const uint rgba_size = width * height * sizeof(uint32);
+            pixels += width * height * tex_info.m_faces;
+
+            vector<uint8> dxt_data[cCRNMaxFaces], rgba_data[cCRNMaxFaces];
+            dxt_image dxt_images[cCRNMaxFaces];
+            image_u8 images[cCRNMaxFaces];
+            void* pDXT_faces[cCRNMaxFaces];
+            void* pRGBA_faces[cCRNMaxFaces];
+            for (uint face_index = 0; face_index < tex_info.m_faces; face_index++)
+            {
+               dxt_data[face_index].resize(dxt_size);
+               rgba_data[face_index].resize(rgba_size);
+               pDXT_faces[face_index] = dxt_data[face_index].get_ptr();
+               pRGBA_faces[face_index] = rgba_data[face_index].get_ptr();
+               dxt_images[face_index].init(dxt_fmt, width, height, false);
+            }
+
+            // The first pass warms up the caches and isn't timed.
+            for (uint iter = 0; (iter <= m_iters) && (success); iter++)
+            {
+               timer tm;
+               tm.start();
+               success = crnd::crnd_unpack_level(pContext, pDXT_faces, dxt_size, 0, level_index);
+               for (uint face_index = 0; (face_index < tex_info.m_faces) && (success); face_index++)
+               {
+                  memcpy(&dxt_images[face_index].get_element_vec()[0], dxt_data[face_index].get_ptr(), dxt_size);
+                  success = dxt_images[face_index].unpack(images[face_index]);
+               }
+               if (iter)
+                  dxt_time += tm.get_elapsed_secs();
+
+               tm.start();
+               success = success && crnd::crnd_unpack_level_rgba(pContext, pRGBA_faces, rgba_size, 0, level_index);
+               if (iter)
+                  rgba_time += tm.get_elapsed_secs();
+            }
+
+            for (uint face_index = 0; (face_index < tex_info.m_faces) && (success); face_index++)
+            {
+               for (uint y = 0; y < height; y++)
+               {
+                  if (memcmp(&rgba_data[face_index][y * width * sizeof(uint32)], images[face_index].get_scanline(y), width * sizeof(uint32)) != 0)
+                  {
+                     console::error("crnd_unpack_level_rgba() output doesn't match the DXT decode of level %u face %u: %s", level_index, face_index, pFilename);
+                     all_succeeded = false;
+                     break;
+                  }
+               }
+            }
+         }
+
+         crnd::crnd_unpack_end(pContext);
+
+         if (!success)
+         {
+            console::warning("Unpacking failed: %s", pFilename);
+            all_succeeded = false;
+            continue;
+         }
+
+         dxt_time /= m_iters;
+         rgba_time /= m_iters;
+
+         console::printf("%s: %ux%u, %u levels, %u faces: DXT+decode %3.3f ms, RGBA %3.3f ms, %3.1f MPixels/sec",
+            pFilename, tex_info.m_width, tex_info.m_height, tex_info.m_levels, tex_info.m_faces,
+            dxt_time * 1000.0f, rgba_time * 1000.0f, pixels / (1000000.0f * rgba_time));
+
+         total_dxt_time += dxt_time;
+         total_rgba_time += rgba_time;
+         total_pixels += pixels;
+      }
+
+      if (total_rgba_time <= 0.0f)
+         return false;
+
+      console::printf("Total: DXT+decode %3.3f ms, RGBA %3.3f ms, %3.1f MPixels/sec",
+         total_dxt_time * 1000.0f, total_rgba_time * 1000.0f, total_pixels / (1000000.0f * total_rgba_time));
+
+      return all_succeeded;
+   }
+
+   namespace
+   {
+      // Near-empty tasks, so the timings are dominated by task_pool's queueing and scheduling overhead.
+      class task_dispatch_test
+      {
+      public:
+         task_dispatch_test(task_pool& tp) : m_pTask_pool(&tp), m_total(0) { }
+
+         void empty_task(uint64 data, void* pData_ptr)
+         {
+            data, pData_ptr;
+            atomic_increment32(&m_total);
+         }
+
+         // Spawns data subtasks and waits for them, like a codebook task splitting up its work.
+         void nested_task(uint64 data, void* pData_ptr)
+         {
+            pData_ptr;
+            for (uint i = 0; i < data; i++)
+               m_pTask_pool->queue_object_task(this, &task_dispatch_test::empty_task);
+            m_pTask_pool->join();
+            atomic_increment32(&m_total);
+         }
+
+         task_pool* m_pTask_pool;
+         volatile atomic32_t m_total;
+      };
+   }
+
+   // Measures task_pool dispatch throughput with flat batches of tasks queued from the calling thread (the pattern crn_comp and dxt_hc use),
+   // with tasks that spawn and join their own subtasks, and with a single burst of far more tasks than the deques start out holding.
+   bool benchmark::tasks()
+   {
+      const uint cBatchSize = 64;
+      const uint cNumBatches = 1024;
+      const uint cNumSubtasks = 16;
+      const uint cBurstSize = 65536;
+
+      const uint max_threads = math::maximum(16U, m_max_threads);
+
+#if CRNLIB_USE_WIN32_API
+      // The Win32 task_pool doesn't support joining from within a task.
+      const bool test_nested = false;
+#else
+      const bool test_nested = true;
+#endif
+
+      for (uint num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+      {
+         task_pool tp;
+         if (!tp.init(num_threads))
+         {
+            console::error("Failed initializing task pool with %u threads!", num_threads);
+            return false;
+         }
+
+         task_dispatch_test test(tp);
+         double flat_time = 0.0f, nested_time = 0.0f, burst_time = 0.0f;
+
+         // The first pass warms up the workers and isn't timed.
+         for (uint iter = 0; iter <= m_iters; iter++)
+         {
+            timer tm;
+            tm.start();
+            for (uint b = 0; b < cNumBatches; b++)
+            {
+               for (uint i = 0; i < cBatchSize; i++)
+                  tp.queue_object_task(&test, &task_dispatch_test::empty_task);
+               tp.join();
+            }
+            if (iter)
+               flat_time += tm.get_elapsed_secs();
+
+            if (test_nested)
+            {
+               tm.start();
+               for (uint b = 0; b < cNumBatches / cNumSubtasks; b++)
+               {
+                  for (uint i = 0; i < cBatchSize; i++)
+                     tp.queue_object_task(&test, &task_dispatch_test::nested_task, cNumSubtasks);
+                  tp.join();
+               }
+               if (iter)
+                  nested_time += tm.get_elapsed_secs();
+            }
+
+            tm.start();
+            for (uint i = 0; i < cBurstSize; i++)
+               tp.queue_object_task(&test, &task_dispatch_test::empty_task);
+            tp.join();
+            if (iter)
+               burst_time += tm.get_elapsed_secs();
+         }
+
+         const uint num_nested_tasks = test_nested ? ((cNumBatches / cNumSubtasks) * cBatchSize * (cNumSubtasks + 1)) : 0;
+         const uint expected = (m_iters + 1) * (cNumBatches * cBatchSize + num_nested_tasks + cBurstSize);
+         if ((uint)test.m_total != expected)
+         {
+            console::error("Task pool with %u threads ran %u tasks, expected %u!", num_threads, (uint)test.m_total, expected);
+            return false;
+         }
+
+         const double flat_tasks = (double)m_iters * cNumBatches * cBatchSize;
+         const double nested_tasks = (double)m_iters * num_nested_tasks;
+         const double burst_tasks = (double)m_iters * cBurstSize;
+
+         console::printf("%2u threads: flat %3.3f ms, %3.2f M tasks/sec, nested %3.3f ms, %3.2f M tasks/sec, burst %3.3f ms, %3.2f M tasks/sec",
+            num_threads, flat_time * 1000.0f, flat_tasks / (1000000.0f * flat_time), nested_time * 1000.0f, test_nested ? (nested_tasks / (1000000.0f * nested_time)) : 0.0f,
+            burst_time * 1000.0f, burst_tasks / (1000000.0f * burst_time));
+      }
+
+      return true;
+   }
+
+   namespace
+   {
+      // Routes crnlib's allocations to the C heap while tracking the peak number of bytes allocated. Not thread safe.
+      class peak_memory_tracker
+      {
+      public:
+         static void begin()
+         {
+            s_cur_allocated = 0;
+            s_max_allocated = 0;
+            crn_set_memory_callbacks(realloc_func, msize_func, NULL);
+         }
+
+         // Returns the peak number of bytes allocated since begin(), and restores crnlib's default allocator.
+         static int64 end()
+         {
+            crn_set_memory_callbacks(NULL, NULL, NULL);
+            return s_max_allocated;
+         }
+
+      private:
+         static int64 s_cur_allocated;
+         static int64 s_max_allocated;
+
+         static void* realloc_func(void* p, size_t size, size_t* pActual_size, bool movable, void* pUser_data)
+         {
+            pUser_data;
+
+            const size_t old_size = p ? _msize(p) : 0;
+
+            if ((p) && (size) && (!movable))
+            {
+               if (pActual_size)
+                  *pActual_size = old_size;
+               return NULL;
+            }
+
+            void* p_new = NULL;
+            if (size)
+            {
+               p_new = ::realloc(p, size);
+               if (!p_new)
+               {
+                  if (pActual_size)
+                     *pActual_size = old_size;
+                  return NULL;
+               }
+            }
+            else
+               ::free(p);
+
+            const size_t new_size = p_new ? _msize(p_new) : 0;
+            if (pActual_size)
+               *pActual_size = new_size;
+
+            s_cur_allocated += static_cast<int64>(new_size) - static_cast<int64>(old_size);
+            s_max_allocated = math::maximum(s_max_allocated, s_cur_allocated);
+
+            return p_new;
+         }
+
+         static size_t msize_func(void* p, void* pUser_data)
+         {
+            pUser_data;
+            return p ? _msize(p) : 0;
+         }
+      };
+
+      int64 peak_memory_tracker::s_cur_allocated;
+      int64 peak_memory_tracker::s_max_allocated;
+
+      float zeng_similarity(uint index_a, uint index_b, void* pContext)
+      {
+         const uint n = *static_cast<const uint*>(pContext);
+         return 1.0f - fabs(static_cast<float>(index_a) - static_cast<float>(index_b)) / n;
+      }
+   }
+
+   // Reorders synthetic palette index streams (mostly small steps, with occasional jumps) with create_zeng_reorder_table() at several
+   // palette sizes, with and without a similarity function, and reports the time and the peak memory crnlib allocated.
+   bool benchmark::zeng()
+   {
+      const uint palette_sizes[] = { 256, 1024, 4096, cCRNMaxPaletteSize };
+      const uint cNumIndices = 256 * 1024;
+
+      for (uint s = 0; s < CRNLIB_ARRAY_SIZE(palette_sizes); s++)
+      {
+         uint n = palette_sizes[s];
+
+         random rm;
+         rm.seed(n);
+
+         crnlib::vector<uint> indices(cNumIndices);
+         int cur_index = 0;
+         for (uint i = 0; i < cNumIndices; i++)
+         {
+            if (!rm.irand(0, 8))
+               cur_index = rm.irand(0, n);
+            else
+               cur_index = math::clamp<int>(cur_index + rm.irand(-3, 4), 0, n - 1);
+            indices[i] = cur_index;
+         }
+
+         double times[2] = { 0.0f, 0.0f };
+         int64 max_allocated = 0;
+
+         for (uint iter = 0; iter < m_iters; iter++)
+         {
+            for (uint f = 0; f < 2; f++)
+            {
+               crnlib::vector<uint> remap_table;
+
+               peak_memory_tracker::begin();
+
+               timer tm;
+               tm.start();
+               create_zeng_reorder_table(n, cNumIndices, indices.get_ptr(), remap_table, f ? zeng_similarity : NULL, &n, f ? .5f : 0.0f);
+               times[f] += tm.get_elapsed_secs() / m_iters;
+
+               max_allocated = math::maximum(max_allocated, peak_memory_tracker::end());
+            }
+         }
+
+         console::printf("Palette size %4u, %u indices: %3.3f ms, with similarity func %3.3f ms, peak memory %u KB",
+            n, cNumIndices, times[0] * 1000.0f, times[1] * 1000.0f, static_cast<uint>((max_allocated + 1023) / 1024));
+      }
+
+      return true;
+   }
+
+   // Compresses each image to a single level .CRN with crn_comp at 1, 2, 4, etc. total threads up to -threads (default: # of CPU's),
+   // and reports the time and parallel efficiency of each phase of crn_comp::compress_pass() relative to the single threaded run.
+   // The quantization phase is broken down further into dxt_hc's multithreaded phases, along with how unevenly their work was
+   // spread over the threads (the slowest thread's busy time over the average's).
+   bool benchmark::scaling(const dynamic_string_array& files)
+   {
+      if (files.empty())
+      {
+         console::error("The scaling suite requires one or more image files!");
+         return false;
+      }
+
+      crnlib::vector<uint> thread_counts;
+      for (uint num_threads = 1; num_threads < m_max_threads; num_threads *= 2)
+         thread_counts.push_back(num_threads);
+      thread_counts.push_back(m_max_threads);
+
+      const uint cNumTimes = crn_comp::cNumPhases + 1;
+
+      bool all_succeeded = true;
+
+      for (uint file_index = 0; file_index < files.size(); file_index++)
+      {
+         const char* pFilename = files[file_index].get_ptr();
+
+         image_u8 img;
+         if (!image_utils::read_from_file(img, pFilename))
+         {
+            console::warning("Failed reading image: %s", pFilename);
+            continue;
+         }
+
+         crn_comp_params params;
+         params.m_width = img.get_width();
+         params.m_height = img.get_height();
+         params.m_format = img.has_alpha() ? cCRNFmtDXT5 : cCRNFmtDXT1;
+         params.m_pImages[0][0] = reinterpret_cast<const crn_uint32*>(img.get_pixels());
+
+         // Rows and columns are the thread counts and the phases followed by the total.
+         crnlib::vector<double> times(thread_counts.size() * cNumTimes);
+
+         // The same for dxt_hc's phases, which run in the same order at every thread count.
+         crnlib::vector<const char*> quantize_phase_names;
+         crnlib::vector<double> quantize_times, quantize_imbalances;
+         uint comp_size = 0;
+         bool success = true;
+
+         for (uint t = 0; (t < thread_counts.size()) && (success); t++)
+         {
+            params.m_num_helper_threads = thread_counts[t] - 1;
+            if ((img.get_pitch() != img.get_width()) || (!params.check()))
+            {
+               success = false;
+               break;
+            }
+
+            for (uint iter = 0; iter < m_iters; iter++)
+            {
+               crn_comp comp;
+
+               timer tm;
+               tm.start();
+               success = comp.compress_init(params) && comp.compress_pass(params, NULL);
+               const double total_time = tm.get_elapsed_secs();
+
+               if (success)
+               {
+                  // Read the phase times and compressed data before compress_deinit() releases the compressor's state.
+                  for (uint p = 0; p < crn_comp::cNumPhases; p++)
+                     times[t * cNumTimes + p] += comp.get_phase_time(static_cast<crn_comp::phase>(p)) / m_iters;
+                  times[t * cNumTimes + crn_comp::cNumPhases] += total_time / m_iters;
+
+                  const dxt_hc::phase_stats_vec& quantize_stats = comp.get_quantize_phase_stats();
+                  if (quantize_phase_names.empty())
+                  {
+                     for (uint p = 0; p < quantize_stats.size(); p++)
+                        quantize_phase_names.push_back(quantize_stats[p].m_pName);
+                     quantize_times.resize(thread_counts.size() * quantize_stats.size());
+                     quantize_imbalances.resize(thread_counts.size() * quantize_stats.size());
+                  }
+
+                  for (uint p = 0; p < math::minimum(quantize_stats.size(), quantize_phase_names.size()); p++)
+                  {
+                     quantize_times[t * quantize_phase_names.size() + p] += quantize_stats[p].m_time / m_iters;
+                     quantize_imbalances[t * quantize_phase_names.size() + p] += quantize_stats[p].m_imbalance / m_iters;
+                  }
+
+                  comp_size = comp.get_comp_data_size();
+               }
+
+               comp.compress_deinit();
+
+               if (!success)
+                  break;
+            }
+         }
+
+         if (!success)
+         {
+            console::warning("Compression failed: %s", pFilename);
+            all_succeeded = false;
+            continue;
+         }
+
+         console::printf("%s: %ux%u %s, %u bytes", pFilename, params.m_width, params.m_height, crn_get_format_string(params.m_format), comp_size);
+
+         dynamic_string line("                 "), column;
+         for (uint t = 0; t < thread_counts.size(); t++)
+            line += column.format(" %4u thr  eff", thread_counts[t]);
+         console::printf("%s", line.get_ptr());
+
+         for (uint p = 0; p < cNumTimes; p++)
+         {
+            line.format("%16s:", (p < crn_comp::cNumPhases) ? crn_comp::get_phase_name(static_cast<crn_comp::phase>(p)) : "total");
+
+            const double base_time = times[p];
+            for (uint t = 0; t < thread_counts.size(); t++)
+            {
+               const double time = times[t * cNumTimes + p];
+               const double efficiency = (time > 0.0f) ? (base_time / (time * thread_counts[t])) : 1.0f;
+               line += column.format(" %8.1f %3.0f%%", time * 1000.0f, efficiency * 100.0f);
+            }
+
+            console::printf("%s", line.get_ptr());
+         }
+
+         line.format("\n%-26s", "Quantization phases");
+         for (uint t = 0; t < thread_counts.size(); t++)
+            line += column.format(" %4u thr  eff  imb", thread_counts[t]);
+         console::printf("%s", line.get_ptr());
+
+         const uint num_quantize_phases = quantize_phase_names.size();
+         for (uint p = 0; p < num_quantize_phases; p++)
+         {
+            line.format("%25s:", quantize_phase_names[p]);
+
+            const double base_time = quantize_times[p];
+            for (uint t = 0; t < thread_counts.size(); t++)
+            {
+               const double time = quantize_times[t * num_quantize_phases + p];
+               const double efficiency = (time > 0.0f) ? (base_time / (time * thread_counts[t])) : 1.0f;
+               line += column.format(" %8.1f %3.0f%% %4.2f", time * 1000.0f, efficiency * 100.0f, quantize_imbalances[t * num_quantize_phases + p]);
+            }
+
+            console::printf("%s", line.get_ptr());
+         }
+      }
+
+      return all_succeeded;
+   }
+
+   // Compresses each image to a single level .CRN at several quality levels, with one crn_compress() call per quality level and with a
+   // single crn_compress_quality_levels() call, which reuses the quality independent work. Both must produce the same files.
+   bool benchmark::sweep(const dynamic_string_array& files)
+   {
+      if (files.empty())
+      {
+         console::error("The sweep suite requires one or more image files!");
+         return false;
+      }
+
+      const crn_uint32 quality_levels[] = { 32, 96, 160, 224 };
+      const uint cNumQualityLevels = CRNLIB_ARRAY_SIZE(quality_levels);
+
+      bool all_succeeded = true;
+
+      for (uint file_index = 0; file_index < files.size(); file_index++)
+      {
+         const char* pFilename = files[file_index].get_ptr();
+
+         image_u8 img;
+         if ((!image_utils::read_from_file(img, pFilename)) || (img.get_pitch() != img.get_width()))
+         {
+            console::warning("Failed reading image: %s", pFilename);
+            continue;
+         }
+
+         crn_comp_params params;
+         params.m_width = img.get_width();
+         params.m_height = img.get_height();
+         params.m_format = img.has_alpha() ? cCRNFmtDXT5 : cCRNFmtDXT1;
+         params.m_pImages[0][0] = reinterpret_cast<const crn_uint32*>(img.get_pixels());
+         params.m_num_helper_threads = cCRNHelperThreadsAuto;
+
+         bool success = true;
+         double single_time = 0.0f, sweep_time = 0.0f;
+
+         for (uint iter = 0; (iter < m_iters) && (success); iter++)
+         {
+            void* pSingle_data[cNumQualityLevels];
+            crn_uint32 single_sizes[cNumQualityLevels];
+
+            timer tm;
+            tm.start();
+            for (uint i = 0; i < cNumQualityLevels; i++)
+            {
+               params.m_quality_level = quality_levels[i];
+               pSingle_data[i] = crn_compress(params, single_sizes[i]);
+               success = success && (pSingle_data[i] != NULL);
+            }
+            single_time += tm.get_elapsed_secs();
+
+            void* pSweep_data[cNumQualityLevels];
+            crn_uint32 sweep_sizes[cNumQualityLevels];
+
+            tm.start();
+            success = crn_compress_quality_levels(params, quality_levels, cNumQualityLevels, pSweep_data, sweep_sizes) && success;
+            sweep_time += tm.get_elapsed_secs();
+
+            for (uint i = 0; (i < cNumQualityLevels) && (success); i++)
+            {
+               if ((single_sizes[i] != sweep_sizes[i]) || (memcmp(pSingle_data[i], pSweep_data[i], single_sizes[i]) != 0))
+               {
+                  console::error("crn_compress_quality_levels() output at quality level %u doesn't match crn_compress(): %s", quality_levels[i], pFilename);
+                  all_succeeded = false;
+                  break;
+               }
+            }
+
+            for (uint i = 0; i < cNumQualityLevels; i++)
+            {
+               crn_free_block(pSingle_data[i]);
+               crn_free_block(pSweep_data[i]);
+            }
+         }
+
+         if (!success)
+         {
+            console::warning("Compression failed: %s", pFilename);
+            all_succeeded = false;
+            continue;
+         }
+
+         single_time /= m_iters;
+         sweep_time /= m_iters;
+
+         console::printf("%s: %ux%u %s, %u quality levels: separate %3.3f ms, sweep %3.3f ms, %3.2fx",
+            pFilename, params.m_width, params.m_height, crn_get_format_string(params.m_format), cNumQualityLevels,
+            single_time * 1000.0f, sweep_time * 1000.0f, single_time / sweep_time);
+      }
+
+      return all_succeeded;
+   }
+
+   // Cuts each image into 32x32 tiles and compresses them to .CRN files, with one crn_compress() call per tile using -threads total threads,
+   // and with a batch compressor using the same number of threads. Both must produce the same files.
+   bool benchmark::batch(const dynamic_string_array& files)
+   {
+      if (files.empty())
+      {
+         console::error("The batch suite requires one or more image files!");
+         return false;
+      }
+
+      const uint cTileSize = 32;
+
+      crn_compressor_context_t pCompressor = crn_create_compressor(m_max_threads - 1);
+      if (!pCompressor)
+         return false;
+
+      bool all_succeeded = true;
+
+      for (uint file_index = 0; file_index < files.size(); file_index++)
+      {
+         const char* pFilename = files[file_index].get_ptr();
+
+         image_u8 img;
+         if (!image_utils::read_from_file(img, pFilename))
+         {
+            console::warning("Failed reading image: %s", pFilename);
+            continue;
+         }
+
+         const uint tiles_x = (img.get_width() + cTileSize - 1) / cTileSize;
+         const uint tiles_y = (img.get_height() + cTileSize - 1) / cTileSize;
+         const uint num_tiles = tiles_x * tiles_y;
+
+         crnlib::vector<color_quad_u8> tile_pixels(num_tiles * cTileSize * cTileSize);
+         for (uint t = 0; t < num_tiles; t++)
+            img.extract_block(&tile_pixels[t * cTileSize * cTileSize], (t % tiles_x) * cTileSize, (t / tiles_x) * cTileSize, cTileSize, cTileSize);
+
+         crn_comp_params params;
+         params.m_width = cTileSize;
+         params.m_height = cTileSize;
+         params.m_format = img.has_alpha() ? cCRNFmtDXT5 : cCRNFmtDXT1;
+         params.m_num_helper_threads = m_max_threads - 1;
+
+         crnlib::vector<void*> single_data(num_tiles), batch_data(num_tiles);
+         crnlib::vector<crn_uint32> single_sizes(num_tiles), batch_sizes(num_tiles);
+
+         bool success = true;
+         uint total_size = 0;
+         double single_time = 0.0f, batch_time = 0.0f;
+
+         for (uint iter = 0; (iter < m_iters) && (success); iter++)
+         {
+            timer tm;
+            tm.start();
+            for (uint t = 0; t < num_tiles; t++)
+            {
+               params.m_pImages[0][0] = reinterpret_cast<const crn_uint32*>(&tile_pixels[t * cTileSize * cTileSize]);
+               single_data[t] = crn_compress(params, single_sizes[t]);
+               success = success && (single_data[t] != NULL);
+            }
+            single_time += tm.get_elapsed_secs();
+
+            tm.start();
+            for (uint t = 0; t < num_tiles; t++)
+            {
+               params.m_pImages[0][0] = reinterpret_cast<const crn_uint32*>(&tile_pixels[t * cTileSize * cTileSize]);
+               success = crn_compressor_add(pCompressor, params, NULL, &batch_data[t], &batch_sizes[t]) && success;
+            }
+            success = crn_compressor_flush(pCompressor) && success;
+            batch_time += tm.get_elapsed_secs();
+
+            total_size = 0;
+            for (uint t = 0; (t < num_tiles) && (success); t++)
+            {
+               if ((single_sizes[t] != batch_sizes[t]) || (memcmp(single_data[t], batch_data[t], single_sizes[t]) != 0))
+               {
+                  console::error("Batch compressor output of tile %u doesn't match crn_compress(): %s", t, pFilename);
+                  all_succeeded = false;
+                  break;
+               }
+               total_size += single_sizes[t];
+            }
+
+            for (uint t = 0; t < num_tiles; t++)
+            {
+               crn_free_block(single_data[t]);
+               crn_free_block(batch_data[t]);
+            }
+         }
+
+         if (!success)
+         {
+            console::warning("Compression failed: %s", pFilename);
+            all_succeeded = false;
+            continue;
+         }
+
+         single_time /= m_iters;
+         batch_time /= m_iters;
+
+         console::printf("%s: %u %ux%u %s tiles, %u bytes, %u threads: crn_compress %3.3f ms, batch %3.3f ms, %3.2fx",
+            pFilename, num_tiles, cTileSize, cTileSize, crn_get_format_string(params.m_format), total_size, m_max_threads,
+            single_time * 1000.0f, batch_time * 1000.0f, single_time / batch_time);
+      }
+
+      crn_free_compressor(pCompressor);
+
+      return all_succeeded;
+   }
+
+   // Compresses each image to DXT1 .DDS files at several endpoint optimizer qualities and to a .CRN file, once per supported DXT1 selector
+   // kernel level. Every level must produce the same files as the scalar kernels.
+   bool benchmark::dxt1(const dynamic_string_array& files)
+   {
+      if (files.empty())
+      {
+         console::error("The dxt1 suite requires one or more image files!");
+         return false;
+      }
+
+      struct test_case
+      {
+         const char* m_pName;
+         crn_file_type m_file_type;
+         crn_dxt_quality m_quality;
+      };
+      const test_case test_cases[] =
+      {
+         { "DDS fast", cCRNFileTypeDDS, cCRNDXTQualityFast },
+         { "DDS normal", cCRNFileTypeDDS, cCRNDXTQualityNormal },
+         { "DDS uber", cCRNFileTypeDDS, cCRNDXTQualityUber },
+         { "CRN", cCRNFileTypeCRN, cCRNDXTQualityUber },
+      };
+
+      const cpu_level orig_level = cpu_features::get_level();
+      const uint num_levels = cpu_features::get_supported_level() + 1;
+
+      bool all_succeeded = true;
+
+      for (uint file_index = 0; file_index < files.size(); file_index++)
+      {
+         const char* pFilename = files[file_index].get_ptr();
+
+         image_u8 img;
+         if ((!image_utils::read_from_file(img, pFilename)) || (img.get_pitch() != img.get_width()))
+         {
+            console::warning("Failed reading image: %s", pFilename);
+            continue;
+         }
+
+         crn_comp_params params;
+         params.m_width = img.get_width();
+         params.m_height = img.get_height();
+         params.m_format = cCRNFmtDXT1;
+         params.m_pImages[0][0] = reinterpret_cast<const crn_uint32*>(img.get_pixels());
+         params.m_num_helper_threads = m_max_threads - 1;
+
+         console::printf("%s: %ux%u", pFilename, params.m_width, params.m_height);
+
+         for (uint test_index = 0; test_index < CRNLIB_ARRAY_SIZE(test_cases); test_index++)
+         {
+            const test_case& t = test_cases[test_index];
+            params.m_file_type = t.m_file_type;
+            params.m_dxt_quality = t.m_quality;
+
+            dynamic_string results;
+            void* pRef_data = NULL;
+            crn_uint32 ref_size = 0;
+            double ref_time = 0.0f;
+
+            for (uint level = 0; level < num_levels; level++)
+            {
+               cpu_features::set_level(static_cast<cpu_level>(level));
+
+               double total_time = 0.0f;
+               for (uint iter = 0; iter < m_iters; iter++)
+               {
+                  crn_uint32 size = 0;
+                  timer tm;
+                  tm.start();
+                  void* pData = crn_compress(params, size);
+                  total_time += tm.get_elapsed_secs();
+
+                  if (!pData)
+                  {
+                     console::warning("Compression failed: %s", pFilename);
+                     all_succeeded = false;
+                     break;
+                  }
+
+                  if (!pRef_data)
+                  {
+                     pRef_data = pData;
+                     ref_size = size;
+                     continue;
+                  }
+
+                  if ((size != ref_size) || (memcmp(pData, pRef_data, size) != 0))
+                  {
+                     console::error("%s output of the %s kernels doesn't match the scalar kernels: %s", t.m_pName, cpu_features::get_level_name(cpu_features::get_level()), pFilename);
+                     all_succeeded = false;
+                  }
+                  crn_free_block(pData);
+               }
+
+               total_time /= m_iters;
+               if (!level)
+                  ref_time = total_time;
+
+               dynamic_string level_result;
+               level_result.format(", %s %3.3f ms (%3.2fx)", cpu_features::get_level_name(cpu_features::get_level()), total_time * 1000.0f, ref_time / total_time);
+               results += level_result;
+            }
+
+            crn_free_block(pRef_data);
+
+            console::printf("  %s%s", t.m_pName, results.get_ptr());
+         }
+      }
+
+      cpu_features::set_level(orig_level);
+
+      return all_succeeded;
+   }
+
+   // Packs each image with rg_etc1::pack_etc1_blocks() at every quality level, once per supported CPU level, and reports the throughput in blocks/sec.
+   // Every level must produce the same blocks as the scalar code.
+   bool benchmark::etc1(const dynamic_string_array& files)
+   {
+      if (files.empty())
+      {
+         console::error("The etc1 suite requires one or more image files!");
+         return false;
+      }
+
+      static const char* s_quality_names[] = { "low", "medium", "high" };
+
+      const cpu_level orig_level = cpu_features::get_level();
+      const uint num_levels = cpu_features::get_supported_level() + 1;
+
+      bool all_succeeded = true;
+
+      for (uint file_index = 0; file_index < files.size(); file_index++)
+      {
+         const char* pFilename = files[file_index].get_ptr();
+
+         image_u8 img;
+         if (!image_utils::read_from_file(img, pFilename))
+         {
+            console::warning("Failed reading image: %s", pFilename);
+            continue;
+         }
+
+         // rg_etc1 expects opaque pixels.
+         const uint width = img.get_width(), height = img.get_height();
+         crnlib::vector<uint32> pixels(width * height);
+         for (uint y = 0; y < height; y++)
+         {
+            for (uint x = 0; x < width; x++)
+            {
+               color_quad_u8 c(img(x, y));
+               c.a = 255;
+               memcpy(&pixels[x + y * width], &c, sizeof(uint32));
+            }
+         }
+
+         const uint num_blocks = ((width + 3) >> 2) * ((height + 3) >> 2);
+         crnlib::vector<uint64> ref_blocks(num_blocks), blocks(num_blocks);
+
+         console::printf("%s: %ux%u, %u blocks", pFilename, width, height, num_blocks);
+
+         for (uint quality = rg_etc1::cLowQuality; quality <= rg_etc1::cHighQuality; quality++)
+         {
+            rg_etc1::etc1_pack_params pack_params;
+            pack_params.m_quality = static_cast<rg_etc1::etc1_quality>(quality);
+
+            dynamic_string results;
+            uint64 ref_error = 0;
+
+            for (uint level = 0; level < num_levels; level++)
+            {
+               cpu_features::set_level(static_cast<cpu_level>(level));
+
+               uint64 error = 0;
+               double total_time = 0.0f;
+               for (uint iter = 0; iter < m_iters; iter++)
+               {
+                  timer tm;
+                  tm.start();
+                  error = rg_etc1::pack_etc1_blocks(level ? blocks.get_ptr() : ref_blocks.get_ptr(), pixels.get_ptr(), width, height, width, pack_params);
+                  total_time += tm.get_elapsed_secs();
+               }
+               total_time /= m_iters;
+
+               if (!level)
+                  ref_error = error;
+               else if ((error != ref_error) || (memcmp(blocks.get_ptr(), ref_blocks.get_ptr(), num_blocks * sizeof(uint64)) != 0))
+               {
+                  console::error("%s quality output of the %s code doesn't match the scalar code: %s", s_quality_names[quality], cpu_features::get_level_name(cpu_features::get_level()), pFilename);
+                  all_succeeded = false;
+               }
+
+               dynamic_string level_result;
+               level_result.format(", %s %.0f blocks/sec", cpu_features::get_level_name(cpu_features::get_level()), num_blocks / math::maximum(total_time, 1e-9));
+               results += level_result;
+            }
+
+            console::printf("  %s%s, RMSE %3.3f", s_quality_names[quality], results.get_ptr(), sqrt(ref_error / (width * height * 3.0f)));
+         }
+      }
+
+      cpu_features::set_level(orig_level);
+
+      return all_succeeded;
+   }
+
+   namespace
+   {
+      bool textures_match(const mipmapped_texture& a, const mipmapped_texture& b)
+      {
+         if ((a.get_width() != b.get_width()) || (a.get_height() != b.get_height()) || (a.get_format() != b.get_format()) ||
+             (a.get_num_faces() != b.get_num_faces()) || (a.get_num_levels() != b.get_num_levels()))
+            return false;
+
+         for (uint face = 0; face < a.get_num_faces(); face++)
+         {
+            for (uint level = 0; level < a.get_num_levels(); level++)
+            {
+               const mip_level* pA = a.get_level(face, level);
+               const mip_level* pB = b.get_level(face, level);
+
+               if (pA->is_packed())
+               {
+                  const dxt_image* pA_dxt = pA->get_dxt_image();
+                  const dxt_image* pB_dxt = pB->get_dxt_image();
+                  if ((!pB_dxt) || (pA_dxt->get_size_in_bytes() != pB_dxt->get_size_in_bytes()) ||
+                      (memcmp(pA_dxt->get_element_ptr(), pB_dxt->get_element_ptr(), pA_dxt->get_size_in_bytes()) != 0))
+                     return false;
+               }
+               else
+               {
+                  const image_u8* pA_img = pA->get_image();
+                  const image_u8* pB_img = pB->get_image();
+                  if ((!pB_img) || (pA_img->get_total() != pB_img->get_total()) ||
+                      (memcmp(pA_img->get_pixels(), pB_img->get_pixels(), pA_img->get_size_in_bytes()) != 0))
+                     return false;
+               }
+            }
+         }
+
+         return true;
+      }
+   }
+
+   // Loads each .DDS, .KTX or .CRN file with mipmapped_texture::read_from_file() (which memory maps it) and with read_from_stream() over a
+   // cfile_stream, then writes it back out as a .DDS both ways, and reports the time and the peak memory crnlib allocated for each.
+   // Both loads must produce the same texture, and both writes the same file.
+   bool benchmark::io(const dynamic_string_array& files)
+   {
+      if (files.empty())
+      {
+         console::error("The io suite requires one or more .DDS, .KTX or .CRN files!");
+         return false;
+      }
+
+      const char* pOut_filenames[2] = { "__crunch_io_mapped.dds", "__crunch_io_stream.dds" };
+
+      bool all_succeeded = true;
+
+      for (uint file_index = 0; file_index < files.size(); file_index++)
+      {
+         const char* pFilename = files[file_index].get_ptr();
+
+         const texture_file_types::format file_format = texture_file_types::determine_file_format(pFilename);
+         if (!texture_file_types::supports_mipmaps(file_format))
+         {
+            console::warning("Skipping non-texture file: %s", pFilename);
+            continue;
+         }
+
+         mipmapped_texture textures[2];
+         double read_times[2] = { 0.0f, 0.0f };
+         int64 read_peaks[2] = { 0, 0 };
+         double write_times[2] = { 0.0f, 0.0f };
+
+         bool succeeded = true;
+         for (uint iter = 0; (iter < m_iters) && (succeeded); iter++)
+         {
+            for (uint m = 0; m < 2; m++)
+            {
+               textures[m].clear();
+
+               peak_memory_tracker::begin();
+
+               timer tm;
+               tm.start();
+               if (!m)
+                  succeeded = textures[m].read_from_file(pFilename, file_format);
+               else
+               {
+                  cfile_stream in_stream;
+                  data_stream_serializer serializer(in_stream);
+                  succeeded = (in_stream.open(pFilename)) && (textures[m].read_from_stream(serializer, file_format));
+               }
+               read_times[m] += tm.get_elapsed_secs() / m_iters;
+
+               read_peaks[m] = math::maximum(read_peaks[m], peak_memory_tracker::end());
+
+               if (!succeeded)
+                  break;
+            }
+
+            if (!succeeded)
+               break;
+
+            for (uint m = 0; m < 2; m++)
+            {
+               timer tm;
+               tm.start();
+               if (!m)
+                  succeeded = textures[0].write_to_file(pOut_filenames[m], texture_file_types::cFormatDDS);
+               else
+               {
+                  cfile_stream out_stream;
+                  data_stream_serializer serializer(out_stream);
+                  succeeded = (out_stream.open(pOut_filenames[m], cDataStreamWritable | cDataStreamSeekable)) && (textures[0].write_dds(serializer)) && (out_stream.close());
+               }
+               write_times[m] += tm.get_elapsed_secs() / m_iters;
+
+               if (!succeeded)
+                  break;
+            }
+         }
+
+         if (!succeeded)
+         {
+            console::warning("Failed reading or writing texture: %s", pFilename);
+            all_succeeded = false;
+         }
+         else
+         {
+            crnlib::vector<uint8> out_files[2];
+            if (!textures_match(textures[0], textures[1]))
+            {
+               console::error("Mapped and streamed loads don't match: %s", pFilename);
+               all_succeeded = false;
+            }
+            else if ((!cfile_stream::read_file_into_array(pOut_filenames[0], out_files[0])) || (!cfile_stream::read_file_into_array(pOut_filenames[1], out_files[1])) ||
+                     (out_files[0].size() != out_files[1].size()) || (memcmp(out_files[0].get_ptr(), out_files[1].get_ptr(), out_files[0].size()) != 0))
+            {
+               console::error("Mapped and streamed .DDS writes don't match: %s", pFilename);
+               all_succeeded = false;
+            }
+
+            console::printf("%s: %ux%u, %u levels, %u faces, %s", pFilename, textures[0].get_width(), textures[0].get_height(),
+               textures[0].get_num_levels(), textures[0].get_num_faces(), pixel_format_helpers::get_pixel_format_string(textures[0].get_format()));
+            console::printf("  read: mapped %3.3f ms, peak memory %u KB, streamed %3.3f ms, peak memory %u KB",
+               read_times[0] * 1000.0f, static_cast<uint>((read_peaks[0] + 1023) / 1024), read_times[1] * 1000.0f, static_cast<uint>((read_peaks[1] + 1023) / 1024));
+            console::printf("  write .DDS: mapped %3.3f ms, streamed %3.3f ms", write_times[0] * 1000.0f, write_times[1] * 1000.0f);
+         }
+      }
+
+      remove(pOut_filenames[0]);
+      remove(pOut_filenames[1]);
+
+      return all_succeeded;
+   }
+
+   // Compresses each image to DDS at several quality levels and compares lzma_codec::estimate_packed_size() with the size pack() actually
+   // produces, both raw and scaled by the ratio at the middle quality level (the way the estimated -bitrate search calibrates it).
+   bool benchmark::lzmaest(const dynamic_string_array& files)
+   {
+      if (files.empty())
+      {
+         console::error("The lzmaest suite requires one or more image files!");
+         return false;
+      }
+
+      const crn_format formats[] = { cCRNFmtDXT1, cCRNFmtDXT5, cCRNFmtDXN_XY };
+      const uint quality_levels[] = { 0, 64, 128, 192, 254 };
+      const uint cCalibrationLevelIndex = 2;
+      const uint cDDSHeaderSize = 128;
+
+      bool all_succeeded = true;
+
+      double total_pack_time = 0.0f, total_estimate_time = 0.0f;
+      double total_sq_error = 0.0f, total_sq_calibrated_error = 0.0f;
+      float max_calibrated_error = 0.0f;
+      uint num_samples = 0;
+
+      for (uint file_index = 0; file_index < files.size(); file_index++)
+      {
+         const char* pFilename = files[file_index].get_ptr();
+
+         image_u8 img;
+         if ((!image_utils::read_from_file(img, pFilename)) || (img.get_pitch() != img.get_width()))
+         {
+            console::warning("Failed reading image: %s", pFilename);
+            continue;
+         }
+
+         crn_comp_params params;
+         params.m_file_type = cCRNFileTypeDDS;
+         params.m_width = img.get_width();
+         params.m_height = img.get_height();
+         params.m_pImages[0][0] = reinterpret_cast<const crn_uint32*>(img.get_pixels());
+         params.m_num_helper_threads = m_max_threads - 1;
+
+         console::printf("%s: %ux%u", pFilename, params.m_width, params.m_height);
+
+         for (uint format_index = 0; format_index < CRNLIB_ARRAY_SIZE(formats); format_index++)
+         {
+            params.m_format = formats[format_index];
+            const uint element_size = pixel_format_helpers::get_dxt_bytes_per_block(pixel_format_helpers::convert_crn_format_to_pixel_format(params.m_format));
+
+            uint actual_sizes[CRNLIB_ARRAY_SIZE(quality_levels)];
+            uint estimated_sizes[CRNLIB_ARRAY_SIZE(quality_levels)];
+            double pack_time = 0.0f, estimate_time = 0.0f;
+
+            bool succeeded = true;
+            for (uint level_index = 0; (level_index < CRNLIB_ARRAY_SIZE(quality_levels)) && (succeeded); level_index++)
+            {
+               params.m_quality_level = quality_levels[level_index];
+
+               crn_uint32 size = 0;
+               void* pData = crn_compress(params, size);
+               if ((!pData) || (size <= cDDSHeaderSize))
+               {
+                  crn_free_block(pData);
+                  succeeded = false;
+                  break;
+               }
+
+               const uint8* pBlocks = static_cast<const uint8*>(pData) + cDDSHeaderSize;
+               const uint blocks_size = size - cDDSHeaderSize;
+
+               for (uint iter = 0; iter < m_iters; iter++)
+               {
+                  lzma_codec codec;
+                  crnlib::vector<uint8> packed;
+
+                  timer tm;
+                  tm.start();
+                  succeeded = codec.pack(pBlocks, blocks_size, packed);
+                  pack_time += tm.get_elapsed_secs() / m_iters;
+                  actual_sizes[level_index] = packed.size();
+
+                  tm.start();
+                  estimated_sizes[level_index] = lzma_codec::estimate_packed_size(pBlocks, blocks_size, element_size);
+                  estimate_time += tm.get_elapsed_secs() / m_iters;
+               }
+
+               crn_free_block(pData);
+            }
+
+            if (!succeeded)
+            {
+               console::warning("Compression failed: %s", pFilename);
+               all_succeeded = false;
+               continue;
+            }
+
+            const float scale = static_cast<float>(actual_sizes[cCalibrationLevelIndex]) / estimated_sizes[cCalibrationLevelIndex];
+
+            dynamic_string results;
+            for (uint level_index = 0; level_index < CRNLIB_ARRAY_SIZE(quality_levels); level_index++)
+            {
+               const float error = (static_cast<float>(estimated_sizes[level_index]) - actual_sizes[level_index]) / actual_sizes[level_index];
+               const float calibrated_error = (estimated_sizes[level_index] * scale - actual_sizes[level_index]) / actual_sizes[level_index];
+
+               total_sq_error += error * error;
+               total_sq_calibrated_error += calibrated_error * calibrated_error;
+               max_calibrated_error = math::maximum(max_calibrated_error, fabs(calibrated_error));
+               num_samples++;
+
+               dynamic_string level_result;
+               level_result.format("%s%u: %+3.1f%% (%+3.1f%%)", level_index ? ", " : "", quality_levels[level_index], error * 100.0f, calibrated_error * 100.0f);
+               results += level_result;
+            }
+
+            total_pack_time += pack_time;
+            total_estimate_time += estimate_time;
+
+            console::printf("  %s: %s, pack %3.3f ms, estimate %3.3f ms (%3.1fx)", crn_get_format_string(params.m_format), results.get_ptr(),
+               pack_time * 1000.0f, estimate_time * 1000.0f, pack_time / math::maximum(estimate_time, 1e-9));
+         }
+      }
+
+      if (num_samples)
+      {
+         console::printf("Estimate error: RMS %3.1f%%, calibrated RMS %3.1f%%, calibrated max %3.1f%%, %3.1fx faster than packing",
+            sqrt(total_sq_error / num_samples) * 100.0f, sqrt(total_sq_calibrated_error / num_samples) * 100.0f, max_calibrated_error * 100.0f,
+            total_pack_time / math::maximum(total_estimate_time, 1e-9));
+      }
+
+      return all_succeeded;
+   }
+
+} // namespace crnlib
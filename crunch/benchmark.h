@@ -0,0 +1,35 @@
+// File: benchmark.h
+// This software is in the public domain. Please see license.txt.
+#pragma once
+#include "crn_command_line_params.h"
+
+namespace crnlib
+{
+   // Timing harness for the performance sensitive parts of crnlib and the CRN transcoder.
+   // Usage: crunch -benchmark -suite <name> -in <filespec> [-iters N] [-threads N]
+   class benchmark
+   {
+   public:
+      benchmark();
+
+      bool run(const char* pCmd_line);
+
+   private:
+      uint m_iters;
+      uint m_max_threads;
+
+      bool transcode(const dynamic_string_array& files);
+      bool region(const dynamic_string_array& files);
+      bool rgba(const dynamic_string_array& files);
+      bool tasks();
+      bool zeng();
+      bool scaling(const dynamic_string_array& files);
+      bool sweep(const dynamic_string_array& files);
+      bool batch(const dynamic_string_array& files);
+      bool dxt1(const dynamic_string_array& files);
+      bool etc1(const dynamic_string_array& files);
+      bool io(const dynamic_string_array& files);
+      bool lzmaest(const dynamic_string_array& files);
+   };
+
+} // namespace crnlib
@@ -18,17 +18,25 @@
 
 #include "crn_dxt.h"
 #include "crn_cfile_stream.h"
+#include "crn_mmap_stream.h"
 #include "crn_texture_conversion.h"
+#include "crn_cpu_features.h"
+#include "crn_stream_comp.h"
+#include "crn_threading.h"
 
 #define CRND_HEADER_FILE_ONLY
 #include "crn_decomp.h"
 
 #include "corpus_gen.h"
 #include "corpus_test.h"
+#include "benchmark.h"
+#include "texture_cache.h"
 
 using namespace crnlib;
 
 const int cDefaultCRNQualityLevel = 128;
+const int cMaxJobs = 64;
+const int cDefaultCacheSizeMB = 4096;
 
 class crunch
 {
@@ -40,13 +48,20 @@ class crunch
    uint32 m_num_failed;
    uint32 m_num_succeeded;
    uint32 m_num_skipped;
+   uint64 m_total_pixels;
 
 public:
    crunch() :
       m_num_processed(0),
       m_num_failed(0),
       m_num_succeeded(0),
-      m_num_skipped(0)
+      m_num_skipped(0),
+      m_total_pixels(0),
+      m_pFiles(NULL),
+      m_num_jobs(1),
+      m_next_job(0),
+      m_next_job_to_finish(0),
+      m_aborted(false)
    {
    }
 
@@ -88,6 +103,10 @@ public:
       console::printf("-timestamp - Update only changed files");
       console::printf("-forcewrite - Overwrite read-only files");
       console::printf("-recreate - Recreate directory structure");
+      console::printf("-cache dir - Copy output files from dir when a file with the same source pixels was");
+      console::printf("             converted with the same settings before. New output files are added.");
+      console::printf("-cacheSize # - Cache size limit in MB (least recently used files are deleted),");
+      console::printf("               0=unlimited, default=%u", cDefaultCacheSizeMB);
       console::printf("-fileformat [dds,ktx,crn,tga,bmp,png] - Output file format, default=crn or dds");
 
       console::message("\nModes:");
@@ -95,13 +114,17 @@ public:
       console::printf("-info - Only display input file statistics (no output files are written).");
 
       console::message("\nMisc. options:");
-      console::printf("-helperThreads # - Set number of helper threads, 0-16, default=(# of CPU's)-1");
+      console::printf("-helperThreads # - Set number of helper threads, 0-%u or \"auto\", default=auto ((# of CPU's)-1)", cCRNMaxHelperThreads);
+      console::printf("-jobs # - Convert # files at once, 1-%u or \"auto\" (one per CPU), default=1. The CPU's", cMaxJobs);
+      console::printf("          are split evenly between the jobs, which lowers -helperThreads to fit.");
       console::printf("-noprogress - Disable progress output");
       console::printf("-quiet - Disable all console output");
       console::printf("-ignoreerrors - Continue processing files after errors. Note: The default");
       console::printf("                behavior is to immediately exit whenever an error occurs.");
       console::printf("-logfile filename - Append output to log file");
       console::printf("-pause - Wait for keypress on error");
+      console::printf("-cpuLevel [scalar,sse2,sse4.1,avx2] - Limit the SIMD kernels used, default=best supported.");
+      console::printf("           Output is identical at every level. Also settable with the CRN_CPU_LEVEL env var.");
       console::printf("-window <left> <top> <right> <bottom> - Crop window before processing");
       console::printf("-clamp <width> <height> - Crop image if larger than width/height");
       console::printf("-clampscale <width> <height> - Scale image if larger than width/height");
@@ -112,6 +135,8 @@ public:
       console::printf("-split - Write faces/mip levels to multiple separate output PNG files");
       console::printf("-yflip - Always flip texture on Y axis before processing");
       console::printf("-unflip - Unflip texture if read from source file as flipped");
+      console::printf("-stream - Compress to .DDS a few scanlines at a time, for images too large to load.");
+      console::printf("          .TGA/.JPG sources are never fully loaded. No rescaling, cropping or flipping.");
 
       console::message("\nImage rescaling (mutually exclusive options)");
       console::printf("-rescale <int> <int> - Rescale image to specified resolution");
@@ -126,12 +151,20 @@ public:
       console::printf("-bitrate # - Set the desired output bitrate of DDS or CRN output files.");
       console::printf("             This option causes crunch to find the quality factor");
       console::printf("             closest to the desired bitrate using a binary search.");
+      console::printf("-parallelBitrateSearch - Compress several quality levels at once during the");
+      console::printf("             -bitrate search. Faster with 4 or more threads.");
+      console::printf("-lzmaLevel # - LZMA level used to measure DDS bitrates, 0-9, default=5");
+      console::printf("-lzmaDictSize # - LZMA dictionary size in KB, 4-131072, default=level's default");
 
       console::message("\nLow-level CRN specific options:");
       console::printf("-c # - Color endpoint palette size, 32-8192, default=3072");
       console::printf("-s # - Color selector palette size, 32-8192, default=3072");
       console::printf("-ca # - Alpha endpoint palette size, 32-8192, default=3072");
       console::printf("-sa # - Alpha selector palette size, 32-8192, default=3072");
+      console::printf("-restartInterval # - Store a restart point every # chunk rows (8 pixel rows) for crnd_unpack_region(), 0-512, default=0");
+      console::printf("-incremental - If the output .CRN file exists, reuse its palettes and only requantize the");
+      console::printf("               changed parts of the texture (much faster). Falls back to a full compression");
+      console::printf("               if the texture changed too much. Quality and bitrate settings are ignored.");
 
       //                -------------------------------------------------------------------------------
       console::message("\nMipmap filtering options:");
@@ -185,6 +218,7 @@ public:
       m_num_failed = 0;
       m_num_succeeded = 0;
       m_num_skipped = 0;
+      m_total_pixels = 0;
 
       command_line_params::param_desc std_params[] =
       {
@@ -195,12 +229,16 @@ public:
          { "outsamedir", 0, false },
          { "deep", 0, false },
          { "fileformat", 1, false },
+         { "cache", 1, false },
+         { "cacheSize", 1, false },
 
          { "helperThreads", 1, false },
+         { "jobs", 1, false },
          { "noprogress", 0, false },
          { "quiet", 0, false },
          { "ignoreerrors", 0, false },
          { "logfile", 1, false },
+         { "cpuLevel", 1, false },
 
          { "q", 1, false },
          { "quality", 1, false },
@@ -209,6 +247,8 @@ public:
          { "s", 1, false },
          { "ca", 1, false },
          { "sa", 1, false },
+         { "restartInterval", 1, false },
+         { "incremental", 0, false },
 
          { "mipMode", 1, false },
          { "mipFilter", 1, false },
@@ -255,6 +295,9 @@ public:
          { "minmipsize", 1, false },
 
          { "bitrate", 1, false },
+         { "parallelBitrateSearch", 0, false },
+         { "lzmaLevel", 1, false },
+         { "lzmaDictSize", 1, false },
 
          { "lzmastats", 0, false },
          { "split", 0, false },
@@ -262,6 +305,7 @@ public:
 
          { "yflip", 0, false },
          { "unflip", 0, false },
+         { "stream", 0, false },
       };
 
       crnlib::vector<command_line_params::param_desc> params;
@@ -329,6 +373,28 @@ public:
          console::set_log_stream(&m_log_stream);
       }
 
+      dynamic_string cpu_level_str;
+      if (m_params.get_value_as_string("cpuLevel", 0, cpu_level_str))
+      {
+         cpu_level level;
+         if (!cpu_features::find_level(cpu_level_str.get_ptr(), level))
+         {
+            console::error("Invalid cpuLevel: \"%s\"", cpu_level_str.get_ptr());
+            return false;
+         }
+
+         cpu_features::set_level(level);
+      }
+      console::info("Using %s kernels", cpu_features::get_level_name(cpu_features::get_level()));
+
+      dynamic_string cache_dir;
+      if (m_params.get_value_as_string("cache", 0, cache_dir))
+      {
+         const uint64 max_cache_size = static_cast<uint64>(m_params.get_value_as_int("cacheSize", 0, cDefaultCacheSizeMB, 0)) * 1024U * 1024U;
+         if (!m_cache.init(cache_dir.get_ptr(), max_cache_size))
+            return false;
+      }
+
       bool status = convert();
 
       if (m_log_stream.is_opened())
@@ -343,6 +409,7 @@ public:
 
 private:
    command_line_params m_params;
+   texture_cache m_cache;
 
    bool convert()
    {
@@ -398,10 +465,15 @@ private:
 
       console::printf("Total time: %3.3fs", total_time);
 
+      if ((m_num_succeeded) && (total_time > 0.0f))
+         console::printf("Throughput: %3.3f MPix/s, %3.3f files/s", (m_total_pixels / 1000000.0f) / total_time, m_num_succeeded / total_time);
+
       console::printf(
          ((m_num_skipped) || (m_num_failed)) ? cWarningConsoleMessage : cInfoConsoleMessage,
          "%u total file(s) successfully processed, %u file(s) skipped, %u file(s) failed.", m_num_succeeded, m_num_skipped, m_num_failed);
 
+      m_cache.print_stats();
+
       return true;
    }
 
@@ -473,161 +545,130 @@ private:
       return false;
    }
 
-   bool process_files(find_files::file_desc_vec& files)
+   // One input file. With -jobs, files are converted on whichever thread gets to them first, with their console output captured, and
+   // finished (output printed and counted) in order by finish_jobs().
+   struct file_job
    {
-      const bool compare_mode = m_params.get_value_as_bool("compare");
-      const bool info_mode = m_params.get_value_as_bool("info");
+      file_job() : m_status(cCSFailed), m_processed(true), m_num_pixels(0), m_time(0.0f), m_done(false) { }
+
+      convert_status m_status;
+      bool m_processed;       // false if the file was skipped without being looked at
+      uint64 m_num_pixels;    // source texels, all mip levels and faces
+      double m_time;
+      bool m_done;
+      console_capture m_output;
+   };
 
-      for (uint32 file_index = 0; file_index < files.size(); file_index++)
-      {
-         const find_files::file_desc& file_desc = files[file_index];
-         const dynamic_string& in_filename = file_desc.m_fullname;
+   const find_files::file_desc_vec* m_pFiles;
+   crnlib::vector<file_job> m_jobs;
+   uint32 m_num_jobs;
+   volatile atomic32_t m_next_job;
+   uint32 m_next_job_to_finish;
+   volatile bool m_aborted;
+   mutex m_jobs_mutex;
 
-         dynamic_string in_drive, in_path, in_fname, in_ext;
-         file_utils::split_path(in_filename.get_ptr(), &in_drive, &in_path, &in_fname, &in_ext);
+   bool process_files(find_files::file_desc_vec& files)
+   {
+      m_pFiles = &files;
+      m_jobs.clear();
+      m_jobs.resize(files.size());
+      m_next_job = 0;
+      m_next_job_to_finish = 0;
+      m_aborted = false;
+
+      m_num_jobs = 1;
+      if (m_params.has_key("jobs"))
+      {
+         if (m_params.get_value_as_string_or_empty("jobs") == "auto")
+            m_num_jobs = crn_get_max_helper_threads() + 1;
+         else
+            m_num_jobs = m_params.get_value_as_int("jobs", 0, 1, 1, cMaxJobs);
+      }
+      m_num_jobs = math::clamp<uint32>(m_num_jobs, 1, math::minimum<uint32>(files.size(), cMaxJobs));
 
-         texture_file_types::format out_file_type = texture_file_types::cFormatCRN;
-         dynamic_string fmt;
-         if (m_params.get_value_as_string("fileformat", 0, fmt))
+      if (m_num_jobs == 1)
+      {
+         for (uint32 file_index = 0; (file_index < files.size()) && (!m_aborted); file_index++)
          {
-            if (fmt == "tga")
-               out_file_type = texture_file_types::cFormatTGA;
-            else if (fmt == "bmp")
-               out_file_type = texture_file_types::cFormatBMP;
-            else if (fmt == "dds")
-               out_file_type = texture_file_types::cFormatDDS;
-            else if (fmt == "ktx")
-               out_file_type = texture_file_types::cFormatKTX;
-            else if (fmt == "crn")
-               out_file_type = texture_file_types::cFormatCRN;
-            else if (fmt == "png")
-               out_file_type = texture_file_types::cFormatPNG;
-            else
-            {
-               console::error("Unsupported output file type: %s", fmt.get_ptr());
-               return false;
-            }
-         }
+            run_job(file_index);
 
-         // No explicit output format has been specified - try to determine something doable.
-         if (!m_params.has_key("fileformat"))
-         {
-            if (m_params.has_key("split"))
-            {
-               out_file_type = texture_file_types::cFormatPNG;
-            }
-            else
-            {
-               texture_file_types::format input_file_type = texture_file_types::determine_file_format(in_filename.get_ptr());
-               if (input_file_type == texture_file_types::cFormatCRN)
-               {
-                  // Automatically transcode CRN->DXTc and write to DDS files, unless the user specifies either the /fileformat or /split options.
-                  out_file_type = texture_file_types::cFormatDDS;
-               }
-               else if (input_file_type == texture_file_types::cFormatKTX)
-               {
-                  // Default to converting KTX files to PNG
-                  out_file_type = texture_file_types::cFormatPNG;
-               }
-            }
+            m_jobs[file_index].m_done = true;
+            finish_jobs();
          }
+      }
+      else
+      {
+         console::info("Converting %u files at once", m_num_jobs);
 
-         dynamic_string out_filename;
-         if (m_params.get_value_as_bool("outsamedir"))
-            out_filename.format("%s%s%s.%s", in_drive.get_ptr(), in_path.get_ptr(), in_fname.get_ptr(), texture_file_types::get_extension(out_file_type));
-         else if (m_params.has_key("out"))
+         // The calling thread runs jobs too, while it waits in join().
+         task_pool tp;
+         if ((!tp.init(m_num_jobs - 1)) || (!tp.queue_multiple_object_tasks(this, &crunch::job_task, 0, m_num_jobs)))
          {
-            out_filename = m_params.get_value_as_string_or_empty("out");
+            console::error("Failed starting jobs!");
+            return false;
+         }
+         tp.join();
+      }
 
-            if (files.size() > 1)
-            {
-               dynamic_string out_drive, out_dir, out_name, out_ext;
-               file_utils::split_path(out_filename.get_ptr(), &out_drive, &out_dir, &out_name, &out_ext);
+      return !m_aborted;
+   }
 
-               out_name.format("%s_%u", out_name.get_ptr(), file_index);
+   void job_task(uint64 data, void* pData_ptr)
+   {
+      data, pData_ptr;
 
-               out_filename.format("%s%s%s%s", out_drive.get_ptr(), out_dir.get_ptr(), out_name.get_ptr(), out_ext.get_ptr());
-            }
+      for ( ; ; )
+      {
+         const uint32 file_index = atomic_increment32(&m_next_job) - 1;
+         if ((file_index >= m_jobs.size()) || (m_aborted))
+            break;
 
-            if (!m_params.has_key("fileformat"))
-               out_file_type = texture_file_types::determine_file_format(out_filename.get_ptr());
-         }
-         else
-         {
-            dynamic_string out_dir(m_params.get_value_as_string_or_empty("outdir"));
+         file_job& job = m_jobs[file_index];
 
-            if (m_params.get_value_as_bool("recreate") && file_desc.m_rel.get_len())
-            {
-               file_utils::combine_path(out_dir, out_dir.get_ptr(), file_desc.m_rel.get_ptr());
-            }
+         console::begin_capture(job.m_output);
+         run_job(file_index);
+         console::end_capture();
 
-            if (out_dir.get_len())
-            {
-               if (file_utils::is_path_separator(out_dir.back()))
-                  out_filename.format("%s%s.%s", out_dir.get_ptr(), in_fname.get_ptr(), texture_file_types::get_extension(out_file_type));
-               else
-                  out_filename.format("%s\\%s.%s", out_dir.get_ptr(), in_fname.get_ptr(), texture_file_types::get_extension(out_file_type));
-            }
-            else
-            {
-               out_filename.format("%s.%s", in_fname.get_ptr(), texture_file_types::get_extension(out_file_type));
-            }
+         scoped_mutex lock(m_jobs_mutex);
+         job.m_done = true;
+         finish_jobs();
+      }
+   }
 
-            if (m_params.get_value_as_bool("recreate"))
-            {
-               if (file_utils::full_path(out_filename))
-               {
-                  if ((!compare_mode) && (!info_mode))
-                  {
-                     dynamic_string out_drive, out_path;
-                     file_utils::split_path(out_filename.get_ptr(), &out_drive, &out_path, NULL, NULL);
-                     out_drive += out_path;
-                     file_utils::create_path(out_drive.get_ptr());
-                  }
-               }
-            }
-         }
+   // Prints the output of the jobs that are done and have no unfinished jobs before them, and counts them. Must be called with
+   // m_jobs_mutex locked in -jobs mode.
+   void finish_jobs()
+   {
+      while ((m_next_job_to_finish < m_jobs.size()) && (m_jobs[m_next_job_to_finish].m_done))
+      {
+         file_job& job = m_jobs[m_next_job_to_finish++];
 
-         if ((!compare_mode) && (!info_mode))
+         // The files after one that stopped the conversion wouldn't have been looked at without -jobs.
+         if (m_aborted)
          {
-            if (file_utils::does_file_exist(out_filename.get_ptr()))
-            {
-               if (m_params.get_value_as_bool("nooverwrite"))
-               {
-                  console::warning("Skipping already existing file: %s\n", out_filename.get_ptr());
-                  m_num_skipped++;
-                  continue;
-               }
-
-               if (m_params.get_value_as_bool("timestamp"))
-               {
-                  if (file_utils::is_older_than(in_filename.get_ptr(), out_filename.get_ptr()))
-                  {
-                     console::warning("Skipping up to date file: %s\n", out_filename.get_ptr());
-                     m_num_skipped++;
-                     continue;
-                  }
-               }
-            }
+            job.m_output.clear();
+            continue;
          }
 
-         convert_status status = cCSFailed;
+         job.m_output.replay();
 
-         if (info_mode)
-            status = display_file_info(file_index, files.size(), in_filename.get_ptr());
-         else if (compare_mode)
-            status = compare_file(file_index, files.size(), in_filename.get_ptr(), out_filename.get_ptr(), out_file_type);
-         else if (read_only_file_check(out_filename.get_ptr()))
-            status = convert_file(file_index, files.size(), in_filename.get_ptr(), out_filename.get_ptr(), out_file_type);
+         if (!job.m_processed)
+         {
+            m_num_skipped++;
+            continue;
+         }
 
          m_num_processed++;
 
-         switch (status)
+         switch (job.m_status)
          {
             case cCSSucceeded:
             {
+               if ((m_num_jobs > 1) && (job.m_time > 0.0f))
+                  console::info("File time: %3.3fs, %3.3f MPix/s", job.m_time, (job.m_num_pixels / 1000000.0f) / job.m_time);
                console::info("");
                m_num_succeeded++;
+               m_total_pixels += job.m_num_pixels;
                break;
             }
             case cCSSkipped:
@@ -638,12 +679,16 @@ private:
             }
             case cCSBadParam:
             {
-               return false;
+               m_aborted = true;
+               break;
             }
             default:
             {
                if (!m_params.get_value_as_bool("ignoreerrors"))
-                  return false;
+               {
+                  m_aborted = true;
+                  break;
+               }
 
                console::info("");
 
@@ -652,8 +697,176 @@ private:
             }
          }
       }
+   }
 
-      return true;
+   void run_job(uint32 file_index)
+   {
+      file_job& job = m_jobs[file_index];
+
+      timer tm;
+      tm.start();
+
+      job.m_status = process_file(file_index, job);
+
+      job.m_time = tm.get_elapsed_secs();
+   }
+
+   convert_status process_file(uint32 file_index, file_job& job)
+   {
+      const bool compare_mode = m_params.get_value_as_bool("compare");
+      const bool info_mode = m_params.get_value_as_bool("info");
+
+      const find_files::file_desc& file_desc = (*m_pFiles)[file_index];
+      const dynamic_string& in_filename = file_desc.m_fullname;
+
+      dynamic_string in_drive, in_path, in_fname, in_ext;
+      file_utils::split_path(in_filename.get_ptr(), &in_drive, &in_path, &in_fname, &in_ext);
+
+      texture_file_types::format out_file_type = texture_file_types::cFormatCRN;
+      dynamic_string fmt;
+      if (m_params.get_value_as_string("fileformat", 0, fmt))
+      {
+         if (fmt == "tga")
+            out_file_type = texture_file_types::cFormatTGA;
+         else if (fmt == "bmp")
+            out_file_type = texture_file_types::cFormatBMP;
+         else if (fmt == "dds")
+            out_file_type = texture_file_types::cFormatDDS;
+         else if (fmt == "ktx")
+            out_file_type = texture_file_types::cFormatKTX;
+         else if (fmt == "crn")
+            out_file_type = texture_file_types::cFormatCRN;
+         else if (fmt == "png")
+            out_file_type = texture_file_types::cFormatPNG;
+         else
+         {
+            console::error("Unsupported output file type: %s", fmt.get_ptr());
+            return cCSBadParam;
+         }
+      }
+
+      // No explicit output format has been specified - try to determine something doable.
+      if (!m_params.has_key("fileformat"))
+      {
+         if (m_params.has_key("split"))
+         {
+            out_file_type = texture_file_types::cFormatPNG;
+         }
+         else
+         {
+            texture_file_types::format input_file_type = texture_file_types::determine_file_format(in_filename.get_ptr());
+            if (input_file_type == texture_file_types::cFormatCRN)
+            {
+               // Automatically transcode CRN->DXTc and write to DDS files, unless the user specifies either the /fileformat or /split options.
+               out_file_type = texture_file_types::cFormatDDS;
+            }
+            else if (input_file_type == texture_file_types::cFormatKTX)
+            {
+               // Default to converting KTX files to PNG
+               out_file_type = texture_file_types::cFormatPNG;
+            }
+         }
+      }
+
+      dynamic_string out_filename;
+      if (m_params.get_value_as_bool("outsamedir"))
+         out_filename.format("%s%s%s.%s", in_drive.get_ptr(), in_path.get_ptr(), in_fname.get_ptr(), texture_file_types::get_extension(out_file_type));
+      else if (m_params.has_key("out"))
+      {
+         out_filename = m_params.get_value_as_string_or_empty("out");
+
+         if (m_jobs.size() > 1)
+         {
+            dynamic_string out_drive, out_dir, out_name, out_ext;
+            file_utils::split_path(out_filename.get_ptr(), &out_drive, &out_dir, &out_name, &out_ext);
+
+            out_name.format("%s_%u", out_name.get_ptr(), file_index);
+
+            out_filename.format("%s%s%s%s", out_drive.get_ptr(), out_dir.get_ptr(), out_name.get_ptr(), out_ext.get_ptr());
+         }
+
+         if (!m_params.has_key("fileformat"))
+            out_file_type = texture_file_types::determine_file_format(out_filename.get_ptr());
+      }
+      else
+      {
+         dynamic_string out_dir(m_params.get_value_as_string_or_empty("outdir"));
+
+         if (m_params.get_value_as_bool("recreate") && file_desc.m_rel.get_len())
+         {
+            file_utils::combine_path(out_dir, out_dir.get_ptr(), file_desc.m_rel.get_ptr());
+         }
+
+         if (out_dir.get_len())
+         {
+            if (file_utils::is_path_separator(out_dir.back()))
+               out_filename.format("%s%s.%s", out_dir.get_ptr(), in_fname.get_ptr(), texture_file_types::get_extension(out_file_type));
+            else
+               out_filename.format("%s\\%s.%s", out_dir.get_ptr(), in_fname.get_ptr(), texture_file_types::get_extension(out_file_type));
+         }
+         else
+         {
+            out_filename.format("%s.%s", in_fname.get_ptr(), texture_file_types::get_extension(out_file_type));
+         }
+
+         if (m_params.get_value_as_bool("recreate"))
+         {
+            if (file_utils::full_path(out_filename))
+            {
+               if ((!compare_mode) && (!info_mode))
+               {
+                  dynamic_string out_drive, out_path;
+                  file_utils::split_path(out_filename.get_ptr(), &out_drive, &out_path, NULL, NULL);
+                  out_drive += out_path;
+                  file_utils::create_path(out_drive.get_ptr());
+               }
+            }
+         }
+      }
+
+      if ((!compare_mode) && (!info_mode))
+      {
+         if (file_utils::does_file_exist(out_filename.get_ptr()))
+         {
+            if (m_params.get_value_as_bool("nooverwrite"))
+            {
+               console::warning("Skipping already existing file: %s\n", out_filename.get_ptr());
+               job.m_processed = false;
+               return cCSSkipped;
+            }
+
+            if (m_params.get_value_as_bool("timestamp"))
+            {
+               if (file_utils::is_older_than(in_filename.get_ptr(), out_filename.get_ptr()))
+               {
+                  console::warning("Skipping up to date file: %s\n", out_filename.get_ptr());
+                  job.m_processed = false;
+                  return cCSSkipped;
+               }
+            }
+         }
+      }
+
+      if (info_mode)
+         return display_file_info(file_index, m_jobs.size(), in_filename.get_ptr(), job.m_num_pixels);
+      else if (compare_mode)
+         return compare_file(file_index, m_jobs.size(), in_filename.get_ptr(), out_filename.get_ptr(), out_file_type, job.m_num_pixels);
+      else if (read_only_file_check(out_filename.get_ptr()))
+         return convert_file(file_index, m_jobs.size(), in_filename.get_ptr(), out_filename.get_ptr(), out_file_type, job.m_num_pixels);
+
+      return cCSFailed;
+   }
+
+   static uint64 get_total_pixels(const mipmapped_texture& tex)
+   {
+      uint64 total_pixels = 0;
+      for (uint32 i = 0; i < tex.get_num_levels(); i++)
+      {
+         uint32 width = math::maximum<uint32>(1, tex.get_width() >> i);
+         uint32 height = math::maximum<uint32>(1, tex.get_height() >> i);
+         total_pixels += static_cast<uint64>(width) * height * tex.get_num_faces();
+      }
+      return total_pixels;
    }
 
    void print_texture_info(const char* pTex_desc, texture_conversion::convert_params& params, mipmapped_texture& tex)
@@ -888,6 +1101,13 @@ private:
          comp_params.m_crn_alpha_selector_palette_size = alpha_selectors;
       }
 
+      if (m_params.has_key("restartInterval"))
+         comp_params.m_crn_restart_interval = m_params.get_value_as_int("restartInterval", 0, 0, 0, cCRNMaxRestartInterval);
+
+      comp_params.m_lzma_level = m_params.get_value_as_int("lzmaLevel", 0, 5, 0, cCRNMaxLZMALevel);
+      if (m_params.has_key("lzmaDictSize"))
+         comp_params.m_lzma_dict_size = m_params.get_value_as_int("lzmaDictSize", 0, 0, cCRNMinLZMADictSize / 1024, cCRNMaxLZMADictSize / 1024) * 1024;
+
       if (m_params.has_key("alphaThreshold"))
       {
          int dxt1a_alpha_threshold = m_params.get_value_as_int("alphaThreshold", 0, 128, 0, 255);
@@ -901,10 +1121,17 @@ private:
       comp_params.set_flag(cCRNCompFlagPerceptual, !m_params.get_value_as_bool("uniformMetrics"));
       comp_params.set_flag(cCRNCompFlagHierarchical, !m_params.get_value_as_bool("noAdaptiveBlocks"));
 
-      if (m_params.has_key("helperThreads"))
+      comp_params.m_num_helper_threads = cCRNHelperThreadsAuto;
+      if ((m_params.has_key("helperThreads")) && (m_params.get_value_as_string_or_empty("helperThreads") != "auto"))
          comp_params.m_num_helper_threads = m_params.get_value_as_int("helperThreads", 0, cCRNMaxHelperThreads, 0, cCRNMaxHelperThreads);
-      else if (g_number_of_processors > 1)
-         comp_params.m_num_helper_threads = g_number_of_processors - 1;
+
+      // Files converted at once share the CPU's, so (jobs * (helper threads + 1)) doesn't exceed the number of CPU's.
+      if (m_num_jobs > 1)
+      {
+         const uint32 max_helper_threads = math::maximum<uint32>(crn_get_max_helper_threads() + 1, m_num_jobs) / m_num_jobs - 1;
+         if ((comp_params.m_num_helper_threads == cCRNHelperThreadsAuto) || (comp_params.m_num_helper_threads > max_helper_threads))
+            comp_params.m_num_helper_threads = max_helper_threads;
+      }
 
       dynamic_string comp_name;
       if (m_params.get_value_as_string("compressor", 0, comp_name))
@@ -950,6 +1177,7 @@ private:
 
       comp_params.set_flag(cCRNCompFlagDisableEndpointCaching, m_params.get_value_as_bool("noendpointcaching"));
       comp_params.set_flag(cCRNCompFlagGrayscaleSampling, m_params.get_value_as_bool("grayscalesampling"));
+      comp_params.set_flag(cCRNCompFlagParallelBitrateSearch, m_params.get_value_as_bool("parallelBitrateSearch"));
       comp_params.set_flag(cCRNCompFlagUseBothBlockTypes, !m_params.get_value_as_bool("forceprimaryencoding"));
       if (comp_params.get_flag(cCRNCompFlagUseBothBlockTypes))
          comp_params.set_flag(cCRNCompFlagUseTransparentIndicesForBlack, m_params.get_value_as_bool("usetransparentindicesforblack"));
@@ -959,7 +1187,7 @@ private:
       return true;
    }
 
-   convert_status display_file_info(uint32 file_index, uint32 num_files, const char* pSrc_filename)
+   convert_status display_file_info(uint32 file_index, uint32 num_files, const char* pSrc_filename, uint64& total_pixels)
    {
       if (num_files > 1)
          console::message("[%u/%u] Source texture: \"%s\"", file_index + 1, num_files, pSrc_filename);
@@ -994,26 +1222,37 @@ private:
          uint32 height = math::maximum<uint32>(1, src_tex.get_height() >> i);
          total_in_pixels += width*height*src_tex.get_num_faces();
       }
+      total_pixels = total_in_pixels;
 
-      vector<uint8> src_tex_bytes;
-      if (!cfile_stream::read_file_into_array(pSrc_filename, src_tex_bytes))
+      // The file's contents are only looked at, so they're mapped rather than loaded. (Empty files can't be mapped.)
+      mmap_stream src_file;
+      if (!src_file.open(pSrc_filename))
       {
+         if (!input_file_size)
+         {
+            console::warning("Source file is empty: %s", pSrc_filename);
+            return cCSSkipped;
+         }
+
          console::error("Failed loading source file: %s", pSrc_filename);
          return cCSFailed;
       }
 
-      if (!src_tex_bytes.size())
+      if (src_file.get_size() > cUINT32_MAX)
       {
-         console::warning("Source file is empty: %s", pSrc_filename);
-         return cCSSkipped;
+         console::error("Source file is too large: %s", pSrc_filename);
+         return cCSFailed;
       }
 
+      const uint8* pSrc_tex_bytes = static_cast<const uint8*>(src_file.get_ptr());
+      const uint src_tex_size = static_cast<uint>(src_file.get_size());
+
       uint32 compressed_size = 0;
       if (m_params.has_key("lzmastats"))
       {
          lzma_codec lossless_codec;
          vector<uint8> cmp_tex_bytes;
-         if (lossless_codec.pack(src_tex_bytes.get_ptr(), src_tex_bytes.size(), cmp_tex_bytes))
+         if (lossless_codec.pack(pSrc_tex_bytes, src_tex_size, cmp_tex_bytes))
          {
             compressed_size = cmp_tex_bytes.size();
          }
@@ -1035,14 +1274,14 @@ private:
             compressed_size, compressed_size * 8.0f / total_in_pixels);
       }
 
-      double entropy = math::compute_entropy(src_tex_bytes.get_ptr(), src_tex_bytes.size());
-      console::info("Source file entropy: %3.6f bits per byte", entropy / src_tex_bytes.size());
+      double entropy = math::compute_entropy(pSrc_tex_bytes, src_tex_size);
+      console::info("Source file entropy: %3.6f bits per byte", entropy / src_tex_size);
 
       if (src_file_format == texture_file_types::cFormatCRN)
       {
          crnd::crn_texture_info tex_info;
          tex_info.m_struct_size = sizeof(crnd::crn_texture_info);
-         crn_bool success = crnd::crnd_get_texture_info(src_tex_bytes.get_ptr(), src_tex_bytes.size(), &tex_info);
+         crn_bool success = crnd::crnd_get_texture_info(pSrc_tex_bytes, src_tex_size, &tex_info);
          if (!success)
             console::error("Failed retrieving CRN texture info!");
          else
@@ -1078,7 +1317,7 @@ private:
       }
    }
 
-   convert_status compare_file(uint32 file_index, uint32 num_files, const char* pSrc_filename, const char* pDst_filename, texture_file_types::format out_file_type)
+   convert_status compare_file(uint32 file_index, uint32 num_files, const char* pSrc_filename, const char* pDst_filename, texture_file_types::format out_file_type, uint64& total_pixels)
    {
       if (num_files > 1)
          console::message("[%u/%u] Comparing source texture \"%s\" to output texture \"%s\"", file_index + 1, num_files, pSrc_filename, pDst_filename);
@@ -1104,6 +1343,8 @@ private:
          return cCSFailed;
       }
 
+      total_pixels = get_total_pixels(src_tex);
+
       texture_conversion::convert_stats stats;
       if (!stats.init(pSrc_filename, pDst_filename, src_tex, out_file_type, m_params.has_key("lzmastats")))
          return cCSFailed;
@@ -1113,8 +1354,11 @@ private:
       return cCSSucceeded;
    }
 
-   convert_status convert_file(uint32 file_index, uint32 num_files, const char* pSrc_filename, const char* pDst_filename, texture_file_types::format out_file_type)
+   convert_status convert_file(uint32 file_index, uint32 num_files, const char* pSrc_filename, const char* pDst_filename, texture_file_types::format out_file_type, uint64& total_pixels)
    {
+      if (m_params.get_value_as_bool("stream"))
+         return stream_convert_file(file_index, num_files, pSrc_filename, pDst_filename, out_file_type, total_pixels);
+
       timer tim;
 
       if (num_files > 1)
@@ -1143,6 +1387,8 @@ private:
       double total_time = tim.get_elapsed_secs();
       console::info("Texture successfully loaded in %3.3fs", total_time);
 
+      total_pixels = get_total_pixels(src_tex);
+
       if (m_params.get_value_as_bool("converttoluma"))
          src_tex.convert(image_utils::cConversion_Y_To_RGB);
       if (m_params.get_value_as_bool("setalphatoluma"))
@@ -1160,7 +1406,8 @@ private:
       params.m_y_flip = m_params.has_key("yflip");
       params.m_unflip = m_params.has_key("unflip");
 
-      if ((!m_params.get_value_as_bool("noprogress")) && (!m_params.get_value_as_bool("quiet")))
+      // Progress output isn't captured in -jobs mode.
+      if ((!m_params.get_value_as_bool("noprogress")) && (!m_params.get_value_as_bool("quiet")) && (m_num_jobs == 1))
          params.m_pProgress_func = progress_callback_func;
 
       if (m_params.get_value_as_bool("debug"))
@@ -1210,9 +1457,41 @@ private:
          params.m_comp_params.set_flag(cCRNCompFlagPerceptual, false);
       }
 
+      // The reference is the output file itself, which gets overwritten before the compressor is done with it, so read it into memory
+      // rather than mapping it (a mapping would only survive on platforms where the file can be unlinked first, and not at all on Win32).
+      crnlib::vector<uint8> reference_file;
+      if ((m_params.get_value_as_bool("incremental")) && (out_file_type == texture_file_types::cFormatCRN) && (file_utils::does_file_exist(pDst_filename)))
+      {
+         if ((cfile_stream::read_file_into_array(pDst_filename, reference_file)) && (reference_file.size()))
+         {
+            console::info("Recompressing incrementally, using \"%s\" as reference", pDst_filename);
+            params.m_comp_params.m_pCRN_reference = reference_file.get_ptr();
+            params.m_comp_params.m_crn_reference_size = reference_file.size();
+         }
+         else
+            console::warning("Unable to read reference file \"%s\"", pDst_filename);
+      }
+
       texture_conversion::convert_stats stats;
 
+      uint64 cache_key = 0;
+      const bool use_cache = (m_cache.is_initialized()) && (texture_cache::compute_key(params, cache_key));
+
       tim.start();
+
+      if ((use_cache) && (m_cache.fetch(cache_key, out_file_type, pDst_filename)))
+      {
+         console::info("Output file \"%s\" copied from cache in %3.3fs", pDst_filename, tim.get_elapsed_secs());
+
+         if (!m_params.get_value_as_bool("nostats"))
+         {
+            if (stats.init(pSrc_filename, pDst_filename, src_tex, out_file_type, m_params.has_key("lzmastats"), params.m_comp_params.m_num_helper_threads))
+               print_stats(stats);
+         }
+
+         return cCSSucceeded;
+      }
+
       bool status = texture_conversion::process(params, stats);
       total_time = tim.get_elapsed_secs();
 
@@ -1227,11 +1506,96 @@ private:
 
       console::info("Texture successfully processed in %3.3fs", total_time);
 
+      if (use_cache)
+         m_cache.store(cache_key, out_file_type, pDst_filename);
+
       if (!m_params.get_value_as_bool("nostats"))
          print_stats(stats);
 
       return cCSSucceeded;
    }
+
+   convert_status stream_convert_file(uint32 file_index, uint32 num_files, const char* pSrc_filename, const char* pDst_filename, texture_file_types::format out_file_type, uint64& total_pixels)
+   {
+      if (out_file_type != texture_file_types::cFormatDDS)
+      {
+         console::error("-stream only supports .DDS output files");
+         return cCSBadParam;
+      }
+
+      static const char* s_unsupported_params[] = { "rescalemode", "rescale", "relrescale", "clamp", "clampScale", "window", "yflip", "split", "bitrate", "quality", "q" };
+      for (uint32 i = 0; i < sizeof(s_unsupported_params) / sizeof(s_unsupported_params[0]); i++)
+         if (m_params.has_key(s_unsupported_params[i]))
+            console::warning("-%s is ignored in -stream mode", s_unsupported_params[i]);
+
+      if (num_files > 1)
+         console::message("[%u/%u] Streaming source texture: \"%s\"", file_index + 1, num_files, pSrc_filename);
+      else
+         console::message("Streaming source texture: \"%s\"", pSrc_filename);
+
+      scanline_reader* pReader = create_scanline_reader(pSrc_filename);
+      if (!pReader)
+      {
+         console::error("Failed reading source file: \"%s\"", pSrc_filename);
+         return cCSFailed;
+      }
+
+      pixel_format fmt = PIXEL_FMT_INVALID;
+      for (uint32 i = 0; i < pixel_format_helpers::get_num_formats(); i++)
+      {
+         pixel_format trial_fmt = pixel_format_helpers::get_pixel_format_by_index(i);
+         if (m_params.has_key(pixel_format_helpers::get_pixel_format_string(trial_fmt)))
+         {
+            fmt = trial_fmt;
+            break;
+         }
+      }
+
+      crn_mipmap_params mipmap_params;
+      crn_comp_params comp_params;
+      if ((!parse_mipmap_params(mipmap_params)) || (!parse_comp_params(out_file_type, comp_params)))
+      {
+         crnlib_delete(pReader);
+         return cCSBadParam;
+      }
+
+      if (fmt == PIXEL_FMT_INVALID)
+         fmt = pReader->has_alpha() ? PIXEL_FMT_DXT5 : PIXEL_FMT_DXT1;
+      if ((fmt == PIXEL_FMT_DXT1) && (comp_params.get_flag(cCRNCompFlagDXT1AForTransparency)))
+         fmt = PIXEL_FMT_DXT1A;
+      else if (fmt == PIXEL_FMT_DXT1A)
+         comp_params.set_flag(cCRNCompFlagDXT1AForTransparency, true);
+
+      console::info("Source texture: %ux%u, Alpha: %u", pReader->get_width(), pReader->get_height(), pReader->has_alpha());
+      console::message("Writing %s texture to file: \"%s\"", pixel_format_helpers::get_pixel_format_string(fmt), pDst_filename);
+
+      convert_status status = cCSFailed;
+
+      cfile_stream dst_file;
+      if (!dst_file.open(pDst_filename, cDataStreamWritable | cDataStreamSeekable))
+         console::error("Unable to create output file \"%s\"", pDst_filename);
+      else
+      {
+         const bool show_progress = (!m_params.get_value_as_bool("noprogress")) && (!m_params.get_value_as_bool("quiet")) && (m_num_jobs == 1);
+
+         timer tim;
+         tim.start();
+
+         stream_dds_comp comp;
+         if (!comp.compress(*pReader, dst_file, fmt, comp_params, mipmap_params, show_progress ? progress_callback_func : NULL, NULL))
+            console::error("Failed writing output file: \"%s\"", pDst_filename);
+         else
+         {
+            console::progress("");
+            console::info("Wrote %u mip levels, texture successfully processed in %3.3fs", comp.get_num_levels(), tim.get_elapsed_secs());
+            total_pixels = static_cast<uint64>(pReader->get_width()) * pReader->get_height();
+            status = cCSSucceeded;
+         }
+      }
+
+      crnlib_delete(pReader);
+      return status;
+   }
 };
 
 //-----------------------------------------------------------------------------------------------------------------------
@@ -1286,6 +1650,11 @@ static int main_internal(int argc, char *argv[])
       corpus_tester tester;
       status = tester.test(cmd_line.get_ptr());
    }
+   else if (check_for_option(argc, argv, "benchmark"))
+   {
+      benchmark bench;
+      status = bench.run(cmd_line.get_ptr());
+   }
    else
    {
       crunch converter;
@@ -0,0 +1,339 @@
+// File: texture_cache.cpp
+// This software is in the public domain. Please see license.txt.
+#include "crn_core.h"
+#include "texture_cache.h"
+#include "crn_console.h"
+#include "crn_file_utils.h"
+#include "crn_find_files.h"
+#include "crn_mmap_stream.h"
+
+namespace crnlib
+{
+   // Bump whenever the way keys are computed changes.
+   const uint32 cTextureCacheVersion = 1;
+
+   texture_cache::texture_cache() :
+      m_max_size(0),
+      m_total_size(0),
+      m_num_hits(0),
+      m_num_misses(0),
+      m_num_stores(0),
+      m_num_evicted(0)
+   {
+   }
+
+   bool texture_cache::init(const char* pDir, uint64 max_size)
+   {
+      m_dir = pDir;
+      if ((m_dir.is_empty()) || (!file_utils::full_path(m_dir)))
+      {
+         console::error("Invalid cache directory: \"%s\"", pDir);
+         m_dir.clear();
+         return false;
+      }
+
+      file_utils::trim_trailing_seperator(m_dir);
+
+      if (!file_utils::does_dir_exist(m_dir.get_ptr()))
+      {
+         file_utils::create_path(m_dir);
+
+         if (!file_utils::does_dir_exist(m_dir.get_ptr()))
+         {
+            console::error("Unable to create cache directory: \"%s\"", m_dir.get_ptr());
+            m_dir.clear();
+            return false;
+         }
+      }
+
+      m_max_size = max_size;
+
+      crnlib::vector<entry> entries;
+      find_entries(entries, m_total_size);
+
+      console::info("Using cache directory \"%s\": %u files, %1.1f MB", m_dir.get_ptr(), entries.size(), m_total_size / (1024.0f * 1024.0f));
+
+      if ((m_max_size) && (m_total_size > m_max_size))
+      {
+         scoped_mutex lock(m_mutex);
+         evict();
+      }
+
+      return true;
+   }
+
+   bool texture_cache::compute_key(const texture_conversion::convert_params& params, uint64& key)
+   {
+      key = 0;
+
+      if ((params.m_write_mipmaps_to_multiple_files) || (!params.m_pInput_texture))
+         return false;
+
+      hash64 h;
+
+      h.update_obj(cTextureCacheVersion);
+      h.update_obj(static_cast<uint32>(CRNLIB_VERSION));
+
+      // The source texture's pixels, as loaded (and after -converttoluma/-setalphatoluma).
+      const mipmapped_texture& tex = *params.m_pInput_texture;
+      h.update_obj(tex.get_num_faces());
+      h.update_obj(tex.get_num_levels());
+      h.update_obj(tex.get_format());
+
+      for (uint f = 0; f < tex.get_num_faces(); f++)
+      {
+         for (uint l = 0; l < tex.get_num_levels(); l++)
+         {
+            const mip_level* pLevel = tex.get_level(f, l);
+
+            h.update_obj(pLevel->get_width());
+            h.update_obj(pLevel->get_height());
+            h.update_obj(pLevel->get_format());
+            h.update_obj(pLevel->get_comp_flags());
+            h.update_obj(pLevel->get_orientation_flags());
+
+            if (pLevel->get_image())
+            {
+               const image_u8& img = *pLevel->get_image();
+               for (uint y = 0; y < img.get_height(); y++)
+                  h.update(img.get_scanline(y), img.get_width() * sizeof(color_quad_u8));
+            }
+            else if (pLevel->get_dxt_image())
+            {
+               const dxt_image& dxt = *pLevel->get_dxt_image();
+               h.update_obj(dxt.get_format());
+               h.update(dxt.get_element_ptr(), dxt.get_size_in_bytes());
+            }
+         }
+      }
+
+      h.update_obj(params.m_texture_type);
+      h.update_obj(params.m_dst_file_type);
+      h.update_obj(params.m_dst_format);
+      h.update_obj(params.m_y_flip);
+      h.update_obj(params.m_unflip);
+      h.update_obj(params.m_always_use_source_pixel_format);
+      h.update_obj(params.m_quick);
+
+      // Every crn_comp_params field that can affect the output. The image pointers and progress callback don't.
+      const crn_comp_params& cp = params.m_comp_params;
+      h.update_obj(cp.m_file_type);
+      h.update_obj(cp.m_faces);
+      h.update_obj(cp.m_width);
+      h.update_obj(cp.m_height);
+      h.update_obj(cp.m_levels);
+      h.update_obj(cp.m_format);
+      h.update_obj(cp.m_flags);
+      h.update_obj(cp.m_target_bitrate);
+      h.update_obj(cp.m_quality_level);
+      h.update_obj(cp.m_dxt1a_alpha_threshold);
+      h.update_obj(cp.m_dxt_quality);
+      h.update_obj(cp.m_dxt_compressor_type);
+      h.update_obj(cp.m_alpha_component);
+      h.update_obj(cp.m_crn_adaptive_tile_color_psnr_derating);
+      h.update_obj(cp.m_crn_adaptive_tile_alpha_psnr_derating);
+      h.update_obj(cp.m_crn_color_endpoint_palette_size);
+      h.update_obj(cp.m_crn_color_selector_palette_size);
+      h.update_obj(cp.m_crn_alpha_endpoint_palette_size);
+      h.update_obj(cp.m_crn_alpha_selector_palette_size);
+      h.update_obj(cp.m_crn_restart_interval);
+      h.update_obj(cp.m_lzma_level);
+      h.update_obj(cp.m_lzma_dict_size);
+      h.update_obj(cp.m_userdata0);
+      h.update_obj(cp.m_userdata1);
+
+      // An incremental compression's output depends on its reference file's contents.
+      if (cp.m_pCRN_reference)
+         h.update(cp.m_pCRN_reference, cp.m_crn_reference_size);
+
+      // CRN files come out the same no matter how many threads compressed them, but DXTn blocks packed by different numbers of
+      // threads can differ (see dxt_image::init()), so for anything else the effective thread count is part of the key.
+      if (params.m_dst_file_type != texture_file_types::cFormatCRN)
+      {
+         uint32 num_helper_threads = cp.m_num_helper_threads;
+         if (num_helper_threads == cCRNHelperThreadsAuto)
+            num_helper_threads = math::minimum<uint32>(crn_get_max_helper_threads(), cCRNMaxHelperThreads);
+         h.update_obj(num_helper_threads);
+      }
+
+      const crn_mipmap_params& mp = params.m_mipmap_params;
+      h.update_obj(mp.m_mode);
+      h.update_obj(mp.m_filter);
+      h.update_obj(mp.m_gamma_filtering);
+      h.update_obj(mp.m_gamma);
+      h.update_obj(mp.m_blurriness);
+      h.update_obj(mp.m_max_levels);
+      h.update_obj(mp.m_min_mip_size);
+      h.update_obj(mp.m_renormalize);
+      h.update_obj(mp.m_tiled);
+      h.update_obj(mp.m_scale_mode);
+      h.update_obj(mp.m_scale_x);
+      h.update_obj(mp.m_scale_y);
+      h.update_obj(mp.m_window_left);
+      h.update_obj(mp.m_window_top);
+      h.update_obj(mp.m_window_right);
+      h.update_obj(mp.m_window_bottom);
+      h.update_obj(mp.m_clamp_scale);
+      h.update_obj(mp.m_clamp_width);
+      h.update_obj(mp.m_clamp_height);
+
+      key = h.get_result();
+      return true;
+   }
+
+   bool texture_cache::fetch(uint64 key, texture_file_types::format file_type, const char* pDst_filename)
+   {
+      if (!is_initialized())
+         return false;
+
+      dynamic_string filename;
+      get_entry_filename(filename, key, file_type);
+
+      bool hit = false;
+
+      mmap_stream src_file;
+      if (src_file.open(filename.get_ptr()))
+      {
+         mmap_stream::unlink_if_mapped(pDst_filename);
+
+         hit = file_utils::write_buf_to_file(pDst_filename, src_file.get_ptr(), static_cast<size_t>(src_file.get_size()));
+
+         // Hits count as uses for eviction.
+         if (hit)
+            file_utils::touch_file(filename.get_ptr());
+      }
+
+      scoped_mutex lock(m_mutex);
+      if (hit)
+         m_num_hits++;
+      else
+         m_num_misses++;
+
+      return hit;
+   }
+
+   bool texture_cache::store(uint64 key, texture_file_types::format file_type, const char* pSrc_filename)
+   {
+      if (!is_initialized())
+         return false;
+
+      mmap_stream src_file;
+      if ((!src_file.open(pSrc_filename)) || (static_cast<size_t>(src_file.get_size()) != src_file.get_size()))
+         return false;
+
+      dynamic_string filename;
+      get_entry_filename(filename, key, file_type);
+
+      // Written to a temporary file first, so a half written entry is never visible to other threads or processes. The name includes
+      // both the process and thread ids, so concurrent writers of the same entry never share a temporary file.
+      dynamic_string temp_filename;
+      temp_filename.format("%s.tmp%08X%08X", filename.get_ptr(), crnlib_get_current_process_id(), static_cast<uint32>(crn_get_current_thread_id()));
+
+      if (!file_utils::write_buf_to_file(temp_filename.get_ptr(), src_file.get_ptr(), static_cast<size_t>(src_file.get_size())))
+      {
+         remove(temp_filename.get_ptr());
+         console::warning("Unable to write cache file \"%s\"", temp_filename.get_ptr());
+         return false;
+      }
+
+      // rename() won't replace existing files under Win32.
+      if (rename(temp_filename.get_ptr(), filename.get_ptr()) != 0)
+      {
+         remove(filename.get_ptr());
+         if (rename(temp_filename.get_ptr(), filename.get_ptr()) != 0)
+         {
+            remove(temp_filename.get_ptr());
+            return false;
+         }
+      }
+
+      scoped_mutex lock(m_mutex);
+
+      m_num_stores++;
+      m_total_size += src_file.get_size();
+
+      if ((m_max_size) && (m_total_size > m_max_size))
+         evict();
+
+      return true;
+   }
+
+   void texture_cache::print_stats() const
+   {
+      if (!is_initialized())
+         return;
+
+      scoped_mutex lock(m_mutex);
+
+      const uint num_lookups = m_num_hits + m_num_misses;
+      console::info("Cache: %u hits, %u misses (%3.1f%% hit rate), %u files added, %u evicted, %1.1f MB total",
+         m_num_hits, m_num_misses, num_lookups ? (m_num_hits * 100.0f / num_lookups) : 0.0f,
+         m_num_stores, m_num_evicted, m_total_size / (1024.0f * 1024.0f));
+   }
+
+   void texture_cache::get_entry_filename(dynamic_string& filename, uint64 key, texture_file_types::format file_type) const
+   {
+      dynamic_string name;
+      name.format("%08X%08X.%s", static_cast<uint32>(key >> 32U), static_cast<uint32>(key), texture_file_types::get_extension(file_type));
+
+      file_utils::combine_path(filename, m_dir.get_ptr(), name.get_ptr());
+   }
+
+   // Finds the cache's files: a 16 digit hex key followed by an extension. Anything else (like temporary files) is left alone.
+   bool texture_cache::find_entries(crnlib::vector<entry>& entries, uint64& total_size) const
+   {
+      entries.resize(0);
+      total_size = 0;
+
+      find_files file_finder;
+      if (!file_finder.find(m_dir.get_ptr(), "*", find_files::cFlagAllowFiles))
+         return false;
+
+      const find_files::file_desc_vec& files = file_finder.get_files();
+      for (uint i = 0; i < files.size(); i++)
+      {
+         const dynamic_string& name = files[i].m_name;
+         if ((name.get_len() < 18) || (name[16] != '.') || (name.find_left(".tmp") >= 0))
+            continue;
+
+         uint j;
+         for (j = 0; j < 16; j++)
+            if (!isxdigit(static_cast<uint8>(name[j])))
+               break;
+         if (j < 16)
+            continue;
+
+         entry* pEntry = entries.enlarge(1);
+         pEntry->m_filename = files[i].m_fullname;
+         file_utils::get_file_size(pEntry->m_filename.get_ptr(), pEntry->m_size);
+         file_utils::get_file_time(pEntry->m_filename.get_ptr(), pEntry->m_time);
+
+         total_size += pEntry->m_size;
+      }
+
+      return true;
+   }
+
+   // Deletes the least recently used files until the cache is 10% under its size limit, so the directory isn't rescanned on every
+   // store once it's full. m_mutex must be locked.
+   void texture_cache::evict()
+   {
+      crnlib::vector<entry> entries;
+      if (!find_entries(entries, m_total_size))
+         return;
+
+      std::sort(entries.begin(), entries.end());
+
+      const uint64 target_size = m_max_size - m_max_size / 10U;
+
+      for (uint i = 0; (i < entries.size()) && (m_total_size > target_size); i++)
+      {
+         if (remove(entries[i].m_filename.get_ptr()) != 0)
+            continue;
+
+         m_total_size -= entries[i].m_size;
+         m_num_evicted++;
+      }
+   }
+
+} // namespace crnlib
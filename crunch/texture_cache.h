@@ -0,0 +1,63 @@
+// File: texture_cache.h
+// This software is in the public domain. Please see license.txt.
+#pragma once
+#include "crn_texture_conversion.h"
+#include "crn_threading.h"
+
+namespace crnlib
+{
+   // The directory used by crunch -cache. Each file in it is a previously written output file, named after a hash of everything
+   // that determined its contents: the source texture's pixels, the conversion, mipmap and compression parameters, and crnlib's
+   // version. On a hit the cached file is copied to the destination instead of converting the texture again.
+   // Once the cached files add up to more than the size limit, the least recently used ones are deleted.
+   // Safe to use from several threads at once. Several processes may share a directory, but the size limit is only approximate then.
+   class texture_cache
+   {
+      CRNLIB_NO_COPY_OR_ASSIGNMENT_OP(texture_cache);
+
+   public:
+      texture_cache();
+
+      // Creates pDir if it doesn't exist. max_size is in bytes, 0=unlimited.
+      bool init(const char* pDir, uint64 max_size);
+
+      bool is_initialized() const { return m_dir.get_len() != 0; }
+
+      // Returns false if the conversion's output can't be cached (e.g. mipmaps split into several files).
+      static bool compute_key(const texture_conversion::convert_params& params, uint64& key);
+
+      // Returns true and writes the cached output file to pDst_filename on a hit.
+      bool fetch(uint64 key, texture_file_types::format file_type, const char* pDst_filename);
+
+      // Adds a freshly written output file to the cache.
+      bool store(uint64 key, texture_file_types::format file_type, const char* pSrc_filename);
+
+      void print_stats() const;
+
+   private:
+      struct entry
+      {
+         dynamic_string m_filename;
+         uint64 m_size;
+         uint64 m_time;
+
+         inline bool operator< (const entry& rhs) const { return m_time < rhs.m_time; }
+      };
+
+      dynamic_string m_dir;
+      uint64 m_max_size;
+      uint64 m_total_size;
+
+      uint m_num_hits;
+      uint m_num_misses;
+      uint m_num_stores;
+      uint m_num_evicted;
+
+      mutable mutex m_mutex;
+
+      void get_entry_filename(dynamic_string& filename, uint64 key, texture_file_types::format file_type) const;
+      bool find_entries(crnlib::vector<entry>& entries, uint64& total_size) const;
+      void evict();
+   };
+
+} // namespace crnlib
@@ -144,8 +144,9 @@ namespace crnd
    // crnd_unpack_begin() - Decompresses the texture's decoder tables and endpoint/selector palettes.
    // Once you call this function, you may call crnd_unpack_level() to unpack one or more mip levels.
    // Don't call this once per mip level (unless you absolutely must)!
-   // This function allocates enough memory to hold: Huffman decompression tables, and the endpoint/selector palettes (color and/or alpha).
-   // Worst case allocation is approx. 200k, assuming all palettes contain 8192 entries.
+   // This function allocates enough memory to hold: Huffman decompression tables, the endpoint/selector palettes (color and/or alpha),
+   // and the expanded palettes used by crnd_unpack_level_rgba() and crnd_unpack_level_indices().
+   // Worst case allocation is approx. 600k, assuming all palettes contain 8192 entries.
    // pData must point to a buffer holding all of the compressed .CRN file data.
    // This buffer must be stable until crnd_unpack_end() is called.
    // Returns NULL if out of memory, or if any of the input parameters are invalid.
@@ -163,6 +164,9 @@ namespace crnd
    // level_index - mipmap level index, where 0 is the largest/first level.
    // Returns false if any of the input parameters, or the compressed stream, are invalid.
    // This function does not allocate any memory.
+   // The context is only read from after crnd_unpack_begin(), so multiple threads may call crnd_unpack_level() (or crnd_unpack_level_segmented())
+   // on the same context at once, as long as each call unpacks a different level (or writes to different destination buffers).
+   // All faces of a cubemap level are coded as one serial stream, so a single level can't be split across threads.
    bool crnd_unpack_level(
       crnd_unpack_context pContext,
       void** ppDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes,
@@ -177,6 +181,63 @@ namespace crnd
       void** ppDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes,
       uint32 level_index);
 
+   // crnd_unpack_region() - Transcodes a rectangle of DXT blocks from the specified face of a mipmap level.
+   // The rectangle starts at block (block_x, block_y) and is blocks_w by blocks_h blocks. pDst receives the rectangle's blocks, with
+   // row_pitch_in_bytes between block rows (0=tightly packed). dst_size_in_bytes must be at least row_pitch_in_bytes * blocks_h.
+   // If the file was compressed with restart points (crn_comp_params::m_crn_restart_interval), decoding begins at the nearest restart point
+   // above the rectangle, otherwise all chunk rows above it (and all previous faces of the level) must be decoded and discarded.
+   // Only the rectangle is written to pDst. Not supported on segmented files.
+   // This function allocates a temporary buffer of two rows of DXT blocks. Like crnd_unpack_level(), it doesn't modify the context.
+   bool crnd_unpack_region(
+      crnd_unpack_context pContext,
+      void* pDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes,
+      uint32 level_index, uint32 face_index,
+      uint32 block_x, uint32 block_y, uint32 blocks_w, uint32 blocks_h);
+
+   // crnd_unpack_level_rgba() - Decodes the specified mipmap level directly to 32bpp pixels, 4 bytes per pixel in R,G,B,A order.
+   // No intermediate DXT blocks are written: each block is expanded from RGBA palettes cached per endpoint and selector index.
+   // ppDst - A pointer to an array of 1 or 6 destination buffer pointers, like crnd_unpack_level().
+   // row_pitch_in_bytes - The pitch in bytes from one row of pixels to the next (0=width*4). Must be a multiple of 4.
+   // dst_size_in_bytes - Size of each destination buffer, at least row_pitch_in_bytes * (height - 1) + width * 4.
+   // Pixels match crnlib's software decoder: DXT1 uses 3 color mode (with transparent black) when color0 <= color1, DXT5A writes (0,0,0,A),
+   // DXN writes X and Y to red and green with blue 0 and alpha 255, and ETC1 alpha is 255. The swizzled DXT5 formats are written unswizzled.
+   // The RGBA palettes (16 bytes per color endpoint, 4 per color selector, 8 per alpha endpoint and alpha selector) are built by
+   // crnd_unpack_begin(), so like crnd_unpack_level() this only reads the context and may be called from multiple threads at once.
+   // This function allocates a temporary buffer of two rows of DXT blocks. Not supported on segmented files.
+   bool crnd_unpack_level_rgba(
+      crnd_unpack_context pContext,
+      void** ppDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes,
+      uint32 level_index);
+
+   // The endpoint and selector palettes decoded by crnd_unpack_begin(). Each entry holds the bytes crnd_unpack_level() copies into the blocks
+   // using it: color endpoints are the first 4 bytes of a DXT1 (or ETC1) block and color selectors the last 4, alpha endpoints are the first
+   // 2 bytes of a DXT5A block and alpha selectors the last 6, stored as 3 uint16's per entry. Palettes the format doesn't use are empty.
+   struct crn_unpacked_palettes
+   {
+      const uint32*  m_pColor_endpoints;
+      uint32         m_num_color_endpoints;
+      const uint32*  m_pColor_selectors;
+      uint32         m_num_color_selectors;
+      const uint16*  m_pAlpha_endpoints;
+      uint32         m_num_alpha_endpoints;
+      const uint16*  m_pAlpha_selectors;
+      uint32         m_num_alpha_selectors;
+   };
+
+   // crnd_get_palettes() - Retrieves the context's palettes. The pointers remain valid until crnd_unpack_end() is called.
+   bool crnd_get_palettes(crnd_unpack_context pContext, crn_unpacked_palettes* pPalettes);
+
+   // crnd_unpack_level_indices() - Like crnd_unpack_level(), but writes the index of the palette entries each block was coded with instead of DXT data.
+   // Each 8 byte DXT1/ETC1 block receives its color endpoint and color selector indices as two uint32's, and each 8 byte DXT5A block its alpha
+   // endpoint and alpha selector indices as two uint16's followed by 4 zero bytes. The 16 byte formats get two 8 byte halves laid out the same way:
+   // alpha then color for the DXT5 formats, and the first then the second alpha block for DXN. crnlib uses this to recompress a texture with
+   // the palettes of a previous version (see crn_comp_params::m_pCRN_reference).
+   // Like crnd_unpack_level(), this only reads the context and may be called from multiple threads at once. Not supported on segmented files.
+   bool crnd_unpack_level_indices(
+      crnd_unpack_context pContext,
+      void** ppDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes,
+      uint32 level_index);
+
    // crnd_unpack_end() - Frees the decompress tables and unpacked palettes associated with the specified unpack context.
    // Returns false if the context is NULL, or if it points to an invalid context.
    // This function frees all memory associated with the context.
@@ -260,9 +321,21 @@ namespace crnd
    enum crn_header_flags
    {
       // If set, the compressed mipmap level data is not located after the file's base data - it will be separately managed by the user instead.
-      cCRNHeaderFlagSegmented = 1
+      cCRNHeaderFlagSegmented = 1,
+
+      // If set, the tables section is followed (in the same bitstream) by a table of restart points, see crnd_unpack_region().
+      cCRNHeaderFlagRestartPoints = 2
    };
 
+   // Restart point table layout, all fields are stored MSB first:
+   // interval (16 bits), then for each level, face, and chunk row y where (y % interval) == 0:
+   // the bit offset into the level's stream (32 bits), the pending chunk encoding bits (10 bits), and the previous endpoint and
+   // selector indices (13 bits each) of each coded component in stream order (alpha0, alpha1, color).
+   const uint32 cCRNRestartIntervalBits = 16;
+   const uint32 cCRNRestartBitOfsBits = 32;
+   const uint32 cCRNRestartChunkEncodingBits = 10;
+   const uint32 cCRNRestartIndexBits = 13;
+
    struct crn_header
    {
       enum { cCRNSigValue = ('H' << 8) | 'x' };
@@ -324,6 +397,15 @@ namespace crnd
 
 #define CRND_RESTRICT __restrict
 
+// crnd_unpack_level_rgba() expands blocks with SSE2 or NEON when the target supports it. Define CRND_NO_SIMD to use the plain C++ path.
+#if !defined(CRND_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#include <emmintrin.h>
+#define CRND_USE_SSE2 1
+#elif !defined(CRND_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define CRND_USE_NEON 1
+#endif
+
 #ifdef _MSC_VER
 #include <intrin.h>
 #pragma intrinsic(_WriteBarrier)
@@ -1633,6 +1715,9 @@ namespace crnd
    // Converts DXT5 linear alpha selector index to a raw value (inverse of g_dxt5_to_linear).
    extern const uint8 g_dxt5_from_linear[cDXT5SelectorValues];
 
+   // Converts linear color selector index (ascending intensity modifier) to a raw ETC1 pixel index.
+   extern const uint8 g_etc1_from_linear[cDXT1SelectorValues];
+
    extern const uint8 g_six_alpha_invert_table[cDXT5SelectorValues];
    extern const uint8 g_eight_alpha_invert_table[cDXT5SelectorValues];
 
@@ -1865,16 +1950,20 @@ namespace crnd
       const uint32 cMaxSupportedSyms = 8192;
       const uint32 cMaxTableBits = 11;
 
+      const uint32 cPairSymBits = 13;
+      const uint32 cPairSymMask = (1U << cPairSymBits) - 1U;
+      const uint32 cPairLenShift = cPairSymBits * 2U;
+
       class decoder_tables
       {
       public:
          inline decoder_tables() :
-            m_cur_lookup_size(0), m_lookup(NULL), m_cur_sorted_symbol_order_size(0), m_sorted_symbol_order(NULL)
+            m_cur_lookup_size(0), m_lookup(NULL), m_pair_lookup(NULL), m_cur_sorted_symbol_order_size(0), m_sorted_symbol_order(NULL)
          {
          }
 
          inline decoder_tables(const decoder_tables& other) :
-            m_cur_lookup_size(0), m_lookup(NULL), m_cur_sorted_symbol_order_size(0), m_sorted_symbol_order(NULL)
+            m_cur_lookup_size(0), m_lookup(NULL), m_pair_lookup(NULL), m_cur_sorted_symbol_order_size(0), m_sorted_symbol_order(NULL)
          {
             *this = other;
          }
@@ -1895,6 +1984,13 @@ namespace crnd
                   memcpy(m_lookup, other.m_lookup, sizeof(m_lookup[0]) * m_cur_lookup_size);
             }
 
+            if (other.m_pair_lookup)
+            {
+               m_pair_lookup = crnd_new_array<uint32>(m_cur_lookup_size);
+               if (m_pair_lookup)
+                  memcpy(m_pair_lookup, other.m_pair_lookup, sizeof(m_pair_lookup[0]) * m_cur_lookup_size);
+            }
+
             if (other.m_sorted_symbol_order)
             {
                m_sorted_symbol_order = crnd_new_array<uint16>(m_cur_sorted_symbol_order_size);
@@ -1914,6 +2010,12 @@ namespace crnd
                m_cur_lookup_size = 0;
             }
 
+            if (m_pair_lookup)
+            {
+               crnd_delete_array(m_pair_lookup);
+               m_pair_lookup = NULL;
+            }
+
             if (m_sorted_symbol_order)
             {
                crnd_delete_array(m_sorted_symbol_order);
@@ -1927,6 +2029,9 @@ namespace crnd
             if (m_lookup)
                crnd_delete_array(m_lookup);
 
+            if (m_pair_lookup)
+               crnd_delete_array(m_pair_lookup);
+
             if (m_sorted_symbol_order)
                crnd_delete_array(m_sorted_symbol_order);
          }
@@ -1951,6 +2056,10 @@ namespace crnd
          uint32                  m_cur_lookup_size;
          uint32*                 m_lookup;
 
+         // Resolves two consecutive codes whose total length fits in m_table_bits with a single probe.
+         // Each entry is sym0 | (sym1 << cPairSymBits) | (total_len << cPairLenShift), or 0 if the pair doesn't fit.
+         uint32*                 m_pair_lookup;
+
          uint32                  m_cur_sorted_symbol_order_size;
          uint16*                 m_sorted_symbol_order;
 
@@ -2014,6 +2123,9 @@ namespace crnd
       uint32 decode_bits(uint32 num_bits);
       uint32 decode(const static_huffman_data_model& model);
 
+      // Decodes two consecutive symbols coded with the same model. Short code pairs are resolved with a single table probe.
+      void decode_pair(const static_huffman_data_model& model, uint32& sym0, uint32& sym1);
+
       uint64 stop_decoding();
 
    public:
@@ -2022,8 +2134,8 @@ namespace crnd
       const uint8*         m_pDecode_buf_end;
       uint32               m_decode_buf_size;
 
-      typedef uint32 bit_buf_type;
-      enum { cBitBufSize = 32U };
+      typedef uint64 bit_buf_type;
+      enum { cBitBufSize = 64U };
       bit_buf_type         m_bit_buf;
 
       int                  m_bit_count;
@@ -2031,6 +2143,7 @@ namespace crnd
    private:
       void get_bits_init();
       uint32 get_bits(uint32 num_bits);
+      inline void refill();
    };
 
 } // namespace crnd
@@ -2038,6 +2151,7 @@ namespace crnd
 #define CRND_HUFF_DECODE_BEGIN(x)
 #define CRND_HUFF_DECODE_END(x)
 #define CRND_HUFF_DECODE(codec, model, symbol) symbol = codec.decode(model);
+#define CRND_HUFF_DECODE_PAIR(codec, model, symbol0, symbol1) codec.decode_pair(model, symbol0, symbol1);
 
 namespace crnd
 {
@@ -2299,6 +2413,13 @@ namespace crnd
                m_lookup = crnd_new_array<uint32>(table_size);
                if (!m_lookup)
                   return false;
+
+               if (m_pair_lookup)
+                  crnd_delete_array(m_pair_lookup);
+
+               m_pair_lookup = crnd_new_array<uint32>(table_size);
+               if (!m_pair_lookup)
+                  return false;
             }
 
             memset(m_lookup, 0xFF, (uint)sizeof(m_lookup[0]) * (1UL << table_bits));
@@ -2332,6 +2453,30 @@ namespace crnd
                   }
                }
             }
+
+            const uint32 table_mask = table_size - 1;
+            for (uint32 i = 0; i < table_size; i++)
+            {
+               m_pair_lookup[i] = 0;
+
+               const uint32 t0 = m_lookup[i];
+               if (t0 == cUINT32_MAX)
+                  continue;
+
+               const uint32 len0 = t0 >> 16U;
+               if (len0 >= table_bits)
+                  continue;
+
+               const uint32 t1 = m_lookup[(i << len0) & table_mask];
+               if (t1 == cUINT32_MAX)
+                  continue;
+
+               const uint32 len1 = t1 >> 16U;
+               if ((len0 + len1) > table_bits)
+                  continue;
+
+               m_pair_lookup[i] = (t0 & cUINT16_MAX) | ((t1 & cUINT16_MAX) << cPairSymBits) | ((len0 + len1) << cPairLenShift);
+            }
          }
 
          for (uint32 i = 0; i < cMaxExpectedCodeSize; i++)
@@ -2779,7 +2924,7 @@ namespace crnd
       pInfo->m_levels = pHeader->m_levels;
       pInfo->m_faces = pHeader->m_faces;
       pInfo->m_format = static_cast<crn_format>((uint32)pHeader->m_format);
-      pInfo->m_bytes_per_block = ((pHeader->m_format == cCRNFmtDXT1) || (pHeader->m_format == cCRNFmtDXT5A)) ? 8 : 16;
+      pInfo->m_bytes_per_block = crnd_get_bytes_per_dxt_block(static_cast<crn_format>((uint32)pHeader->m_format));
       pInfo->m_userdata0 = pHeader->m_userdata0;
       pInfo->m_userdata1 = pHeader->m_userdata1;
 
@@ -2810,7 +2955,7 @@ namespace crnd
       pLevel_info->m_faces = pHeader->m_faces;
       pLevel_info->m_blocks_x = (width + 3) >> 2;
       pLevel_info->m_blocks_y = (height + 3) >> 2;
-      pLevel_info->m_bytes_per_block = ((pHeader->m_format == cCRNFmtDXT1) || (pHeader->m_format == cCRNFmtDXT5A)) ? 8 : 16;
+      pLevel_info->m_bytes_per_block = crnd_get_bytes_per_dxt_block(static_cast<crn_format>((uint32)pHeader->m_format));
       pLevel_info->m_format = static_cast<crn_format>((uint32)pHeader->m_format);
 
       return true;
@@ -3217,37 +3362,58 @@ uint32 symbol_codec::get_bits(uint32 num_bits)
    return result;
 }
 
-uint32 symbol_codec::decode(const static_huffman_data_model& model)
+// Tops the bit buffer up to at least 56 bits. Away from the end of the stream this is a single unaligned big endian 64-bit load.
+// Any bits loaded past m_bit_count belong to the next byte, so it's harmless to OR them in again on the next refill.
+inline void symbol_codec::refill()
 {
-   const prefix_coding::decoder_tables* pTables = model.m_pDecode_tables;
+   if ((m_pDecode_buf_end - m_pDecode_buf_next) >= 8)
+   {
+      const uint8* p = m_pDecode_buf_next;
+#if defined(__GNUC__) && !defined(CRND_BIG_ENDIAN_PLATFORM)
+      uint64 w;
+      memcpy(&w, p, sizeof(w));
+      w = __builtin_bswap64(w);
+#elif defined(_MSC_VER) && !defined(CRND_BIG_ENDIAN_PLATFORM)
+      uint64 w;
+      memcpy(&w, p, sizeof(w));
+      w = _byteswap_uint64(w);
+#else
+      uint64 w = ((uint64)p[0] << 56U) | ((uint64)p[1] << 48U) | ((uint64)p[2] << 40U) | ((uint64)p[3] << 32U) |
+         ((uint64)p[4] << 24U) | ((uint64)p[5] << 16U) | ((uint64)p[6] << 8U) | (uint64)p[7];
+#endif
+      m_bit_buf |= (w >> m_bit_count);
 
-   if (m_bit_count < 24)
+      const uint32 num_bytes = (63U - m_bit_count) >> 3U;
+      m_pDecode_buf_next += num_bytes;
+      m_bit_count += num_bytes << 3U;
+   }
+   else
    {
-      if (m_bit_count < 16)
-      {
-         uint32 c0 = 0, c1 = 0;
-         const uint8* p = m_pDecode_buf_next;
-         if (p < m_pDecode_buf_end) c0 = *p++;
-         if (p < m_pDecode_buf_end) c1 = *p++;
-         m_pDecode_buf_next = p;
-         m_bit_count += 16;
-         uint32 c = (c0 << 8) | c1;
-         m_bit_buf |= (c << (32 - m_bit_count));
-      }
-      else
+      while (m_bit_count <= (int)(cBitBufSize - 8U))
       {
-         uint32 c = (m_pDecode_buf_next < m_pDecode_buf_end) ? *m_pDecode_buf_next++ : 0;
+         bit_buf_type c = 0;
+         if (m_pDecode_buf_next < m_pDecode_buf_end)
+            c = *m_pDecode_buf_next++;
+
          m_bit_count += 8;
-         m_bit_buf |= (c << (32 - m_bit_count));
+         m_bit_buf |= (c << (cBitBufSize - m_bit_count));
       }
    }
+}
+
+inline uint32 symbol_codec::decode(const static_huffman_data_model& model)
+{
+   const prefix_coding::decoder_tables* pTables = model.m_pDecode_tables;
+
+   if (m_bit_count < (int)prefix_coding::cMaxExpectedCodeSize)
+      refill();
 
-   uint32 k = (m_bit_buf >> 16) + 1;
+   uint32 k = static_cast<uint32>(m_bit_buf >> (cBitBufSize - 16U)) + 1;
    uint32 sym, len;
 
    if (k <= pTables->m_table_max_code)
    {
-      uint32 t = pTables->m_lookup[m_bit_buf >> (32 - pTables->m_table_bits)];
+      uint32 t = pTables->m_lookup[static_cast<uint32>(m_bit_buf >> (cBitBufSize - pTables->m_table_bits))];
 
       CRND_ASSERT(t != cUINT32_MAX);
       sym = t & cUINT16_MAX;
@@ -3266,7 +3432,7 @@ uint32 symbol_codec::decode(const static_huffman_data_model& model)
          len++;
       }
 
-      int val_ptr = pTables->m_val_ptrs[len - 1] + (m_bit_buf >> (32 - len));
+      int val_ptr = pTables->m_val_ptrs[len - 1] + static_cast<int>(m_bit_buf >> (cBitBufSize - len));
 
       if (((uint32)val_ptr >= model.m_total_syms))
       {
@@ -3284,6 +3450,32 @@ uint32 symbol_codec::decode(const static_huffman_data_model& model)
    return sym;
 }
 
+inline void symbol_codec::decode_pair(const static_huffman_data_model& model, uint32& sym0, uint32& sym1)
+{
+   const prefix_coding::decoder_tables* pTables = model.m_pDecode_tables;
+
+   if (pTables->m_table_bits)
+   {
+      if (m_bit_count < (int)prefix_coding::cMaxTableBits)
+         refill();
+
+      const uint32 t = pTables->m_pair_lookup[static_cast<uint32>(m_bit_buf >> (cBitBufSize - pTables->m_table_bits))];
+      if (t)
+      {
+         sym0 = t & prefix_coding::cPairSymMask;
+         sym1 = (t >> prefix_coding::cPairSymBits) & prefix_coding::cPairSymMask;
+
+         const uint32 len = t >> prefix_coding::cPairLenShift;
+         m_bit_buf <<= len;
+         m_bit_count -= len;
+         return;
+      }
+   }
+
+   sym0 = decode(model);
+   sym1 = decode(model);
+}
+
    uint64 symbol_codec::stop_decoding()
    {
 #if 0
@@ -3350,6 +3542,8 @@ namespace crnd
    const uint8 g_dxt5_to_linear[cDXT5SelectorValues]     = { 0U, 7U, 1U, 2U, 3U, 4U, 5U, 6U };
    const uint8 g_dxt5_from_linear[cDXT5SelectorValues]   = { 0U, 2U, 3U, 4U, 5U, 6U, 7U, 1U };
 
+   const uint8 g_etc1_from_linear[cDXT1SelectorValues]   = { 3U, 2U, 0U, 1U };
+
    const uint8 g_six_alpha_invert_table[cDXT5SelectorValues] = { 1, 0, 5, 4, 3, 2, 6, 7 };
    const uint8 g_eight_alpha_invert_table[cDXT5SelectorValues] = { 1, 0, 7, 6, 5, 4, 3, 2 };
 
@@ -3644,6 +3838,129 @@ namespace crnd
 
    static uint8 g_crnd_chunk_encoding_num_tiles[cNumChunkEncodings] = { 1, 2, 2, 3, 3, 3, 3, 4 };
 
+   // Writes a 4x4 block of RGBA8 pixels. pColors holds the block's 4 colors (in memory order), and selectors holds 2 bits per pixel in
+   // raster order. If pAlpha isn't NULL, it supplies the alpha of each of the 16 pixels.
+   static inline void expand_rgba_block(uint8* CRND_RESTRICT pDst, uint32 row_pitch_in_bytes, const uint32* pColors, uint32 selectors, const uint8* pAlpha)
+   {
+#if CRND_USE_SSE2
+      // Each row's selector byte is broadcast, masked to one 2-bit field per lane, and compared against every selector value.
+      const __m128i lane_mask = _mm_setr_epi32(3 << 0, 3 << 2, 3 << 4, 3 << 6);
+      const __m128i sel1 = _mm_setr_epi32(1 << 0, 1 << 2, 1 << 4, 1 << 6);
+      const __m128i sel2 = _mm_setr_epi32(2 << 0, 2 << 2, 2 << 4, 2 << 6);
+      const __m128i c0 = _mm_set1_epi32(pColors[0]);
+      const __m128i c1 = _mm_set1_epi32(pColors[1]);
+      const __m128i c2 = _mm_set1_epi32(pColors[2]);
+      const __m128i c3 = _mm_set1_epi32(pColors[3]);
+
+      __m128i alpha[4];
+      if (pAlpha)
+      {
+         const __m128i zero = _mm_setzero_si128();
+         const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pAlpha));
+         const __m128i a_lo = _mm_unpacklo_epi8(zero, a);
+         const __m128i a_hi = _mm_unpackhi_epi8(zero, a);
+         alpha[0] = _mm_unpacklo_epi16(zero, a_lo);
+         alpha[1] = _mm_unpackhi_epi16(zero, a_lo);
+         alpha[2] = _mm_unpacklo_epi16(zero, a_hi);
+         alpha[3] = _mm_unpackhi_epi16(zero, a_hi);
+      }
+
+      for (uint32 y = 0; y < 4; y++, selectors >>= 8)
+      {
+         const __m128i s = _mm_and_si128(_mm_set1_epi32(selectors & 0xFF), lane_mask);
+         __m128i p = _mm_and_si128(_mm_cmpeq_epi32(s, _mm_setzero_si128()), c0);
+         p = _mm_or_si128(p, _mm_and_si128(_mm_cmpeq_epi32(s, sel1), c1));
+         p = _mm_or_si128(p, _mm_and_si128(_mm_cmpeq_epi32(s, sel2), c2));
+         p = _mm_or_si128(p, _mm_and_si128(_mm_cmpeq_epi32(s, lane_mask), c3));
+         if (pAlpha)
+            p = _mm_or_si128(_mm_and_si128(p, _mm_set1_epi32(0x00FFFFFF)), alpha[y]);
+         _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + y * row_pitch_in_bytes), p);
+      }
+#elif CRND_USE_NEON
+      static const uint32 s_lane_mask[4] = { 3 << 0, 3 << 2, 3 << 4, 3 << 6 };
+      static const uint32 s_sel1[4] = { 1 << 0, 1 << 2, 1 << 4, 1 << 6 };
+      static const uint32 s_sel2[4] = { 2 << 0, 2 << 2, 2 << 4, 2 << 6 };
+      const uint32x4_t lane_mask = vld1q_u32(s_lane_mask);
+      const uint32x4_t sel1 = vld1q_u32(s_sel1);
+      const uint32x4_t sel2 = vld1q_u32(s_sel2);
+      const uint32x4_t c0 = vdupq_n_u32(pColors[0]);
+      const uint32x4_t c1 = vdupq_n_u32(pColors[1]);
+      const uint32x4_t c2 = vdupq_n_u32(pColors[2]);
+      const uint32x4_t c3 = vdupq_n_u32(pColors[3]);
+
+      uint32x4_t alpha[4];
+      if (pAlpha)
+      {
+         const uint8x16x2_t a8 = vzipq_u8(vdupq_n_u8(0), vld1q_u8(pAlpha));
+         const uint16x8x2_t a_lo = vzipq_u16(vdupq_n_u16(0), vreinterpretq_u16_u8(a8.val[0]));
+         const uint16x8x2_t a_hi = vzipq_u16(vdupq_n_u16(0), vreinterpretq_u16_u8(a8.val[1]));
+         alpha[0] = vreinterpretq_u32_u16(a_lo.val[0]);
+         alpha[1] = vreinterpretq_u32_u16(a_lo.val[1]);
+         alpha[2] = vreinterpretq_u32_u16(a_hi.val[0]);
+         alpha[3] = vreinterpretq_u32_u16(a_hi.val[1]);
+      }
+
+      for (uint32 y = 0; y < 4; y++, selectors >>= 8)
+      {
+         const uint32x4_t s = vandq_u32(vdupq_n_u32(selectors & 0xFF), lane_mask);
+         uint32x4_t p = vandq_u32(vceqq_u32(s, vdupq_n_u32(0)), c0);
+         p = vorrq_u32(p, vandq_u32(vceqq_u32(s, sel1), c1));
+         p = vorrq_u32(p, vandq_u32(vceqq_u32(s, sel2), c2));
+         p = vorrq_u32(p, vandq_u32(vceqq_u32(s, lane_mask), c3));
+         if (pAlpha)
+            p = vorrq_u32(vandq_u32(p, vdupq_n_u32(0x00FFFFFF)), alpha[y]);
+         vst1q_u32(reinterpret_cast<uint32*>(pDst + y * row_pitch_in_bytes), p);
+      }
+#else
+      for (uint32 y = 0; y < 4; y++)
+      {
+         uint8* CRND_RESTRICT pRow = pDst + y * row_pitch_in_bytes;
+         for (uint32 x = 0; x < 4; x++, selectors >>= 2)
+         {
+            memcpy(pRow + x * 4, &pColors[selectors & 3], 4);
+            if (pAlpha)
+               pRow[x * 4 + 3] = pAlpha[y * 4 + x];
+         }
+      }
+#endif
+   }
+
+   // Writes a 4x4 block of RGBA8 pixels with red and green taken from pX and pY (16 values each, raster order), blue 0 and alpha 255.
+   static inline void expand_rgba_xy_block(uint8* CRND_RESTRICT pDst, uint32 row_pitch_in_bytes, const uint8* pX, const uint8* pY)
+   {
+#if CRND_USE_SSE2
+      const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pX));
+      const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pY));
+      const __m128i xy_lo = _mm_unpacklo_epi8(x, y);
+      const __m128i xy_hi = _mm_unpackhi_epi8(x, y);
+      const __m128i ba = _mm_set1_epi16(static_cast<short>(0xFF00));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), _mm_unpacklo_epi16(xy_lo, ba));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + row_pitch_in_bytes), _mm_unpackhi_epi16(xy_lo, ba));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + row_pitch_in_bytes * 2), _mm_unpacklo_epi16(xy_hi, ba));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + row_pitch_in_bytes * 3), _mm_unpackhi_epi16(xy_hi, ba));
+#elif CRND_USE_NEON
+      const uint8x16x2_t xy = vzipq_u8(vld1q_u8(pX), vld1q_u8(pY));
+      const uint16x8x2_t lo = vzipq_u16(vreinterpretq_u16_u8(xy.val[0]), vdupq_n_u16(0xFF00));
+      const uint16x8x2_t hi = vzipq_u16(vreinterpretq_u16_u8(xy.val[1]), vdupq_n_u16(0xFF00));
+      vst1q_u16(reinterpret_cast<uint16*>(pDst), lo.val[0]);
+      vst1q_u16(reinterpret_cast<uint16*>(pDst + row_pitch_in_bytes), lo.val[1]);
+      vst1q_u16(reinterpret_cast<uint16*>(pDst + row_pitch_in_bytes * 2), hi.val[0]);
+      vst1q_u16(reinterpret_cast<uint16*>(pDst + row_pitch_in_bytes * 3), hi.val[1]);
+#else
+      for (uint32 y = 0; y < 4; y++)
+      {
+         uint8* CRND_RESTRICT pRow = pDst + y * row_pitch_in_bytes;
+         for (uint32 x = 0; x < 4; x++)
+         {
+            pRow[x * 4 + 0] = pX[y * 4 + x];
+            pRow[x * 4 + 1] = pY[y * 4 + x];
+            pRow[x * 4 + 2] = 0;
+            pRow[x * 4 + 3] = 255;
+         }
+      }
+#endif
+   }
+
    class crn_unpacker
    {
    public:
@@ -3651,8 +3968,11 @@ namespace crnd
          m_magic(cMagicValue),
          m_pData(NULL),
          m_data_size(0),
-         m_pHeader(NULL)
+         m_pHeader(NULL),
+         m_restart_interval(0)
       {
+         utils::zero_object(m_palettes);
+         utils::zero_object(m_index_palettes);
       }
 
       inline ~crn_unpacker()
@@ -3677,6 +3997,13 @@ namespace crnd
          if (!decode_palettes())
             return false;
 
+         // Built up front rather than by the first call that needs them, so the context is never written to after this.
+         if (!init_index_palettes())
+            return false;
+
+         if (!init_rgba_palettes())
+            return false;
+
          return true;
       }
 
@@ -3700,65 +4027,206 @@ namespace crnd
          void** pDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes,
          uint32 level_index)
       {
-         dst_size_in_bytes;
+         return unpack_level(pSrc, src_size_in_bytes, pDst, dst_size_in_bytes, row_pitch_in_bytes, level_index, m_palettes);
+      }
+
+      bool unpack_level_indices(void** pDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes, uint32 level_index)
+      {
+         if (m_pHeader->m_flags & cCRNHeaderFlagSegmented)
+            return false;
+         if (level_index >= m_pHeader->m_levels)
+            return false;
 
-#ifdef CRND_BUILD_DEBUG
          for (uint32 f = 0; f < m_pHeader->m_faces; f++)
             if (!pDst[f])
                return false;
-#endif
+
+         uint32 cur_level_ofs = m_pHeader->m_level_ofs[level_index];
+         uint32 next_level_ofs = m_data_size;
+         if ((level_index + 1) < (m_pHeader->m_levels))
+            next_level_ofs = m_pHeader->m_level_ofs[level_index + 1];
+         if (next_level_ofs <= cur_level_ofs)
+            return false;
+
+         return unpack_level(m_pData + cur_level_ofs, next_level_ofs - cur_level_ofs, pDst, dst_size_in_bytes, row_pitch_in_bytes, level_index, m_index_palettes);
+      }
+
+      void get_palettes(crn_unpacked_palettes& palettes) const
+      {
+         palettes.m_pColor_endpoints = m_palettes.m_pColor_endpoints;
+         palettes.m_num_color_endpoints = m_color_endpoints.size();
+         palettes.m_pColor_selectors = m_palettes.m_pColor_selectors;
+         palettes.m_num_color_selectors = m_color_selectors.size();
+         palettes.m_pAlpha_endpoints = m_palettes.m_pAlpha_endpoints;
+         palettes.m_num_alpha_endpoints = m_alpha_endpoints.size();
+         palettes.m_pAlpha_selectors = m_palettes.m_pAlpha_selectors;
+         palettes.m_num_alpha_selectors = m_alpha_selectors.size() / 3;
+      }
+
+      bool unpack_region(
+         void* pDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes,
+         uint32 level_index, uint32 face_index,
+         uint32 block_x, uint32 block_y, uint32 blocks_w, uint32 blocks_h)
+      {
+         if (m_pHeader->m_flags & cCRNHeaderFlagSegmented)
+            return false;
+         if ((level_index >= m_pHeader->m_levels) || (face_index >= m_pHeader->m_faces))
+            return false;
 
          const uint32 width = math::maximum(m_pHeader->m_width >> level_index, 1U);
          const uint32 height = math::maximum(m_pHeader->m_height >> level_index, 1U);
          const uint32 blocks_x = (width + 3U) >> 2U;
          const uint32 blocks_y = (height + 3U) >> 2U;
-         const uint32 block_size = ((m_pHeader->m_format == cCRNFmtDXT1) || (m_pHeader->m_format == cCRNFmtDXT5A)) ? 8 : 16;
+         const uint32 block_size = get_block_size();
 
-         uint32 minimal_row_pitch = block_size * blocks_x;
+         if ((!blocks_w) || (!blocks_h) || (block_x >= blocks_x) || (block_y >= blocks_y) || (blocks_w > (blocks_x - block_x)) || (blocks_h > (blocks_y - block_y)))
+            return false;
+
+         const uint32 minimal_row_pitch = block_size * blocks_w;
          if (!row_pitch_in_bytes)
             row_pitch_in_bytes = minimal_row_pitch;
-         else if ((row_pitch_in_bytes < minimal_row_pitch) || (row_pitch_in_bytes & 3))
+         else if (row_pitch_in_bytes < minimal_row_pitch)
             return false;
-         if (dst_size_in_bytes < row_pitch_in_bytes * blocks_y)
+         if (dst_size_in_bytes < row_pitch_in_bytes * (blocks_h - 1) + minimal_row_pitch)
             return false;
 
          const uint32 chunks_x = (blocks_x + 1) >> 1;
          const uint32 chunks_y = (blocks_y + 1) >> 1;
+         const uint32 first_chunk_y = block_y >> 1;
+         const uint32 end_chunk_y = (block_y + blocks_h + 1) >> 1;
 
-#if CRND_CREATE_BYTE_STREAMS
-         crnd_trace("Index stream: %u bytes\n", src_size_in_bytes);
-#endif
-
-         if (!m_codec.start_decoding(static_cast<const crnd::uint8*>(pSrc), src_size_in_bytes))
+         uint32 cur_level_ofs = m_pHeader->m_level_ofs[level_index];
+         uint32 next_level_ofs = m_data_size;
+         if ((level_index + 1) < (m_pHeader->m_levels))
+            next_level_ofs = m_pHeader->m_level_ofs[level_index + 1];
+         if (next_level_ofs <= cur_level_ofs)
             return false;
 
-         bool status = false;
-         switch (m_pHeader->m_format)
+         // Find the closest restart point at or above the rectangle. Without restart points, decoding starts at the beginning of the level's stream.
+         unpack_state state;
+         utils::zero_object(state);
+         state.m_chunk_encoding_bits = 1;
+
+         uint32 start_face = 0, start_chunk_y = 0, start_bit_ofs = 0;
+         if (m_restart_interval)
          {
-         case cCRNFmtDXT1:
-            status = unpack_dxt1((uint8**)pDst, dst_size_in_bytes, row_pitch_in_bytes, blocks_x, blocks_y, chunks_x, chunks_y);
-            break;
-         case cCRNFmtDXT5:
-         case cCRNFmtDXT5_CCxY:
-         case cCRNFmtDXT5_xGBR:
-         case cCRNFmtDXT5_AGBR:
-         case cCRNFmtDXT5_xGxR:
-            status = unpack_dxt5((uint8**)pDst, dst_size_in_bytes, row_pitch_in_bytes, blocks_x, blocks_y, chunks_x, chunks_y);
-            break;
-         case cCRNFmtDXT5A:
-            status = unpack_dxt5a((uint8**)pDst, dst_size_in_bytes, row_pitch_in_bytes, blocks_x, blocks_y, chunks_x, chunks_y);
-            break;
-         case cCRNFmtDXN_XY:
-         case cCRNFmtDXN_YX:
-            status = unpack_dxn((uint8**)pDst, dst_size_in_bytes, row_pitch_in_bytes, blocks_x, blocks_y, chunks_x, chunks_y);
-            break;
-         default:
+            const uint32 restarts_per_face = (chunks_y + m_restart_interval - 1) / m_restart_interval;
+            const restart_point& r = m_restart_points[level_index][face_index * restarts_per_face + first_chunk_y / m_restart_interval];
+            start_face = face_index;
+            start_chunk_y = (first_chunk_y / m_restart_interval) * m_restart_interval;
+            start_bit_ofs = r.m_bit_ofs;
+            state = r.m_state;
+         }
+
+         if ((start_bit_ofs >> 3) >= (next_level_ofs - cur_level_ofs))
+            return false;
+
+         symbol_codec codec;
+         if (!codec.start_decoding(m_pData + cur_level_ofs + (start_bit_ofs >> 3), next_level_ofs - cur_level_ofs - (start_bit_ofs >> 3)))
+            return false;
+         codec.decode_bits(start_bit_ofs & 7);
+
+         // Chunk rows are decoded one at a time into a two block row scratch buffer, which is then copied out if it overlaps the rectangle.
+         const uint32 scratch_pitch = blocks_x * block_size;
+         crnd::vector<uint8> scratch;
+         if (!scratch.resize(scratch_pitch * 2))
             return false;
+
+         for (uint32 f = start_face; f <= face_index; f++)
+         {
+            const uint32 end_y = (f == face_index) ? end_chunk_y : chunks_y;
+            for (uint32 y = (f == start_face) ? start_chunk_y : 0; y < end_y; y++)
+            {
+               if (!unpack_chunk_rows(codec, state, m_palettes, &scratch[0], scratch_pitch, blocks_x, blocks_y, chunks_x, chunks_y, y, y + 1))
+                  return false;
+
+               if ((f != face_index) || (y < first_chunk_y))
+                  continue;
+
+               for (uint32 by = 0; by < 2; by++)
+               {
+                  const uint32 src_block_y = y * 2 + by;
+                  if ((src_block_y < block_y) || (src_block_y >= (block_y + blocks_h)))
+                     continue;
+
+                  memcpy(static_cast<uint8*>(pDst) + (src_block_y - block_y) * row_pitch_in_bytes, &scratch[by * scratch_pitch + block_x * block_size], minimal_row_pitch);
+               }
+            }
          }
-         if (!status)
+
+         codec.stop_decoding();
+         return true;
+      }
+
+      bool unpack_level_rgba(void** pDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes, uint32 level_index)
+      {
+         if (m_pHeader->m_flags & cCRNHeaderFlagSegmented)
+            return false;
+         if (level_index >= m_pHeader->m_levels)
             return false;
 
-         m_codec.stop_decoding();
+         for (uint32 f = 0; f < m_pHeader->m_faces; f++)
+            if (!pDst[f])
+               return false;
+
+         const uint32 width = math::maximum(m_pHeader->m_width >> level_index, 1U);
+         const uint32 height = math::maximum(m_pHeader->m_height >> level_index, 1U);
+         const uint32 blocks_x = (width + 3U) >> 2U;
+         const uint32 blocks_y = (height + 3U) >> 2U;
+         const uint32 block_size = get_block_size();
+
+         const uint32 minimal_row_pitch = width * 4;
+         if (!row_pitch_in_bytes)
+            row_pitch_in_bytes = minimal_row_pitch;
+         else if ((row_pitch_in_bytes < minimal_row_pitch) || (row_pitch_in_bytes & 3))
+            return false;
+         if (dst_size_in_bytes < row_pitch_in_bytes * (height - 1) + minimal_row_pitch)
+            return false;
+
+         const uint32 chunks_x = (blocks_x + 1) >> 1;
+         const uint32 chunks_y = (blocks_y + 1) >> 1;
+
+         uint32 cur_level_ofs = m_pHeader->m_level_ofs[level_index];
+         uint32 next_level_ofs = m_data_size;
+         if ((level_index + 1) < (m_pHeader->m_levels))
+            next_level_ofs = m_pHeader->m_level_ofs[level_index + 1];
+         if (next_level_ofs <= cur_level_ofs)
+            return false;
+
+         symbol_codec codec;
+         if (!codec.start_decoding(m_pData + cur_level_ofs, next_level_ofs - cur_level_ofs))
+            return false;
+
+         unpack_state state;
+         utils::zero_object(state);
+         state.m_chunk_encoding_bits = 1;
+
+         // Each chunk row is decoded to palette indices in a two block row scratch buffer, then expanded straight into the destination.
+         const uint32 scratch_pitch = blocks_x * block_size;
+         crnd::vector<uint8> scratch;
+         if (!scratch.resize(scratch_pitch * 2))
+            return false;
+
+         for (uint32 f = 0; f < m_pHeader->m_faces; f++)
+         {
+            for (uint32 y = 0; y < chunks_y; y++)
+            {
+               if (!unpack_chunk_rows(codec, state, m_index_palettes, &scratch[0], scratch_pitch, blocks_x, blocks_y, chunks_x, chunks_y, y, y + 1))
+                  return false;
+
+               for (uint32 by = 0; by < 2; by++)
+               {
+                  const uint32 block_y = y * 2 + by;
+                  if (block_y >= blocks_y)
+                     break;
+
+                  expand_rgba_block_row(&scratch[by * scratch_pitch], static_cast<uint8*>(pDst[f]) + block_y * 4 * row_pitch_in_bytes, row_pitch_in_bytes,
+                     blocks_x, width, math::minimum(4U, height - block_y * 4));
+               }
+            }
+         }
+
+         codec.stop_decoding();
          return true;
       }
 
@@ -3776,6 +4244,24 @@ namespace crnd
 
       symbol_codec       m_codec;
 
+      // Predictor state carried from one chunk to the next within a level's stream.
+      struct unpack_state
+      {
+         uint32 m_chunk_encoding_bits;
+         uint32 m_prev_endpoint_index[2];
+         uint32 m_prev_selector_index[2];
+      };
+
+      struct restart_point
+      {
+         uint32 m_bit_ofs;
+         unpack_state m_state;
+      };
+
+      // Restart points of each level, indexed by face * ceil(chunks_y / m_restart_interval) + chunk_y / m_restart_interval.
+      uint32 m_restart_interval;
+      crnd::vector<restart_point> m_restart_points[cCRNMaxLevels];
+
       static_huffman_data_model m_chunk_encoding_dm;
       static_huffman_data_model m_endpoint_delta_dm[2];
       static_huffman_data_model m_selector_delta_dm[2];
@@ -3786,6 +4272,29 @@ namespace crnd
       crnd::vector<uint16> m_alpha_endpoints;
       crnd::vector<uint16> m_alpha_selectors;
 
+      // The palettes the chunk decoders copy endpoints and selectors from.
+      struct palette_set
+      {
+         const uint32* m_pColor_endpoints;
+         const uint32* m_pColor_selectors;
+         const uint16* m_pAlpha_endpoints;
+         const uint16* m_pAlpha_selectors;
+      };
+
+      palette_set m_palettes;
+
+      // Built by init(). The index palettes map each entry to its own index, so decoding with them writes palette indices into the block
+      // fields instead of DXT data. The RGBA palettes expand those indices to pixels.
+      palette_set m_index_palettes;
+      crnd::vector<uint32> m_index_colors;
+      crnd::vector<uint16> m_index_alpha_endpoints;
+      crnd::vector<uint16> m_index_alpha_selectors;
+
+      crnd::vector<uint32> m_rgba_color_endpoints;   // 4 colors per endpoint, indexed by selector value
+      crnd::vector<uint32> m_rgba_color_selectors;   // 2 bit selector values in raster order
+      crnd::vector<uint8>  m_rgba_alpha_endpoints;   // 8 values per endpoint, indexed by selector value
+      crnd::vector<uint64> m_rgba_alpha_selectors;   // 3 bit selector values in raster order
+
       bool init_tables()
       {
          if (!m_codec.start_decoding(m_pData + m_pHeader->m_tables_ofs, m_pHeader->m_tables_size))
@@ -3809,39 +4318,386 @@ namespace crnd
             if (!m_codec.decode_receive_static_data_model(m_selector_delta_dm[1])) return false;
          }
 
+         if (m_pHeader->m_flags & cCRNHeaderFlagRestartPoints)
+         {
+            if (!decode_restart_points())
+               return false;
+         }
+
          m_codec.stop_decoding();
 
          return true;
       }
 
-      bool decode_palettes()
+      inline uint32 get_block_size() const
       {
-         if (m_pHeader->m_color_endpoints.m_num)
-         {
-            if (!decode_color_endpoints()) return false;
-            if (!decode_color_selectors()) return false;
-         }
+         return ((m_pHeader->m_format == cCRNFmtDXT1) || (m_pHeader->m_format == cCRNFmtDXT5A) || (m_pHeader->m_format == cCRNFmtETC1)) ? 8 : 16;
+      }
 
-         if (m_pHeader->m_alpha_endpoints.m_num)
+      // Number of components with their own predictor state in the level streams.
+      inline uint32 get_num_coded_comps() const
+      {
+         switch (m_pHeader->m_format)
          {
-            if (!decode_alpha_endpoints()) return false;
-            if (!decode_alpha_selectors()) return false;
+         case cCRNFmtDXT1:
+         case cCRNFmtDXT5A:
+         case cCRNFmtETC1:
+            return 1;
+         default:
+            break;
          }
-
-         return true;
+         return 2;
       }
 
-      bool decode_color_endpoints()
+      bool decode_restart_points()
       {
-         const uint32 num_color_endpoints = m_pHeader->m_color_endpoints.m_num;
-
-         if (!m_color_endpoints.resize(num_color_endpoints))
+         m_restart_interval = m_codec.decode_bits(cCRNRestartIntervalBits);
+         if (!m_restart_interval)
             return false;
 
-         if (!m_codec.start_decoding(m_pData + m_pHeader->m_color_endpoints.m_ofs, m_pHeader->m_color_endpoints.m_size))
-            return false;
+         const uint32 num_comps = get_num_coded_comps();
 
-         static_huffman_data_model dm[2];
+         for (uint32 level_index = 0; level_index < m_pHeader->m_levels; level_index++)
+         {
+            const uint32 height = math::maximum(m_pHeader->m_height >> level_index, 1U);
+            const uint32 chunks_y = (((height + 3U) >> 2U) + 1) >> 1;
+            const uint32 restarts_per_face = (chunks_y + m_restart_interval - 1) / m_restart_interval;
+
+            crnd::vector<restart_point>& points = m_restart_points[level_index];
+            if (!points.resize(restarts_per_face * m_pHeader->m_faces))
+               return false;
+
+            for (uint32 i = 0; i < points.size(); i++)
+            {
+               restart_point& r = points[i];
+               utils::zero_object(r);
+
+               r.m_bit_ofs = m_codec.decode_bits(cCRNRestartBitOfsBits);
+               r.m_state.m_chunk_encoding_bits = m_codec.decode_bits(cCRNRestartChunkEncodingBits);
+               if (!r.m_state.m_chunk_encoding_bits)
+                  return false;
+
+               for (uint32 c = 0; c < num_comps; c++)
+               {
+                  r.m_state.m_prev_endpoint_index[c] = m_codec.decode_bits(cCRNRestartIndexBits);
+                  r.m_state.m_prev_selector_index[c] = m_codec.decode_bits(cCRNRestartIndexBits);
+               }
+            }
+         }
+
+         return true;
+      }
+
+      bool unpack_chunk_rows(symbol_codec& codec, unpack_state& state, const palette_set& pal, uint8* pDst, uint32 row_pitch_in_bytes, uint32 blocks_x, uint32 blocks_y, uint32 chunks_x, uint32 chunks_y, uint32 first_chunk_y, uint32 end_chunk_y)
+      {
+         switch (m_pHeader->m_format)
+         {
+         // ETC1 palette entries are already complete ETC1 block halves, so the DXT1 chunk decoder applies unchanged.
+         case cCRNFmtDXT1:
+         case cCRNFmtETC1:
+            return unpack_dxt1(codec, state, pal, pDst, row_pitch_in_bytes, blocks_x, blocks_y, chunks_x, chunks_y, first_chunk_y, end_chunk_y);
+         case cCRNFmtDXT5:
+         case cCRNFmtDXT5_CCxY:
+         case cCRNFmtDXT5_xGBR:
+         case cCRNFmtDXT5_AGBR:
+         case cCRNFmtDXT5_xGxR:
+            return unpack_dxt5(codec, state, pal, pDst, row_pitch_in_bytes, blocks_x, blocks_y, chunks_x, chunks_y, first_chunk_y, end_chunk_y);
+         case cCRNFmtDXT5A:
+            return unpack_dxt5a(codec, state, pal, pDst, row_pitch_in_bytes, blocks_x, blocks_y, chunks_x, chunks_y, first_chunk_y, end_chunk_y);
+         case cCRNFmtDXN_XY:
+         case cCRNFmtDXN_YX:
+            return unpack_dxn(codec, state, pal, pDst, row_pitch_in_bytes, blocks_x, blocks_y, chunks_x, chunks_y, first_chunk_y, end_chunk_y);
+         default:
+            break;
+         }
+         return false;
+      }
+
+      bool unpack_level(
+         const void* pSrc, uint32 src_size_in_bytes,
+         void** pDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes,
+         uint32 level_index, const palette_set& pal)
+      {
+         dst_size_in_bytes;
+
+#ifdef CRND_BUILD_DEBUG
+         for (uint32 f = 0; f < m_pHeader->m_faces; f++)
+            if (!pDst[f])
+               return false;
+#endif
+
+         const uint32 width = math::maximum(m_pHeader->m_width >> level_index, 1U);
+         const uint32 height = math::maximum(m_pHeader->m_height >> level_index, 1U);
+         const uint32 blocks_x = (width + 3U) >> 2U;
+         const uint32 blocks_y = (height + 3U) >> 2U;
+         const uint32 block_size = get_block_size();
+
+         uint32 minimal_row_pitch = block_size * blocks_x;
+         if (!row_pitch_in_bytes)
+            row_pitch_in_bytes = minimal_row_pitch;
+         else if ((row_pitch_in_bytes < minimal_row_pitch) || (row_pitch_in_bytes & 3))
+            return false;
+         if (dst_size_in_bytes < row_pitch_in_bytes * blocks_y)
+            return false;
+
+         const uint32 chunks_x = (blocks_x + 1) >> 1;
+         const uint32 chunks_y = (blocks_y + 1) >> 1;
+
+#if CRND_CREATE_BYTE_STREAMS
+         crnd_trace("Index stream: %u bytes\n", src_size_in_bytes);
+#endif
+
+         // Each call decodes through its own codec, so the context's tables and palettes are only read here.
+         symbol_codec codec;
+         if (!codec.start_decoding(static_cast<const crnd::uint8*>(pSrc), src_size_in_bytes))
+            return false;
+
+         // The faces of a level are coded back to back, so the predictor state carries over from one face to the next.
+         unpack_state state;
+         utils::zero_object(state);
+         state.m_chunk_encoding_bits = 1;
+
+         for (uint32 f = 0; f < m_pHeader->m_faces; f++)
+         {
+            if (!unpack_chunk_rows(codec, state, pal, static_cast<uint8*>(pDst[f]), row_pitch_in_bytes, blocks_x, blocks_y, chunks_x, chunks_y, 0, chunks_y))
+               return false;
+         }
+
+         codec.stop_decoding();
+         return true;
+      }
+
+      bool init_index_palettes()
+      {
+         const uint32 num_color_endpoints = m_color_endpoints.size();
+         const uint32 num_color_selectors = m_color_selectors.size();
+         const uint32 num_alpha_endpoints = m_alpha_endpoints.size();
+         const uint32 num_alpha_selectors = m_alpha_selectors.size() / 3;
+
+         if (!m_index_colors.resize(math::maximum(num_color_endpoints, num_color_selectors)))
+            return false;
+         for (uint32 i = 0; i < m_index_colors.size(); i++)
+            m_index_colors[i] = i;
+
+         if (!m_index_alpha_endpoints.resize(num_alpha_endpoints))
+            return false;
+         for (uint32 i = 0; i < num_alpha_endpoints; i++)
+            m_index_alpha_endpoints[i] = static_cast<uint16>(i);
+
+         if (!m_index_alpha_selectors.resize(num_alpha_selectors * 3))
+            return false;
+         for (uint32 i = 0; i < num_alpha_selectors; i++)
+         {
+            m_index_alpha_selectors[i * 3 + 0] = static_cast<uint16>(i);
+            m_index_alpha_selectors[i * 3 + 1] = 0;
+            m_index_alpha_selectors[i * 3 + 2] = 0;
+         }
+
+         m_index_palettes.m_pColor_endpoints = m_index_colors.empty() ? NULL : &m_index_colors[0];
+         m_index_palettes.m_pColor_selectors = m_index_palettes.m_pColor_endpoints;
+         m_index_palettes.m_pAlpha_endpoints = m_index_alpha_endpoints.empty() ? NULL : &m_index_alpha_endpoints[0];
+         m_index_palettes.m_pAlpha_selectors = m_index_alpha_selectors.empty() ? NULL : &m_index_alpha_selectors[0];
+
+         return true;
+      }
+
+      bool init_rgba_palettes()
+      {
+         const uint32 num_color_endpoints = m_color_endpoints.size();
+         const uint32 num_color_selectors = m_color_selectors.size();
+         const uint32 num_alpha_endpoints = m_alpha_endpoints.size();
+         const uint32 num_alpha_selectors = m_alpha_selectors.size() / 3;
+
+         // The palette entries are read as bytes in block order, so the tables come out the same on big endian platforms.
+         const bool etc1 = m_pHeader->m_format == cCRNFmtETC1;
+
+         if (!m_rgba_color_endpoints.resize(num_color_endpoints * 4))
+            return false;
+         for (uint32 i = 0; i < num_color_endpoints; i++)
+         {
+            const uint8* p = reinterpret_cast<const uint8*>(&m_color_endpoints[i]);
+            color_quad_u8 colors[4];
+            if (etc1)
+            {
+               // ETC1 entries are differential mode block halves with a zero delta, so both subblocks share one base color and table.
+               static const int s_etc1_modifiers[8][4] =
+               {
+                  { 2, 8, -2, -8 }, { 5, 17, -5, -17 }, { 9, 29, -9, -29 }, { 13, 42, -13, -42 },
+                  { 18, 60, -18, -60 }, { 24, 80, -24, -80 }, { 33, 106, -33, -106 }, { 47, 183, -47, -183 }
+               };
+               const int r = (p[0] & 0xF8) | (p[0] >> 5), g = (p[1] & 0xF8) | (p[1] >> 5), b = (p[2] & 0xF8) | (p[2] >> 5);
+               const int* pModifiers = s_etc1_modifiers[p[3] >> 5];
+               for (uint32 s = 0; s < 4; s++)
+                  colors[s].set(r + pModifiers[s], g + pModifiers[s], b + pModifiers[s], 255);
+            }
+            else
+               dxt1_block::get_block_colors(colors, static_cast<uint16>(p[0] | (p[1] << 8)), static_cast<uint16>(p[2] | (p[3] << 8)));
+
+            for (uint32 s = 0; s < 4; s++)
+            {
+               uint8* q = reinterpret_cast<uint8*>(&m_rgba_color_endpoints[i * 4 + s]);
+               q[0] = colors[s].r;
+               q[1] = colors[s].g;
+               q[2] = colors[s].b;
+               q[3] = colors[s].a;
+            }
+         }
+
+         if (!m_rgba_color_selectors.resize(num_color_selectors))
+            return false;
+         for (uint32 i = 0; i < num_color_selectors; i++)
+         {
+            const uint8* p = reinterpret_cast<const uint8*>(&m_color_selectors[i]);
+            uint32 s = 0;
+            if (etc1)
+            {
+               // ETC1 selectors are two bit planes in column major order.
+               const uint32 msb = (p[0] << 8) | p[1], lsb = (p[2] << 8) | p[3];
+               for (uint32 y = 0; y < 4; y++)
+               {
+                  for (uint32 x = 0; x < 4; x++)
+                  {
+                     const uint32 bit = x * 4 + y;
+                     s |= ((((msb >> bit) & 1) << 1) | ((lsb >> bit) & 1)) << ((y * 4 + x) * 2);
+                  }
+               }
+            }
+            else
+               s = p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+            m_rgba_color_selectors[i] = s;
+         }
+
+         if (!m_rgba_alpha_endpoints.resize(num_alpha_endpoints * 8))
+            return false;
+         for (uint32 i = 0; i < num_alpha_endpoints; i++)
+         {
+            const uint8* p = reinterpret_cast<const uint8*>(&m_alpha_endpoints[i]);
+            uint32 values[8];
+            dxt5_block::get_block_values(values, p[0], p[1]);
+            for (uint32 s = 0; s < 8; s++)
+               m_rgba_alpha_endpoints[i * 8 + s] = static_cast<uint8>(values[s]);
+         }
+
+         if (!m_rgba_alpha_selectors.resize(num_alpha_selectors))
+            return false;
+         for (uint32 i = 0; i < num_alpha_selectors; i++)
+         {
+            const uint8* p = reinterpret_cast<const uint8*>(&m_alpha_selectors[i * 3]);
+            uint64 s = 0;
+            for (uint32 j = 0; j < 6; j++)
+               s |= static_cast<uint64>(p[j]) << (j * 8);
+            m_rgba_alpha_selectors[i] = s;
+         }
+
+         return true;
+      }
+
+      inline void get_rgba_alpha_values(uint8* pDst, uint32 endpoint_index, uint32 selector_index) const
+      {
+         const uint8* pValues = &m_rgba_alpha_endpoints[endpoint_index * 8];
+         uint64 s = m_rgba_alpha_selectors[selector_index];
+         for (uint32 i = 0; i < 16; i++, s >>= 3)
+            pDst[i] = pValues[s & 7];
+      }
+
+      // Expands one row of blocks decoded with m_index_palettes to RGBA8 pixels, clipping the last block column and the rows to the level.
+      void expand_rgba_block_row(const uint8* pBlocks, uint8* pDst, uint32 row_pitch_in_bytes, uint32 blocks_x, uint32 width, uint32 rows) const
+      {
+         static const uint32 s_black[4] = { 0, 0, 0, 0 };
+         uint32 pixels[16];
+         uint8 alpha0[16], alpha1[16];
+
+         const crn_format fmt = static_cast<crn_format>(static_cast<uint32>(m_pHeader->m_format));
+
+         for (uint32 bx = 0; bx < blocks_x; bx++)
+         {
+            const uint32 cols = math::minimum(4U, width - bx * 4);
+            const bool clipped = (cols < 4) || (rows < 4);
+            uint8* pOut = clipped ? reinterpret_cast<uint8*>(pixels) : (pDst + bx * 16);
+            const uint32 out_pitch = clipped ? 16 : row_pitch_in_bytes;
+
+            switch (fmt)
+            {
+               case cCRNFmtDXT1:
+               case cCRNFmtETC1:
+               {
+                  const uint32* pB = reinterpret_cast<const uint32*>(pBlocks + bx * 8);
+                  expand_rgba_block(pOut, out_pitch, &m_rgba_color_endpoints[pB[0] * 4], m_rgba_color_selectors[pB[1]], NULL);
+                  break;
+               }
+               case cCRNFmtDXT5A:
+               {
+                  const uint16* pA = reinterpret_cast<const uint16*>(pBlocks + bx * 8);
+                  get_rgba_alpha_values(alpha0, pA[0], pA[1]);
+                  expand_rgba_block(pOut, out_pitch, s_black, 0, alpha0);
+                  break;
+               }
+               case cCRNFmtDXN_XY:
+               case cCRNFmtDXN_YX:
+               {
+                  const uint16* pA = reinterpret_cast<const uint16*>(pBlocks + bx * 16);
+                  get_rgba_alpha_values(alpha0, pA[0], pA[1]);
+                  get_rgba_alpha_values(alpha1, pA[4], pA[5]);
+                  if (fmt == cCRNFmtDXN_XY)
+                     expand_rgba_xy_block(pOut, out_pitch, alpha0, alpha1);
+                  else
+                     expand_rgba_xy_block(pOut, out_pitch, alpha1, alpha0);
+                  break;
+               }
+               default:
+               {
+                  const uint16* pA = reinterpret_cast<const uint16*>(pBlocks + bx * 16);
+                  const uint32* pB = reinterpret_cast<const uint32*>(pBlocks + bx * 16 + 8);
+                  get_rgba_alpha_values(alpha0, pA[0], pA[1]);
+                  expand_rgba_block(pOut, out_pitch, &m_rgba_color_endpoints[pB[0] * 4], m_rgba_color_selectors[pB[1]], alpha0);
+                  break;
+               }
+            }
+
+            if (clipped)
+            {
+               for (uint32 y = 0; y < rows; y++)
+                  memcpy(pDst + bx * 16 + y * row_pitch_in_bytes, &pixels[y * 4], cols * 4);
+            }
+         }
+      }
+
+      bool decode_palettes()
+      {
+         if (m_pHeader->m_color_endpoints.m_num)
+         {
+            if (!decode_color_endpoints()) return false;
+            if (!decode_color_selectors()) return false;
+         }
+
+         if (m_pHeader->m_alpha_endpoints.m_num)
+         {
+            if (!decode_alpha_endpoints()) return false;
+            if (!decode_alpha_selectors()) return false;
+         }
+
+         m_palettes.m_pColor_endpoints = m_color_endpoints.empty() ? NULL : &m_color_endpoints[0];
+         m_palettes.m_pColor_selectors = m_color_selectors.empty() ? NULL : &m_color_selectors[0];
+         m_palettes.m_pAlpha_endpoints = m_alpha_endpoints.empty() ? NULL : &m_alpha_endpoints[0];
+         m_palettes.m_pAlpha_selectors = m_alpha_selectors.empty() ? NULL : &m_alpha_selectors[0];
+
+         return true;
+      }
+
+      bool decode_color_endpoints()
+      {
+         const uint32 num_color_endpoints = m_pHeader->m_color_endpoints.m_num;
+
+         if (!m_color_endpoints.resize(num_color_endpoints))
+            return false;
+
+         if (!m_codec.start_decoding(m_pData + m_pHeader->m_color_endpoints.m_ofs, m_pHeader->m_color_endpoints.m_size))
+            return false;
+
+         if (m_pHeader->m_format == cCRNFmtETC1)
+            return decode_etc1_endpoints();
+
+         static_huffman_data_model dm[2];
          for (uint32 i = 0; i < 2; i++)
             if (!m_codec.decode_receive_static_data_model(dm[i]))
                return false;
@@ -3895,6 +4751,46 @@ namespace crnd
          return true;
       }
 
+      // Each ETC1 endpoint is a 5:5:5 base color and an intensity table, which expand to the first 4 bytes of a differential mode
+      // ETC1 block with a zero color delta, no flip, and the same table in both subblocks.
+      bool decode_etc1_endpoints()
+      {
+         static_huffman_data_model dm[2];
+         for (uint32 i = 0; i < 2; i++)
+            if (!m_codec.decode_receive_static_data_model(dm[i]))
+               return false;
+
+         const uint32 num_color_endpoints = m_pHeader->m_color_endpoints.m_num;
+
+         uint32 r = 0, g = 0, b = 0, t = 0;
+
+         uint32* CRND_RESTRICT pDst = &m_color_endpoints[0];
+
+         CRND_HUFF_DECODE_BEGIN(m_codec);
+
+         for (uint32 i = 0; i < num_color_endpoints; i++)
+         {
+            uint32 dr, dg, db, dt;
+            CRND_HUFF_DECODE(m_codec, dm[0], dr); r = (r + dr) & 31;
+            CRND_HUFF_DECODE(m_codec, dm[0], dg); g = (g + dg) & 31;
+            CRND_HUFF_DECODE(m_codec, dm[0], db); b = (b + db) & 31;
+            CRND_HUFF_DECODE(m_codec, dm[1], dt); t = (t + dt) & 7;
+
+            const uint32 flags = (t << 5U) | (t << 2U) | 2U;
+
+            if (c_crnd_little_endian_platform)
+               *pDst++ = (r << 3U) | (g << 11U) | (b << 19U) | (flags << 24U);
+            else
+               *pDst++ = (r << 27U) | (g << 19U) | (b << 11U) | flags;
+         }
+
+         CRND_HUFF_DECODE_END(m_codec);
+
+         m_codec.stop_decoding();
+
+         return true;
+      }
+
       bool decode_color_selectors()
       {
          const uint32 cMaxSelectorValue = 3U;
@@ -3933,6 +4829,7 @@ namespace crnd
          uint32* CRND_RESTRICT pDst = &m_color_selectors[0];
 
          const uint8* pFrom_linear = g_dxt1_from_linear;
+         const bool etc1 = m_pHeader->m_format == cCRNFmtETC1;
 
          CRND_HUFF_DECODE_BEGIN(m_codec);
 
@@ -3942,20 +4839,40 @@ namespace crnd
 
          for (uint32 i = 0; i < num_color_selectors; i++)
          {
-            for (uint32 j = 0; j < 8; j++)
+            for (uint32 j = 0; j < 8; j += 2)
             {
-               int32 sym;
-               CRND_HUFF_DECODE(m_codec, dm, sym);
+               uint32 sym0, sym1;
+               CRND_HUFF_DECODE_PAIR(m_codec, dm, sym0, sym1);
 
 #if CRND_CREATE_BYTE_STREAMS
-               byte_stream.push_back(sym);
+               byte_stream.push_back(sym0);
+               byte_stream.push_back(sym1);
 #endif
 
-               cur[j*2+0] = (delta0[sym] + cur[j*2+0]) & 3;
-               cur[j*2+1] = (delta1[sym] + cur[j*2+1]) & 3;
+               cur[j*2+0] = (delta0[sym0] + cur[j*2+0]) & 3;
+               cur[j*2+1] = (delta1[sym0] + cur[j*2+1]) & 3;
+               cur[j*2+2] = (delta0[sym1] + cur[j*2+2]) & 3;
+               cur[j*2+3] = (delta1[sym1] + cur[j*2+3]) & 3;
             }
 
-            if (c_crnd_little_endian_platform)
+            if (etc1)
+            {
+               // cur[] is in raster order, ETC1 stores each pixel index's MSB and LSB in separate 16-bit column major planes.
+               uint32 msb = 0, lsb = 0;
+               for (uint32 p = 0; p < 16; p++)
+               {
+                  const uint32 v = g_etc1_from_linear[cur[p]];
+                  const uint32 bit = ((p & 3U) << 2U) | (p >> 2U);
+                  msb |= (v >> 1U) << bit;
+                  lsb |= (v & 1U) << bit;
+               }
+
+               if (c_crnd_little_endian_platform)
+                  *pDst++ = (msb >> 8U) | ((msb & 0xFFU) << 8U) | ((lsb >> 8U) << 16U) | ((lsb & 0xFFU) << 24U);
+               else
+                  *pDst++ = (msb << 16U) | lsb;
+            }
+            else if (c_crnd_little_endian_platform)
             {
                *pDst++ =
                   (pFrom_linear[cur[0 ]]      ) | (pFrom_linear[cur[1 ]] <<  2) | (pFrom_linear[cur[2 ]] <<  4) | (pFrom_linear[cur[3 ]] <<  6) |
@@ -4006,8 +4923,7 @@ namespace crnd
 
          for (uint32 i = 0; i < num_alpha_endpoints; i++)
          {
-            uint sa; CRND_HUFF_DECODE(m_codec, dm, sa);
-            uint sb; CRND_HUFF_DECODE(m_codec, dm, sb);
+            uint32 sa, sb; CRND_HUFF_DECODE_PAIR(m_codec, dm, sa, sb);
 
             a = (sa + a) & 255;
             b = (sb + b) & 255;
@@ -4065,13 +4981,15 @@ namespace crnd
 
          for (uint32 i = 0; i < num_alpha_selectors; i++)
          {
-            for (uint32 j = 0; j < 8; j++)
+            for (uint32 j = 0; j < 8; j += 2)
             {
-               int32 sym;
-               CRND_HUFF_DECODE(m_codec, dm, sym);
+               uint32 sym0, sym1;
+               CRND_HUFF_DECODE_PAIR(m_codec, dm, sym0, sym1);
 
-               cur[j*2+0] = (delta0[sym] + cur[j*2+0]) & 7;
-               cur[j*2+1] = (delta1[sym] + cur[j*2+1]) & 7;
+               cur[j*2+0] = (delta0[sym0] + cur[j*2+0]) & 7;
+               cur[j*2+1] = (delta1[sym0] + cur[j*2+1]) & 7;
+               cur[j*2+2] = (delta0[sym1] + cur[j*2+2]) & 7;
+               cur[j*2+3] = (delta1[sym1] + cur[j*2+3]) & 7;
                //cur[j*2+0] = ((sym%15)-7 + cur[j*2+0]) & 7;
                //cur[j*2+1] = ((sym/15)-7 + cur[j*2+1]) & 7;
             }
@@ -4133,25 +5051,21 @@ namespace crnd
          x = (x & msk) | (v & ~msk);
       }
 
-      bool unpack_dxt1(uint8** pDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes, uint32 blocks_x, uint32 blocks_y, uint32 chunks_x, uint32 chunks_y)
+      bool unpack_dxt1(symbol_codec& codec, unpack_state& state, const palette_set& pal, uint8* pDst, uint32 row_pitch_in_bytes, uint32 blocks_x, uint32 blocks_y, uint32 chunks_x, uint32 chunks_y, uint32 first_chunk_y, uint32 end_chunk_y)
       {
-         dst_size_in_bytes;
-
-         uint32 chunk_encoding_bits = 1;
+         uint32 chunk_encoding_bits = state.m_chunk_encoding_bits;
 
          const uint32 num_color_endpoints = m_color_endpoints.size();
          const uint32 num_color_selectors = m_color_selectors.size();
 
-         uint32 prev_color_endpoint_index = 0;
-         uint32 prev_color_selector_index = 0;
-
-         const uint32 num_faces = m_pHeader->m_faces;
+         uint32 prev_color_endpoint_index = state.m_prev_endpoint_index[0];
+         uint32 prev_color_selector_index = state.m_prev_selector_index[0];
 
          const uint32 row_pitch_in_dwords = row_pitch_in_bytes >> 2U;
 
          const int32 cBytesPerBlock = 8;
 
-         CRND_HUFF_DECODE_BEGIN(m_codec);
+         CRND_HUFF_DECODE_BEGIN(codec);
 
 #if CRND_CREATE_BYTE_STREAMS
          vector<uint8> tile_encoding_stream;
@@ -4159,156 +5073,164 @@ namespace crnd
          vector<uint8> selector_indices_stream;
 #endif
 
-         for (uint32 f = 0; f < num_faces; f++)
+         uint8* CRND_RESTRICT pRow = pDst;
+
+         for (uint32 y = first_chunk_y; y < end_chunk_y; y++)
          {
-            uint8* CRND_RESTRICT pRow = pDst[f];
+            int32 start_x = 0;
+            int32 end_x = chunks_x;
+            int32 dir_x = 1;
+            int32 block_delta = cBytesPerBlock*2;
+            uint8* CRND_RESTRICT pBlock = pRow;
 
-            for (uint32 y = 0; y < chunks_y; y++)
+            if (y & 1)
             {
-               int32 start_x = 0;
-               int32 end_x = chunks_x;
-               int32 dir_x = 1;
-               int32 block_delta = cBytesPerBlock*2;
-               uint8* CRND_RESTRICT pBlock = pRow;
+               start_x = chunks_x - 1;
+               end_x = -1;
+               dir_x = -1;
+               block_delta = -cBytesPerBlock*2;
+               pBlock += (chunks_x - 1) * cBytesPerBlock * 2;
+            }
 
-               if (y & 1)
-               {
-                  start_x = chunks_x - 1;
-                  end_x = -1;
-                  dir_x = -1;
-                  block_delta = -cBytesPerBlock*2;
-                  pBlock += (chunks_x - 1) * cBytesPerBlock * 2;
-               }
+            const bool skip_bottom_row = (y == (chunks_y - 1)) && (blocks_y & 1);
 
-               const bool skip_bottom_row = (y == (chunks_y - 1)) && (blocks_y & 1);
+            for (int32 x = start_x; x != end_x; x += dir_x)
+            {
+               uint32 color_endpoints[4];
 
-               for (int32 x = start_x; x != end_x; x += dir_x)
+               if (chunk_encoding_bits == 1)
                {
-                  uint32 color_endpoints[4];
-
-                  if (chunk_encoding_bits == 1)
-                  {
-                     CRND_HUFF_DECODE(m_codec, m_chunk_encoding_dm, chunk_encoding_bits);
+                  CRND_HUFF_DECODE(codec, m_chunk_encoding_dm, chunk_encoding_bits);
 #if CRND_CREATE_BYTE_STREAMS
-                     tile_encoding_stream.push_back(chunk_encoding_bits & 7);
-                     tile_encoding_stream.push_back((chunk_encoding_bits >> 3) & 7);
-                     tile_encoding_stream.push_back((chunk_encoding_bits >> 6) & 7);
+                  tile_encoding_stream.push_back(chunk_encoding_bits & 7);
+                  tile_encoding_stream.push_back((chunk_encoding_bits >> 3) & 7);
+                  tile_encoding_stream.push_back((chunk_encoding_bits >> 6) & 7);
 #endif
-                     chunk_encoding_bits |= 512;
-                  }
+                  chunk_encoding_bits |= 512;
+               }
 
-                  const uint32 chunk_encoding_index = chunk_encoding_bits & 7;
-                  chunk_encoding_bits >>= 3;
+               const uint32 chunk_encoding_index = chunk_encoding_bits & 7;
+               chunk_encoding_bits >>= 3;
 
-                  const uint32 num_tiles = g_crnd_chunk_encoding_num_tiles[chunk_encoding_index];
+               const uint32 num_tiles = g_crnd_chunk_encoding_num_tiles[chunk_encoding_index];
 
-                  for (uint32 i = 0; i < num_tiles; i++)
+               // Endpoints are decoded two at a time. With an odd tile count the last pair's second delta is 0 and lands in an unused slot.
+               for (uint32 i = 0; i < num_tiles; i += 2)
+               {
+                  uint32 delta0, delta1;
+                  if ((i + 1) < num_tiles)
+                  {
+                     CRND_HUFF_DECODE_PAIR(codec, m_endpoint_delta_dm[0], delta0, delta1);
+                  }
+                  else
                   {
-                     uint32 delta;
-                     CRND_HUFF_DECODE(m_codec, m_endpoint_delta_dm[0], delta);
+                     CRND_HUFF_DECODE(codec, m_endpoint_delta_dm[0], delta0);
+                     delta1 = 0;
+                  }
 #if CRND_CREATE_BYTE_STREAMS
-                     endpoint_indices_stream.push_back(delta);
+                  endpoint_indices_stream.push_back(delta0);
+                  if ((i + 1) < num_tiles)
+                     endpoint_indices_stream.push_back(delta1);
 #endif
-                     prev_color_endpoint_index += delta;
-                     limit(prev_color_endpoint_index, num_color_endpoints);
-                     color_endpoints[i] = m_color_endpoints[prev_color_endpoint_index];
-                  }
-
-                  const uint8* pTile_indices = g_crnd_chunk_encoding_tiles[chunk_encoding_index].m_tiles;
+                  prev_color_endpoint_index += delta0;
+                  limit(prev_color_endpoint_index, num_color_endpoints);
+                  color_endpoints[i] = pal.m_pColor_endpoints[prev_color_endpoint_index];
+                  prev_color_endpoint_index += delta1;
+                  limit(prev_color_endpoint_index, num_color_endpoints);
+                  color_endpoints[i + 1] = pal.m_pColor_endpoints[prev_color_endpoint_index];
+               }
 
-                  const bool skip_right_col = (blocks_x & 1) && (x == ((int32)chunks_x - 1));
+               const uint8* pTile_indices = g_crnd_chunk_encoding_tiles[chunk_encoding_index].m_tiles;
 
-                  uint32* CRND_RESTRICT pD = (uint32*)pBlock;
+               const bool skip_right_col = (blocks_x & 1) && (x == ((int32)chunks_x - 1));
 
-                  if ((!skip_bottom_row) && (!skip_right_col))
-                  {
-                     //CRND_ASSERT( ((uint8*)&pD[4 + row_pitch_in_dwords] - pDst) <= dst_size_in_bytes );
+               uint32* CRND_RESTRICT pD = (uint32*)pBlock;
 
-                     pD[0] = color_endpoints[pTile_indices[0]];
-                     CRND_WRITE_BARRIER
-                     uint32 delta0;
-                     CRND_HUFF_DECODE(m_codec, m_selector_delta_dm[0], delta0);
-#if CRND_CREATE_BYTE_STREAMS
-                     selector_indices_stream.push_back(delta0);
-#endif
-                     prev_color_selector_index += delta0;
-                     limit(prev_color_selector_index, num_color_selectors);
-                     pD[1] = m_color_selectors[prev_color_selector_index];
-                     CRND_WRITE_BARRIER
+               if ((!skip_bottom_row) && (!skip_right_col))
+               {
+                  //CRND_ASSERT( ((uint8*)&pD[4 + row_pitch_in_dwords] - pDst) <= dst_size_in_bytes );
 
-                     pD[2] = color_endpoints[pTile_indices[1]];
-                     CRND_WRITE_BARRIER
-                     uint32 delta1;
-                     CRND_HUFF_DECODE(m_codec, m_selector_delta_dm[0], delta1);
+                  uint32 delta0, delta1;
+                  CRND_HUFF_DECODE_PAIR(codec, m_selector_delta_dm[0], delta0, delta1);
 #if CRND_CREATE_BYTE_STREAMS
-                     selector_indices_stream.push_back(delta1);
+                  selector_indices_stream.push_back(delta0);
+                  selector_indices_stream.push_back(delta1);
 #endif
-                     prev_color_selector_index += delta1;
-                     limit(prev_color_selector_index, num_color_selectors);
-                     pD[3] = m_color_selectors[prev_color_selector_index];
-                     CRND_WRITE_BARRIER
 
-                     pD[0 + row_pitch_in_dwords] = color_endpoints[pTile_indices[2]];
-                     CRND_WRITE_BARRIER
-                     uint32 delta2;
-                     CRND_HUFF_DECODE(m_codec, m_selector_delta_dm[0], delta2);
+                  pD[0] = color_endpoints[pTile_indices[0]];
+                  CRND_WRITE_BARRIER
+                  prev_color_selector_index += delta0;
+                  limit(prev_color_selector_index, num_color_selectors);
+                  pD[1] = pal.m_pColor_selectors[prev_color_selector_index];
+                  CRND_WRITE_BARRIER
+
+                  pD[2] = color_endpoints[pTile_indices[1]];
+                  CRND_WRITE_BARRIER
+                  prev_color_selector_index += delta1;
+                  limit(prev_color_selector_index, num_color_selectors);
+                  pD[3] = pal.m_pColor_selectors[prev_color_selector_index];
+                  CRND_WRITE_BARRIER
+
+                  uint32 delta2, delta3;
+                  CRND_HUFF_DECODE_PAIR(codec, m_selector_delta_dm[0], delta2, delta3);
 #if CRND_CREATE_BYTE_STREAMS
-                     selector_indices_stream.push_back(delta2);
+                  selector_indices_stream.push_back(delta2);
+                  selector_indices_stream.push_back(delta3);
 #endif
-                     prev_color_selector_index += delta2;
-                     limit(prev_color_selector_index, num_color_selectors);
-                     pD[1 + row_pitch_in_dwords] = m_color_selectors[prev_color_selector_index];
-                     CRND_WRITE_BARRIER
 
-                     pD[2 + row_pitch_in_dwords] = color_endpoints[pTile_indices[3]];
-                     CRND_WRITE_BARRIER
-                     uint32 delta3;
-                     CRND_HUFF_DECODE(m_codec, m_selector_delta_dm[0], delta3);
-#if CRND_CREATE_BYTE_STREAMS
-                     selector_indices_stream.push_back(delta3);
-#endif
-                     prev_color_selector_index += delta3;
-                     limit(prev_color_selector_index, num_color_selectors);
-                     pD[3 + row_pitch_in_dwords] = m_color_selectors[prev_color_selector_index];
-                     CRND_WRITE_BARRIER
-                  }
-                  else
+                  pD[0 + row_pitch_in_dwords] = color_endpoints[pTile_indices[2]];
+                  CRND_WRITE_BARRIER
+                  prev_color_selector_index += delta2;
+                  limit(prev_color_selector_index, num_color_selectors);
+                  pD[1 + row_pitch_in_dwords] = pal.m_pColor_selectors[prev_color_selector_index];
+                  CRND_WRITE_BARRIER
+
+                  pD[2 + row_pitch_in_dwords] = color_endpoints[pTile_indices[3]];
+                  CRND_WRITE_BARRIER
+                  prev_color_selector_index += delta3;
+                  limit(prev_color_selector_index, num_color_selectors);
+                  pD[3 + row_pitch_in_dwords] = pal.m_pColor_selectors[prev_color_selector_index];
+                  CRND_WRITE_BARRIER
+               }
+               else
+               {
+                  for (uint32 by = 0; by < 2; by++)
                   {
-                     for (uint32 by = 0; by < 2; by++)
+                     pD = (uint32*)((uint8*)pBlock + row_pitch_in_bytes * by);
+                     for (uint32 bx = 0; bx < 2; bx++, pD += 2)
                      {
-                        pD = (uint32*)((uint8*)pBlock + row_pitch_in_bytes * by);
-                        for (uint32 bx = 0; bx < 2; bx++, pD += 2)
-                        {
-                           uint32 delta;
-                           CRND_HUFF_DECODE(m_codec, m_selector_delta_dm[0], delta);
+                        uint32 delta;
+                        CRND_HUFF_DECODE(codec, m_selector_delta_dm[0], delta);
 #if CRND_CREATE_BYTE_STREAMS
-                           selector_indices_stream.push_back(delta);
+                        selector_indices_stream.push_back(delta);
 #endif
-                           prev_color_selector_index += delta;
-                           limit(prev_color_selector_index, num_color_selectors);
-
-                           if (!((bx && skip_right_col) || (by && skip_bottom_row)))
-                           {
-                              pD[0] = color_endpoints[pTile_indices[bx + by * 2]];
-                              CRND_WRITE_BARRIER
-                              pD[1] = m_color_selectors[prev_color_selector_index];
-                              CRND_WRITE_BARRIER
-                           }
+                        prev_color_selector_index += delta;
+                        limit(prev_color_selector_index, num_color_selectors);
+
+                        if (!((bx && skip_right_col) || (by && skip_bottom_row)))
+                        {
+                           pD[0] = color_endpoints[pTile_indices[bx + by * 2]];
+                           CRND_WRITE_BARRIER
+                           pD[1] = pal.m_pColor_selectors[prev_color_selector_index];
+                           CRND_WRITE_BARRIER
                         }
                      }
                   }
+               }
 
-                  pBlock += block_delta;
+               pBlock += block_delta;
 
-               } // x
+            } // x
 
-               pRow += row_pitch_in_bytes * 2;
+            pRow += row_pitch_in_bytes * 2;
 
-            } // y
+         } // y
 
-         } // f
+         CRND_HUFF_DECODE_END(codec);
 
-         CRND_HUFF_DECODE_END(m_codec);
+         state.m_chunk_encoding_bits = chunk_encoding_bits;
+         state.m_prev_endpoint_index[0] = prev_color_endpoint_index;
+         state.m_prev_selector_index[0] = prev_color_selector_index;
 
 #if CRND_CREATE_BYTE_STREAMS
          write_array_to_file(L"tile_encodings.bin", tile_encoding_stream);
@@ -4319,403 +5241,455 @@ namespace crnd
          return true;
       }
 
-      bool unpack_dxt5(uint8** pDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes, uint32 blocks_x, uint32 blocks_y, uint32 chunks_x, uint32 chunks_y)
+      bool unpack_dxt5(symbol_codec& codec, unpack_state& state, const palette_set& pal, uint8* pDst, uint32 row_pitch_in_bytes, uint32 blocks_x, uint32 blocks_y, uint32 chunks_x, uint32 chunks_y, uint32 first_chunk_y, uint32 end_chunk_y)
       {
-         dst_size_in_bytes;
-
-         uint32 chunk_encoding_bits = 1;
+         uint32 chunk_encoding_bits = state.m_chunk_encoding_bits;
 
          const uint32 num_color_endpoints = m_color_endpoints.size();
          const uint32 num_color_selectors = m_color_selectors.size();
          const uint32 num_alpha_endpoints = m_alpha_endpoints.size();
          const uint32 num_alpha_selectors = m_pHeader->m_alpha_selectors.m_num;
 
-         uint32 prev_color_endpoint_index = 0;
-         uint32 prev_color_selector_index = 0;
-         uint32 prev_alpha_endpoint_index = 0;
-         uint32 prev_alpha_selector_index = 0;
-
-         const uint32 num_faces = m_pHeader->m_faces;
+         uint32 prev_color_endpoint_index = state.m_prev_endpoint_index[1];
+         uint32 prev_color_selector_index = state.m_prev_selector_index[1];
+         uint32 prev_alpha_endpoint_index = state.m_prev_endpoint_index[0];
+         uint32 prev_alpha_selector_index = state.m_prev_selector_index[0];
 
          //const uint32 row_pitch_in_dwords = row_pitch_in_bytes >> 2U;
 
          const int32 cBytesPerBlock = 16;
 
-         CRND_HUFF_DECODE_BEGIN(m_codec);
+         CRND_HUFF_DECODE_BEGIN(codec);
+
+         uint8* CRND_RESTRICT pRow = pDst;
 
-         for (uint32 f = 0; f < num_faces; f++)
+         for (uint32 y = first_chunk_y; y < end_chunk_y; y++)
          {
-            uint8* CRND_RESTRICT pRow = pDst[f];
+            int32 start_x = 0;
+            int32 end_x = chunks_x;
+            int32 dir_x = 1;
+            int32 block_delta = cBytesPerBlock*2;
+            uint8* CRND_RESTRICT pBlock = pRow;
 
-            for (uint32 y = 0; y < chunks_y; y++)
+            if (y & 1)
             {
-               int32 start_x = 0;
-               int32 end_x = chunks_x;
-               int32 dir_x = 1;
-               int32 block_delta = cBytesPerBlock*2;
-               uint8* CRND_RESTRICT pBlock = pRow;
+               start_x = chunks_x - 1;
+               end_x = -1;
+               dir_x = -1;
+               block_delta = -cBytesPerBlock*2;
+               pBlock += (chunks_x - 1) * cBytesPerBlock * 2;
+            }
 
-               if (y & 1)
-               {
-                  start_x = chunks_x - 1;
-                  end_x = -1;
-                  dir_x = -1;
-                  block_delta = -cBytesPerBlock*2;
-                  pBlock += (chunks_x - 1) * cBytesPerBlock * 2;
-               }
+            const bool skip_bottom_row = (y == (chunks_y - 1)) && (blocks_y & 1);
 
-               const bool skip_bottom_row = (y == (chunks_y - 1)) && (blocks_y & 1);
+            for (int32 x = start_x; x != end_x; x += dir_x)
+            {
+               uint32 color_endpoints[4];
+               uint32 alpha_endpoints[4];
 
-               for (int32 x = start_x; x != end_x; x += dir_x)
+               if (chunk_encoding_bits == 1)
                {
-                  uint32 color_endpoints[4];
-                  uint32 alpha_endpoints[4];
-
-                  if (chunk_encoding_bits == 1)
-                  {
-                     CRND_HUFF_DECODE(m_codec, m_chunk_encoding_dm, chunk_encoding_bits);
-                     chunk_encoding_bits |= 512;
-                  }
+                  CRND_HUFF_DECODE(codec, m_chunk_encoding_dm, chunk_encoding_bits);
+                  chunk_encoding_bits |= 512;
+               }
 
-                  const uint32 chunk_encoding_index = chunk_encoding_bits & 7;
-                  chunk_encoding_bits >>= 3;
+               const uint32 chunk_encoding_index = chunk_encoding_bits & 7;
+               chunk_encoding_bits >>= 3;
 
-                  const uint32 num_tiles = g_crnd_chunk_encoding_num_tiles[chunk_encoding_index];
+               const uint32 num_tiles = g_crnd_chunk_encoding_num_tiles[chunk_encoding_index];
 
-                  const uint8* pTile_indices = g_crnd_chunk_encoding_tiles[chunk_encoding_index].m_tiles;
+               const uint8* pTile_indices = g_crnd_chunk_encoding_tiles[chunk_encoding_index].m_tiles;
 
-                  const bool skip_right_col = (blocks_x & 1) && (x == ((int32)chunks_x - 1));
+               const bool skip_right_col = (blocks_x & 1) && (x == ((int32)chunks_x - 1));
 
-                  uint32* CRND_RESTRICT pD = (uint32*)pBlock;
+               uint32* CRND_RESTRICT pD = (uint32*)pBlock;
 
-                  for (uint32 i = 0; i < num_tiles; i++)
+               for (uint32 i = 0; i < num_tiles; i += 2)
+               {
+                  uint32 delta0, delta1;
+                  if ((i + 1) < num_tiles)
+                  {
+                     CRND_HUFF_DECODE_PAIR(codec, m_endpoint_delta_dm[1], delta0, delta1);
+                  }
+                  else
                   {
-                     uint32 delta; CRND_HUFF_DECODE(m_codec, m_endpoint_delta_dm[1], delta);
-                     prev_alpha_endpoint_index += delta;
-                     limit(prev_alpha_endpoint_index, num_alpha_endpoints);
-                     alpha_endpoints[i] = m_alpha_endpoints[prev_alpha_endpoint_index];
+                     CRND_HUFF_DECODE(codec, m_endpoint_delta_dm[1], delta0);
+                     delta1 = 0;
                   }
+                  prev_alpha_endpoint_index += delta0;
+                  limit(prev_alpha_endpoint_index, num_alpha_endpoints);
+                  alpha_endpoints[i] = pal.m_pAlpha_endpoints[prev_alpha_endpoint_index];
+                  prev_alpha_endpoint_index += delta1;
+                  limit(prev_alpha_endpoint_index, num_alpha_endpoints);
+                  alpha_endpoints[i + 1] = pal.m_pAlpha_endpoints[prev_alpha_endpoint_index];
+               }
 
-                  for (uint32 i = 0; i < num_tiles; i++)
+               for (uint32 i = 0; i < num_tiles; i += 2)
+               {
+                  uint32 delta0, delta1;
+                  if ((i + 1) < num_tiles)
                   {
-                     uint32 delta; CRND_HUFF_DECODE(m_codec, m_endpoint_delta_dm[0], delta);
-                     prev_color_endpoint_index += delta;
-                     limit(prev_color_endpoint_index, num_color_endpoints);
-                     color_endpoints[i] = m_color_endpoints[prev_color_endpoint_index];
+                     CRND_HUFF_DECODE_PAIR(codec, m_endpoint_delta_dm[0], delta0, delta1);
                   }
+                  else
+                  {
+                     CRND_HUFF_DECODE(codec, m_endpoint_delta_dm[0], delta0);
+                     delta1 = 0;
+                  }
+                  prev_color_endpoint_index += delta0;
+                  limit(prev_color_endpoint_index, num_color_endpoints);
+                  color_endpoints[i] = pal.m_pColor_endpoints[prev_color_endpoint_index];
+                  prev_color_endpoint_index += delta1;
+                  limit(prev_color_endpoint_index, num_color_endpoints);
+                  color_endpoints[i + 1] = pal.m_pColor_endpoints[prev_color_endpoint_index];
+               }
 
-                  pD = (uint32*)pBlock;
-                  for (uint32 by = 0; by < 2; by++)
+               pD = (uint32*)pBlock;
+               for (uint32 by = 0; by < 2; by++)
+               {
+                  for (uint32 bx = 0; bx < 2; bx++, pD += 4)
                   {
-                     for (uint32 bx = 0; bx < 2; bx++, pD += 4)
-                     {
-                        uint32 delta0; CRND_HUFF_DECODE(m_codec, m_selector_delta_dm[1], delta0);
-                        prev_alpha_selector_index += delta0;
-                        limit(prev_alpha_selector_index, num_alpha_selectors);
+                     uint32 delta0; CRND_HUFF_DECODE(codec, m_selector_delta_dm[1], delta0);
+                     prev_alpha_selector_index += delta0;
+                     limit(prev_alpha_selector_index, num_alpha_selectors);
 
-                        uint32 delta1; CRND_HUFF_DECODE(m_codec, m_selector_delta_dm[0], delta1);
-                        prev_color_selector_index += delta1;
-                        limit(prev_color_selector_index, num_color_selectors);
+                     uint32 delta1; CRND_HUFF_DECODE(codec, m_selector_delta_dm[0], delta1);
+                     prev_color_selector_index += delta1;
+                     limit(prev_color_selector_index, num_color_selectors);
 
-                        if (!((bx && skip_right_col) || (by && skip_bottom_row)))
-                        {
-                           const uint32 tile_index = pTile_indices[bx + by * 2];
-                           const uint16* pAlpha_selectors = &m_alpha_selectors[prev_alpha_selector_index * 3];
+                     if (!((bx && skip_right_col) || (by && skip_bottom_row)))
+                     {
+                        const uint32 tile_index = pTile_indices[bx + by * 2];
+                        const uint16* pAlpha_selectors = &pal.m_pAlpha_selectors[prev_alpha_selector_index * 3];
 
 #ifdef CRND_BIG_ENDIAN_PLATFORM
-                           pD[0] = (alpha_endpoints[tile_index] << 16) | pAlpha_selectors[0];
-                           CRND_WRITE_BARRIER
-                           pD[1] = (pAlpha_selectors[1] << 16) | pAlpha_selectors[2];
-                           CRND_WRITE_BARRIER
-                           pD[2] = color_endpoints[tile_index];
-                           CRND_WRITE_BARRIER
-                           pD[3] = m_color_selectors[prev_color_selector_index];
-                           CRND_WRITE_BARRIER
+                        pD[0] = (alpha_endpoints[tile_index] << 16) | pAlpha_selectors[0];
+                        CRND_WRITE_BARRIER
+                        pD[1] = (pAlpha_selectors[1] << 16) | pAlpha_selectors[2];
+                        CRND_WRITE_BARRIER
+                        pD[2] = color_endpoints[tile_index];
+                        CRND_WRITE_BARRIER
+                        pD[3] = pal.m_pColor_selectors[prev_color_selector_index];
+                        CRND_WRITE_BARRIER
 #else
-                           pD[0] = alpha_endpoints[tile_index] | (pAlpha_selectors[0] << 16);
-                           CRND_WRITE_BARRIER
-                           pD[1] = pAlpha_selectors[1] | (pAlpha_selectors[2] << 16);
-                           CRND_WRITE_BARRIER
-                           pD[2] = color_endpoints[tile_index];
-                           CRND_WRITE_BARRIER
-                           pD[3] = m_color_selectors[prev_color_selector_index];
-                           CRND_WRITE_BARRIER
+                        pD[0] = alpha_endpoints[tile_index] | (pAlpha_selectors[0] << 16);
+                        CRND_WRITE_BARRIER
+                        pD[1] = pAlpha_selectors[1] | (pAlpha_selectors[2] << 16);
+                        CRND_WRITE_BARRIER
+                        pD[2] = color_endpoints[tile_index];
+                        CRND_WRITE_BARRIER
+                        pD[3] = pal.m_pColor_selectors[prev_color_selector_index];
+                        CRND_WRITE_BARRIER
 #endif
-                        }
                      }
-
-                     pD = (uint32*)((uint8*)pD - cBytesPerBlock * 2 + row_pitch_in_bytes);
                   }
 
-                  pBlock += block_delta;
+                  pD = (uint32*)((uint8*)pD - cBytesPerBlock * 2 + row_pitch_in_bytes);
+               }
 
-               } // x
+               pBlock += block_delta;
 
-               pRow += row_pitch_in_bytes * 2;
+            } // x
 
-            } // y
+            pRow += row_pitch_in_bytes * 2;
 
-         } // f
+         } // y
 
-         CRND_HUFF_DECODE_END(m_codec);
+         CRND_HUFF_DECODE_END(codec);
+
+         state.m_chunk_encoding_bits = chunk_encoding_bits;
+         state.m_prev_endpoint_index[0] = prev_alpha_endpoint_index;
+         state.m_prev_selector_index[0] = prev_alpha_selector_index;
+         state.m_prev_endpoint_index[1] = prev_color_endpoint_index;
+         state.m_prev_selector_index[1] = prev_color_selector_index;
 
          return true;
       }
 
-      bool unpack_dxn(uint8** pDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes, uint32 blocks_x, uint32 blocks_y, uint32 chunks_x, uint32 chunks_y)
+      bool unpack_dxn(symbol_codec& codec, unpack_state& state, const palette_set& pal, uint8* pDst, uint32 row_pitch_in_bytes, uint32 blocks_x, uint32 blocks_y, uint32 chunks_x, uint32 chunks_y, uint32 first_chunk_y, uint32 end_chunk_y)
       {
-         dst_size_in_bytes;
-
-         uint32 chunk_encoding_bits = 1;
+         uint32 chunk_encoding_bits = state.m_chunk_encoding_bits;
 
          const uint32 num_alpha_endpoints = m_alpha_endpoints.size();
          const uint32 num_alpha_selectors = m_pHeader->m_alpha_selectors.m_num;
 
-         uint32 prev_alpha0_endpoint_index = 0;
-         uint32 prev_alpha0_selector_index = 0;
-         uint32 prev_alpha1_endpoint_index = 0;
-         uint32 prev_alpha1_selector_index = 0;
-
-         const uint32 num_faces = m_pHeader->m_faces;
+         uint32 prev_alpha0_endpoint_index = state.m_prev_endpoint_index[0];
+         uint32 prev_alpha0_selector_index = state.m_prev_selector_index[0];
+         uint32 prev_alpha1_endpoint_index = state.m_prev_endpoint_index[1];
+         uint32 prev_alpha1_selector_index = state.m_prev_selector_index[1];
 
          //const uint32 row_pitch_in_dwords = row_pitch_in_bytes >> 2U;
 
          const int32 cBytesPerBlock = 16;
 
-         CRND_HUFF_DECODE_BEGIN(m_codec);
+         CRND_HUFF_DECODE_BEGIN(codec);
 
-         for (uint32 f = 0; f < num_faces; f++)
+         uint8* CRND_RESTRICT pRow = pDst;
+
+         for (uint32 y = first_chunk_y; y < end_chunk_y; y++)
          {
-            uint8* CRND_RESTRICT pRow = pDst[f];
+            int32 start_x = 0;
+            int32 end_x = chunks_x;
+            int32 dir_x = 1;
+            int32 block_delta = cBytesPerBlock*2;
+            uint8* CRND_RESTRICT pBlock = pRow;
 
-            for (uint32 y = 0; y < chunks_y; y++)
+            if (y & 1)
             {
-               int32 start_x = 0;
-               int32 end_x = chunks_x;
-               int32 dir_x = 1;
-               int32 block_delta = cBytesPerBlock*2;
-               uint8* CRND_RESTRICT pBlock = pRow;
+               start_x = chunks_x - 1;
+               end_x = -1;
+               dir_x = -1;
+               block_delta = -cBytesPerBlock*2;
+               pBlock += (chunks_x - 1) * cBytesPerBlock * 2;
+            }
 
-               if (y & 1)
-               {
-                  start_x = chunks_x - 1;
-                  end_x = -1;
-                  dir_x = -1;
-                  block_delta = -cBytesPerBlock*2;
-                  pBlock += (chunks_x - 1) * cBytesPerBlock * 2;
-               }
+            const bool skip_bottom_row = (y == (chunks_y - 1)) && (blocks_y & 1);
 
-               const bool skip_bottom_row = (y == (chunks_y - 1)) && (blocks_y & 1);
+            for (int32 x = start_x; x != end_x; x += dir_x)
+            {
+               uint32 alpha0_endpoints[4];
+               uint32 alpha1_endpoints[4];
 
-               for (int32 x = start_x; x != end_x; x += dir_x)
+               if (chunk_encoding_bits == 1)
                {
-                  uint32 alpha0_endpoints[4];
-                  uint32 alpha1_endpoints[4];
-
-                  if (chunk_encoding_bits == 1)
-                  {
-                     CRND_HUFF_DECODE(m_codec, m_chunk_encoding_dm, chunk_encoding_bits);
-                     chunk_encoding_bits |= 512;
-                  }
+                  CRND_HUFF_DECODE(codec, m_chunk_encoding_dm, chunk_encoding_bits);
+                  chunk_encoding_bits |= 512;
+               }
 
-                  const uint32 chunk_encoding_index = chunk_encoding_bits & 7;
-                  chunk_encoding_bits >>= 3;
+               const uint32 chunk_encoding_index = chunk_encoding_bits & 7;
+               chunk_encoding_bits >>= 3;
 
-                  const uint32 num_tiles = g_crnd_chunk_encoding_num_tiles[chunk_encoding_index];
+               const uint32 num_tiles = g_crnd_chunk_encoding_num_tiles[chunk_encoding_index];
 
-                  const uint8* pTile_indices = g_crnd_chunk_encoding_tiles[chunk_encoding_index].m_tiles;
+               const uint8* pTile_indices = g_crnd_chunk_encoding_tiles[chunk_encoding_index].m_tiles;
 
-                  const bool skip_right_col = (blocks_x & 1) && (x == ((int32)chunks_x - 1));
+               const bool skip_right_col = (blocks_x & 1) && (x == ((int32)chunks_x - 1));
 
-                  uint32* CRND_RESTRICT pD = (uint32*)pBlock;
+               uint32* CRND_RESTRICT pD = (uint32*)pBlock;
 
-                  for (uint32 i = 0; i < num_tiles; i++)
+               for (uint32 i = 0; i < num_tiles; i += 2)
+               {
+                  uint32 delta0, delta1;
+                  if ((i + 1) < num_tiles)
+                  {
+                     CRND_HUFF_DECODE_PAIR(codec, m_endpoint_delta_dm[1], delta0, delta1);
+                  }
+                  else
                   {
-                     uint32 delta; CRND_HUFF_DECODE(m_codec, m_endpoint_delta_dm[1], delta);
-                     prev_alpha0_endpoint_index += delta;
-                     limit(prev_alpha0_endpoint_index, num_alpha_endpoints);
-                     alpha0_endpoints[i] = m_alpha_endpoints[prev_alpha0_endpoint_index];
+                     CRND_HUFF_DECODE(codec, m_endpoint_delta_dm[1], delta0);
+                     delta1 = 0;
                   }
+                  prev_alpha0_endpoint_index += delta0;
+                  limit(prev_alpha0_endpoint_index, num_alpha_endpoints);
+                  alpha0_endpoints[i] = pal.m_pAlpha_endpoints[prev_alpha0_endpoint_index];
+                  prev_alpha0_endpoint_index += delta1;
+                  limit(prev_alpha0_endpoint_index, num_alpha_endpoints);
+                  alpha0_endpoints[i + 1] = pal.m_pAlpha_endpoints[prev_alpha0_endpoint_index];
+               }
 
-                  for (uint32 i = 0; i < num_tiles; i++)
+               for (uint32 i = 0; i < num_tiles; i += 2)
+               {
+                  uint32 delta0, delta1;
+                  if ((i + 1) < num_tiles)
                   {
-                     uint32 delta; CRND_HUFF_DECODE(m_codec, m_endpoint_delta_dm[1], delta);
-                     prev_alpha1_endpoint_index += delta;
-                     limit(prev_alpha1_endpoint_index, num_alpha_endpoints);
-                     alpha1_endpoints[i] = m_alpha_endpoints[prev_alpha1_endpoint_index];
+                     CRND_HUFF_DECODE_PAIR(codec, m_endpoint_delta_dm[1], delta0, delta1);
                   }
+                  else
+                  {
+                     CRND_HUFF_DECODE(codec, m_endpoint_delta_dm[1], delta0);
+                     delta1 = 0;
+                  }
+                  prev_alpha1_endpoint_index += delta0;
+                  limit(prev_alpha1_endpoint_index, num_alpha_endpoints);
+                  alpha1_endpoints[i] = pal.m_pAlpha_endpoints[prev_alpha1_endpoint_index];
+                  prev_alpha1_endpoint_index += delta1;
+                  limit(prev_alpha1_endpoint_index, num_alpha_endpoints);
+                  alpha1_endpoints[i + 1] = pal.m_pAlpha_endpoints[prev_alpha1_endpoint_index];
+               }
 
-                  pD = (uint32*)pBlock;
-                  for (uint32 by = 0; by < 2; by++)
+               pD = (uint32*)pBlock;
+               for (uint32 by = 0; by < 2; by++)
+               {
+                  for (uint32 bx = 0; bx < 2; bx++, pD += 4)
                   {
-                     for (uint32 bx = 0; bx < 2; bx++, pD += 4)
-                     {
-                        uint32 delta0; CRND_HUFF_DECODE(m_codec, m_selector_delta_dm[1], delta0);
-                        prev_alpha0_selector_index += delta0;
-                        limit(prev_alpha0_selector_index, num_alpha_selectors);
+                     uint32 delta0, delta1; CRND_HUFF_DECODE_PAIR(codec, m_selector_delta_dm[1], delta0, delta1);
+                     prev_alpha0_selector_index += delta0;
+                     limit(prev_alpha0_selector_index, num_alpha_selectors);
 
-                        uint32 delta1; CRND_HUFF_DECODE(m_codec, m_selector_delta_dm[1], delta1);
-                        prev_alpha1_selector_index += delta1;
-                        limit(prev_alpha1_selector_index, num_alpha_selectors);
+                     prev_alpha1_selector_index += delta1;
+                     limit(prev_alpha1_selector_index, num_alpha_selectors);
 
-                        if (!((bx && skip_right_col) || (by && skip_bottom_row)))
-                        {
-                           const uint32 tile_index = pTile_indices[bx + by * 2];
-                           const uint16* pAlpha0_selectors = &m_alpha_selectors[prev_alpha0_selector_index * 3];
-                           const uint16* pAlpha1_selectors = &m_alpha_selectors[prev_alpha1_selector_index * 3];
+                     if (!((bx && skip_right_col) || (by && skip_bottom_row)))
+                     {
+                        const uint32 tile_index = pTile_indices[bx + by * 2];
+                        const uint16* pAlpha0_selectors = &pal.m_pAlpha_selectors[prev_alpha0_selector_index * 3];
+                        const uint16* pAlpha1_selectors = &pal.m_pAlpha_selectors[prev_alpha1_selector_index * 3];
 
 #ifdef CRND_BIG_ENDIAN_PLATFORM
-                           pD[0] = (alpha0_endpoints[tile_index] << 16) | pAlpha0_selectors[0];
-                           CRND_WRITE_BARRIER
-                           pD[1] = (pAlpha0_selectors[1] << 16) | pAlpha0_selectors[2];
-                           CRND_WRITE_BARRIER
-                           pD[2] = (alpha1_endpoints[tile_index] << 16) | pAlpha1_selectors[0];
-                           CRND_WRITE_BARRIER
-                           pD[3] = (pAlpha1_selectors[1] << 16) | pAlpha1_selectors[2];
-                           CRND_WRITE_BARRIER
+                        pD[0] = (alpha0_endpoints[tile_index] << 16) | pAlpha0_selectors[0];
+                        CRND_WRITE_BARRIER
+                        pD[1] = (pAlpha0_selectors[1] << 16) | pAlpha0_selectors[2];
+                        CRND_WRITE_BARRIER
+                        pD[2] = (alpha1_endpoints[tile_index] << 16) | pAlpha1_selectors[0];
+                        CRND_WRITE_BARRIER
+                        pD[3] = (pAlpha1_selectors[1] << 16) | pAlpha1_selectors[2];
+                        CRND_WRITE_BARRIER
 #else
-                           pD[0] = alpha0_endpoints[tile_index] | (pAlpha0_selectors[0] << 16);
-                           CRND_WRITE_BARRIER
-                           pD[1] = pAlpha0_selectors[1] | (pAlpha0_selectors[2] << 16);
-                           CRND_WRITE_BARRIER
-                           pD[2] = alpha1_endpoints[tile_index] | (pAlpha1_selectors[0] << 16);
-                           CRND_WRITE_BARRIER
-                           pD[3] = pAlpha1_selectors[1] | (pAlpha1_selectors[2] << 16);
-                           CRND_WRITE_BARRIER
+                        pD[0] = alpha0_endpoints[tile_index] | (pAlpha0_selectors[0] << 16);
+                        CRND_WRITE_BARRIER
+                        pD[1] = pAlpha0_selectors[1] | (pAlpha0_selectors[2] << 16);
+                        CRND_WRITE_BARRIER
+                        pD[2] = alpha1_endpoints[tile_index] | (pAlpha1_selectors[0] << 16);
+                        CRND_WRITE_BARRIER
+                        pD[3] = pAlpha1_selectors[1] | (pAlpha1_selectors[2] << 16);
+                        CRND_WRITE_BARRIER
 #endif
-                        }
                      }
-
-                     pD = (uint32*)((uint8*)pD - cBytesPerBlock * 2 + row_pitch_in_bytes);
                   }
 
-                  pBlock += block_delta;
+                  pD = (uint32*)((uint8*)pD - cBytesPerBlock * 2 + row_pitch_in_bytes);
+               }
 
-               } // x
+               pBlock += block_delta;
 
-               pRow += row_pitch_in_bytes * 2;
+            } // x
 
-            } // y
+            pRow += row_pitch_in_bytes * 2;
 
-         } // f
+         } // y
 
-         CRND_HUFF_DECODE_END(m_codec);
+         CRND_HUFF_DECODE_END(codec);
+
+         state.m_chunk_encoding_bits = chunk_encoding_bits;
+         state.m_prev_endpoint_index[0] = prev_alpha0_endpoint_index;
+         state.m_prev_selector_index[0] = prev_alpha0_selector_index;
+         state.m_prev_endpoint_index[1] = prev_alpha1_endpoint_index;
+         state.m_prev_selector_index[1] = prev_alpha1_selector_index;
 
          return true;
       }
 
-      bool unpack_dxt5a(uint8** pDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes, uint32 blocks_x, uint32 blocks_y, uint32 chunks_x, uint32 chunks_y)
+      bool unpack_dxt5a(symbol_codec& codec, unpack_state& state, const palette_set& pal, uint8* pDst, uint32 row_pitch_in_bytes, uint32 blocks_x, uint32 blocks_y, uint32 chunks_x, uint32 chunks_y, uint32 first_chunk_y, uint32 end_chunk_y)
       {
-         dst_size_in_bytes;
-
-         uint32 chunk_encoding_bits = 1;
+         uint32 chunk_encoding_bits = state.m_chunk_encoding_bits;
 
          const uint32 num_alpha_endpoints = m_alpha_endpoints.size();
          const uint32 num_alpha_selectors = m_pHeader->m_alpha_selectors.m_num;
 
-         uint32 prev_alpha0_endpoint_index = 0;
-         uint32 prev_alpha0_selector_index = 0;
-
-         const uint32 num_faces = m_pHeader->m_faces;
+         uint32 prev_alpha0_endpoint_index = state.m_prev_endpoint_index[0];
+         uint32 prev_alpha0_selector_index = state.m_prev_selector_index[0];
 
          const int32 cBytesPerBlock = 8;
 
-         CRND_HUFF_DECODE_BEGIN(m_codec);
+         CRND_HUFF_DECODE_BEGIN(codec);
 
-         for (uint32 f = 0; f < num_faces; f++)
+         uint8* CRND_RESTRICT pRow = pDst;
+
+         for (uint32 y = first_chunk_y; y < end_chunk_y; y++)
          {
-            uint8* CRND_RESTRICT pRow = pDst[f];
+            int32 start_x = 0;
+            int32 end_x = chunks_x;
+            int32 dir_x = 1;
+            int32 block_delta = cBytesPerBlock*2;
+            uint8* CRND_RESTRICT pBlock = pRow;
 
-            for (uint32 y = 0; y < chunks_y; y++)
+            if (y & 1)
             {
-               int32 start_x = 0;
-               int32 end_x = chunks_x;
-               int32 dir_x = 1;
-               int32 block_delta = cBytesPerBlock*2;
-               uint8* CRND_RESTRICT pBlock = pRow;
+               start_x = chunks_x - 1;
+               end_x = -1;
+               dir_x = -1;
+               block_delta = -cBytesPerBlock*2;
+               pBlock += (chunks_x - 1) * cBytesPerBlock * 2;
+            }
 
-               if (y & 1)
-               {
-                  start_x = chunks_x - 1;
-                  end_x = -1;
-                  dir_x = -1;
-                  block_delta = -cBytesPerBlock*2;
-                  pBlock += (chunks_x - 1) * cBytesPerBlock * 2;
-               }
+            const bool skip_bottom_row = (y == (chunks_y - 1)) && (blocks_y & 1);
 
-               const bool skip_bottom_row = (y == (chunks_y - 1)) && (blocks_y & 1);
+            for (int32 x = start_x; x != end_x; x += dir_x)
+            {
+               uint32 alpha0_endpoints[4];
 
-               for (int32 x = start_x; x != end_x; x += dir_x)
+               if (chunk_encoding_bits == 1)
                {
-                  uint32 alpha0_endpoints[4];
-
-                  if (chunk_encoding_bits == 1)
-                  {
-                     CRND_HUFF_DECODE(m_codec, m_chunk_encoding_dm, chunk_encoding_bits);
-                     chunk_encoding_bits |= 512;
-                  }
+                  CRND_HUFF_DECODE(codec, m_chunk_encoding_dm, chunk_encoding_bits);
+                  chunk_encoding_bits |= 512;
+               }
 
-                  const uint32 chunk_encoding_index = chunk_encoding_bits & 7;
-                  chunk_encoding_bits >>= 3;
+               const uint32 chunk_encoding_index = chunk_encoding_bits & 7;
+               chunk_encoding_bits >>= 3;
 
-                  const uint32 num_tiles = g_crnd_chunk_encoding_num_tiles[chunk_encoding_index];
+               const uint32 num_tiles = g_crnd_chunk_encoding_num_tiles[chunk_encoding_index];
 
-                  const uint8* pTile_indices = g_crnd_chunk_encoding_tiles[chunk_encoding_index].m_tiles;
+               const uint8* pTile_indices = g_crnd_chunk_encoding_tiles[chunk_encoding_index].m_tiles;
 
-                  const bool skip_right_col = (blocks_x & 1) && (x == ((int32)chunks_x - 1));
+               const bool skip_right_col = (blocks_x & 1) && (x == ((int32)chunks_x - 1));
 
-                  uint32* CRND_RESTRICT pD = (uint32*)pBlock;
+               uint32* CRND_RESTRICT pD = (uint32*)pBlock;
 
-                  for (uint32 i = 0; i < num_tiles; i++)
+               for (uint32 i = 0; i < num_tiles; i += 2)
+               {
+                  uint32 delta0, delta1;
+                  if ((i + 1) < num_tiles)
+                  {
+                     CRND_HUFF_DECODE_PAIR(codec, m_endpoint_delta_dm[1], delta0, delta1);
+                  }
+                  else
                   {
-                     uint32 delta; CRND_HUFF_DECODE(m_codec, m_endpoint_delta_dm[1], delta);
-                     prev_alpha0_endpoint_index += delta;
-                     limit(prev_alpha0_endpoint_index, num_alpha_endpoints);
-                     alpha0_endpoints[i] = m_alpha_endpoints[prev_alpha0_endpoint_index];
+                     CRND_HUFF_DECODE(codec, m_endpoint_delta_dm[1], delta0);
+                     delta1 = 0;
                   }
+                  prev_alpha0_endpoint_index += delta0;
+                  limit(prev_alpha0_endpoint_index, num_alpha_endpoints);
+                  alpha0_endpoints[i] = pal.m_pAlpha_endpoints[prev_alpha0_endpoint_index];
+                  prev_alpha0_endpoint_index += delta1;
+                  limit(prev_alpha0_endpoint_index, num_alpha_endpoints);
+                  alpha0_endpoints[i + 1] = pal.m_pAlpha_endpoints[prev_alpha0_endpoint_index];
+               }
 
-                  pD = (uint32*)pBlock;
-                  for (uint32 by = 0; by < 2; by++)
+               pD = (uint32*)pBlock;
+               for (uint32 by = 0; by < 2; by++)
+               {
+                  uint32 deltas[2]; CRND_HUFF_DECODE_PAIR(codec, m_selector_delta_dm[1], deltas[0], deltas[1]);
+
+                  for (uint32 bx = 0; bx < 2; bx++, pD += 2)
                   {
-                     for (uint32 bx = 0; bx < 2; bx++, pD += 2)
-                     {
-                        uint32 delta; CRND_HUFF_DECODE(m_codec, m_selector_delta_dm[1], delta);
-                        prev_alpha0_selector_index += delta;
-                        limit(prev_alpha0_selector_index, num_alpha_selectors);
+                     prev_alpha0_selector_index += deltas[bx];
+                     limit(prev_alpha0_selector_index, num_alpha_selectors);
 
-                        if (!((bx && skip_right_col) || (by && skip_bottom_row)))
-                        {
-                           const uint32 tile_index = pTile_indices[bx + by * 2];
-                           const uint16* pAlpha0_selectors = &m_alpha_selectors[prev_alpha0_selector_index * 3];
+                     if (!((bx && skip_right_col) || (by && skip_bottom_row)))
+                     {
+                        const uint32 tile_index = pTile_indices[bx + by * 2];
+                        const uint16* pAlpha0_selectors = &pal.m_pAlpha_selectors[prev_alpha0_selector_index * 3];
 
 #if CRND_BIG_ENDIAN_PLATFORM
-                           pD[0] = (alpha0_endpoints[tile_index] << 16) | pAlpha0_selectors[0];
-                           CRND_WRITE_BARRIER
-                           pD[1] = (pAlpha0_selectors[1] << 16) | pAlpha0_selectors[2];
-                           CRND_WRITE_BARRIER
+                        pD[0] = (alpha0_endpoints[tile_index] << 16) | pAlpha0_selectors[0];
+                        CRND_WRITE_BARRIER
+                        pD[1] = (pAlpha0_selectors[1] << 16) | pAlpha0_selectors[2];
+                        CRND_WRITE_BARRIER
 #else
-                           pD[0] = alpha0_endpoints[tile_index] | (pAlpha0_selectors[0] << 16);
-                           CRND_WRITE_BARRIER
-                           pD[1] = pAlpha0_selectors[1] | (pAlpha0_selectors[2] << 16);
-                           CRND_WRITE_BARRIER
+                        pD[0] = alpha0_endpoints[tile_index] | (pAlpha0_selectors[0] << 16);
+                        CRND_WRITE_BARRIER
+                        pD[1] = pAlpha0_selectors[1] | (pAlpha0_selectors[2] << 16);
+                        CRND_WRITE_BARRIER
 #endif
-                        }
                      }
-
-                     pD = (uint32*)((uint8*)pD - cBytesPerBlock * 2 + row_pitch_in_bytes);
                   }
 
-                  pBlock += block_delta;
+                  pD = (uint32*)((uint8*)pD - cBytesPerBlock * 2 + row_pitch_in_bytes);
+               }
 
-               } // x
+               pBlock += block_delta;
 
-               pRow += row_pitch_in_bytes * 2;
+            } // x
 
-            } // y
+            pRow += row_pitch_in_bytes * 2;
 
-         } // f
+         } // y
 
-         CRND_HUFF_DECODE_END(m_codec);
+         CRND_HUFF_DECODE_END(codec);
+
+         state.m_chunk_encoding_bits = chunk_encoding_bits;
+         state.m_prev_endpoint_index[0] = prev_alpha0_endpoint_index;
+         state.m_prev_selector_index[0] = prev_alpha0_selector_index;
 
          return true;
       }
@@ -4791,6 +5765,69 @@ namespace crnd
       return pUnpacker->unpack_level(pSrc, src_size_in_bytes, pDst, dst_size_in_bytes, row_pitch_in_bytes, level_index);
    }
 
+   bool crnd_unpack_region(
+      crnd_unpack_context pContext,
+      void* pDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes,
+      uint32 level_index, uint32 face_index,
+      uint32 block_x, uint32 block_y, uint32 blocks_w, uint32 blocks_h)
+   {
+      if ((!pContext) || (!pDst) || (level_index >= cCRNMaxLevels) || (face_index >= cCRNMaxFaces))
+         return false;
+
+      crn_unpacker* pUnpacker = static_cast<crn_unpacker*>(pContext);
+
+      if (!pUnpacker->is_valid())
+         return false;
+
+      return pUnpacker->unpack_region(pDst, dst_size_in_bytes, row_pitch_in_bytes, level_index, face_index, block_x, block_y, blocks_w, blocks_h);
+   }
+
+   bool crnd_unpack_level_rgba(
+      crnd_unpack_context pContext,
+      void** ppDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes,
+      uint32 level_index)
+   {
+      if ((!pContext) || (!ppDst) || (level_index >= cCRNMaxLevels))
+         return false;
+
+      crn_unpacker* pUnpacker = static_cast<crn_unpacker*>(pContext);
+
+      if (!pUnpacker->is_valid())
+         return false;
+
+      return pUnpacker->unpack_level_rgba(ppDst, dst_size_in_bytes, row_pitch_in_bytes, level_index);
+   }
+
+   bool crnd_get_palettes(crnd_unpack_context pContext, crn_unpacked_palettes* pPalettes)
+   {
+      if ((!pContext) || (!pPalettes))
+         return false;
+
+      crn_unpacker* pUnpacker = static_cast<crn_unpacker*>(pContext);
+
+      if (!pUnpacker->is_valid())
+         return false;
+
+      pUnpacker->get_palettes(*pPalettes);
+      return true;
+   }
+
+   bool crnd_unpack_level_indices(
+      crnd_unpack_context pContext,
+      void** ppDst, uint32 dst_size_in_bytes, uint32 row_pitch_in_bytes,
+      uint32 level_index)
+   {
+      if ((!pContext) || (!ppDst) || (dst_size_in_bytes < 8U) || (level_index >= cCRNMaxLevels))
+         return false;
+
+      crn_unpacker* pUnpacker = static_cast<crn_unpacker*>(pContext);
+
+      if (!pUnpacker->is_valid())
+         return false;
+
+      return pUnpacker->unpack_level_indices(ppDst, dst_size_in_bytes, row_pitch_in_bytes, level_index);
+   }
+
    bool crnd_unpack_end(crnd_unpack_context pContext)
    {
       if (!pContext)
@@ -81,8 +81,9 @@ enum crn_format
 // Various library/file format limits.
 enum crn_limits
 {
-   // Max. mipmap level resolution on any axis.
-   cCRNMaxLevelResolution     = 4096,
+   // Max. mipmap level resolution on any axis. The .CRN header stores each dimension in 16 bits, so this only limits the
+   // compressor and the transcoder's validation. Older transcoders reject .CRN files larger than 4096 on either axis.
+   cCRNMaxLevelResolution     = 16384,
 
    cCRNMinPaletteSize         = 8,
    cCRNMaxPaletteSize         = 8192,
@@ -90,12 +91,27 @@ enum crn_limits
    cCRNMaxFaces               = 6,
    cCRNMaxLevels              = 16,
 
-   cCRNMaxHelperThreads       = 16,
+   // Sanity limit on the number of helper threads, not a tuning parameter.
+   cCRNMaxHelperThreads       = 1024,
+
+   // Max. distance between restart points, in chunk rows.
+   cCRNMaxRestartInterval     = cCRNMaxLevelResolution / 8,
+
+   // LZMA settings used to measure the effective bitrate of DDS files.
+   cCRNMaxLZMALevel           = 9,
+   cCRNMinLZMADictSize        = 4096,
+   cCRNMaxLZMADictSize        = 128 * 1024 * 1024,
 
    cCRNMinQualityLevel        = 0,
    cCRNMaxQualityLevel        = 255
 };
 
+// Special value for crn_comp_params::m_num_helper_threads: create one helper thread per processor beyond the first.
+enum crn_helper_threads
+{
+   cCRNHelperThreadsAuto      = 0xFFFFFFFF
+};
+
 // CRN/DDS compression flags.
 // See the m_flags member in the crn_comp_params struct, below.
 enum crn_comp_flags
@@ -146,6 +162,11 @@ enum crn_comp_flags
    // Default: Not set.
    cCRNCompFlagGrayscaleSampling = 256,
 
+   // If enabled, the target bitrate search compresses several quality levels at once, each on its own share of the helper threads.
+   // It needs fewer steps than the serial search, so with 4 or more threads it's usually several times faster. The selected quality level may differ slightly.
+   // Default: Not set.
+   cCRNCompFlagParallelBitrateSearch = 512,
+
    // If enabled, debug information will be output during compression.
    // Default: Not set.
    cCRNCompFlagDebugging = 0x80000000,
@@ -227,6 +248,11 @@ struct crn_comp_params
       m_crn_color_selector_palette_size = 0;
       m_crn_alpha_endpoint_palette_size = 0;
       m_crn_alpha_selector_palette_size = 0;
+      m_crn_restart_interval = 0;
+      m_pCRN_reference = NULL;
+      m_crn_reference_size = 0;
+      m_lzma_level = 5;
+      m_lzma_dict_size = 0;
 
       m_num_helper_threads = 0;
       m_userdata0 = 0;
@@ -258,6 +284,11 @@ struct crn_comp_params
       CRNLIB_COMP(m_crn_color_selector_palette_size);
       CRNLIB_COMP(m_crn_alpha_endpoint_palette_size);
       CRNLIB_COMP(m_crn_alpha_selector_palette_size);
+      CRNLIB_COMP(m_crn_restart_interval);
+      CRNLIB_COMP(m_pCRN_reference);
+      CRNLIB_COMP(m_crn_reference_size);
+      CRNLIB_COMP(m_lzma_level);
+      CRNLIB_COMP(m_lzma_dict_size);
       CRNLIB_COMP(m_num_helper_threads);
       CRNLIB_COMP(m_userdata0);
       CRNLIB_COMP(m_userdata1);
@@ -287,8 +318,12 @@ struct crn_comp_params
          ((m_crn_color_selector_palette_size) && ((m_crn_color_selector_palette_size < cCRNMinPaletteSize) || (m_crn_color_selector_palette_size > cCRNMaxPaletteSize))) ||
          ((m_crn_alpha_endpoint_palette_size) && ((m_crn_alpha_endpoint_palette_size < cCRNMinPaletteSize) || (m_crn_alpha_endpoint_palette_size > cCRNMaxPaletteSize))) ||
          ((m_crn_alpha_selector_palette_size) && ((m_crn_alpha_selector_palette_size < cCRNMinPaletteSize) || (m_crn_alpha_selector_palette_size > cCRNMaxPaletteSize))) ||
+         (m_crn_restart_interval > cCRNMaxRestartInterval) ||
+         ((m_pCRN_reference != NULL) != (m_crn_reference_size != 0)) ||
+         (m_lzma_level > cCRNMaxLZMALevel) ||
+         ((m_lzma_dict_size) && ((m_lzma_dict_size < cCRNMinLZMADictSize) || (m_lzma_dict_size > cCRNMaxLZMADictSize))) ||
          (m_alpha_component > 3) ||
-         (m_num_helper_threads > cCRNMaxHelperThreads) ||
+         ((m_num_helper_threads > cCRNMaxHelperThreads) && (m_num_helper_threads != cCRNHelperThreadsAuto)) ||
          (m_dxt_quality > cCRNDXTQualityUber) ||
          (m_dxt_compressor_type >= cCRNTotalDXTCompressors) )
       {
@@ -344,7 +379,24 @@ struct crn_comp_params
    crn_uint32                 m_crn_alpha_endpoint_palette_size;  // [cCRNMinPaletteSize,cCRNMaxPaletteSize]
    crn_uint32                 m_crn_alpha_selector_palette_size;  // [cCRNMinPaletteSize,cCRNMaxPaletteSize]
 
-   // Number of helper threads to create during compression. 0=no threading.
+   // If non-zero, the CRN encoder stores a restart point every m_crn_restart_interval chunk rows (1 chunk row=8 pixel rows) of each level,
+   // which allows crnd_unpack_region() to begin decoding near the requested blocks instead of at the top of the level.
+   // The interval is automatically increased if the restart points don't fit in the file's tables section. 0=disabled.
+   crn_uint32                 m_crn_restart_interval;             // [0,cCRNMaxRestartInterval]
+
+   // Optional CRN file previously compressed from (an older version of) the same texture. If set, the CRN encoder reuses its palettes and
+   // only requantizes the chunks that changed, which is much faster than a full compression. The quality level, target bitrate and palette
+   // sizes are ignored then. Falls back to a full compression if the reference's dimensions, level count, face count or format don't match,
+   // or if the palettes no longer fit the texture well. DXTn formats only. Must remain valid until the compressor returns.
+   const void*                m_pCRN_reference;
+   crn_uint32                 m_crn_reference_size;
+
+   // LZMA settings used to measure the effective bitrate of DDS files (their size after LZMA compression), which m_target_bitrate targets.
+   // Higher levels compress better but slow down the search. 0 for the dictionary size uses the level's default (16MB at level 5).
+   crn_uint32                 m_lzma_level;                       // [0,cCRNMaxLZMALevel], default 5
+   crn_uint32                 m_lzma_dict_size;                   // 0, or [cCRNMinLZMADictSize,cCRNMaxLZMADictSize] bytes
+
+   // Number of helper threads to create during compression. 0=no threading, cCRNHelperThreadsAuto=one per additional processor.
    crn_uint32                 m_num_helper_threads;
 
    // CRN userdata0 and userdata1 members, which are written directly to the header of the output file.
@@ -536,6 +588,38 @@ void *crn_compress(const crn_comp_params &comp_params, crn_uint32 &compressed_si
 // Be sure to set the "m_gamma_filtering" member of crn_mipmap_params to false if the input texture is not sRGB.
 void *crn_compress(const crn_comp_params &comp_params, const crn_mipmap_params &mip_params, crn_uint32 &compressed_size, crn_uint32 *pActual_quality_level = NULL, float *pActual_bitrate = NULL);
 
+// Compresses the same texture once for each of the num_quality_levels entries in pQuality_levels (comp_params.m_quality_level and m_target_bitrate are ignored).
+// Work that doesn't depend on the quality level, such as splitting the images into chunks and picking each chunk's tile layout, is only done once
+// instead of once per quality level. The endpoint and selector clustering still runs for every level and dominates the time, so the saving is
+// modest: 4 quality levels took about 4-9% less time than 4 calls to crn_compress().
+// On success, ppCompressed_data[i] and pCompressed_sizes[i] are set to each output file. Each returned block must be freed by calling crn_free_block().
+bool crn_compress_quality_levels(const crn_comp_params &comp_params, const crn_uint32 *pQuality_levels, crn_uint32 num_quality_levels, void **ppCompressed_data, crn_uint32 *pCompressed_sizes);
+
+// -------- Batch compression API
+
+// When compressing many small textures, starting and stopping crn_compress()'s helper threads for each texture can take longer than the compression itself.
+// A batch compressor owns a pool of helper threads for its whole lifetime, and compresses its queued textures concurrently, each one on a single thread.
+// The output files are identical to crn_compress()'s.
+typedef void *crn_compressor_context_t;
+
+// Creates a batch compressor using num_helper_threads helper threads (or cCRNHelperThreadsAuto). Returns NULL on failure.
+crn_compressor_context_t crn_create_compressor(crn_uint32 num_helper_threads = cCRNHelperThreadsAuto);
+
+// Queues a texture for compression by the next crn_compressor_flush(). comp_params.m_num_helper_threads is ignored.
+// pMip_params may be NULL, which compresses the images like crn_compress(comp_params, ...) does, otherwise like crn_compress(comp_params, *pMip_params, ...).
+// The params are copied, but the images they point to must remain valid until crn_compressor_flush() returns.
+// The progress callback (if any) may be called from any of the helper threads.
+// Returns false if the params are invalid.
+bool crn_compressor_add(crn_compressor_context_t pContext, const crn_comp_params &comp_params, const crn_mipmap_params *pMip_params, void **ppCompressed_data, crn_uint32 *pCompressed_size);
+
+// Compresses all the queued textures and empties the queue.
+// Each texture's *ppCompressed_data and *pCompressed_size are set to its output file, which must be freed by calling crn_free_block(), or to NULL and 0 if it failed.
+// Returns false if any texture failed.
+bool crn_compressor_flush(crn_compressor_context_t pContext);
+
+// Frees a batch compressor, discarding any textures that haven't been flushed.
+void crn_free_compressor(crn_compressor_context_t pContext);
+
 // Transcodes an entire CRN file to DDS using the crn_decomp.h header file library to do most of the heavy lifting.
 // The output DDS file's format is guaranteed to be one of the DXTn formats in the crn_format enum.
 // This is a fast operation, because the CRN format is explicitly designed to be efficiently transcodable to DXTn.